@@ -0,0 +1,163 @@
+/**
+ * Battery node example for ESP32: deep sleep between the changes of the
+ * calendar instead of a one-minute polling loop.
+ *
+ * Each wake-up is a fresh boot. The session, the calendar id and the events of
+ * the next hours are kept in RTC memory (SleepState); the node only brings
+ * WiFi up when the timeline is due for a reload, and otherwise sets its output
+ * from the timeline and goes back to sleep until the next event starts or
+ * ends. The refresh_token stays in NVS, as in examples/wifi_persistent_esp32.
+ *
+ * Pairing and the first calendar lookup happen on the first boot (or after a
+ * power loss, which clears RTC memory); see wifi_persistent_esp32 for the
+ * re-pairing policy, left out here.
+ */
+
+#include <WiFi.h>
+#include <WiFiUdp.h>
+#include <Preferences.h>
+
+#include <TimestampNtp.hpp>
+#include <GoogleSchedular.hpp>
+
+
+#define STASSID "**** SSID ****"
+#define STAPSK  "***password***"
+
+#define OUTPUT_PIN 4
+
+const String GOOGLE_API_CLIENT_ID     = "**** CLIENT_ID ****";
+const String GOOGLE_API_CLIENT_SECRET = "**** CLIENT_SECRET ****";
+
+const unsigned int LOCAL_PORT    = 3669;
+const char*        NTP_HOST      = "2.europe.pool.ntp.org";
+const String       CALENDAR_NAME = "ArduinoRelay";
+const uint32_t     HORIZON       = 6 * 3600;    // one load every 6 hours
+
+const char* NVS_NAMESPACE = "gcal";
+const char* NVS_KEY       = "rt";
+
+
+RTC_DATA_ATTR SleepState sleepState;
+
+TimestampNtp<WiFiUDP> ntp;
+GoogleSchedular gs(GOOGLE_API_CLIENT_ID, GOOGLE_API_CLIENT_SECRET, &ntp);
+EventTimeline timeline(HORIZON);
+Preferences prefs;
+
+
+String loadToken()
+{
+    prefs.begin(NVS_NAMESPACE, /*readOnly=*/true);
+    const String t = prefs.getString(NVS_KEY, "");
+    prefs.end();
+    return t;
+}
+
+void saveToken(const String& t)
+{
+    if (t.length() == 0 || t == loadToken()) {
+        return;
+    }
+    prefs.begin(NVS_NAMESPACE, /*readOnly=*/false);
+    prefs.putString(NVS_KEY, t);
+    prefs.end();
+}
+
+// WiFi and NTP; false if either is not there within a few seconds.
+bool goOnline()
+{
+    WiFi.mode(WIFI_STA);
+    WiFi.begin(STASSID, STAPSK);
+    const unsigned long t0 = millis();
+    while (WiFi.status() != WL_CONNECTED) {
+        if (millis() - t0 > 10000) {
+            return false;
+        }
+        delay(100);
+    }
+    ntp.begin(LOCAL_PORT);
+    ntp.request(NTP_HOST);
+    const unsigned long t1 = millis();
+    while (!ntp.listenSync()) {
+        if (millis() - t1 > 3000) {
+            return false;
+        }
+        delay(10);
+    }
+    return true;
+}
+
+void pair()
+{
+    String url, code;
+    gs.startRegistration(url, code);
+    Serial.print("Pair at "); Serial.print(url);
+    Serial.print(" with code "); Serial.println(code);
+    while (gs.isInitialized()) {
+        delay(2000);
+        ntp.listen();
+        gs.maintain();
+    }
+    saveToken(gs.getRefreshToken());
+}
+
+// The output keeps its level through the sleep.
+void sleepFor(const uint32_t seconds)
+{
+    gpio_hold_en(static_cast<gpio_num_t>(OUTPUT_PIN));
+    gpio_deep_sleep_hold_en();
+    WiFi.disconnect(true);
+    esp_sleep_enable_timer_wakeup(static_cast<uint64_t>(seconds) * 1000000ULL);
+    esp_deep_sleep_start();
+}
+
+
+void setup()
+{
+    gpio_hold_dis(static_cast<gpio_num_t>(OUTPUT_PIN));
+    pinMode(OUTPUT_PIN, OUTPUT);
+    Serial.begin(115200);
+
+    gs.setTimeline(&timeline);
+    const String rt = loadToken();
+    if (rt.length()) {
+        gs.setRefreshToken(rt);
+    }
+
+    // The RTC timer drifts a little over a sleep: good enough between two
+    // loads, which set the clock again.
+    uint32_t now = sleepState.wakeAt;
+    if (!gs.resume(sleepState) || gs.needsRequest(now)) {
+        if (!goOnline()) {
+            digitalWrite(OUTPUT_PIN, LOW);
+            sleepFor(300);                  // retry in 5 minutes
+        }
+        int32_t t, offset;
+        bool allDay;
+        CivilTime::parseRfc3339(ntp.c_str(), t, offset, allDay);
+        now = static_cast<uint32_t>(t);
+
+        if (rt.length() == 0) {
+            pair();
+        }
+        gs.maintain();
+        if (!gs.isLinked()) {
+            gs.setCalendar(CALENDAR_NAME);
+        }
+    }
+
+    char ts[21];
+    CivilTime::formatRfc3339(static_cast<int32_t>(now), ts);
+    if (gs.syncAt(ts)) {
+        digitalWrite(OUTPUT_PIN, gs.getEventList().empty() ? LOW : HIGH);
+    } else {
+        digitalWrite(OUTPUT_PIN, LOW);
+    }
+
+    sleepFor(gs.suspend(sleepState, now));
+}
+
+void loop()
+{
+}
@@ -52,6 +52,9 @@
 #include <FastTimer.hpp>
 #include <TimestampNtp.hpp>
 
+// Uncomment to compile the request counters and latency histograms in
+// (see SchedularStats.hpp); without it they cost nothing.
+//#define SCHEDULAR_STATS
 #include <GoogleSchedular.hpp>
 
 
@@ -116,6 +119,10 @@ void setup()
         Serial.println(ts);
     }
     
+    // Optional: ask Google for 512-byte TLS records to shrink the TLS buffers.
+    // Each host is probed on its first request; see SchedularTransport.hpp.
+    //SchedularTransport::shared().setTlsProfile(SchedularTransport::TLS_512);
+
     Serial.println("+-- GOOGLE ---");
     {
         Serial.println("|- starting registration");
@@ -180,7 +187,7 @@ void setup()
             ntp.syncRFC3339();
             const char* ts = ntp.c_str(); // zero-copy, no heap allocation
             gs.syncAt(ts);
-            for(String e : gs.getEventList()) {
+            for(const String& e : gs.getEventList()) {
                 Serial.println("|- " + e);
             }
             Serial.println("+-----------");
@@ -209,12 +216,22 @@ void loop()
         Serial.print("-- ");
         Serial.println(ts);
         gs.syncAt(ts);
-        for(String e : gs.getEventList()) {
+        for(const String& e : gs.getEventList()) {
             Serial.println("- " + e);
         }
 
         Serial.println("----------");
         Serial.printf("[HW] Free heap: %d bytes\n", ESP.getFreeHeap());
+#ifdef SCHEDULAR_STATS
+        {
+            const SchedularStats& st = gs.stats();
+            const SchedularStats::Histogram& total = st.phase(SchedularStats::PHASE_TOTAL);
+            Serial.printf("[GS] %u requests, p50 < %u us, max %u us\n",
+                (unsigned) total.count, (unsigned) total.percentileUs(50), (unsigned) total.maxUs);
+            Serial.printf("[GS] %u bytes in, %u TLS handshakes, heap low-water %u bytes\n",
+                (unsigned) st.bytesReceived, (unsigned) st.tlsHandshakes, (unsigned) st.heapLowWater);
+        }
+#endif
         Serial.println("----------");
         Serial.flush();
 
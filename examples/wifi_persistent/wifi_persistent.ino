@@ -211,7 +211,7 @@ void loop()
     if (gs.syncAt(ntp.c_str())) {
         const bool active = !gs.getEventList().empty();
         digitalWrite(LED_BUILTIN, active ? LOW : HIGH);   // active-low: LOW == on
-        for (String e : gs.getEventList()) {
+        for (const String& e : gs.getEventList()) {
             Serial.println("- " + e);
         }
     } else {
@@ -194,7 +194,7 @@ void loop()
     if (gs.syncAt(ntp.c_str())) {
         const bool active = !gs.getEventList().empty();
         digitalWrite(LED_BUILTIN, active ? LED_ON : LED_OFF);
-        for (String e : gs.getEventList()) {
+        for (const String& e : gs.getEventList()) {
             Serial.println("- " + e);
         }
     } else {
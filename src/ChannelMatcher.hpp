@@ -0,0 +1,143 @@
+#pragma once
+
+
+#include <Arduino.h>
+
+
+// Trie nodes of a ChannelMatcher (fixed table; at most one per character of
+// the registered names, shared prefixes counted once). At most 255.
+#ifndef SCHEDULAR_MATCHER_NODES
+#define SCHEDULAR_MATCHER_NODES 96
+#endif
+
+
+/**
+ * Maps event titles to up to 32 output channels, compiled once up front.
+ *
+ * The names given to add() are compiled into a trie held in a fixed table, so
+ * match() walks a title once, character by character, with no allocation and
+ * no String: the cost is the title length, not the number of channels. The
+ * result is a bitmask, bit N set when channel N matched, which is what a
+ * sketch driving relays wants (digitalWrite per bit).
+ *
+ *   ChannelMatcher channels(ChannelMatcher::IGNORE_CASE);
+ *   channels.add(0, "Relay1");
+ *   channels.add(1, "Heating", ChannelMatcher::PREFIX);  // "Heating (eco)" too
+ *
+ * Several names may share a channel (aliases). Given to
+ * GoogleSchedular::setChannels(), it turns syncAt() into a mask producer: the
+ * titles are matched straight from the parsed reply and never stored.
+ */
+class ChannelMatcher {
+
+    public:
+
+    // Matcher-wide: compare titles and names ASCII case-insensitively.
+    enum Case : uint8_t {
+        MATCH_CASE  = 0,
+        IGNORE_CASE = 1,
+    };
+
+    // Per name: the whole title, or any title that starts with it.
+    enum Mode : uint8_t {
+        EXACT  = 0,
+        PREFIX = 1,
+    };
+
+    static_assert(SCHEDULAR_MATCHER_NODES <= 255, "node indexes are 8-bit");
+
+
+    explicit ChannelMatcher(const Case sensitivity = MATCH_CASE) : _used(1), _ignoreCase(sensitivity == IGNORE_CASE)
+    {
+        memset(_nodes, 0, sizeof(_nodes));
+    }
+
+    // Registers `name` for channel `bit` (0..31). Returns false, leaving the
+    // matcher unchanged, if `bit` is out of range or the node table is full.
+    bool add(const uint8_t bit, const char* name, const Mode mode = EXACT)
+    {
+        if (bit >= 32 || name == nullptr) {
+            return false;
+        }
+        if (_missingNodes(name) > SCHEDULAR_MATCHER_NODES - _used) {
+            return false;
+        }
+        uint8_t n = 0;
+        for (const char* p = name; *p != '\0'; ++p) {
+            const char c = _fold(*p);
+            uint8_t k = _child(n, c);
+            if (k == 0) {
+                k = _used++;
+                _nodes[k].c = c;
+                _nodes[k].sibling = _nodes[n].child;
+                _nodes[n].child = k;
+            }
+            n = k;
+        }
+        (mode == PREFIX ? _nodes[n].prefix : _nodes[n].exact) |= (1UL << bit);
+        return true;
+    }
+
+    // Channels matched by `title`.
+    uint32_t match(const char* title) const
+    {
+        uint32_t mask = _nodes[0].prefix;
+        uint8_t n = 0;
+        for (const char* p = title; *p != '\0'; ++p) {
+            n = _child(n, _fold(*p));
+            if (n == 0) {
+                return mask;
+            }
+            mask |= _nodes[n].prefix;
+        }
+        return mask | _nodes[n].exact;
+    }
+
+    // Nodes in use, root included.
+    uint8_t nodes(void) const { return _used; }
+
+
+    protected:
+
+    struct Node {
+        uint32_t exact;             // channels whose name ends here
+        uint32_t prefix;            // same, for PREFIX names
+        uint8_t child;              // first child, 0: none (the root is no child)
+        uint8_t sibling;            // next child of the same parent
+        char c;
+    };
+
+    char _fold(const char c) const
+    {
+        return (_ignoreCase && c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+
+    uint8_t _child(const uint8_t n, const char c) const
+    {
+        uint8_t k = _nodes[n].child;
+        while (k != 0 && _nodes[k].c != c) {
+            k = _nodes[k].sibling;
+        }
+        return k;
+    }
+
+    // Nodes add(name) would create.
+    uint8_t _missingNodes(const char* name) const
+    {
+        uint8_t n = 0;
+        const char* p = name;
+        for (; *p != '\0'; ++p) {
+            const uint8_t k = _child(n, _fold(*p));
+            if (k == 0) {
+                break;
+            }
+            n = k;
+        }
+        const size_t missing = strlen(p);
+        return missing < 255 ? static_cast<uint8_t>(missing) : 255;
+    }
+
+    Node _nodes[SCHEDULAR_MATCHER_NODES];
+    uint8_t _used;
+    bool _ignoreCase;
+};
@@ -0,0 +1,249 @@
+#pragma once
+
+
+#include <algorithm>
+
+#include "GoogleSchedular.hpp"
+
+
+// Calendars a DeadlineSchedular can follow (fixed, no heap for the slots).
+#ifndef SCHEDULAR_MAX_CALENDARS
+#define SCHEDULAR_MAX_CALENDARS 8
+#endif
+
+
+/**
+ * Follows several calendars of one Google account, each polled on its own
+ * deadline instead of at the sketch's single cadence.
+ *
+ * Each calendar has a period (the age its events may reach before they are
+ * stale) and a priority. The calendars are kept in a min-heap by next due
+ * time. On each maintain(ts) tick the due ones are taken off the heap and
+ * synced, highest priority first, as long as they fit in the tick's time
+ * budget: a calendar is skipped when the time already spent in the tick plus
+ * what its previous sync took would exceed the budget, and stays due for the
+ * next tick. The first sync of a tick always runs, so the budget caps the
+ * request rate without ever stalling the calendars. The door lock then stays
+ * fresh while the decorative light waits its turn.
+ *
+ * The account side is BasicGoogleSchedular's, unchanged: registration, the
+ * refresh_token, maintain() and hasFailed()/isAuthInvalid(). Calendar names
+ * are resolved with one calendar list request, when the first of them falls
+ * due, and at most one per tick whatever the number of unresolved names. A
+ * name the list does not hold is missing: it is looked for again after 2, 4,
+ * .. up to 64 periods, not every period. A failed sync puts the object in ERROR, like syncAt(), ends the tick and
+ * is retried after a quarter of the calendar's period; maintain() recovers the
+ * token meanwhile. setCalendar()/syncAt() are not used: read each calendar's
+ * events with getEventList(calendar).
+ */
+template <class TTransport = SchedularTransport, uint8_t CAPACITY = SCHEDULAR_MAX_CALENDARS>
+class BasicDeadlineSchedular : public BasicGoogleSchedular<TTransport> {
+
+    public:
+
+    typedef BasicGoogleSchedular<TTransport> Schedular;
+    typedef typename Schedular::OAuth2 OAuth2;
+    typedef typename Schedular::EventList EventList;
+
+    using Schedular::maintain;
+    using Schedular::getEventList;
+    using Schedular::hasFailed;
+    using Schedular::isAuthenticated;
+
+    // Returned by addCalendar() when all CAPACITY slots are taken.
+    static constexpr int8_t FULL = -1;
+
+    // Periods a missing calendar waits, at most, as a power of two.
+    static constexpr uint8_t MAX_BACKOFF = 6;
+
+
+    BasicDeadlineSchedular(const String& clientId, const String& clientSecret, Ntp* ntp, TTransport& transport = TTransport::shared())
+        : Schedular(clientId, clientSecret, ntp, transport), _count(0), _budgetMs(0), _lastTickSyncs(0), _listed(false) {}
+
+    // Follows `calendarName`, synced at least every `periodSeconds`; among
+    // calendars due at the same tick, higher `priority` goes first. Due at the
+    // first tick. Returns the calendar's index, or FULL.
+    int8_t addCalendar(const String& calendarName, const uint16_t periodSeconds, const uint8_t priority = 0)
+    {
+        if (_count == CAPACITY) {
+            return FULL;
+        }
+        Slot& s = _slots[_count];
+        s.name = calendarName;
+        s.period = periodSeconds != 0 ? periodSeconds : 1;
+        s.priority = priority;
+        s.nextDue = 0;
+        s.ok = false;
+        s.misses = 0;
+        s.costMs = 0;
+        _heap[_count] = _count;
+        ++_count;
+        std::push_heap(_heap, _heap + _count, Later(_slots));
+        return static_cast<int8_t>(_count - 1);
+    }
+
+    // Milliseconds of requests allowed per maintain(ts) tick; 0 (default)
+    // syncs everything that is due.
+    void setTickBudget(const uint16_t ms) { _budgetMs = ms; }
+
+    // maintain(), then the due calendars that fit in the tick budget, at the
+    // RFC3339 instant `ts` (same contract as syncAt()).
+    void maintain(const char* ts)
+    {
+        maintain();
+        _lastTickSyncs = 0;
+        _listed = false;
+        if (!isAuthenticated() || ts == nullptr || _count == 0) {
+            return;
+        }
+        const unsigned long now = _ntp->time();
+
+        // Due calendars move to the tail of _heap, [size, _count).
+        uint8_t size = _count;
+        while (size != 0 && _slots[_heap[0]].nextDue <= now) {
+            std::pop_heap(_heap, _heap + size, Later(_slots));
+            --size;
+        }
+        std::sort(_heap + size, _heap + _count, Urgent(_slots));
+
+        const unsigned long start = millis();
+        for (uint8_t i = size; i < _count && !hasFailed(); ++i) {
+            Slot& s = _slots[_heap[i]];
+            if (_lastTickSyncs != 0 && _budgetMs != 0 && (millis() - start) + s.costMs > _budgetMs) {
+                continue;               // does not fit: stays due
+            }
+            _sync(s, ts, now);
+        }
+
+        for (uint8_t i = size; i < _count; ++i) {
+            std::push_heap(_heap, _heap + i + 1, Later(_slots));
+        }
+    }
+
+    uint8_t calendars(void) const { return _count; }
+
+    // Titles of the events of `calendar` at its last successful sync.
+    const EventList& getEventList(const uint8_t calendar) const { return _slots[calendar].events; }
+
+    // Synced, and younger than its period.
+    bool isFresh(const uint8_t calendar) const
+    {
+        return _slots[calendar].ok && _ntp->time() < _slots[calendar].nextDue;
+    }
+
+    bool isResolved(const uint8_t calendar) const { return !_slots[calendar].id.isEmpty(); }
+
+    // Absent from the last calendar list looked through for it.
+    bool isMissing(const uint8_t calendar) const { return _slots[calendar].misses != 0; }
+
+    // Earliest deadline (Ntp time); a sketch may sleep until then.
+    unsigned long nextDue(void) const { return _count != 0 ? _slots[_heap[0]].nextDue : 0; }
+
+    // Syncs attempted by the last maintain(ts) tick.
+    uint8_t lastTickSyncs(void) const { return _lastTickSyncs; }
+
+
+    protected:
+
+    using Schedular::_state;
+    using Schedular::_enter;
+    using Schedular::_ntp;
+    using Schedular::_jsonArena;
+    using Schedular::_fetchEvents;
+    using Schedular::getCalendars;
+
+    struct Slot {
+        SchedularString<SCHEDULAR_TITLE_SIZE> name;
+        SchedularString<SCHEDULAR_CALENDAR_ID_SIZE> id;     // empty until resolved
+        EventList events;
+        unsigned long nextDue;
+        uint16_t period;
+        uint16_t costMs;                // duration of its previous sync
+        uint8_t priority;
+        uint8_t misses;                 // lists in a row that did not hold it
+        bool ok;                        // last sync succeeded
+    };
+
+    // Heap order: earliest deadline on top, then highest priority.
+    struct Later {
+        explicit Later(const Slot* slots) : slots(slots) {}
+        bool operator()(const uint8_t a, const uint8_t b) const
+        {
+            return slots[a].nextDue != slots[b].nextDue ? slots[a].nextDue > slots[b].nextDue
+                                                        : slots[a].priority < slots[b].priority;
+        }
+        const Slot* slots;
+    };
+
+    // Run order of the due calendars: highest priority, then most overdue.
+    struct Urgent {
+        explicit Urgent(const Slot* slots) : slots(slots) {}
+        bool operator()(const uint8_t a, const uint8_t b) const
+        {
+            return slots[a].priority != slots[b].priority ? slots[a].priority > slots[b].priority
+                                                          : slots[a].nextDue < slots[b].nextDue;
+        }
+        const Slot* slots;
+    };
+
+    void _sync(Slot& s, const char* ts, const unsigned long now)
+    {
+        const unsigned long start = millis();
+        ++_lastTickSyncs;
+        unsigned long wait = s.period;
+        if (s.id.isEmpty() && !_listed && !_resolve()) {
+            s.ok = false;
+        } else if (s.id.isEmpty()) {
+            s.ok = false;               // not in this tick's list: backs off
+            if (s.misses < MAX_BACKOFF) {
+                ++s.misses;
+            }
+            wait <<= s.misses;
+        } else {
+            s.ok = _fetchEvents(s.id.c_str(), ts, s.events);
+            if (!s.ok) {
+                _enter(Schedular::ERROR);
+            }
+        }
+        s.nextDue = now + (s.ok || !hasFailed() ? wait : (s.period + 3) / 4);
+        const unsigned long cost = millis() - start;
+        s.costMs = cost < 0xFFFF ? static_cast<uint16_t>(cost) : 0xFFFF;
+    }
+
+    // Resolves every unresolved calendar from one calendar list request, the
+    // only one of the tick.
+    bool _resolve(void)
+    {
+        _listed = true;
+        SchedularDocument doc(_jsonArena);
+        if (getCalendars(doc) != OAuth2::OK) {
+            _enter(Schedular::ERROR);
+            return false;
+        }
+        const JsonArray items = doc[F("items")].as<JsonArray>();
+        SchedularPace pace(SCHEDULAR_PARSE_SLICE_ITEMS);
+        for (JsonObject item : items) {
+            pace.step();
+            const char* summary = item[F("summary")].as<const char*>();
+            if (summary == nullptr) {
+                continue;
+            }
+            for (uint8_t i = 0; i < _count; ++i) {
+                if (_slots[i].id.isEmpty() && _slots[i].name.equals(summary)) {
+                    schedularKeep(_slots[i].id, item[F("id")].as<const char*>());
+                    _slots[i].misses = 0;
+                }
+            }
+        }
+        return true;
+    }
+
+    Slot _slots[CAPACITY];
+    uint8_t _heap[CAPACITY];
+    uint8_t _count;
+    uint16_t _budgetMs;
+    uint8_t _lastTickSyncs;
+    bool _listed;                       // the calendar list was asked for this tick
+};
+
+typedef BasicDeadlineSchedular<> DeadlineSchedular;
@@ -0,0 +1,197 @@
+#pragma once
+
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+
+// Bytes of the query an EventFilter assembles (terminator included). Filters
+// that would not fit are refused by the call that adds them.
+#ifndef SCHEDULAR_FILTER_SIZE
+#define SCHEDULAR_FILTER_SIZE 160
+#endif
+
+
+/**
+ * Narrows the events syncAt() asks for, so a shared calendar costs only the
+ * events the device acts on.
+ *
+ * Most of it is done by the server, from query parameters the Calendar API
+ * already has: a text match (q), private extended property tags
+ * (privateExtendedProperty, all of them must match) and event types
+ * (eventTypes). They are assembled once, as they are added, into query(),
+ * which every events request appends as is; showDeleted=false is always part
+ * of it.
+ *
+ * What the API cannot filter is dropped on the device, after the parse:
+ * events the calendar's owner declined, and events marked "show as available"
+ * (transparent). Asking for either widens the fields mask to the few members
+ * needed to tell (transparency, and the owner's own attendee entry, with
+ * maxAttendees=1), so only set them when such events do show up.
+ *
+ *   EventFilter filter;
+ *   filter.tag("device", "relay-board-2");
+ *   filter.types(EventFilter::TYPE_DEFAULT);
+ *   filter.skip(EventFilter::SKIP_DECLINED | EventFilter::SKIP_TRANSPARENT);
+ *   gs.setEventFilter(&filter);
+ *
+ * Applies to syncAt(), with or without channels; the recurring events of a
+ * RecurrenceStore get the server-side part only.
+ */
+class EventFilter {
+
+    public:
+
+    // eventTypes values; or-ed together.
+    enum Type : uint8_t {
+        TYPE_DEFAULT          = 1 << 0,
+        TYPE_FOCUS_TIME       = 1 << 1,
+        TYPE_OUT_OF_OFFICE    = 1 << 2,
+        TYPE_WORKING_LOCATION = 1 << 3,
+        TYPE_BIRTHDAY         = 1 << 4,
+        TYPE_FROM_GMAIL       = 1 << 5,
+    };
+
+    // Events dropped on the device; or-ed together.
+    enum Skip : uint8_t {
+        SKIP_DECLINED    = 1 << 0,
+        SKIP_TRANSPARENT = 1 << 1,
+    };
+
+
+    EventFilter() { clear(); }
+
+    // Back to no filter at all.
+    void clear(void)
+    {
+        _skip = 0;
+        _length = 0;
+        _query[0] = '\0';
+        _append("&showDeleted=false");
+    }
+
+    // Events whose text (title, description, location, attendees...) holds
+    // `words`, as in the Calendar search box.
+    bool text(const char* words)
+    {
+        return _add("&q=", words, nullptr, nullptr);
+    }
+
+    // Events tagged `name`=`value` in their private extended properties.
+    // Several tags must all match.
+    bool tag(const char* name, const char* value)
+    {
+        return _add("&privateExtendedProperty=", name, "%3D", value);
+    }
+
+    // Events of these types only (a Type mask). Without it, the server's
+    // default set.
+    bool types(const uint8_t mask)
+    {
+        static const char* const names[] = { "default", "focusTime", "outOfOffice", "workingLocation", "birthday", "fromGmail" };
+        const size_t start = _length;
+        for (uint8_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+            if ((mask & (1 << i)) != 0 && !(_append("&eventTypes=") && _append(names[i]))) {
+                _cut(start);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Drops these events (a Skip mask) from the replies.
+    void skip(const uint8_t mask) { _skip = mask; }
+
+    uint8_t skipped(void) const { return _skip; }
+
+    // The query parameters, each starting with '&'.
+    const char* query(void) const { return _query; }
+
+    // Whether the reply must carry more than the event titles.
+    bool needsDetails(void) const { return _skip != 0; }
+
+    // Whether an item of the reply passes the device-side part.
+    bool accepts(const JsonObject item) const
+    {
+        if ((_skip & SKIP_TRANSPARENT) != 0 && _equals(item[F("transparency")].as<const char*>(), "transparent")) {
+            return false;
+        }
+        if ((_skip & SKIP_DECLINED) != 0) {
+            for (JsonObject attendee : item[F("attendees")].as<JsonArray>()) {
+                if (attendee[F("self")].as<bool>()) {
+                    return !_equals(attendee[F("responseStatus")].as<const char*>(), "declined");
+                }
+            }
+        }
+        return true;
+    }
+
+
+    protected:
+
+    static bool _equals(const char* a, const char* b) { return a != nullptr && strcmp(a, b) == 0; }
+
+    // `key` + encoded `a` [+ `separator` + encoded `b`], whole or not at all.
+    bool _add(const char* key, const char* a, const char* separator, const char* b)
+    {
+        if (a == nullptr || *a == '\0') {
+            return false;
+        }
+        const size_t start = _length;
+        if (!_append(key) || !_appendEncoded(a) || (separator != nullptr && !(_append(separator) && _appendEncoded(b)))) {
+            _cut(start);
+            return false;
+        }
+        return true;
+    }
+
+    bool _append(const char* s)
+    {
+        for (; *s != '\0'; ++s) {
+            if (!_put(*s)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Percent-encodes all but the URI unreserved characters.
+    bool _appendEncoded(const char* s)
+    {
+        static const char hex[] = "0123456789ABCDEF";
+        if (s == nullptr) {
+            return false;
+        }
+        for (; *s != '\0'; ++s) {
+            const uint8_t c = static_cast<uint8_t>(*s);
+            if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+                if (!_put(static_cast<char>(c))) {
+                    return false;
+                }
+            } else if (!(_put('%') && _put(hex[c >> 4]) && _put(hex[c & 0x0F]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool _put(const char c)
+    {
+        if (_length + 1 >= sizeof(_query)) {
+            return false;
+        }
+        _query[_length++] = c;
+        _query[_length] = '\0';
+        return true;
+    }
+
+    void _cut(const size_t length)
+    {
+        _length = length;
+        _query[length] = '\0';
+    }
+
+    char _query[SCHEDULAR_FILTER_SIZE];
+    size_t _length;
+    uint8_t _skip;
+};
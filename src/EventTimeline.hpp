@@ -0,0 +1,287 @@
+#pragma once
+
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "EventFilter.hpp"
+#include "Recurrence.hpp"
+
+
+// Events an EventTimeline holds.
+#ifndef SCHEDULAR_TIMELINE_EVENTS
+#define SCHEDULAR_TIMELINE_EVENTS 16
+#endif
+
+// Bytes for the titles of an EventTimeline, terminators included. At most
+// 65535.
+#ifndef SCHEDULAR_TIMELINE_TITLES
+#define SCHEDULAR_TIMELINE_TITLES 512
+#endif
+
+
+/**
+ * One event of an EventTimeline: 12 bytes, its title kept apart.
+ */
+struct EventRecord {
+    uint32_t start;             // Unix time
+    uint32_t end;               // Unix time, exclusive
+    uint16_t title;             // offset of the title in the timeline's pool
+    uint8_t  length;            // of the title, cut to 255
+    uint8_t  flags;
+
+    static constexpr uint8_t ALL_DAY = 1 << 0;
+
+    bool isAllDay(void) const { return (flags & ALL_DAY) != 0; }
+    uint32_t duration(void) const { return end - start; }
+    bool isActiveAt(const uint32_t t) const { return start <= t && t < end; }
+};
+
+
+/**
+ * The events of a time window, with their start and end, for the device to
+ * reason about time itself: what is running at any instant of the window,
+ * when the next change is due, how long an event lasts.
+ *
+ * load() reads an events reply fetched with fields=items(summary,start,end)
+ * (see GoogleApiCalendar::getTimedEvents()). The dateTime / date values go
+ * through CivilTime::parseRfc3339(), a fixed-format parser with no allocation.
+ * Events are kept as EventRecords in one array sorted by start, and their
+ * titles back to back in one pool: 12 bytes per event plus the title, against
+ * a list node, a String and a heap block per event for getEventList().
+ *
+ * Given to GoogleSchedular::setTimeline(), it is loaded again once
+ * `horizonSeconds` have passed; in between, syncAt() answers from it without
+ * any request. An event list that does not fit (SCHEDULAR_TIMELINE_EVENTS,
+ * SCHEDULAR_TIMELINE_TITLES) fails the load, and syncAt() then asks the server
+ * each time until the next one. All-day events are taken at the local midnight
+ * of setAllDayOffset() (UTC by default), as the API gives them no offset.
+ */
+class EventTimeline {
+
+    public:
+
+    explicit EventTimeline(const uint32_t horizonSeconds = 3600)
+        : _horizon(horizonSeconds), _loadedAt(0), _allDayOffset(0), _longest(0), _used(0), _size(0), _loaded(false), _usable(false) {}
+
+    void setAllDayOffset(const int32_t seconds) { _allDayOffset = seconds; }
+
+    // Seconds a load is trusted for; also the window it is fetched for.
+    uint32_t horizonSeconds(void) const { return _horizon; }
+
+    void setHorizonSeconds(const uint32_t seconds) { _horizon = seconds; }
+
+    bool isStale(const uint32_t now) const { return !_loaded || now - _loadedAt >= _horizon; }
+
+    // Whether the last load succeeded.
+    bool isUsable(void) const { return _usable; }
+
+    uint32_t loadedAt(void) const { return _loadedAt; }
+
+    uint8_t size(void) const { return _size; }
+
+    // Events by start, then by end.
+    const EventRecord& record(const uint8_t i) const { return _records[i]; }
+
+    const char* title(const uint8_t i) const { return _titles + _records[i].title; }
+
+    void clear(void)
+    {
+        _size = 0;
+        _used = 0;
+        _longest = 0;
+        _loaded = false;
+        _usable = false;
+    }
+
+    // Marks a load at `now` that could not be used.
+    void reject(const uint32_t now)
+    {
+        clear();
+        _loadedAt = now;
+        _loaded = true;
+    }
+
+    // Replaces the events with `items`, but for those `filter` (if any)
+    // drops. False, and nothing usable, when one cannot be read or they do
+    // not fit.
+    bool load(const JsonArray& items, const uint32_t now, const EventFilter* filter = nullptr)
+    {
+        reject(now);
+        for (JsonObject item : items) {
+            if (filter != nullptr && !filter->accepts(item)) {
+                continue;
+            }
+            if (!_add(item)) {
+                _size = 0;
+                _used = 0;
+                return false;
+            }
+        }
+        _usable = true;
+        return true;
+    }
+
+    // Replaces the events with those given to insert() next, as a load at
+    // `now` (for events that do not come from a reply, see
+    // SchedularBroadcast.hpp).
+    void beginLoad(const uint32_t now)
+    {
+        reject(now);
+        _usable = true;
+    }
+
+    // Adds one event after beginLoad(); `end` is exclusive. False, and
+    // nothing usable, when it does not fit.
+    bool insert(const uint32_t start, const uint32_t end, const char* title, const size_t length, const bool allDay = false)
+    {
+        EventRecord r;
+        r.start = start;
+        r.end = end;
+        r.flags = allDay ? EventRecord::ALL_DAY : 0;
+        if (end < start || !_insert(r, title, length)) {
+            reject(_loadedAt);
+            return false;
+        }
+        return true;
+    }
+
+    // Calls `f(i)` for each event running at Unix time `t`, by start.
+    template <class F>
+    void forEachActive(const uint32_t t, F f) const
+    {
+        // Sorted by start: only those that started within the longest
+        // duration before `t` can still run.
+        for (uint8_t i = _firstStartingFrom(t > _longest ? t - _longest : 0); i < _size && _records[i].start <= t; ++i) {
+            if (_records[i].isActiveAt(t)) {
+                f(i);
+            }
+        }
+    }
+
+    // Number of events running at `t`.
+    uint8_t activeCount(const uint32_t t) const
+    {
+        uint8_t n = 0;
+        forEachActive(t, [&n](uint8_t) { ++n; });
+        return n;
+    }
+
+    // First instant after `t` at which an event starts or ends, or 0 if
+    // nothing changes within the loaded events.
+    uint32_t nextTransition(const uint32_t t) const
+    {
+        uint32_t next = 0;
+        const uint8_t from = _firstStartingFrom(t > _longest ? t - _longest : 0);
+        for (uint8_t i = from; i < _size; ++i) {
+            const EventRecord& r = _records[i];
+            if (r.start > t) {
+                // Events after this one start, and so end, no earlier.
+                if (next == 0 || r.start < next) {
+                    next = r.start;
+                }
+                break;
+            }
+            if (r.end > t && (next == 0 || r.end < next)) {
+                next = r.end;
+            }
+        }
+        return next;
+    }
+
+
+    protected:
+
+    // Index of the first event starting at or after `t` (binary search).
+    uint8_t _firstStartingFrom(const uint32_t t) const
+    {
+        uint8_t lo = 0;
+        uint8_t hi = _size;
+        while (lo < hi) {
+            const uint8_t mid = static_cast<uint8_t>((lo + hi) / 2);
+            if (_records[mid].start < t) {
+                lo = static_cast<uint8_t>(mid + 1);
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    }
+
+    // {"dateTime": "..."} or {"date": "..."}.
+    bool _time(const JsonObject& when, uint32_t& utc, bool& allDay) const
+    {
+        const char* s = when[F("dateTime")].as<const char*>();
+        if (s == nullptr) {
+            s = when[F("date")].as<const char*>();
+        }
+        int32_t t, offset;
+        if (!CivilTime::parseRfc3339(s, t, offset, allDay)) {
+            return false;
+        }
+        if (allDay) {
+            t -= _allDayOffset;
+        }
+        utc = static_cast<uint32_t>(t);
+        return true;
+    }
+
+    // Reads `item` and inserts it.
+    bool _add(const JsonObject& item)
+    {
+        EventRecord r;
+        bool allDay, endAllDay;
+        if (!_time(item[F("start")].as<JsonObject>(), r.start, allDay) ||
+            !_time(item[F("end")].as<JsonObject>(), r.end, endAllDay) || r.end < r.start) {
+            return false;
+        }
+        const char* summary = item[F("summary")].as<const char*>();
+        if (summary == nullptr) {
+            summary = "";
+        }
+        r.flags = allDay ? EventRecord::ALL_DAY : 0;
+        return _insert(r, summary, strlen(summary));
+    }
+
+    // Pools the title of `r` and inserts it at its place by start (then end).
+    bool _insert(EventRecord r, const char* title, size_t length)
+    {
+        if (length > 255) {
+            length = 255;
+        }
+        if (_size == SCHEDULAR_TIMELINE_EVENTS || length + 1 > sizeof(_titles) - _used) {
+            return false;
+        }
+        memcpy(_titles + _used, title, length);
+        _titles[_used + length] = '\0';
+        r.title = static_cast<uint16_t>(_used);
+        r.length = static_cast<uint8_t>(length);
+        _used += length + 1;
+
+        uint8_t i = _size;
+        while (i > 0 && (_records[i - 1].start > r.start || (_records[i - 1].start == r.start && _records[i - 1].end > r.end))) {
+            _records[i] = _records[i - 1];
+            --i;
+        }
+        _records[i] = r;
+        ++_size;
+        if (r.duration() > _longest) {
+            _longest = r.duration();
+        }
+        return true;
+    }
+
+    static_assert(SCHEDULAR_TIMELINE_EVENTS <= 255, "event indexes are 8-bit");
+    static_assert(SCHEDULAR_TIMELINE_TITLES <= 65535, "title offsets are 16-bit");
+
+    EventRecord _records[SCHEDULAR_TIMELINE_EVENTS];
+    char _titles[SCHEDULAR_TIMELINE_TITLES];
+    uint32_t _horizon;
+    uint32_t _loadedAt;
+    int32_t _allDayOffset;
+    uint32_t _longest;          // longest duration loaded
+    size_t _used;               // bytes of _titles
+    uint8_t _size;
+    bool _loaded;
+    bool _usable;
+};
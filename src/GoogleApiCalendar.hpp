@@ -14,25 +14,37 @@
  * keeping this library light on a microcontroller:
  *
  *  - getCalendars() requests only items(id, summary).
+ *  - getCalendar()  requests only the summary of one calendar.
  *  - getEvents()    requests only items(summary), and relies on singleEvents=true
- *    so recurring events are already expanded server-side.
+ *    so recurring events are already expanded server-side. An EventFilter
+ *    (setEventFilter()) narrows it further, server-side where the API can.
+ *  - getTimedEvents() adds start and end, for an EventTimeline.
+ *  - getRecurringEvents() is the other way round (singleEvents=false): the
+ *    recurring events themselves, with their rules, to expand on the device
+ *    (see Recurrence.hpp).
  *
  * Trimming the payload server-side means a smaller JsonDocument, less socket
  * traffic and less heap churn on the device. Requests reuse the shared HTTP/TLS
  * clients and the streaming reader inherited from GoogleOAuth2.
  */
-class GoogleApiCalendar : public GoogleOAuth2 {
+template <class TTransport = SchedularTransport>
+class GoogleApiCalendar : public GoogleOAuth2<TTransport> {
 
     public: 
+
+    typedef GoogleOAuth2<TTransport> OAuth2;
+    typedef typename OAuth2::Response Response;
+    using OAuth2::ERROR;
+    using OAuth2::OK;
     
     // OAuth scope for read-only Calendar access, returned as an FPSTR handle.
     // A `static constexpr char SCOPE[]` member would be odr-used by FPSTR(...)
-    // (its address is taken) and then require an out-of-line definition to link
-    // pre-C++17 (AVR / gnu++11). For this non-template, header-only class such a
-    // definition would clash across translation units, unlike FastTimer's
-    // templated NTP_PACKET. A function holding a local static PROGMEM string
-    // links everywhere -- single- or multi-TU, C++11 through C++17 -- with no
-    // separate definition, and keeps the literal in flash.
+    // (its address is taken) and then need an out-of-line definition to link
+    // pre-C++17 (AVR / gnu++11). As the class is a template, that definition
+    // could sit in this header, like FastTimer's NTP_PACKET, and from C++17 an
+    // inline static member would need none. The function-local static PROGMEM
+    // string is kept for the pre-C++17 toolchains: no separate definition in
+    // any standard, and the literal stays in flash.
     static const __FlashStringHelper* scope()
     {
         static const char s[] PROGMEM = "https://www.googleapis.com/auth/calendar.readonly";
@@ -40,13 +52,23 @@ class GoogleApiCalendar : public GoogleOAuth2 {
     }
 
 
-    GoogleApiCalendar(const String& clientId, const String& clientSecret): GoogleOAuth2(clientId, clientSecret) {}
+    GoogleApiCalendar(const String& clientId, const String& clientSecret, TTransport& transport = TTransport::shared()): OAuth2(clientId, clientSecret, transport), _eventFilter(nullptr) {}
+
+    // Narrows the events requests (see EventFilter.hpp). The filter must
+    // outlive this object, and its query must not change while a request is
+    // built from it; nullptr removes it.
+    void setEventFilter(const EventFilter* filter) { _eventFilter = filter; }
+
+    const EventFilter* getEventFilter(void) const { return _eventFilter; }
 
     // GET https://www.googleapis.com/calendar/v3/users/me/calendarList?fields=items(id,summary)
-    GoogleOAuth2::Response getCalendars(JsonDocument& response)
+    Response getCalendars(JsonDocument& response)
     {
         int httpCode;
-        _getRequest(F("/calendar/v3/users/me/calendarList?fields=items(id,summary)&minAccessRole=reader&showHidden=true"), httpCode, response);
+        SCHEDULAR_STATS_ONLY(_stats.begin(SchedularStats::OP_CALENDARS);)
+        SCHEDULAR_TRACE_ONLY(_trace.begin(SchedularStats::OP_CALENDARS);)
+        const SchedularText uri = F("/calendar/v3/users/me/calendarList?fields=items(id,summary)&minAccessRole=reader&showHidden=true");
+        _getRequest(uri, httpCode, response);
 
         if (httpCode == HTTP_CODE_OK) {
             /*
@@ -61,13 +83,31 @@ class GoogleApiCalendar : public GoogleOAuth2 {
         return ERROR;
     }
 
+    // GET https://www.googleapis.com/calendar/v3/calendars/{calendarId}?fields=summary
+    // One calendar's title: a cheap check that a known id is still the
+    // calendar it was resolved for.
+    Response getCalendar(JsonDocument& response, const char* calendarId)
+    {
+        int httpCode;
+        SCHEDULAR_STATS_ONLY(_stats.begin(SchedularStats::OP_CALENDARS);)
+        SCHEDULAR_TRACE_ONLY(_trace.begin(SchedularStats::OP_CALENDARS);)
+        SchedularText uri = F("/calendar/v3/calendars/");
+        uri += calendarId;
+        uri += F("?fields=summary");
+        _getRequest(uri, httpCode, response);
+
+        return httpCode == HTTP_CODE_OK ? OK : ERROR;
+    }
+
     // timeMin/timeMax are taken as const char* so the caller can pass a
     // zero-copy timestamp (e.g. TimestampNtp::c_str()) without wrapping it in a
     // heap-allocated String; they are appended straight to the URI below.
-    GoogleOAuth2::Response getEvents(JsonDocument& response, const String& calendarId, const char* timeMin, const char* timeMax)
+    Response getEvents(JsonDocument& response, const char* calendarId, const char* timeMin, const char* timeMax)
     {
         int httpCode;
-        const String uri = _buildEventsUri(calendarId, timeMin, timeMax);
+        SCHEDULAR_STATS_ONLY(_stats.begin(SchedularStats::OP_EVENTS);)
+        SCHEDULAR_TRACE_ONLY(_trace.begin(SchedularStats::OP_EVENTS);)
+        const SchedularText uri = _buildEventsUri(calendarId, timeMin, timeMax);
         _getRequest(uri, httpCode, response);
 
         if (httpCode == HTTP_CODE_OK) {
@@ -82,41 +122,126 @@ class GoogleApiCalendar : public GoogleOAuth2 {
         return ERROR;
     }
 
+    Response getEvents(JsonDocument& response, const String& calendarId, const char* timeMin, const char* timeMax)
+    {
+        return getEvents(response, calendarId.c_str(), timeMin, timeMax);
+    }
+
+    // Same query, with each event's start and end (see EventTimeline.hpp).
+    Response getTimedEvents(JsonDocument& response, const char* calendarId, const char* timeMin, const char* timeMax)
+    {
+        int httpCode;
+        SCHEDULAR_STATS_ONLY(_stats.begin(SchedularStats::OP_EVENTS);)
+        SCHEDULAR_TRACE_ONLY(_trace.begin(SchedularStats::OP_EVENTS);)
+        const SchedularText uri = _buildEventsUri(calendarId, timeMin, timeMax, true);
+        _getRequest(uri, httpCode, response);
+
+        if (httpCode == HTTP_CODE_OK) {
+            /*
+            items[] =
+                summary     : title
+                start, end  : {dateTime} or {date}
+            */
+
+            return OK;
+        }
+
+        return ERROR;
+    }
+
+    // Same window, unexpanded: recurring events come once, with their
+    // RRULE/EXDATE lines, and moved or cancelled instances as exceptions
+    // (recurringEventId + originalStartTime). Single events come as they are.
+    Response getRecurringEvents(JsonDocument& response, const char* calendarId, const char* timeMin, const char* timeMax)
+    {
+        int httpCode;
+        SCHEDULAR_STATS_ONLY(_stats.begin(SchedularStats::OP_EVENTS);)
+        SCHEDULAR_TRACE_ONLY(_trace.begin(SchedularStats::OP_EVENTS);)
+        SchedularText uri = F("/calendar/v3/calendars/");
+        uri += calendarId;
+        uri += F("/events?fields=items(id,summary,start,end,recurrence,recurringEventId,originalStartTime,status)&singleEvents=false");
+        if (_eventFilter != nullptr) {
+            uri += _eventFilter->query();
+        }
+        uri += F("&timeMin=");
+        uri += timeMin;
+        uri += F("&timeMax=");
+        uri += timeMax;
+        _getRequest(uri, httpCode, response);
+
+        if (httpCode == HTTP_CODE_OK) {
+            /*
+            items[] =
+                id, summary, status
+                start, end          : {dateTime} or {date}
+                recurrence[]        : "RRULE:...", "EXDATE:..."
+                recurringEventId, originalStartTime : exceptions only
+            */
+
+            return OK;
+        }
+
+        return ERROR;
+    }
+
     protected:
 
+    using OAuth2::_accessToken;
+    using OAuth2::_transport;
+    using OAuth2::_readJsonResponse;
+    using OAuth2::_abandon;
+#ifdef SCHEDULAR_STATS
+    using OAuth2::_stats;
+    using OAuth2::_endStats;
+#endif
+#ifdef SCHEDULAR_TRACE
+    using OAuth2::_trace;
+#endif
+
     // Authenticated GET that streams the JSON reply straight into `response`.
     // Same lightweight strategy as GoogleOAuth2::_postJsonRequest: HTTP/1.0 so
     // the body is read without chunked-decoding, shared TLS client closed after
     // each call. The Bearer token is the access_token kept by GoogleOAuth2.
-    void _getRequest(const String path, int& httpCode, JsonDocument& response) {
-        _httpClient.begin(_wifiClient, F("www.googleapis.com"), 443, path, true);
+    // A path or header that ran out of room (static build) is not sent, as
+    // an empty path or a header without its token would be answered 404 / 401:
+    // the request fails as a transient error (0).
+    void _getRequest(const SchedularText& path, int& httpCode, JsonDocument& response) {
         // Build the header in a String first: on the ESP32 core "FPSTR(..) + String"
         // is ambiguous (a FlashStringHelper* also converts to integer), so
         // concatenate explicitly to compile on both ESP8266 and ESP32.
-        String auth = FPSTR("Bearer ");
-        auth += _accessToken;
-        _httpClient.addHeader(F("Authorization"), auth);
-
-        httpCode = _httpClient.GET();
-        // Demote a malformed body to a failure (see GoogleOAuth2::_postJsonRequest).
-        const DeserializationError err = deserializeJson(response, _wifiClient);
-        if (err && httpCode == HTTP_CODE_OK) {
-            httpCode = 0;
+        SchedularText auth = FPSTR("Bearer ");
+        auth += _accessToken.c_str();
+
+        if (schedularFailed(path) || schedularFailed(auth) || !_transport.acquire(TTransport::HOST_API)) {
+            _abandon(httpCode);
+            return;
         }
-        _wifiClient.stop();
-        _httpClient.end();
+
+        httpCode = _transport.get(path.c_str(), auth.c_str());
+        _readJsonResponse(httpCode, response);
     }
 
     // Builds the events endpoint URI in place by appending to a single String,
     // so the query is assembled with as few reallocations as possible.
-    // fields=items(summary) keeps the response to bare event titles; timeMin and
-    // timeMax bound the query to the caller's window (see GoogleSchedular::syncAt).
-    String _buildEventsUri(const String& calendarId, const char* timeMin, const char* timeMax) const
+    // fields=items(summary) keeps the response to bare event titles, plus
+    // start and end when `timed`, and what the filter has to see of them; its
+    // query comes ready-made. timeMin and timeMax bound the query to the
+    // caller's window (see GoogleSchedular::syncAt).
+    SchedularText _buildEventsUri(const char* calendarId, const char* timeMin, const char* timeMax, const bool timed = false) const
     {
 
-        String uri = F("/calendar/v3/calendars/");
+        SchedularText uri = F("/calendar/v3/calendars/");
         uri += calendarId;
-        uri += F("/events?fields=items(summary)&singleEvents=true&timeMin=");
+        uri += timed ? F("/events?fields=items(summary,start,end") : F("/events?fields=items(summary");
+        if (_eventFilter == nullptr) {
+            uri += F(")&singleEvents=true");
+        } else {
+            uri += _eventFilter->needsDetails()
+                 ? F(",transparency,attendees(self,responseStatus))&maxAttendees=1&singleEvents=true")
+                 : F(")&singleEvents=true");
+            uri += _eventFilter->query();
+        }
+        uri += F("&timeMin=");
         uri += timeMin;
         uri += F("&timeMax=");
         uri += timeMax;
@@ -124,4 +249,5 @@ class GoogleApiCalendar : public GoogleOAuth2 {
         return uri;
     }
 
+    const EventFilter* _eventFilter;
 };
\ No newline at end of file
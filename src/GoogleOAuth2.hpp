@@ -12,8 +12,11 @@
  * RAM/flash budget of an ESP8266/ESP32, so a few deliberate trade-offs are made
  * to stay lightweight:
  *
- *  - A single reusable HTTPClient + WiFiClientSecure are kept as members and
- *    reused for every request, instead of allocating one per call.
+ *  - The HTTP/TLS layer is the TTransport policy (see SchedularTransport.hpp),
+ *    chosen at compile time: HTTPClient + WiFiClientSecure on the ESP cores,
+ *    POSIX sockets on Linux. One connection is borrowed for every request,
+ *    instead of allocating one per call; several instances (calendars,
+ *    accounts) can share it.
  *  - useHTTP10(true) disables chunked transfer decoding so the JSON body can be
  *    streamed straight from the socket into ArduinoJson (see _postJsonRequest),
  *    avoiding a full in-RAM copy of the response.
@@ -26,6 +29,7 @@
  *    so no extra String member is needed for a value that only lives until the
  *    user validates the device.
  */
+template <class TTransport = SchedularTransport>
 class GoogleOAuth2 {
 
     public:
@@ -37,28 +41,50 @@ class GoogleOAuth2 {
     };
 
     
-    GoogleOAuth2(const String& clientId, const String& clientSecret) : _clientId(clientId), _clientSecret(clientSecret), _refreshToken(), _accessToken(), _httpClient(), _wifiClient()
-    {
-        _wifiClient.setInsecure();
-        _httpClient.useHTTP10(true);
-    }
+    // `transport` is borrowed for each request and must outlive this object;
+    // by default all instances share one (see SchedularTransport).
+    GoogleOAuth2(const String& clientId, const String& clientSecret, TTransport& transport = TTransport::shared()) : _clientId(clientId), _clientSecret(clientSecret), _refreshToken(), _accessToken(), _transport(transport) {}
 
-    String getRefreshToken(void) const { return _refreshToken; }
-    void setRefreshToken(const String& tok) { _refreshToken = tok; }
+    String getRefreshToken(void) const { return _refreshToken.c_str(); }
+    void setRefreshToken(const String& tok) { schedularKeep(_refreshToken, tok.c_str()); }
 
     // HTTP status of the last token request (refreshAccessToken). Lets the caller
     // tell a rejected credential (400 invalid_grant) from a transient failure
     // (negative code / 5xx). 0 before any attempt. See GoogleSchedular::isAuthInvalid().
     int lastAuthHttpCode(void) const { return _lastAuthHttpCode; }
 
+    // Runs the JSON of every request (the request and reply documents, and
+    // the request body) out of `arena` instead of the heap, or of the scratch
+    // arena in a static build; nullptr goes back to that. The arena is the
+    // caller's and must outlive this object. It rewinds on its own once a call
+    // has released what it took, so capacity() bounds the JSON memory of any
+    // call and peak() / failures() tell how close it came: a reply that does
+    // not fit fails to parse (ERROR), it never falls back to the heap.
+    void setJsonArena(SchedularArena* arena) { _jsonArena = arena; }
+    SchedularArena* getJsonArena(void) const { return _jsonArena; }
+
+#ifdef SCHEDULAR_STATS
+    // Request counters and latency histograms (see SchedularStats.hpp).
+    const SchedularStats& stats(void) const { return _stats; }
+    void resetStats(void) { _stats.reset(); }
+#endif
+
+#ifdef SCHEDULAR_TRACE
+    // The last trace records (see SchedularTrace.hpp).
+    const SchedularTrace& trace(void) const { return _trace; }
+    void clearTrace(void) { _trace.clear(); }
+#endif
+
     // POST https://oauth2.googleapis.com/device/code
     GoogleOAuth2::Response requestDeviceAndUserCode(JsonDocument& response, const String& scope)
     {
         int httpCode;
-        JsonDocument request;
-        request[F("client_id")]    = _clientId;
+        SchedularDocument request(_jsonArena);
+        request[F("client_id")]    = _clientId.c_str();
         request[F("scope")]        = scope;
 
+        SCHEDULAR_STATS_ONLY(_stats.begin(SchedularStats::OP_DEVICE_CODE);)
+        SCHEDULAR_TRACE_ONLY(_trace.begin(SchedularStats::OP_DEVICE_CODE);)
         _postJsonRequest(F("/device/code"), httpCode, response, request);
 
         if (httpCode != HTTP_CODE_OK) {
@@ -75,7 +101,9 @@ class GoogleOAuth2 {
         // Reuse _refreshToken to hold the transient device_code until the user
         // validates the device; pollAuthorization() replaces it with the real
         // refresh_token on success. Saves one String member.
-        _refreshToken = response["device_code"].as<String>();
+        if (!schedularKeep(_refreshToken, response[F("device_code")].as<const char*>())) {
+            return ERROR;
+        }
 
         return OK;
     }
@@ -84,12 +112,14 @@ class GoogleOAuth2 {
     GoogleOAuth2::Response pollAuthorization(JsonDocument& response)
     {
         int httpCode;
-        JsonDocument request;
-        request[F("client_id")]        = _clientId;
-        request[F("client_secret")]    = _clientSecret;
-        request[F("device_code")]      = _refreshToken;
+        SchedularDocument request(_jsonArena);
+        request[F("client_id")]        = _clientId.c_str();
+        request[F("client_secret")]    = _clientSecret.c_str();
+        request[F("device_code")]      = _refreshToken.c_str();
         request[F("grant_type")]       = F("urn:ietf:params:oauth:grant-type:device_code");
 
+        SCHEDULAR_STATS_ONLY(_stats.begin(SchedularStats::OP_POLL);)
+        SCHEDULAR_TRACE_ONLY(_trace.begin(SchedularStats::OP_POLL);)
         _postJsonRequest(F("/token"), httpCode, response, request);
 
         switch (httpCode) {
@@ -108,8 +138,10 @@ class GoogleOAuth2 {
                     scope           : // useless
                     token_type      : Bearer
                 */
-                _refreshToken = response[F("refresh_token")].as<String>();
-                _accessToken = response[F("access_token")].as<String>();
+                if (!schedularKeep(_refreshToken, response[F("refresh_token")].as<const char*>()) ||
+                    !schedularKeep(_accessToken, response[F("access_token")].as<const char*>())) {
+                    return ERROR;
+                }
 
                 return OK;
         }
@@ -121,12 +153,14 @@ class GoogleOAuth2 {
     GoogleOAuth2::Response refreshAccessToken(JsonDocument& response)
     {
         int httpCode;
-        JsonDocument request;
-        request[F("client_id")]        = _clientId;
-        request[F("client_secret")]    = _clientSecret;
+        SchedularDocument request(_jsonArena);
+        request[F("client_id")]        = _clientId.c_str();
+        request[F("client_secret")]    = _clientSecret.c_str();
         request[F("grant_type")]       = F("refresh_token");
-        request[F("refresh_token")]    = _refreshToken;
+        request[F("refresh_token")]    = _refreshToken.c_str();
 
+        SCHEDULAR_STATS_ONLY(_stats.begin(SchedularStats::OP_REFRESH);)
+        SCHEDULAR_TRACE_ONLY(_trace.begin(SchedularStats::OP_REFRESH);)
         _postJsonRequest(F("/token"), httpCode, response, request);
         _lastAuthHttpCode = httpCode;
 
@@ -140,7 +174,9 @@ class GoogleOAuth2 {
             scope           : // useless
             token_type      : Bearer
         */
-        _accessToken = response[F("access_token")].as<String>();
+        if (!schedularKeep(_accessToken, response[F("access_token")].as<const char*>())) {
+            return ERROR;
+        }
 
         return OK;
     }
@@ -152,31 +188,131 @@ class GoogleOAuth2 {
     // without chunked-decoding, so no intermediate String holds the full
     // response. The shared HTTP/TLS clients are opened and closed per call to
     // keep only one connection alive at a time.
-    void _postJsonRequest(const String path, int& httpCode, JsonDocument& response, const JsonDocument& request)
+    void _postJsonRequest(const __FlashStringHelper* path, int& httpCode, JsonDocument& response, const JsonDocument& request)
+    {
+#ifdef SCHEDULAR_STATIC
+        ArenaText payload(_jsonArena != nullptr ? *_jsonArena : SchedularArena::scratch());
+        _serialize(request, payload);
+        _post(path, httpCode, response, request, payload);
+#else
+        if (_jsonArena != nullptr) {
+            ArenaText payload(*_jsonArena);
+            _serialize(request, payload);
+            _post(path, httpCode, response, request, payload);
+        } else {
+            String payload;
+            serializeJson(request, payload);
+            _post(path, httpCode, response, request, payload);
+        }
+#endif
+    }
+
+    // A request that did not fit its memory (document, body or path) is not
+    // sent: cut short, Google would answer it with a 400, which reads as a
+    // revoked credential (isAuthInvalid()). It fails as a transient error
+    // instead (0).
+    template <class TText>
+    void _post(const __FlashStringHelper* path, int& httpCode, JsonDocument& response, const JsonDocument& request, const TText& payload)
+    {
+        const SchedularText uri = path;
+        if (request.overflowed() || schedularFailed(payload) || schedularFailed(uri) || !_transport.acquire(TTransport::HOST_OAUTH2)) {
+            _abandon(httpCode);
+            return;
+        }
+
+        httpCode = _transport.post(uri.c_str(), payload.c_str());
+        _readJsonResponse(httpCode, response);
+    }
+
+    // End of a request that never reached the transport.
+    void _abandon(int& httpCode)
     {
-        String payload;
-        serializeJson(request, payload);
-
-        _httpClient.begin(_wifiClient, F("oauth2.googleapis.com"), 443, path, true);
-        _httpClient.addHeader(F("Content-Type"), F("application/json"));
-        
-        httpCode = _httpClient.POST(payload);
-        // A truncated/garbled body on an otherwise-OK response would silently
-        // yield empty fields; demote it to a failure so callers hit the error path.
-        const DeserializationError err = deserializeJson(response, _wifiClient);
+        httpCode = 0;
+        SCHEDULAR_STATS_ONLY(_endStats(httpCode);)
+        SCHEDULAR_TRACE_ONLY(_trace.record(SchedularTrace::EV_END, httpCode, _trace.elapsedUs());)
+    }
+
+    // `request` as text in an arena; "" (a failed request) when it is full.
+    static void _serialize(const JsonDocument& request, ArenaText& payload)
+    {
+        const size_t length = measureJson(request);
+        char* json = payload.prepare(length);
+        if (json != nullptr) {
+            serializeJson(request, json, length + 1);
+        }
+    }
+
+    // Common tail of every request: streams the reply body into `response`, then
+    // closes the shared clients and hands them back to the transport. A
+    // truncated/garbled body on an otherwise-OK response would silently yield
+    // empty fields; demote it to a failure so callers hit the error path.
+    void _readJsonResponse(int& httpCode, JsonDocument& response)
+    {
+        typename TTransport::Body& body = _transport.body();
+        SCHEDULAR_STATS_ONLY(_stats.mark(SchedularStats::PHASE_REQUEST);)
+        SCHEDULAR_STATS_ONLY(_stats.resolved(_transport.resolution().lookups, _transport.resolution().cached);)
+        SCHEDULAR_STATS_ONLY(_stats.connected(_transport.resolution().resolveUs + _transport.resolution().connectUs);)
+        SCHEDULAR_TRACE_ONLY(_trace.record(SchedularTrace::EV_RESPONSE, httpCode, _trace.elapsedUs());)
+        SCHEDULAR_TRACE_ONLY(_traceConnection();)
+        SCHEDULAR_TRACE_ONLY(const unsigned long parseUs = micros();)
+#ifdef SCHEDULAR_STATS
+        SchedularStats::Reader<typename TTransport::Body> counted(body, _stats);
+        PacedReader<SchedularStats::Reader<typename TTransport::Body> > reader(counted);
+        const DeserializationError err = deserializeJson(response, reader);
+        _stats.parsed();
+#else
+        PacedReader<typename TTransport::Body> reader(body);
+        const DeserializationError err = deserializeJson(response, reader);
+#endif
+        SCHEDULAR_TRACE_ONLY(_trace.record(SchedularTrace::EV_PARSE, err.code(), micros() - parseUs);)
         if (err && httpCode == HTTP_CODE_OK) {
             httpCode = 0;
         }
-        _wifiClient.stop();
-        _httpClient.end();
+        _transport.close();
+        SCHEDULAR_STATS_ONLY(_endStats(httpCode);)
+        SCHEDULAR_TRACE_ONLY(_trace.record(SchedularTrace::EV_END, httpCode, _trace.elapsedUs());)
+    }
+
+#ifdef SCHEDULAR_TRACE
+    // EV_DNS, then EV_CONNECT when the transport opened the socket itself.
+    void _traceConnection(void)
+    {
+        const typename TTransport::Resolution& r = _transport.resolution();
+        _trace.record(SchedularTrace::EV_DNS, r.lookups, r.resolveUs, r.cached);
+        if (r.connectUs != 0) {
+            _trace.record(SchedularTrace::EV_CONNECT, 0, r.connectUs);
+        }
+    }
+#endif
+
+#ifdef SCHEDULAR_STATS
+    // A positive code means the connection (and so a fresh TLS session, as
+    // every request closes the previous one) was established.
+    void _endStats(const int httpCode)
+    {
+        if (httpCode > 0) {
+            ++_stats.tlsHandshakes;
+        }
+        if (httpCode == HTTP_CODE_NOT_MODIFIED) {
+            ++_stats.notModified;
+        }
+        _stats.end(httpCode == HTTP_CODE_OK || httpCode == HTTP_CODE_PRECONDITION_REQUIRED);
     }
+#endif
 
-    const String _clientId;
-    const String _clientSecret;
-    String _refreshToken;
-    String _accessToken;
+    // Strings, or fixed buffers with SCHEDULAR_STATIC (see SchedularMemory.hpp).
+    const SchedularString<SCHEDULAR_CLIENT_ID_SIZE> _clientId;
+    const SchedularString<SCHEDULAR_CLIENT_SECRET_SIZE> _clientSecret;
+    SchedularString<SCHEDULAR_REFRESH_TOKEN_SIZE> _refreshToken;
+    SchedularString<SCHEDULAR_ACCESS_TOKEN_SIZE> _accessToken;
     int _lastAuthHttpCode = 0;
+    SchedularArena* _jsonArena = nullptr;
 
-    HTTPClient _httpClient;
-    WiFiClientSecure _wifiClient;
+    TTransport& _transport;
+#ifdef SCHEDULAR_STATS
+    SchedularStats _stats;
+#endif
+#ifdef SCHEDULAR_TRACE
+    SchedularTrace _trace;
+#endif
 };
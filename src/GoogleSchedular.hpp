@@ -21,6 +21,16 @@
 #include <TimestampNtp.hpp>
 
 
+#include "SchedularStats.hpp"
+#include "SchedularTrace.hpp"
+#include "SchedularMemory.hpp"
+#include "ChannelMatcher.hpp"
+#include "EventFilter.hpp"
+#include "Recurrence.hpp"
+#include "EventTimeline.hpp"
+#include "SchedularSleep.hpp"
+#include "SchedularTransport.hpp"
+#include "PosixTransport.hpp"
 #include "GoogleOAuth2.hpp"
 #include "GoogleApiCalendar.hpp"
 
@@ -30,6 +40,29 @@
 //#endif
 
 
+/**
+ * A resolved calendar id, for the sketch to keep across reboots, as it keeps
+ * the refresh_token (see BasicGoogleSchedular::setCalendarCache()). A plain
+ * struct: store it as is, in flash, EEPROM or RTC memory. All zeroes is an
+ * empty cache.
+ */
+struct CalendarCache {
+    uint32_t nameHash;                          // of the name it was resolved for
+    uint32_t checkedAt;                         // Ntp time of the last check
+    char id[SCHEDULAR_CALENDAR_ID_SIZE];
+
+    // FNV-1a of a calendar name.
+    static uint32_t hash(const char* name)
+    {
+        uint32_t h = 2166136261UL;
+        while (*name != '\0') {
+            h = (h ^ static_cast<uint8_t>(*name++)) * 16777619UL;
+        }
+        return h;
+    }
+};
+
+
 /**
  * Use a Google Calendar as a scheduler for an Arduino / ESP project.
  *
@@ -54,11 +87,41 @@
  *
  * Time comes from an injected NTP source (Ntp*), used both to time-box the
  * requests and to know when the access_token has to be refreshed.
+ *
+ * The HTTP/TLS layer is the TTransport policy (see SchedularTransport.hpp);
+ * GoogleSchedular, defined below, is this class on the platform's default one.
  */
-class GoogleSchedular : public GoogleApiCalendar {
+template <class TTransport = SchedularTransport>
+class BasicGoogleSchedular : public GoogleApiCalendar<TTransport> {
 
     public:
 
+    typedef GoogleApiCalendar<TTransport> Calendar;
+    typedef GoogleOAuth2<TTransport> OAuth2;
+    typedef typename OAuth2::Response Response;
+    // std::list<String>, or a FixedList with SCHEDULAR_STATIC.
+    typedef SchedularEventList EventList;
+
+    using OAuth2::getRefreshToken;
+    using OAuth2::setRefreshToken;
+    using OAuth2::lastAuthHttpCode;
+    using OAuth2::requestDeviceAndUserCode;
+    using OAuth2::pollAuthorization;
+    using OAuth2::refreshAccessToken;
+    using OAuth2::setJsonArena;
+    using OAuth2::getJsonArena;
+    using Calendar::getCalendars;
+    using Calendar::getCalendar;
+    using Calendar::getEvents;
+#ifdef SCHEDULAR_STATS
+    using OAuth2::stats;
+    using OAuth2::resetStats;
+#endif
+#ifdef SCHEDULAR_TRACE
+    using OAuth2::trace;
+    using OAuth2::clearTrace;
+#endif
+
     /*
     State is a 4-bit CADE bitmask, one bit per acquired credential/condition:
     - C: Calendar   => a calendar.id has been resolved
@@ -83,7 +146,8 @@ class GoogleSchedular : public GoogleApiCalendar {
 
 
     // Init list ordered to match member declaration order below (avoids -Wreorder).
-    GoogleSchedular(const String& clientId, const String& clientSecret, Ntp* ntp) : GoogleApiCalendar(clientId, clientSecret), _state(State::VOID), _ntp(ntp), _expirationTimestamp(0), _eventList() {}
+    // Schedulers share TTransport::shared() unless given a transport.
+    BasicGoogleSchedular(const String& clientId, const String& clientSecret, Ntp* ntp, TTransport& transport = TTransport::shared()) : Calendar(clientId, clientSecret, transport), _state(State::VOID), _ntp(ntp), _expirationTimestamp(0), _eventList(), _channels(nullptr), _activeChannels(0), _recurrences(nullptr), _timeline(nullptr), _cache(nullptr), _persistCache(nullptr), _cacheTrust(0) {}
 
     // Lifecycle predicates, all cheap bit tests on the CADE state.
     bool hasFailed(void) const       { return _state == State::ERROR; }
@@ -99,7 +163,144 @@ class GoogleSchedular : public GoogleApiCalendar {
     bool isAuthInvalid(void) const   { return _state == State::ERROR && lastAuthHttpCode() == 400; }
 
     // Titles of the events matched by the last syncAt() call, oldest first.
-    std::list<String>getEventList(void) const { return _eventList; }
+    // Returned by reference: valid until the next syncAt(), and no copy of the
+    // list or of its Strings is made.
+    const EventList& getEventList(void) const { return _eventList; }
+
+    // Switches syncAt() to channel output: each title is matched against
+    // `channels` (see ChannelMatcher.hpp) straight from the parsed reply, and
+    // only the mask is kept -- getEventList() then stays empty. The matcher
+    // must outlive the scheduler; nullptr goes back to the event list.
+    void setChannels(const ChannelMatcher* channels)
+    {
+        _channels = channels;
+        _activeChannels = 0;
+        _eventList.clear();
+    }
+
+    // Channels matched by the events of the last successful syncAt().
+    uint32_t getActiveChannels(void) const { return _activeChannels; }
+
+    // Switches syncAt() to local expansion (see Recurrence.hpp): the events of
+    // the next store->refreshSeconds() are fetched unexpanded, once, and each
+    // syncAt() until then is answered from `store` with no request. Rules the
+    // store cannot expand leave that window to the server, as before. The
+    // store must outlive the scheduler; nullptr goes back to server expansion.
+    void setRecurrences(RecurrenceStore* store)
+    {
+        _recurrences = store;
+        if (store != nullptr) {
+            store->clear();
+        }
+    }
+
+    // Switches syncAt() to a local timeline (see EventTimeline.hpp): the
+    // events of the next timeline->horizonSeconds() are fetched once, with
+    // their start and end, and each syncAt() until then is answered from
+    // `timeline` with no request. The timeline stays readable for time
+    // queries (nextTransition(), durations). A usable RecurrenceStore takes
+    // precedence. The timeline must outlive the scheduler; nullptr goes back
+    // to a request per syncAt().
+    void setTimeline(EventTimeline* timeline)
+    {
+        _timeline = timeline;
+        if (timeline != nullptr) {
+            timeline->clear();
+        }
+    }
+
+    const EventTimeline* getTimeline(void) const { return _timeline; }
+
+
+    // Lets setCalendar() start from the id in `cache` instead of the whole
+    // calendar list. When the cache holds an id resolved for the same name,
+    // setCalendar() only checks it with a request for that calendar's summary
+    // (no request at all within `trustSeconds` of the last check, if not 0),
+    // and goes back to the list only when the check fails. Each resolution or
+    // check updates `cache`, then calls `persist` (if any) for the sketch to
+    // save it. `cache` must outlive the scheduler; nullptr disables it.
+    void setCalendarCache(CalendarCache* cache, void (*persist)(const CalendarCache&) = nullptr, const uint32_t trustSeconds = 0)
+    {
+        _cache = cache;
+        _persistCache = persist;
+        _cacheTrust = trustSeconds;
+    }
+
+
+    // Duty cycle for battery nodes (see SchedularSleep.hpp). After a
+    // syncAt() at Unix time `now`, keeps in `state` what a wake-up needs and
+    // returns the seconds to sleep: until the next event starts or ends, or
+    // the timeline is due for a reload, whichever comes first, and at most
+    // `maxSeconds`.
+    uint32_t suspend(SleepState& state, const uint32_t now, const uint32_t maxSeconds = SCHEDULAR_SLEEP_MAX)
+    {
+        state.clear();
+        state.sleptAt = now;
+        state.wakeAt = nextWakeUp(now, maxSeconds);
+        state.state = static_cast<uint8_t>(_state);
+        // A token that does not fit is refreshed by the next request.
+        if (_accessToken.length() < sizeof(state.accessToken)) {
+            memcpy(state.accessToken, _accessToken.c_str(), _accessToken.length() + 1);
+            state.expiresAt = _expirationTimestamp;
+        }
+        if (_calendarId.length() < sizeof(state.calendarId)) {
+            memcpy(state.calendarId, _calendarId.c_str(), _calendarId.length() + 1);
+        }
+        if (_timeline != nullptr) {
+            memcpy(state.timeline, _timeline, sizeof(state.timeline));
+            state.hasTimeline = true;
+        }
+        state.seal();
+        return state.wakeAt - now;
+    }
+
+    // On wake-up, in place of the boot sequence (maintain(), setCalendar()):
+    // true, LINKED again with the session, calendar and timeline of
+    // suspend(), if `state` is valid and was taken linked. The timeline goes
+    // back into the one given to setTimeline(). The clock is the sketch's
+    // business: state.wakeAt is the time it planned to wake up at.
+    bool resume(const SleepState& state)
+    {
+        if (!state.isValid() || state.state != State::LINKED || state.calendarId[0] == '\0' ||
+            !schedularKeep(_calendarId, state.calendarId) || !schedularKeep(_accessToken, state.accessToken)) {
+            return false;
+        }
+        _expirationTimestamp = state.expiresAt;
+        if (_timeline != nullptr) {
+            if (state.hasTimeline) {
+                memcpy(_timeline, state.timeline, sizeof(state.timeline));
+            } else {
+                _timeline->clear();
+            }
+        }
+        _enter(State::LINKED);
+        return true;
+    }
+
+    // Whether a syncAt() at `now` goes to the network: not linked, no
+    // timeline, or one due for a reload or that did not fit. If not, the
+    // sketch can sync without bringing the network (or NTP) up.
+    bool needsRequest(const uint32_t now) const
+    {
+        return !isLinked() || _timeline == nullptr || _timeline->isStale(now) || !_timeline->isUsable();
+    }
+
+    // Unix time of the next wake-up after `now` (see suspend()).
+    uint32_t nextWakeUp(const uint32_t now, const uint32_t maxSeconds = SCHEDULAR_SLEEP_MAX) const
+    {
+        uint32_t wake = now + (maxSeconds != 0 ? maxSeconds : 1);
+        if (_timeline != nullptr && !_timeline->isStale(now)) {
+            const uint32_t reload = _timeline->loadedAt() + _timeline->horizonSeconds();
+            if (reload < wake) {
+                wake = reload;
+            }
+            const uint32_t next = _timeline->isUsable() ? _timeline->nextTransition(now) : 0;
+            if (next != 0 && next < wake) {
+                wake = next;
+            }
+        }
+        return wake;
+    }
 
 
     bool hasExpired(void)
@@ -112,25 +313,37 @@ class GoogleSchedular : public GoogleApiCalendar {
     // goes to ERROR (so the caller can tell "request failed" from "calendar not
     // found"); on success it moves to LINKED if the name matches, otherwise
     // stays AUTHENTICATED. The comparison is done while streaming the
-    // (id, summary) list, so only the matched id is kept.
-    void setCalendar(String calendarName)
+    // (id, summary) list, so only the matched id is kept. With a calendar
+    // cache, a cached id still valid spares the list (see setCalendarCache()).
+    void setCalendar(const String& calendarName)
     {
         if (_state & State::AUTHENTICATED) {
-            JsonDocument doc;
-            const GoogleOAuth2::Response ret = getCalendars(doc);
+            if (_linkCached(calendarName)) {
+                return;
+            }
 
-            if (ret != GoogleOAuth2::OK) {
-                _state = State::ERROR;
+            SchedularDocument doc(_jsonArena);
+            const Response ret = getCalendars(doc);
+
+            if (ret != OAuth2::OK) {
+                _enter(State::ERROR);
                 return;
             }
 
-            _state = State::AUTHENTICATED;
+            _enter(State::AUTHENTICATED);
 
+            // Compared and copied as const char* straight from the document,
+            // so scanning the list builds no String per calendar.
             const JsonArray items = doc[F("items")].as<JsonArray>();
+            SchedularPace pace(SCHEDULAR_PARSE_SLICE_ITEMS);
             for (JsonObject item : items) {
-                if (calendarName.equals(item[F("summary")].as<String>())) {
-                    _calendarId = item[F("id")].as<String>();
-                    _state = State::LINKED;
+                pace.step();
+                const char* summary = item[F("summary")].as<const char*>();
+                if (summary != nullptr && calendarName.equals(summary)) {
+                    if (schedularKeep(_calendarId, item[F("id")].as<const char*>())) {
+                        _enter(State::LINKED);
+                        _storeCache(calendarName);
+                    }
                     break;
                 }
             }
@@ -145,16 +358,18 @@ class GoogleSchedular : public GoogleApiCalendar {
     void startQuietRegistration()
     {
         String url;
-        startRegistration(url, _accessToken);
-        _state = State::VOID;
+        String code;
+        startRegistration(url, code);
+        _accessToken = code;
+        _enter(State::VOID);
     }
 
     // Returns the pending user_code once (arming registration), then "" on later
     // calls. Pairs with startQuietRegistration().
     String getQuietUserCode(void) {
         if (_state == State::VOID) {
-            _state = State::INIT;
-            return _accessToken;
+            _enter(State::INIT);
+            return _accessToken.c_str();
         }
 
         return "";
@@ -167,21 +382,23 @@ class GoogleSchedular : public GoogleApiCalendar {
     // this reuse keeps the object free of a dedicated interval member.
     void startRegistration(String& url, String& code)
     {
-        _state = State::VOID;
+        _enter(State::VOID);
 
-        const String scope = GoogleApiCalendar::scope();
-        JsonDocument doc;
-        const GoogleOAuth2::Response ret = requestDeviceAndUserCode(doc, scope);
+        const String scope = Calendar::scope();
+        SchedularDocument doc(_jsonArena);
+        const Response ret = requestDeviceAndUserCode(doc, scope);
 
-        if (ret == GoogleOAuth2::OK) {
+        if (ret == OAuth2::OK) {
             url  = doc[F("verification_url")].as<String>();
             code = doc[F("user_code")].as<String>();
 
             const uint8_t interval = doc[F("interval")];
-            _calendarId = String(interval);
+            char digits[4];
+            snprintf(digits, sizeof(digits), "%u", interval);
+            _calendarId = digits;
 
             _setExpirationTimestamp(interval);
-            _state = State::INIT;
+            _enter(State::INIT);
         }
     }
 
@@ -201,6 +418,8 @@ class GoogleSchedular : public GoogleApiCalendar {
         // A genuine invalid_grant (400) is left sticky for the sketch to re-pair.
         if (hasFailed() && !isAuthInvalid() && _refreshToken.length() > 8) {
             _accessToken = "";
+            SCHEDULAR_STATS_ONLY(++_stats.retries;)
+            SCHEDULAR_TRACE_ONLY(_trace.record(SchedularTrace::EV_RETRY, lastAuthHttpCode());)
         }
 
         // already authenticated
@@ -223,7 +442,7 @@ class GoogleSchedular : public GoogleApiCalendar {
                 // tell a dead credential (must re-register) from a transient
                 // failure (retry), and owns the retry cadence.
                 if (!_accessToken.isEmpty()) {
-                    _state = State::AUTHENTICATED;
+                    _enter(State::AUTHENTICATED);
                 }
             } else {
                 // access_token present (startQuietRegistration), or the
@@ -241,24 +460,24 @@ class GoogleSchedular : public GoogleApiCalendar {
     void handleRegistration(void)
     {
         if (_expirationTimestamp < _ntp->time()) {
-            JsonDocument doc;
-            const GoogleOAuth2::Response ret = pollAuthorization(doc);
+            SchedularDocument doc(_jsonArena);
+            const Response ret = pollAuthorization(doc);
 
             switch (ret) {
-                case GoogleOAuth2::PENDING: {
+                case OAuth2::PENDING: {
                     const uint8_t interval = _calendarId.toInt();
                     _setExpirationTimestamp(interval);
                     break;
                 }
-                case GoogleOAuth2::OK: {
+                case OAuth2::OK: {
                     const uint16_t expiresInSeconds = doc[F("expires_in")];
                     _setSecureExpirationTimestamp(expiresInSeconds);
-                    _state = State::AUTHENTICATED;
+                    _enter(State::AUTHENTICATED);
                     break;
                 }
                 default: {
                     _setExpirationTimestamp(0);
-                    _state = State::ERROR;
+                    _enter(State::ERROR);
                 }
             }
         }
@@ -269,13 +488,13 @@ class GoogleSchedular : public GoogleApiCalendar {
     void maintainAuthorization(const bool force=false)
     {
         if (force || hasExpired()) {
-            JsonDocument doc;
-            const GoogleOAuth2::Response ret = refreshAccessToken(doc);
-            if (ret == GoogleOAuth2::OK) {
+            SchedularDocument doc(_jsonArena);
+            const Response ret = refreshAccessToken(doc);
+            if (ret == OAuth2::OK) {
                 const uint16_t expiresInSeconds = doc[F("expires_in")];
                 _setSecureExpirationTimestamp(expiresInSeconds);
             } else {
-                _state = State::ERROR;
+                _enter(State::ERROR);
             }
         }
     }
@@ -336,47 +555,287 @@ class GoogleSchedular : public GoogleApiCalendar {
             return false;               // no timestamp
         }
 
-        GoogleOAuth2::Response ret;
-        JsonDocument doc;
-        {
-            // Copy into two stack buffers so the source (possibly the NTP
-            // client's internal c_str() buffer) is never mutated.
-            char t0[21];
-            char t1[21];
-            memcpy(t0, ts, 20); t0[20] = '\0';
-            memcpy(t1, ts, 20); t1[20] = '\0';
-            t0[18] = '0';
-            t1[18] = '9';
-
-            ret = getEvents(doc, _calendarId, t0, t1);
+        SCHEDULAR_TRACE_ONLY(const unsigned long t0 = micros();)
+        bool ok = _recurrences == nullptr || _loadRecurrences(ts);
+        const bool expand = ok && _recurrences != nullptr && _recurrences->isUsable();
+        if (ok && !expand && _timeline != nullptr) {
+            ok = _loadTimeline(ts);
         }
+        if (ok) {
+            ok = expand ? _expandRecurrences(ts)
+               : _timeline != nullptr && _timeline->isUsable() ? _readTimeline(ts)
+               : _channels != nullptr ? _fetchChannels(_calendarId.c_str(), ts, *_channels, _activeChannels)
+               : _fetchEvents(_calendarId.c_str(), ts, _eventList);
+        }
+        SCHEDULAR_TRACE_ONLY(_traceSync(ok, expand, micros() - t0);)
+        if (!ok) {
+            _enter(State::ERROR);
+            return false;
+        }
+        return true;
+    }
+
+    // Backward-compatible overload for String callers. Prefer the const char*
+    // form fed by TimestampNtp::c_str() to avoid the extra String allocation.
+    bool syncAt(const String& ts) { return syncAt(ts.c_str()); }
+
 
-        if (ret != GoogleOAuth2::OK) {
-            _state = State::ERROR;
+    protected:
+
+    using OAuth2::_refreshToken;
+    using OAuth2::_accessToken;
+    using OAuth2::_jsonArena;
+#ifdef SCHEDULAR_STATS
+    using OAuth2::_stats;
+#endif
+#ifdef SCHEDULAR_TRACE
+    using OAuth2::_trace;
+#endif
+
+    // Every state change goes through here, so it can be traced.
+    void _enter(const State state)
+    {
+        SCHEDULAR_TRACE_ONLY(if (state != _state) { _trace.record(SchedularTrace::EV_STATE, state); })
+        _state = state;
+    }
+
+#ifdef SCHEDULAR_TRACE
+    // EV_SYNC: where the answer of syncAt() came from, negated on failure.
+    void _traceSync(const bool ok, const bool expand, const uint32_t us)
+    {
+        const int source = expand ? SchedularTrace::SYNC_RECURRENCES
+                         : _timeline != nullptr && _timeline->isUsable() ? SchedularTrace::SYNC_TIMELINE
+                         : SchedularTrace::SYNC_REQUEST;
+        _trace.record(SchedularTrace::EV_SYNC, ok ? source : -source, us);
+    }
+#endif
+
+    // Queries the events of `calendarId` at `ts`. The window [timeMin,
+    // timeMax] is built on the stack (see syncAt()).
+    Response _queryEvents(JsonDocument& doc, const char* calendarId, const char* ts)
+    {
+        // Copy into two stack buffers so the source (possibly the NTP
+        // client's internal c_str() buffer) is never mutated.
+        char t0[21];
+        char t1[21];
+        memcpy(t0, ts, 20); t0[20] = '\0';
+        memcpy(t1, ts, 20); t1[20] = '\0';
+        t0[18] = '0';
+        t1[18] = '9';
+
+        return getEvents(doc, calendarId, t0, t1);
+    }
+
+    // Body of syncAt(), for one calendar id and event list: queries the events
+    // at `ts` and, on success only, replaces `eventList` with their titles.
+    // Leaves the state alone; shared with schedulers that follow several
+    // calendars (DeadlineSchedular.hpp).
+    bool _fetchEvents(const char* calendarId, const char* ts, EventList& eventList)
+    {
+        SchedularDocument doc(_jsonArena);
+        if (_queryEvents(doc, calendarId, ts) != OAuth2::OK) {
             return false;
         }
 
-        _eventList.clear();
+        eventList.clear();
 
         const JsonArray items = doc[F("items")].as<JsonArray>();
+        const EventFilter* filter = _detailedFilter();
+        SchedularPace pace(SCHEDULAR_PARSE_SLICE_ITEMS);
 
         for (JsonObject item : items) {
-            // Read the first (and, thanks to fields=items(summary), only)
-            // member of each item by iterator instead of by the "summary"
-            // key. This skips a key lookup / string compare per event.
-            // !!! only valid because the query masks fields to items(summary) !!!
-            const String summary = item.begin()->value().as<String>();
-            _eventList.push_back(summary);
+            pace.step();
+            if (filter != nullptr && !filter->accepts(item)) {
+                continue;
+            }
+            // Pushed as const char*: the list builds its item in place.
+            const char* title = _title(item, filter);
+            eventList.push_back(title != nullptr ? title : "");
         }
         return true;
     }
 
-    // Backward-compatible overload for String callers. Prefer the const char*
-    // form fed by TimestampNtp::c_str() to avoid the extra String allocation.
-    bool syncAt(const String& ts) { return syncAt(ts.c_str()); }
+    // The filter when it drops events on the device (the reply then carries
+    // more than titles), else nullptr.
+    const EventFilter* _detailedFilter(void) const
+    {
+        const EventFilter* filter = Calendar::getEventFilter();
+        return filter != nullptr && filter->needsDetails() ? filter : nullptr;
+    }
 
+    // Title of an events reply item. With fields=items(summary) it is the
+    // first (and only) member, read by iterator instead of by the "summary"
+    // key: this skips a key lookup / string compare per event. A detailed
+    // filter widens the mask, and the key is looked up then.
+    static const char* _title(const JsonObject item, const EventFilter* filter)
+    {
+        if (filter != nullptr) {
+            return item[F("summary")].as<const char*>();
+        }
+        return item.begin()->value().as<const char*>();
+    }
 
-    protected:
+    // Same query, but the titles only go through `channels`: the matched
+    // channels are OR-ed into `mask` (replaced on success only), read as
+    // const char* from the document, so no String is built per event.
+    bool _fetchChannels(const char* calendarId, const char* ts, const ChannelMatcher& channels, uint32_t& mask)
+    {
+        SchedularDocument doc(_jsonArena);
+        if (_queryEvents(doc, calendarId, ts) != OAuth2::OK) {
+            return false;
+        }
+
+        uint32_t matched = 0;
+        const JsonArray items = doc[F("items")].as<JsonArray>();
+        const EventFilter* filter = _detailedFilter();
+        SchedularPace pace(SCHEDULAR_PARSE_SLICE_ITEMS);
+        for (JsonObject item : items) {
+            pace.step();
+            if (filter != nullptr && !filter->accepts(item)) {
+                continue;
+            }
+            const char* title = _title(item, filter);
+            if (title != nullptr) {
+                matched |= channels.match(title);
+            }
+        }
+        mask = matched;
+        return true;
+    }
+
+    // Loads the RecurrenceStore when stale, with the events of
+    // [ts, ts + refreshSeconds]. False only when the request fails; a reply
+    // the store cannot expand is rejected until the next refresh.
+    bool _loadRecurrences(const char* ts)
+    {
+        int32_t now, offset;
+        bool allDay;
+        if (!CivilTime::parseRfc3339(ts, now, offset, allDay) || !_recurrences->isStale(now)) {
+            return true;
+        }
+        char t0[21];
+        char t1[21];
+        memcpy(t0, ts, 20); t0[20] = '\0';
+        CivilTime::formatRfc3339(now + static_cast<int32_t>(_recurrences->refreshSeconds()), t1);
+
+        SchedularDocument doc(_jsonArena);
+        if (Calendar::getRecurringEvents(doc, _calendarId.c_str(), t0, t1) != OAuth2::OK) {
+            return false;
+        }
+        if (!_recurrences->load(doc[F("items")].as<JsonArray>(), now)) {
+            _recurrences->reject(now);
+        }
+        return true;
+    }
+
+    // syncAt() from the RecurrenceStore: no request.
+    bool _expandRecurrences(const char* ts)
+    {
+        int32_t now, offset;
+        bool allDay;
+        if (!CivilTime::parseRfc3339(ts, now, offset, allDay)) {
+            return false;
+        }
+        if (_channels != nullptr) {
+            uint32_t matched = 0;
+            const ChannelMatcher& channels = *_channels;
+            _recurrences->forEachActive(now, [&matched, &channels](const RecurrenceStore::Title& title) { matched |= channels.match(title.c_str()); });
+            _activeChannels = matched;
+        } else {
+            EventList& events = _eventList;
+            events.clear();
+            _recurrences->forEachActive(now, [&events](const RecurrenceStore::Title& title) { events.push_back(title.c_str()); });
+        }
+        SCHEDULAR_STATS_ONLY(++_stats.cacheHits;)
+        return true;
+    }
+
+    // Loads the EventTimeline when stale, with the events of
+    // [ts, ts + horizonSeconds]. False only when the request fails; a reply
+    // that does not fit is rejected until the next load.
+    bool _loadTimeline(const char* ts)
+    {
+        int32_t now, offset;
+        bool allDay;
+        if (!CivilTime::parseRfc3339(ts, now, offset, allDay) || !_timeline->isStale(now)) {
+            return true;
+        }
+        char t0[21];
+        char t1[21];
+        memcpy(t0, ts, 20); t0[20] = '\0';
+        CivilTime::formatRfc3339(now + static_cast<int32_t>(_timeline->horizonSeconds()), t1);
+
+        SchedularDocument doc(_jsonArena);
+        if (Calendar::getTimedEvents(doc, _calendarId.c_str(), t0, t1) != OAuth2::OK) {
+            return false;
+        }
+        _timeline->load(doc[F("items")].as<JsonArray>(), now, Calendar::getEventFilter());
+        return true;
+    }
+
+    // syncAt() from the EventTimeline: no request.
+    bool _readTimeline(const char* ts)
+    {
+        int32_t now, offset;
+        bool allDay;
+        if (!CivilTime::parseRfc3339(ts, now, offset, allDay)) {
+            return false;
+        }
+        const EventTimeline& timeline = *_timeline;
+        if (_channels != nullptr) {
+            uint32_t matched = 0;
+            const ChannelMatcher& channels = *_channels;
+            timeline.forEachActive(now, [&matched, &channels, &timeline](uint8_t i) { matched |= channels.match(timeline.title(i)); });
+            _activeChannels = matched;
+        } else {
+            EventList& events = _eventList;
+            events.clear();
+            timeline.forEachActive(now, [&events, &timeline](uint8_t i) { events.push_back(timeline.title(i)); });
+        }
+        SCHEDULAR_STATS_ONLY(++_stats.cacheHits;)
+        return true;
+    }
+
+    // setCalendar() from the cache: true, LINKED, if it holds an id for
+    // `calendarName` that is trusted or still has that summary. Anything else
+    // (no cache, another name, a failed check) leaves it to the list.
+    bool _linkCached(const String& calendarName)
+    {
+        if (_cache == nullptr || _cache->id[0] == '\0' || _cache->nameHash != CalendarCache::hash(calendarName.c_str())) {
+            return false;
+        }
+        const uint32_t now = _ntp->time();
+        if (_cacheTrust == 0 || now - _cache->checkedAt >= _cacheTrust) {
+            SchedularDocument doc(_jsonArena);
+            if (getCalendar(doc, _cache->id) != OAuth2::OK || !calendarName.equals(doc[F("summary")].as<const char*>())) {
+                return false;
+            }
+            _cache->checkedAt = now;
+            if (_persistCache != nullptr) {
+                _persistCache(*_cache);
+            }
+        }
+        if (!schedularKeep(_calendarId, _cache->id)) {
+            return false;
+        }
+        SCHEDULAR_STATS_ONLY(++_stats.cacheHits;)
+        _enter(State::LINKED);
+        return true;
+    }
+
+    // Records the id just resolved for `calendarName`.
+    void _storeCache(const String& calendarName)
+    {
+        if (_cache == nullptr || _calendarId.length() >= sizeof(_cache->id)) {
+            return;
+        }
+        _cache->nameHash = CalendarCache::hash(calendarName.c_str());
+        _cache->checkedAt = _ntp->time();
+        memcpy(_cache->id, _calendarId.c_str(), _calendarId.length() + 1);
+        if (_persistCache != nullptr) {
+            _persistCache(*_cache);
+        }
+    }
 
     // Arm _expirationTimestamp exactly `expiresInSeconds` from now. Used for
     // short-lived, non-token deadlines such as the registration poll interval.
@@ -389,7 +848,7 @@ class GoogleSchedular : public GoogleApiCalendar {
     // access_token so it is refreshed before Google's real expiry.
     void _setSecureExpirationTimestamp(const uint16_t expiresInSeconds)
     {
-        _expirationTimestamp = _ntp->time() + expiresInSeconds - GoogleSchedular::EXPIRATION_TIME_MARGIN;
+        _expirationTimestamp = _ntp->time() + expiresInSeconds - EXPIRATION_TIME_MARGIN;
     }
 
     // NOTE: _calendarId doubles as scratch storage for the OAuth polling
@@ -397,9 +856,18 @@ class GoogleSchedular : public GoogleApiCalendar {
     // doubles as both the poll-interval timer and the token-refresh deadline.
     // These overlaps are safe because the phases never run at the same time.
     State _state;
-    String _calendarId;
+    SchedularString<SCHEDULAR_CALENDAR_ID_SIZE> _calendarId;
     Ntp* _ntp = nullptr;
     unsigned long _expirationTimestamp;
-    std::list<String> _eventList;
+    EventList _eventList;
+    const ChannelMatcher* _channels;
+    uint32_t _activeChannels;
+    RecurrenceStore* _recurrences;
+    EventTimeline* _timeline;
+    CalendarCache* _cache;
+    void (*_persistCache)(const CalendarCache&);
+    uint32_t _cacheTrust;
 
 };
+
+typedef BasicGoogleSchedular<> GoogleSchedular;
@@ -0,0 +1,578 @@
+#pragma once
+
+
+#if !defined(ESP8266) && !defined(ESP32) && (defined(__unix__) || defined(__APPLE__))
+
+#include <Arduino.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <string>
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef SCHEDULAR_OPENSSL
+  #include <openssl/ssl.h>
+#endif
+
+#include "SchedularTransport.hpp"
+#include "SchedularDns.hpp"
+#include "SchedularGzip.hpp"
+
+
+// Status codes the library compares against, as the ESP cores' HTTPClient
+// names them.
+#ifndef HTTP_CODE_OK
+#define HTTP_CODE_OK 200
+#endif
+#ifndef HTTP_CODE_NOT_MODIFIED
+#define HTTP_CODE_NOT_MODIFIED 304
+#endif
+#ifndef HTTP_CODE_PRECONDITION_REQUIRED
+#define HTTP_CODE_PRECONDITION_REQUIRED 428
+#endif
+
+
+/**
+ * Transport policy for native Linux (and other POSIX) builds.
+ *
+ * Runs the unmodified scheduler logic as a host binary, for profiling it or
+ * driving it against a local stand-in for the Google endpoints. Requests are
+ * HTTP/1.0 over a blocking socket, connected and read through a small buffer
+ * with a poll() timeout, and the connection is closed after every
+ * request -- the same shape as the device transport.
+ *
+ * Two ways to reach a server:
+ *  - setEndpoint("127.0.0.1", 8080): every host is sent, in plain HTTP, to that
+ *    address (the Host header still names the Google host). No TLS involved,
+ *    for a loopback stand-in server.
+ *  - otherwise, TLS to the real host on port 443, when built with
+ *    SCHEDULAR_OPENSSL (link -lssl -lcrypto). The peer certificate is verified
+ *    against the system store -- a desktop can afford it -- and the TLS session
+ *    of each host is resumed on its next connection, as BearSSL does on the
+ *    ESP8266. Without OpenSSL such a request fails with ERROR_CONNECT.
+ *
+ * Negative status codes mirror HTTPClient's: the library treats any of them as
+ * a transient failure. One instance serves one thread at a time; give each
+ * thread its own.
+ */
+class PosixTransport : public SchedularTransportBase {
+
+    public:
+
+    enum Error : int {
+        ERROR_CONNECT     = -1,
+        ERROR_SEND        = -2,
+        ERROR_NO_STATUS   = -11,
+    };
+
+    // The connection, read by deserializeJson() through read()/readBytes().
+    // Each call waits up to the timeout for missing bytes, like
+    // Stream::readBytes().
+    class Socket {
+
+        public:
+
+        Socket() : _fd(-1), _pos(0), _len(0), _timeoutMs(5000)
+#ifdef SCHEDULAR_OPENSSL
+            , _ssl(nullptr)
+#endif
+        {}
+
+        int read(void)
+        {
+            if (_pos == _len && !_fill()) {
+                return -1;
+            }
+            return static_cast<unsigned char>(_buffer[_pos++]);
+        }
+
+        size_t readBytes(char* buffer, const size_t length)
+        {
+            size_t n = 0;
+            while (n < length) {
+                if (_pos == _len && !_fill()) {
+                    break;
+                }
+                const size_t k = (_len - _pos) < (length - n) ? (_len - _pos) : (length - n);
+                memcpy(buffer + n, _buffer + _pos, k);
+                _pos += k;
+                n += k;
+            }
+            return n;
+        }
+
+        void setTimeout(const unsigned long ms) { _timeoutMs = ms; }
+
+        protected:
+
+        friend class PosixTransport;
+
+        void _open(const int fd)
+        {
+            _fd = fd;
+            _pos = 0;
+            _len = 0;
+        }
+
+        // Refills the buffer; false on timeout, error or end of stream.
+        bool _fill(void)
+        {
+            if (_fd < 0) {
+                return false;
+            }
+#ifdef SCHEDULAR_OPENSSL
+            // Bytes OpenSSL already decrypted do not show up on the socket.
+            if (_ssl != nullptr && SSL_pending(_ssl) == 0 && !_wait()) {
+                return false;
+            }
+            const int n = _ssl != nullptr ? SSL_read(_ssl, _buffer, sizeof(_buffer))
+                                          : (_wait() ? static_cast<int>(recv(_fd, _buffer, sizeof(_buffer), 0)) : -1);
+#else
+            const int n = _wait() ? static_cast<int>(recv(_fd, _buffer, sizeof(_buffer), 0)) : -1;
+#endif
+            if (n <= 0) {
+                return false;
+            }
+            _pos = 0;
+            _len = static_cast<size_t>(n);
+            return true;
+        }
+
+        bool _wait(void) const
+        {
+            struct pollfd p;
+            p.fd = _fd;
+            p.events = POLLIN;
+            p.revents = 0;
+            int r;
+            do {
+                r = poll(&p, 1, static_cast<int>(_timeoutMs));
+            } while (r < 0 && errno == EINTR);
+            return r > 0;
+        }
+
+        int _fd;
+        size_t _pos;
+        size_t _len;
+        unsigned long _timeoutMs;
+#ifdef SCHEDULAR_OPENSSL
+        SSL* _ssl;
+#endif
+        char _buffer[512];
+    };
+
+    // A resolved address, as getaddrinfo() gives it.
+    struct Address {
+        sockaddr_storage addr;
+        socklen_t length;
+    };
+
+    // What the DNS cache ages entries by, and connections are timed with:
+    // the host's monotonic clock, as a host build's millis() may be a shim
+    // that does not move.
+    struct MonotonicClock {
+        static unsigned long now(void) { return static_cast<unsigned long>(_read() / 1000000ULL); }
+
+        static unsigned long micros(void) { return static_cast<unsigned long>(_read() / 1000ULL); }
+
+        static uint64_t _read(void)
+        {
+            struct timespec t;
+            clock_gettime(CLOCK_MONOTONIC, &t);
+            return static_cast<uint64_t>(t.tv_sec) * 1000000000ULL + static_cast<uint64_t>(t.tv_nsec);
+        }
+    };
+
+    // What the reply is read from: the socket, or a GzipReader over it with
+    // SCHEDULAR_GZIP (see SchedularGzip.hpp).
+#ifdef SCHEDULAR_GZIP
+    typedef GzipReader<Socket> Body;
+#else
+    typedef Socket Body;
+#endif
+
+
+    PosixTransport() : _socket(), _endpoint(), _endpointPort(0), _host(HOST_OAUTH2), _busy(false)
+#ifdef SCHEDULAR_OPENSSL
+        , _ctx(nullptr)
+#endif
+    {
+#ifdef SCHEDULAR_OPENSSL
+        memset(_sessions, 0, sizeof(_sessions));
+#endif
+    }
+
+    ~PosixTransport()
+    {
+        _disconnect();
+#ifdef SCHEDULAR_OPENSSL
+        for (uint8_t i = 0; i < HOST_COUNT; ++i) {
+            if (_sessions[i] != nullptr) {
+                SSL_SESSION_free(_sessions[i]);
+            }
+        }
+        if (_ctx != nullptr) {
+            SSL_CTX_free(_ctx);
+        }
+#endif
+    }
+
+    PosixTransport(const PosixTransport&) = delete;
+    PosixTransport& operator=(const PosixTransport&) = delete;
+
+    // Process-wide instance, used by every scheduler not given its own.
+    // Shared by all threads, so only for single-threaded programs.
+    static PosixTransport& shared(void)
+    {
+        static PosixTransport transport;
+        return transport;
+    }
+
+    // Sends every request, in plain HTTP, to `address`:`port` instead of the
+    // Google host (see the class comment). An empty address restores TLS.
+    void setEndpoint(const char* address, const uint16_t port)
+    {
+        const char* a = address != nullptr ? address : "";
+        if (_endpoint != a || _endpointPort != port) {
+            _dns.clear();
+        }
+        _endpoint = a;
+        _endpointPort = port;
+    }
+
+    // How long a resolved address is reused, in seconds (SCHEDULAR_DNS_TTL by
+    // default; 0 resolves on every connection).
+    void setDnsTtl(const uint32_t seconds) { _dns.setTtl(seconds); }
+
+    // Longest wait for a connection, then for the next bytes of a reply
+    // (default 5 s).
+    void setTimeout(const unsigned long ms) { _socket.setTimeout(ms); }
+
+    bool acquire(const Host host)
+    {
+        if (_busy) {
+            return false;
+        }
+        _busy = true;
+        _host = host;
+        return true;
+    }
+
+    void release(void) { _busy = false; }
+
+    bool isBusy(void) const { return _busy; }
+
+    int post(const char* path, const char* json)
+    {
+        const size_t length = strlen(json);
+        std::string head = "POST ";
+        head += path;
+        head += " HTTP/1.0\r\nContent-Type: application/json\r\nContent-Length: ";
+        head += std::to_string(length);
+        head += "\r\n";
+        return _exchange(head, json, length);
+    }
+
+    int get(const char* path, const char* authorization)
+    {
+        std::string head = "GET ";
+        head += path;
+        head += " HTTP/1.0\r\nAuthorization: ";
+        head += authorization;
+        head += "\r\n";
+        return _exchange(head, nullptr, 0);
+    }
+
+    Body& body(void)
+    {
+#ifdef SCHEDULAR_GZIP
+        return _gzip;
+#else
+        return _socket;
+#endif
+    }
+
+    void close(void)
+    {
+        _disconnect();
+        release();
+    }
+
+
+    protected:
+
+    const char* _hostName(void) const { return reinterpret_cast<const char*>(hostName(_host)); }
+
+    // Connects, sends `head` + the common headers + `payload`, and reads the
+    // status line and headers, leaving the body to body().
+    int _exchange(std::string& head, const char* payload, const size_t length)
+    {
+        head += "Host: ";
+        head += _hostName();
+        head += "\r\nUser-Agent: GoogleSchedular\r\nConnection: close\r\n";
+#ifdef SCHEDULAR_GZIP
+        head += "Accept-Encoding: gzip\r\n";
+        _gzip.begin(_socket);
+#endif
+        head += "\r\n";
+
+        if (!_connect()) {
+            return ERROR_CONNECT;
+        }
+        if (!_send(head.data(), head.size()) || (length != 0 && !_send(payload, length))) {
+            return ERROR_SEND;
+        }
+        return _readStatus();
+    }
+
+    // Connects to the address cached for the host (see SchedularDns.hpp), or
+    // resolves the name again when there is none or it no longer answers. The
+    // name, not the address, goes into SNI and the Host header.
+    bool _connect(void)
+    {
+        const unsigned long t0 = MonotonicClock::micros();
+        _resolution = Resolution();
+        const bool ok = _open();
+        _resolution.connectUs = MonotonicClock::micros() - t0 - _resolution.resolveUs;
+        return ok;
+    }
+
+    bool _open(void)
+    {
+        const bool plain = !_endpoint.empty();
+#ifndef SCHEDULAR_OPENSSL
+        if (!plain) {
+            return false;
+        }
+#endif
+        int fd = -1;
+        const Address* cached = _dns.find(_host);
+        if (cached != nullptr) {
+            _resolution.cached = true;
+            fd = _dial(*cached);
+            if (fd < 0) {
+                _dns.forget(_host);
+            }
+        }
+        if (fd < 0) {
+            ++_resolution.lookups;
+            fd = _resolve(plain);
+        }
+        if (fd < 0) {
+            return false;
+        }
+        const int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        _socket._open(fd);
+
+#ifdef SCHEDULAR_OPENSSL
+        if (!plain && !_startTls()) {
+            _disconnect();
+            return false;
+        }
+#endif
+        return true;
+    }
+
+    // Looks the host (or the endpoint) up and connects to the first address
+    // that answers, which is then cached.
+    int _resolve(const bool plain)
+    {
+        char port[8];
+        snprintf(port, sizeof(port), "%u", plain ? static_cast<unsigned>(_endpointPort) : 443u);
+
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* found = nullptr;
+        const unsigned long t0 = MonotonicClock::micros();
+        const int error = getaddrinfo(plain ? _endpoint.c_str() : _hostName(), port, &hints, &found);
+        _resolution.resolveUs = MonotonicClock::micros() - t0;
+        if (error != 0) {
+            return -1;
+        }
+        int fd = -1;
+        for (struct addrinfo* a = found; a != nullptr && fd < 0; a = a->ai_next) {
+            if (a->ai_addrlen > sizeof(sockaddr_storage)) {
+                continue;
+            }
+            Address address;
+            memcpy(&address.addr, a->ai_addr, a->ai_addrlen);
+            address.length = a->ai_addrlen;
+            fd = _dial(address);
+            if (fd >= 0) {
+                _dns.store(_host, address);
+            }
+        }
+        freeaddrinfo(found);
+        return fd;
+    }
+
+    // Connects without blocking past the timeout: an address that drops the
+    // SYN would otherwise hold the thread for the kernel's minutes of retries.
+    int _dial(const Address& address) const
+    {
+        const int fd = socket(address.addr.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        const int flags = fcntl(fd, F_GETFL, 0);
+        if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) != 0 || !_connected(fd, address) || fcntl(fd, F_SETFL, flags) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    bool _connected(const int fd, const Address& address) const
+    {
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address.addr), address.length) == 0) {
+            return true;
+        }
+        if (errno != EINPROGRESS) {
+            return false;
+        }
+        struct pollfd p;
+        p.fd = fd;
+        p.events = POLLOUT;
+        p.revents = 0;
+        int r;
+        do {
+            r = poll(&p, 1, static_cast<int>(_socket._timeoutMs));
+        } while (r < 0 && errno == EINTR);
+        int error = 0;
+        socklen_t length = sizeof(error);
+        return r > 0 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+    }
+
+#ifdef SCHEDULAR_OPENSSL
+    bool _startTls(void)
+    {
+        if (_ctx == nullptr) {
+            _ctx = SSL_CTX_new(TLS_client_method());
+            if (_ctx == nullptr) {
+                return false;
+            }
+            SSL_CTX_set_default_verify_paths(_ctx);
+            SSL_CTX_set_verify(_ctx, SSL_VERIFY_PEER, nullptr);
+            SSL_CTX_set_session_cache_mode(_ctx, SSL_SESS_CACHE_CLIENT);
+        }
+        SSL* ssl = SSL_new(_ctx);
+        if (ssl == nullptr) {
+            return false;
+        }
+        _socket._ssl = ssl;
+        SSL_set_fd(ssl, _socket._fd);
+        SSL_set_tlsext_host_name(ssl, _hostName());
+        SSL_set1_host(ssl, _hostName());
+        if (_sessions[_host] != nullptr) {
+            SSL_set_session(ssl, _sessions[_host]);
+        }
+        return SSL_connect(ssl) == 1;
+    }
+#endif
+
+    bool _send(const char* data, size_t length)
+    {
+        while (length != 0) {
+#ifdef SCHEDULAR_OPENSSL
+            const int n = _socket._ssl != nullptr ? SSL_write(_socket._ssl, data, static_cast<int>(length))
+                                                : static_cast<int>(send(_socket._fd, data, length, MSG_NOSIGNAL));
+#else
+            const int n = static_cast<int>(send(_socket._fd, data, length, MSG_NOSIGNAL));
+#endif
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            length -= static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // "HTTP/1.x NNN reason", then headers up to the blank line. HTTP/1.0 means
+    // no chunked encoding: what follows is the body as is.
+    int _readStatus(void)
+    {
+        char line[128];
+        if (!_readLine(line, sizeof(line)) || strncmp(line, "HTTP/1.", 7) != 0 || strlen(line) < 12) {
+            return ERROR_NO_STATUS;
+        }
+        const int code = atoi(line + 9);
+        do {
+            if (!_readLine(line, sizeof(line))) {
+                return ERROR_NO_STATUS;
+            }
+        } while (line[0] != '\0');
+        return code > 0 ? code : static_cast<int>(ERROR_NO_STATUS);
+    }
+
+    // One header line without its CRLF; longer lines are truncated.
+    bool _readLine(char* line, const size_t size)
+    {
+        size_t n = 0;
+        for (;;) {
+            const int c = _socket.read();
+            if (c < 0) {
+                return false;
+            }
+            if (c == '\n') {
+                break;
+            }
+            if (c != '\r' && n + 1 < size) {
+                line[n++] = static_cast<char>(c);
+            }
+        }
+        line[n] = '\0';
+        return true;
+    }
+
+    void _disconnect(void)
+    {
+#ifdef SCHEDULAR_OPENSSL
+        if (_socket._ssl != nullptr) {
+            SSL_SESSION* session = SSL_get1_session(_socket._ssl);
+            if (session != nullptr) {
+                if (_sessions[_host] != nullptr) {
+                    SSL_SESSION_free(_sessions[_host]);
+                }
+                _sessions[_host] = session;
+            }
+            SSL_free(_socket._ssl);
+            _socket._ssl = nullptr;
+        }
+#endif
+        if (_socket._fd >= 0) {
+            ::close(_socket._fd);
+            _socket._fd = -1;
+        }
+    }
+
+    Socket _socket;
+#ifdef SCHEDULAR_GZIP
+    Body _gzip;
+#endif
+    DnsCache<Address, HOST_COUNT, MonotonicClock> _dns;
+    std::string _endpoint;
+    uint16_t _endpointPort;
+    Host _host;
+    bool _busy;
+#ifdef SCHEDULAR_OPENSSL
+    SSL_CTX* _ctx;
+    SSL_SESSION* _sessions[HOST_COUNT];
+#endif
+};
+
+typedef PosixTransport SchedularTransport;
+
+#endif
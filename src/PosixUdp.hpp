@@ -0,0 +1,184 @@
+#pragma once
+
+
+#if !defined(ESP8266) && !defined(ESP32) && (defined(__unix__) || defined(__APPLE__))
+
+#include <Arduino.h>
+#include <Udp.h>
+
+#include <cstring>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+
+/**
+ * The core's UDP interface over a POSIX datagram socket, for native builds
+ * of the snapshot broadcast (SchedularBroadcast.hpp): a leader and followers
+ * as host processes, or on the loopback interface in a test.
+ *
+ * IPv4 only. parsePacket() never blocks, as on the ESP cores. Multicast is
+ * joined with the ESP8266 core's beginMulticast(interface, group, port),
+ * which also sends to groups through that interface (127.0.0.1 keeps it on
+ * the loopback).
+ */
+class PosixUdp : public UDP {
+
+    public:
+
+    PosixUdp() : _fd(-1), _in(65536), _length(0), _pos(0), _to(), _from() {}
+
+    ~PosixUdp() { stop(); }
+
+    uint8_t begin(uint16_t port) override
+    {
+        stop();
+        _fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        if (_fd < 0) {
+            return 0;
+        }
+        const int on = 1;
+        ::setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in local;
+        std::memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+        if (::bind(_fd, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+            stop();
+            return 0;
+        }
+        return 1;
+    }
+
+    uint8_t beginMulticast(IPAddress interfaceAddr, IPAddress multicast, uint16_t port)
+    {
+        if (!begin(port)) {
+            return 0;
+        }
+        ip_mreq group;
+        group.imr_multiaddr = _address(multicast);
+        group.imr_interface = _address(interfaceAddr);
+        const in_addr out = _address(interfaceAddr);
+        if (::setsockopt(_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group)) != 0 ||
+            ::setsockopt(_fd, IPPROTO_IP, IP_MULTICAST_IF, &out, sizeof(out)) != 0) {
+            stop();
+            return 0;
+        }
+        return 1;
+    }
+
+    void stop() override
+    {
+        if (_fd >= 0) {
+            ::close(_fd);
+            _fd = -1;
+        }
+        _length = 0;
+        _pos = 0;
+    }
+
+    int beginPacket(IPAddress ip, uint16_t port) override
+    {
+        std::memset(&_to, 0, sizeof(_to));
+        _to.sin_family = AF_INET;
+        _to.sin_addr = _address(ip);
+        _to.sin_port = htons(port);
+        _out.clear();
+        return _fd >= 0 ? 1 : 0;
+    }
+
+    size_t write(uint8_t c) override
+    {
+        _out.push_back(c);
+        return 1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override
+    {
+        _out.insert(_out.end(), buffer, buffer + size);
+        return size;
+    }
+
+    int endPacket() override
+    {
+        const ssize_t n = ::sendto(_fd, _out.data(), _out.size(), 0, reinterpret_cast<const sockaddr*>(&_to), sizeof(_to));
+        return n == static_cast<ssize_t>(_out.size()) ? 1 : 0;
+    }
+
+    // Size of the next datagram, 0 if none is waiting.
+    int parsePacket() override
+    {
+        _length = 0;
+        _pos = 0;
+        if (_fd < 0) {
+            return 0;
+        }
+        socklen_t size = sizeof(_from);
+        const ssize_t n = ::recvfrom(_fd, _in.data(), _in.size(), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&_from), &size);
+        if (n <= 0) {
+            return 0;
+        }
+        _length = static_cast<size_t>(n);
+        return static_cast<int>(n);
+    }
+
+    int available() override { return static_cast<int>(_length - _pos); }
+
+    int read() override { return _pos < _length ? _in[_pos++] : -1; }
+
+    int read(unsigned char* buffer, size_t len) override
+    {
+        const size_t n = len < _length - _pos ? len : _length - _pos;
+        std::memcpy(buffer, _in.data() + _pos, n);
+        _pos += n;
+        return static_cast<int>(n);
+    }
+
+    int read(char* buffer, size_t len) override { return read(reinterpret_cast<unsigned char*>(buffer), len); }
+
+    int peek() override { return _pos < _length ? _in[_pos] : -1; }
+
+    IPAddress remoteIP() override
+    {
+        const uint32_t a = ntohl(_from.sin_addr.s_addr);
+        return IPAddress(static_cast<uint8_t>(a >> 24), static_cast<uint8_t>(a >> 16), static_cast<uint8_t>(a >> 8), static_cast<uint8_t>(a));
+    }
+
+    uint16_t remotePort() override { return ntohs(_from.sin_port); }
+
+    // The port bound, as begin(0) picks one.
+    uint16_t localPort() const
+    {
+        sockaddr_in local;
+        socklen_t size = sizeof(local);
+        if (_fd < 0 || ::getsockname(_fd, reinterpret_cast<sockaddr*>(&local), &size) != 0) {
+            return 0;
+        }
+        return ntohs(local.sin_port);
+    }
+
+
+    protected:
+
+    static in_addr _address(const IPAddress& ip)
+    {
+        in_addr a;
+        a.s_addr = htonl((static_cast<uint32_t>(ip[0]) << 24) | (static_cast<uint32_t>(ip[1]) << 16) |
+                         (static_cast<uint32_t>(ip[2]) << 8) | static_cast<uint32_t>(ip[3]));
+        return a;
+    }
+
+    int _fd;
+    std::vector<uint8_t> _in;
+    size_t _length;
+    size_t _pos;
+    std::vector<uint8_t> _out;
+    sockaddr_in _to;
+    sockaddr_in _from;
+};
+
+#endif
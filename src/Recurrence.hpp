@@ -0,0 +1,733 @@
+#pragma once
+
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <limits.h>
+
+#include "SchedularMemory.hpp"
+
+
+// Events (recurring masters and single ones) a RecurrenceStore holds.
+#ifndef SCHEDULAR_MAX_RECURRENCES
+#define SCHEDULAR_MAX_RECURRENCES 16
+#endif
+
+// EXDATEs (and moved or cancelled instances) kept per recurring event.
+#ifndef SCHEDULAR_MAX_EXDATES
+#define SCHEDULAR_MAX_EXDATES 4
+#endif
+
+
+/**
+ * Calendar arithmetic on day numbers (days since 1970-01-01) and the date-time
+ * forms the Calendar API and RFC 5545 use. Proleptic Gregorian, no heap.
+ */
+class CivilTime {
+
+    public:
+
+    // Floor division: the day of a negative (pre-1970) second is still right.
+    static int32_t floorDiv(const int32_t a, const int32_t b)
+    {
+        return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+    }
+
+    // days_from_civil / civil_from_days (H. Hinnant), valid over the Unix era.
+    static int32_t daysFromCivil(int32_t y, const uint8_t m, const uint8_t d)
+    {
+        y -= m <= 2;
+        const int32_t era = (y >= 0 ? y : y - 399) / 400;
+        const uint32_t yoe = static_cast<uint32_t>(y - era * 400);
+        const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+        const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<int32_t>(doe) - 719468;
+    }
+
+    static void civilFromDays(int32_t z, int32_t& y, uint8_t& m, uint8_t& d)
+    {
+        z += 719468;
+        const int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+        const uint32_t doe = static_cast<uint32_t>(z - era * 146097);
+        const uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+        const uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+        const uint32_t mp = (5 * doy + 2) / 153;
+        d = static_cast<uint8_t>(doy - (153 * mp + 2) / 5 + 1);
+        m = static_cast<uint8_t>(mp < 10 ? mp + 3 : mp - 9);
+        y = static_cast<int32_t>(yoe) + era * 400 + (m <= 2);
+    }
+
+    // 0 = Monday .. 6 = Sunday (1970-01-01 was a Thursday).
+    static uint8_t weekday(const int32_t day)
+    {
+        const int32_t w = (day + 3) % 7;
+        return static_cast<uint8_t>(w < 0 ? w + 7 : w);
+    }
+
+    static uint8_t daysInMonth(const int32_t y, const uint8_t m)
+    {
+        static const uint8_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        const bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+        return m == 2 && leap ? 29 : days[m - 1];
+    }
+
+    // Parses `n` digits; false on anything else.
+    static bool digits(const char* s, const uint8_t n, int32_t& value)
+    {
+        value = 0;
+        for (uint8_t i = 0; i < n; ++i) {
+            if (s[i] < '0' || s[i] > '9') {
+                return false;
+            }
+            value = value * 10 + (s[i] - '0');
+        }
+        return true;
+    }
+
+    // RFC 3339 as the API sends it: "2024-11-04T09:00:00+01:00", "...Z",
+    // "...:00.000Z", or a date "2024-11-04" (allDay, at UTC midnight).
+    // `utc` is the instant, `offset` the seconds to add to get local time.
+    static bool parseRfc3339(const char* s, int32_t& utc, int32_t& offset, bool& allDay)
+    {
+        int32_t y, mo, d;
+        if (s == nullptr || !digits(s, 4, y) || s[4] != '-' || !digits(s + 5, 2, mo) || s[7] != '-' ||
+            !digits(s + 8, 2, d) || mo < 1 || mo > 12 || d < 1 || d > 31) {
+            return false;
+        }
+        const int32_t day = daysFromCivil(y, static_cast<uint8_t>(mo), static_cast<uint8_t>(d));
+        offset = 0;
+        allDay = s[10] == '\0';
+        if (allDay) {
+            utc = day * 86400;
+            return true;
+        }
+        int32_t h, mi, se;
+        if (s[10] != 'T' || !digits(s + 11, 2, h) || s[13] != ':' || !digits(s + 14, 2, mi) ||
+            s[16] != ':' || !digits(s + 17, 2, se)) {
+            return false;
+        }
+        const char* p = s + 19;
+        if (*p == '.') {
+            do { ++p; } while (*p >= '0' && *p <= '9');
+        }
+        if (*p == '+' || *p == '-') {
+            int32_t oh, om;
+            if (!digits(p + 1, 2, oh) || p[3] != ':' || !digits(p + 4, 2, om)) {
+                return false;
+            }
+            offset = (*p == '-' ? -1 : 1) * (oh * 3600 + om * 60);
+        } else if (*p != 'Z') {
+            return false;
+        }
+        utc = day * 86400 + h * 3600 + mi * 60 + se - offset;
+        return true;
+    }
+
+    // RFC 5545 basic form, as in UNTIL / EXDATE: "20241104T090000Z" (UTC),
+    // "20241104T090000" (local) or "20241104" (a date, local midnight). Gives
+    // the local day and second of day, converting UTC with `offset`.
+    static bool parseBasic(const char* s, const int32_t offset, int32_t& day, int32_t& second)
+    {
+        int32_t y, mo, d;
+        if (!digits(s, 4, y) || !digits(s + 4, 2, mo) || !digits(s + 6, 2, d) || mo < 1 || mo > 12) {
+            return false;
+        }
+        day = daysFromCivil(y, static_cast<uint8_t>(mo), static_cast<uint8_t>(d));
+        second = 0;
+        if (s[8] != 'T') {
+            return true;
+        }
+        int32_t h, mi, se;
+        if (!digits(s + 9, 2, h) || !digits(s + 11, 2, mi) || !digits(s + 13, 2, se)) {
+            return false;
+        }
+        second = h * 3600 + mi * 60 + se;
+        if (s[15] == 'Z') {
+            const int32_t local = day * 86400 + second + offset;
+            day = floorDiv(local, 86400);
+            second = local - day * 86400;
+        }
+        return true;
+    }
+
+    // "YYYY-MM-DDThh:mm:ssZ" for a Unix time, into a caller buffer.
+    static void formatRfc3339(const int32_t utc, char out[21])
+    {
+        const int32_t day = floorDiv(utc, 86400);
+        const int32_t sec = utc - day * 86400;
+        int32_t y;
+        uint8_t m, d;
+        civilFromDays(day, y, m, d);
+        int32_t fields[] = { y, m, d, sec / 3600, (sec / 60) % 60, sec % 60 };
+        const char* const layout = "0000-00-00T00:00:00Z";
+        uint8_t field = 5;
+        for (int8_t i = 19; i >= 0; --i) {
+            if (layout[i] == '0') {
+                out[i] = static_cast<char>('0' + fields[field] % 10);
+                fields[field] /= 10;
+            } else {
+                out[i] = layout[i];
+                field -= i < 19 && layout[i + 1] == '0';
+            }
+        }
+        out[20] = '\0';
+    }
+};
+
+
+/**
+ * One event, recurring or not, in the compact form the device expands itself:
+ * the RRULE subset FREQ=DAILY/WEEKLY/MONTHLY with INTERVAL, BYDAY (with one
+ * ordinal for MONTHLY, "1MO" / "-1FR"), BYMONTHDAY (one day; not WEEKLY, as
+ * RFC 5545 has it), WKST, UNTIL and COUNT, plus up to SCHEDULAR_MAX_EXDATES
+ * excluded instances. BYDAY and BYMONTHDAY both given must both match. At
+ * most one instance per day, at the time of day of the first one.
+ *
+ * Days are counted in the event's local frame: begin() takes the time of day
+ * in the offset of the first start, and `offset` turns Unix time back into
+ * that frame. It stays the first start's offset unless the owner moves it
+ * (RecurrenceStore::setLocalOffset()), so across a daylight saving change
+ * instances keep their wall-clock time only when the offset follows it.
+ */
+class RecurrenceRule {
+
+    public:
+
+    enum Frequency : uint8_t {
+        ONCE,
+        DAILY,
+        WEEKLY,
+        MONTHLY,
+    };
+
+    RecurrenceRule() { clear(); }
+
+    void clear(void)
+    {
+        parse("");
+        exdateCount = 0;
+        firstDay = 0;
+        startSecond = 0;
+        duration = 0;
+        offset = 0;
+    }
+
+    // Sets the first instance: local start and length in seconds.
+    void begin(const int32_t utcStart, const int32_t utcOffset, const int32_t seconds)
+    {
+        offset = utcOffset;
+        const int32_t local = utcStart + utcOffset;
+        firstDay = CivilTime::floorDiv(local, 86400);
+        startSecond = local - firstDay * 86400;
+        duration = seconds > 0 ? seconds : 0;
+    }
+
+    // Reads one "RRULE:..." line (after begin(); replaces a previous rule,
+    // keeps the EXDATEs). False on a part outside the supported subset, which
+    // the caller then leaves to the server.
+    bool parse(const char* line)
+    {
+        frequency = ONCE;
+        byDay = 0;
+        ordinal = 0;
+        monthDay = 0;
+        weekStart = 0;
+        interval = 1;
+        lastDay = INT32_MAX;
+        _count = 0;
+        if (strncmp(line, "RRULE:", 6) != 0) {
+            return false;
+        }
+        const char* p = line + 6;
+        while (*p != '\0') {
+            const char* eq = strchr(p, '=');
+            if (eq == nullptr) {
+                return false;
+            }
+            const char* end = strchr(eq, ';');
+            if (end == nullptr) {
+                end = eq + strlen(eq);
+            }
+            if (!_part(p, static_cast<size_t>(eq - p), eq + 1, end)) {
+                return false;
+            }
+            p = *end == ';' ? end + 1 : end;
+        }
+        if (frequency == ONCE || (frequency != MONTHLY && ordinal != 0) || (frequency == WEEKLY && monthDay != 0)) {
+            return false;               // not RFC 5545, or not expanded here
+        }
+        if (frequency == WEEKLY && byDay == 0) {
+            byDay = static_cast<uint8_t>(1 << CivilTime::weekday(firstDay));
+        }
+        if (frequency == MONTHLY && byDay == 0 && monthDay == 0) {
+            int32_t y;
+            uint8_t m;
+            CivilTime::civilFromDays(firstDay, y, m, monthDay);
+        }
+        if (_count != 0) {
+            _applyCount();
+        }
+        return true;
+    }
+
+    // Reads one "EXDATE[;params]:value[,value...]" line.
+    bool parseExdate(const char* line)
+    {
+        const char* p = strchr(line, ':');
+        if (strncmp(line, "EXDATE", 6) != 0 || p == nullptr) {
+            return false;
+        }
+        while (p != nullptr) {
+            int32_t day, second;
+            if (!CivilTime::parseBasic(p + 1, offset, day, second) || !exclude(day)) {
+                return false;
+            }
+            p = strchr(p + 1, ',');
+        }
+        return true;
+    }
+
+    // Drops the instance of local `day` (EXDATE, or an instance the server
+    // moved or cancelled). False when the table is full.
+    bool exclude(const int32_t day)
+    {
+        if (exdateCount == SCHEDULAR_MAX_EXDATES) {
+            return false;
+        }
+        exdates[exdateCount++] = day;
+        return true;
+    }
+
+    // Whether an instance starts on local `day`.
+    bool occursOn(const int32_t day) const
+    {
+        if (!_matches(day)) {
+            return false;
+        }
+        for (uint8_t i = 0; i < exdateCount; ++i) {
+            if (exdates[i] == day) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Whether an instance is running at Unix time `utc`.
+    bool isActiveAt(const int32_t utc) const
+    {
+        const int32_t local = utc + offset;
+        const int32_t last = CivilTime::floorDiv(local - startSecond, 86400);
+        int32_t first = CivilTime::floorDiv(local - startSecond - duration, 86400) + 1;
+        if (first < last - 62) {
+            first = last - 62;          // instances longer than two months: not looked for
+        }
+        for (int32_t day = last; day >= first; --day) {
+            if (occursOn(day)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Frequency frequency;
+    uint8_t byDay;                  // bit 0 = MO .. bit 6 = SU
+    int8_t ordinal;                 // MONTHLY BYDAY: 1..5, -1..-5, 0 = every
+    uint8_t monthDay;               // BYMONTHDAY, 0 = any day
+    uint8_t weekStart;              // WKST, 0 = MO
+    uint16_t interval;
+    uint8_t exdateCount;
+    int32_t exdates[SCHEDULAR_MAX_EXDATES];
+    int32_t firstDay;               // local day of the first instance
+    int32_t lastDay;                // last possible one (UNTIL / COUNT)
+    int32_t startSecond;            // local second of day of every instance
+    int32_t duration;
+    int32_t offset;                 // local = UTC + offset
+
+
+    protected:
+
+    static int8_t _weekday(const char* s)
+    {
+        static const char names[] = "MOTUWETHFRSASU";
+        for (uint8_t i = 0; i < 7; ++i) {
+            if (s[0] == names[2 * i] && s[1] == names[2 * i + 1]) {
+                return static_cast<int8_t>(i);
+            }
+        }
+        return -1;
+    }
+
+    bool _part(const char* key, const size_t length, const char* value, const char* end)
+    {
+        const size_t n = static_cast<size_t>(end - value);
+        int32_t number;
+        if (length == 4 && strncmp(key, "FREQ", 4) == 0) {
+            if (n == 5 && strncmp(value, "DAILY", 5) == 0)   { frequency = DAILY; return true; }
+            if (n == 6 && strncmp(value, "WEEKLY", 6) == 0)  { frequency = WEEKLY; return true; }
+            if (n == 7 && strncmp(value, "MONTHLY", 7) == 0) { frequency = MONTHLY; return true; }
+            return false;
+        }
+        if (length == 8 && strncmp(key, "INTERVAL", 8) == 0) {
+            if (n == 0 || n > 4 || !CivilTime::digits(value, static_cast<uint8_t>(n), number) || number == 0) {
+                return false;
+            }
+            interval = static_cast<uint16_t>(number);
+            return true;
+        }
+        if (length == 5 && strncmp(key, "COUNT", 5) == 0) {
+            if (n == 0 || n > 4 || !CivilTime::digits(value, static_cast<uint8_t>(n), number) || number == 0) {
+                return false;
+            }
+            _count = static_cast<uint16_t>(number);
+            return true;
+        }
+        if (length == 5 && strncmp(key, "UNTIL", 5) == 0) {
+            int32_t day, second;
+            if (!CivilTime::parseBasic(value, offset, day, second)) {
+                return false;
+            }
+            lastDay = second < startSecond && value[8] == 'T' ? day - 1 : day;
+            return true;
+        }
+        if (length == 4 && strncmp(key, "WKST", 4) == 0) {
+            const int8_t w = _weekday(value);
+            if (w < 0) {
+                return false;
+            }
+            weekStart = static_cast<uint8_t>(w);
+            return true;
+        }
+        if (length == 10 && strncmp(key, "BYMONTHDAY", 10) == 0) {
+            if (n == 0 || n > 2 || !CivilTime::digits(value, static_cast<uint8_t>(n), number) || number == 0 || number > 31) {
+                return false;
+            }
+            monthDay = static_cast<uint8_t>(number);
+            return true;
+        }
+        if (length == 5 && strncmp(key, "BYDAY", 5) == 0) {
+            bool first = true;
+            for (const char* p = value; p < end; ) {
+                const char* comma = p;
+                while (comma < end && *comma != ',') {
+                    ++comma;
+                }
+                int8_t ord = 0;
+                const char* q = p;
+                const bool negative = *q == '-';
+                if (*q == '-' || *q == '+') {
+                    ++q;
+                }
+                if (*q >= '1' && *q <= '5') {
+                    ord = static_cast<int8_t>((*q - '0') * (negative ? -1 : 1));
+                    ++q;
+                }
+                const int8_t w = comma - q == 2 ? _weekday(q) : -1;
+                if (w < 0 || (!first && ord != ordinal)) {
+                    return false;       // one ordinal for all the days only
+                }
+                ordinal = ord;
+                first = false;
+                byDay |= static_cast<uint8_t>(1 << w);
+                p = comma < end ? comma + 1 : end;
+            }
+            return true;
+        }
+        return false;                   // BYMONTH, BYSETPOS, BYHOUR, ...
+    }
+
+    bool _matches(const int32_t day) const
+    {
+        if (day < firstDay || day > lastDay) {
+            return false;
+        }
+        switch (frequency) {
+            case ONCE:
+                return day == firstDay;
+            case DAILY:
+                return (day - firstDay) % interval == 0 && _inMonthDay(day) &&
+                       (byDay == 0 || (byDay & (1 << CivilTime::weekday(day))));
+            case WEEKLY: {
+                if (!(byDay & (1 << CivilTime::weekday(day)))) {
+                    return false;
+                }
+                const int32_t weeks = (_weekOf(day) - _weekOf(firstDay)) / 7;
+                return weeks % interval == 0;
+            }
+            case MONTHLY: {
+                int32_t y, fy;
+                uint8_t m, d, fm, fd;
+                CivilTime::civilFromDays(day, y, m, d);
+                CivilTime::civilFromDays(firstDay, fy, fm, fd);
+                if (((y - fy) * 12 + m - fm) % interval != 0) {
+                    return false;
+                }
+                if (monthDay != 0 && d != monthDay) {
+                    return false;
+                }
+                if (byDay == 0) {
+                    return true;
+                }
+                if (!(byDay & (1 << CivilTime::weekday(day)))) {
+                    return false;
+                }
+                if (ordinal > 0) {
+                    return (d - 1) / 7 + 1 == ordinal;
+                }
+                if (ordinal < 0) {
+                    return (CivilTime::daysInMonth(y, m) - d) / 7 + 1 == -ordinal;
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // BYMONTHDAY, when given.
+    bool _inMonthDay(const int32_t day) const
+    {
+        if (monthDay == 0) {
+            return true;
+        }
+        int32_t y;
+        uint8_t m, d;
+        CivilTime::civilFromDays(day, y, m, d);
+        return d == monthDay;
+    }
+
+    // First day of the week (per WKST) holding `day`.
+    int32_t _weekOf(const int32_t day) const
+    {
+        return day - (CivilTime::weekday(day) + 7 - weekStart) % 7;
+    }
+
+    // COUNT becomes a last day: walk the instances (EXDATEs count, RFC 5545)
+    // for up to ten years; past that the rule is left open.
+    void _applyCount(void)
+    {
+        uint16_t seen = 0;
+        for (int32_t day = firstDay; day <= firstDay + 3660 && day <= lastDay; ++day) {
+            if (_matches(day) && ++seen == _count) {
+                lastDay = day;
+                return;
+            }
+        }
+    }
+
+    uint16_t _count;
+};
+
+
+/**
+ * Recurring events of a calendar, fetched unexpanded and expanded locally.
+ *
+ * load() compiles a singleEvents=false reply (see
+ * GoogleApiCalendar::getRecurringEvents()) into at most
+ * SCHEDULAR_MAX_RECURRENCES RecurrenceRules: each recurring master with its
+ * rule and EXDATEs, each single event as a one-off, and each exception the
+ * server sends (an instance moved or cancelled) as an excluded day of its
+ * master plus, when moved, a one-off of its own. Anything outside the
+ * supported subset (another frequency, RDATE, too many events) fails the
+ * load, and the caller then leaves the expansion to the server.
+ *
+ * Given to GoogleSchedular::setRecurrences(), it is loaded again once
+ * `refreshSeconds` have passed; in between, syncAt() answers without any
+ * request. All-day events are taken at the local midnight of
+ * setAllDayOffset() (UTC by default), as the API gives them no offset; timed
+ * ones are expanded in setLocalOffset() once the sketch sets it.
+ */
+class RecurrenceStore {
+
+    public:
+
+    // String, or a FixedString with SCHEDULAR_STATIC (cut to fit).
+    typedef SchedularString<SCHEDULAR_TITLE_SIZE> Title;
+
+    struct Event {
+        Title title;
+        RecurrenceRule rule;
+        bool allDay;
+    };
+
+    explicit RecurrenceStore(const uint32_t refreshSeconds = 86400)
+        : _refresh(refreshSeconds), _loadedAt(0), _allDayOffset(0), _localOffset(0), _size(0), _hasLocalOffset(false), _loaded(false), _usable(false) {}
+
+    void setAllDayOffset(const int32_t seconds) { _allDayOffset = seconds; }
+
+    // UTC offset timed events are expanded in, from now on (loaded ones too):
+    // the sketch sets it again at each daylight saving change, and instances
+    // keep the wall-clock time of their first start. Unset, each event keeps
+    // the offset of its first start, which may be months old.
+    void setLocalOffset(const int32_t seconds)
+    {
+        _localOffset = seconds;
+        _hasLocalOffset = true;
+        for (uint8_t i = 0; i < _size; ++i) {
+            if (!_events[i].allDay) {
+                _events[i].rule.offset = seconds;
+            }
+        }
+    }
+
+    // Seconds a load is trusted for; also the window it is fetched for.
+    uint32_t refreshSeconds(void) const { return _refresh; }
+
+    bool isStale(const uint32_t now) const { return !_loaded || now - _loadedAt >= _refresh; }
+
+    // Whether the last load succeeded (else the server expands instances).
+    bool isUsable(void) const { return _usable; }
+
+    uint8_t size(void) const { return _size; }
+
+    const Event& event(const uint8_t i) const { return _events[i]; }
+
+    void clear(void)
+    {
+        _size = 0;
+        _loaded = false;
+        _usable = false;
+    }
+
+    // Marks a load at `now` that could not be used.
+    void reject(const uint32_t now)
+    {
+        _size = 0;
+        _loadedAt = now;
+        _loaded = true;
+        _usable = false;
+    }
+
+    bool load(const JsonArray& items, const uint32_t now)
+    {
+        _size = 0;
+        _loadedAt = now;
+        _loaded = true;
+        _usable = false;
+
+        // Masters and one-offs.
+        for (JsonObject item : items) {
+            if (_isCancelled(item)) {
+                continue;
+            }
+            if (_size == SCHEDULAR_MAX_RECURRENCES || !_compile(item, _events[_size])) {
+                _size = 0;
+                return false;
+            }
+            ++_size;
+        }
+        // Exceptions: exclude the original instance from the master.
+        for (JsonObject item : items) {
+            const char* master = item[F("recurringEventId")].as<const char*>();
+            if (master == nullptr) {
+                continue;
+            }
+            RecurrenceRule* rule = _find(items, master);
+            int32_t utc, offset;
+            bool allDay;
+            const JsonObject original = item[F("originalStartTime")].as<JsonObject>();
+            if (rule == nullptr || !_start(original, utc, offset, allDay)) {
+                continue;               // master not in this window
+            }
+            if (!rule->exclude(CivilTime::floorDiv(utc + rule->offset, 86400))) {
+                _size = 0;
+                return false;
+            }
+        }
+        _usable = true;
+        return true;
+    }
+
+    // Calls `f(title)` for each event running at Unix time `utc`.
+    template <class F>
+    void forEachActive(const uint32_t utc, F f) const
+    {
+        for (uint8_t i = 0; i < _size; ++i) {
+            if (_events[i].rule.isActiveAt(static_cast<int32_t>(utc))) {
+                f(_events[i].title);
+            }
+        }
+    }
+
+
+    protected:
+
+    static bool _isCancelled(const JsonObject& item)
+    {
+        const char* status = item[F("status")].as<const char*>();
+        return status != nullptr && strcmp(status, "cancelled") == 0;
+    }
+
+    // {"dateTime": "..."} or {"date": "..."}.
+    bool _start(const JsonObject& when, int32_t& utc, int32_t& offset, bool& allDay) const
+    {
+        const char* s = when[F("dateTime")].as<const char*>();
+        if (s == nullptr) {
+            s = when[F("date")].as<const char*>();
+        }
+        if (!CivilTime::parseRfc3339(s, utc, offset, allDay)) {
+            return false;
+        }
+        if (allDay) {
+            utc -= _allDayOffset;
+            offset = _allDayOffset;
+        }
+        return true;
+    }
+
+    bool _compile(const JsonObject& item, Event& e) const
+    {
+        int32_t start, end, offset, endOffset;
+        bool allDay, endAllDay;
+        if (!_start(item[F("start")].as<JsonObject>(), start, offset, allDay) ||
+            !_start(item[F("end")].as<JsonObject>(), end, endOffset, endAllDay)) {
+            return false;
+        }
+        const char* summary = item[F("summary")].as<const char*>();
+        e.title = summary != nullptr ? summary : "";
+        e.rule.clear();
+        e.rule.begin(start, offset, end - start);
+        for (JsonVariant line : item[F("recurrence")].as<JsonArray>()) {
+            const char* s = line.as<const char*>();
+            if (s == nullptr) {
+                return false;
+            }
+            const bool ok = strncmp(s, "RRULE:", 6) == 0 ? e.rule.parse(s)
+                          : strncmp(s, "EXDATE", 6) == 0 ? e.rule.parseExdate(s)
+                          : false;      // RDATE, EXRULE
+            if (!ok) {
+                return false;
+            }
+        }
+        e.allDay = allDay;
+        if (!allDay && _hasLocalOffset) {
+            e.rule.offset = _localOffset;   // EXDATEs above read in the start's own offset
+        }
+        return true;
+    }
+
+    // Rule of the master event `id`: its index among the non-cancelled items.
+    RecurrenceRule* _find(const JsonArray& items, const char* id)
+    {
+        uint8_t i = 0;
+        for (JsonObject item : items) {
+            if (_isCancelled(item)) {
+                continue;
+            }
+            const char* itemId = item[F("id")].as<const char*>();
+            if (itemId != nullptr && strcmp(itemId, id) == 0) {
+                return &_events[i].rule;
+            }
+            ++i;
+        }
+        return nullptr;
+    }
+
+    Event _events[SCHEDULAR_MAX_RECURRENCES];
+    uint32_t _refresh;
+    uint32_t _loadedAt;
+    int32_t _allDayOffset;
+    int32_t _localOffset;
+    uint8_t _size;
+    bool _hasLocalOffset;
+    bool _loaded;
+    bool _usable;
+};
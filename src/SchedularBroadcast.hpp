@@ -0,0 +1,359 @@
+#pragma once
+
+
+#include <Arduino.h>
+#include <Udp.h>
+
+#include "EventTimeline.hpp"
+
+
+// Bytes of the largest snapshot: header, every event of a full timeline and
+// the CRC. Leader and follower each hold one packet buffer of this size.
+#ifndef SCHEDULAR_SNAPSHOT_SIZE
+#define SCHEDULAR_SNAPSHOT_SIZE (TimelineSnapshot::HEADER + SCHEDULAR_TIMELINE_EVENTS * TimelineSnapshot::EVENT + SCHEDULAR_TIMELINE_TITLES + TimelineSnapshot::CRC)
+#endif
+
+
+/**
+ * Binary form of an EventTimeline, for one node to share what it fetched
+ * with the others of a room (see TimelineLeader / TimelineFollower).
+ *
+ * All integers little-endian:
+ *
+ *   0   2  magic "GS"
+ *   2   1  VERSION of the format
+ *   3   1  kind: KIND_TIMELINE or KIND_ACTIVE
+ *   4   4  sequence, counted by the leader
+ *   8   4  loadedAt, Unix time
+ *   12  4  validFor, seconds from loadedAt
+ *   16  1  events
+ *   17     per event: start (4), end (4), flags (1), title length (1), title
+ *          -- KIND_ACTIVE carries no start and end
+ *   ...  4 CRC-32 (IEEE 802.3) of all the bytes before
+ *
+ * KIND_TIMELINE is a timeline as loaded, start and end included. KIND_ACTIVE
+ * is the titles running at loadedAt, for a leader syncing without one; a
+ * follower reads them as events of [loadedAt, loadedAt + validFor).
+ */
+class TimelineSnapshot {
+
+    public:
+
+    static constexpr uint8_t VERSION = 1;
+
+    enum Kind : uint8_t {
+        KIND_TIMELINE = 1,
+        KIND_ACTIVE   = 2,
+    };
+
+    static constexpr size_t HEADER = 17;
+    static constexpr size_t EVENT  = 10;        // title aside
+    static constexpr size_t CRC    = 4;
+
+    // Writes `timeline` into `out`; the bytes written, 0 if it does not fit.
+    static size_t encode(const EventTimeline& timeline, const uint32_t sequence, uint8_t* out, const size_t size)
+    {
+        if (size < HEADER + CRC) {
+            return 0;
+        }
+        size_t n = _header(out, KIND_TIMELINE, sequence, timeline.loadedAt(), timeline.horizonSeconds(), timeline.size());
+        for (uint8_t i = 0; i < timeline.size(); ++i) {
+            const EventRecord& r = timeline.record(i);
+            if (n + EVENT + r.length + CRC > size) {
+                return 0;
+            }
+            _put32(out + n, r.start);
+            _put32(out + n + 4, r.end);
+            n += 8;
+            n += _putTitle(out + n, r.flags, timeline.title(i), r.length);
+        }
+        return _seal(out, n);
+    }
+
+    // Writes the `titles` (a list of String / FixedString) running at `now`,
+    // valid for `validFor` seconds; the bytes written, 0 if they do not fit.
+    template <class TList>
+    static size_t encodeActive(const TList& titles, const uint32_t now, const uint32_t validFor, const uint32_t sequence, uint8_t* out, const size_t size)
+    {
+        if (size < HEADER + CRC) {
+            return 0;
+        }
+        size_t n = HEADER;
+        uint8_t count = 0;
+        for (const auto& title : titles) {
+            const size_t length = title.length() < 255 ? title.length() : 255;
+            if (count == 255 || n + 2 + length + CRC > size) {
+                return 0;
+            }
+            n += _putTitle(out + n, 0, title.c_str(), length);
+            ++count;
+        }
+        _header(out, KIND_ACTIVE, sequence, now, validFor, count);
+        return _seal(out, n);
+    }
+
+    // Checks `in` (magic, version, length, CRC) and replaces `timeline`
+    // with it. False, `timeline` untouched, for a packet that does not
+    // check out; false, nothing usable, for one that does not fit the
+    // timeline (a leader built with larger SCHEDULAR_TIMELINE_* sizes).
+    static bool decode(const uint8_t* in, const size_t length, EventTimeline& timeline, uint32_t& sequence)
+    {
+        if (!check(in, length)) {
+            return false;
+        }
+        const uint8_t kind = in[3];
+        const uint32_t loadedAt = _get32(in + 8);
+        const uint32_t validFor = _get32(in + 12);
+        sequence = _get32(in + 4);
+
+        timeline.setHorizonSeconds(validFor);
+        timeline.beginLoad(loadedAt);
+        size_t n = HEADER;
+        for (uint8_t i = 0; i < in[16]; ++i) {
+            uint32_t start = loadedAt;
+            uint32_t end = loadedAt + validFor;
+            if (kind == KIND_TIMELINE) {
+                start = _get32(in + n);
+                end = _get32(in + n + 4);
+                n += 8;
+            }
+            const uint8_t flags = in[n];
+            const uint8_t size = in[n + 1];
+            if (!timeline.insert(start, end, reinterpret_cast<const char*>(in + n + 2), size, (flags & EventRecord::ALL_DAY) != 0)) {
+                return false;
+            }
+            n += 2 + size;
+        }
+        return true;
+    }
+
+    // Whether `in` is a whole snapshot of this VERSION: magic, kind, the
+    // events within the length, and the CRC.
+    static bool check(const uint8_t* in, const size_t length)
+    {
+        if (length < HEADER + CRC || in[0] != 'G' || in[1] != 'S' || in[2] != VERSION ||
+            (in[3] != KIND_TIMELINE && in[3] != KIND_ACTIVE)) {
+            return false;
+        }
+        const size_t body = length - CRC;
+        if (crc32(in, body) != _get32(in + body)) {
+            return false;
+        }
+        const size_t times = in[3] == KIND_TIMELINE ? 8 : 0;
+        size_t n = HEADER;
+        for (uint8_t i = 0; i < in[16]; ++i) {
+            if (n + times + 2 > body) {
+                return false;
+            }
+            n += times + 2 + in[n + times + 1];
+        }
+        return n == body;
+    }
+
+    // Sequence of a snapshot that passed check().
+    static uint32_t sequenceOf(const uint8_t* in) { return _get32(in + 4); }
+
+    // Unix time a snapshot that passed check() was loaded at.
+    static uint32_t loadedAtOf(const uint8_t* in) { return _get32(in + 8); }
+
+    // CRC-32 (IEEE 802.3, reflected, as zlib), bit by bit: no table.
+    static uint32_t crc32(const uint8_t* data, size_t length)
+    {
+        uint32_t crc = 0xFFFFFFFFUL;
+        while (length-- != 0) {
+            crc ^= *data++;
+            for (uint8_t k = 0; k < 8; ++k) {
+                crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+            }
+        }
+        return ~crc;
+    }
+
+
+    protected:
+
+    static size_t _header(uint8_t* out, const uint8_t kind, const uint32_t sequence, const uint32_t loadedAt, const uint32_t validFor, const uint8_t count)
+    {
+        out[0] = 'G';
+        out[1] = 'S';
+        out[2] = VERSION;
+        out[3] = kind;
+        _put32(out + 4, sequence);
+        _put32(out + 8, loadedAt);
+        _put32(out + 12, validFor);
+        out[16] = count;
+        return HEADER;
+    }
+
+    static size_t _putTitle(uint8_t* out, const uint8_t flags, const char* title, const size_t length)
+    {
+        out[0] = flags;
+        out[1] = static_cast<uint8_t>(length);
+        memcpy(out + 2, title, length);
+        return 2 + length;
+    }
+
+    static size_t _seal(uint8_t* out, const size_t n)
+    {
+        _put32(out + n, crc32(out, n));
+        return n + CRC;
+    }
+
+    static void _put32(uint8_t* out, const uint32_t v)
+    {
+        out[0] = static_cast<uint8_t>(v);
+        out[1] = static_cast<uint8_t>(v >> 8);
+        out[2] = static_cast<uint8_t>(v >> 16);
+        out[3] = static_cast<uint8_t>(v >> 24);
+    }
+
+    static uint32_t _get32(const uint8_t* in)
+    {
+        return static_cast<uint32_t>(in[0]) | (static_cast<uint32_t>(in[1]) << 8) |
+               (static_cast<uint32_t>(in[2]) << 16) | (static_cast<uint32_t>(in[3]) << 24);
+    }
+};
+
+
+/**
+ * The node of a room that talks to Google: after each syncAt(), it sends
+ * what it got to the others in one UDP datagram, so they need neither OAuth2
+ * nor TLS, nor the RAM for them, and the calendar costs the API quota of one
+ * device.
+ *
+ * `udp` is begun by the sketch (any port); `group` is a multicast group the
+ * followers joined, or a broadcast / unicast address. UDP may lose a packet:
+ * publish again on every cycle, not only when something changed, and the
+ * followers drop the copies.
+ *
+ *   TimelineLeader leader(udp, IPAddress(239, 255, 42, 99), 4299);
+ *   if (gs.syncAt(ntp.c_str())) {
+ *       leader.publish(timeline);                       // with setTimeline()
+ *       leader.publishActive(gs.getEventList(), now, 60); // or without
+ *   }
+ */
+class TimelineLeader {
+
+    public:
+
+    TimelineLeader(UDP& udp, const IPAddress& group, const uint16_t port) : _udp(udp), _group(group), _port(port), _sequence(0), _loadedAt(0) {}
+
+    // Sends `timeline`. A timeline not loaded again since the last publish
+    // keeps its sequence. The bytes sent, 0 on failure.
+    size_t publish(const EventTimeline& timeline)
+    {
+        if (!timeline.isUsable()) {
+            return 0;
+        }
+        if (_sequence == 0 || timeline.loadedAt() != _loadedAt) {
+            ++_sequence;
+            _loadedAt = timeline.loadedAt();
+        }
+        return _send(TimelineSnapshot::encode(timeline, _sequence, _packet, sizeof(_packet)));
+    }
+
+    // Sends the `titles` running at Unix time `now`, for `validFor` seconds.
+    template <class TList>
+    size_t publishActive(const TList& titles, const uint32_t now, const uint32_t validFor)
+    {
+        ++_sequence;
+        _loadedAt = now;
+        return _send(TimelineSnapshot::encodeActive(titles, now, validFor, _sequence, _packet, sizeof(_packet)));
+    }
+
+    uint32_t sequence(void) const { return _sequence; }
+
+
+    protected:
+
+    size_t _send(const size_t length)
+    {
+        if (length == 0 || !_udp.beginPacket(_group, _port)) {
+            return 0;
+        }
+        _udp.write(_packet, length);
+        return _udp.endPacket() ? length : 0;
+    }
+
+    UDP& _udp;
+    IPAddress _group;
+    uint16_t _port;
+    uint32_t _sequence;
+    uint32_t _loadedAt;
+    uint8_t _packet[SCHEDULAR_SNAPSHOT_SIZE];
+};
+
+
+/**
+ * A node of a room that takes its events from a TimelineLeader instead of
+ * Google: poll() reads the datagrams waiting on `udp` into `timeline`, which
+ * the sketch then queries as its own (forEachActive(), nextTransition()).
+ *
+ * A snapshot replaces the timeline when it checks out (TimelineSnapshot::
+ * check()) and is newer: a later load, or another sequence of the same load.
+ * Copies and late packets are dropped. The timeline goes stale validFor
+ * seconds after the leader loaded it, so a follower that stops hearing from
+ * its leader finds out with isStale(now).
+ *
+ * `udp` is begun by the sketch on the leader's port, and has joined its
+ * multicast group if it sends to one (beginMulticast() of the core).
+ */
+class TimelineFollower {
+
+    public:
+
+    TimelineFollower(UDP& udp, EventTimeline& timeline) : _udp(udp), _timeline(timeline), _sequence(0), _received(0), _rejected(0) {}
+
+    // Reads the waiting datagrams; true if one replaced the timeline. One that
+    // checks out but does not fit the timeline leaves it unusable until the
+    // next, and counts as rejected.
+    bool poll(void)
+    {
+        bool updated = false;
+        for (int length = _udp.parsePacket(); length > 0; length = _udp.parsePacket()) {
+            const int n = _udp.read(_packet, sizeof(_packet));
+            ++_received;
+            if (n != length || !TimelineSnapshot::check(_packet, static_cast<size_t>(n))) {
+                ++_rejected;
+                continue;
+            }
+            if (!_isNewer(_packet)) {
+                continue;
+            }
+            uint32_t sequence;
+            if (!TimelineSnapshot::decode(_packet, static_cast<size_t>(n), _timeline, sequence)) {
+                ++_rejected;
+                continue;
+            }
+            _sequence = sequence;
+            updated = true;
+        }
+        return updated;
+    }
+
+    // Sequence of the snapshot in the timeline, 0 before the first.
+    uint32_t sequence(void) const { return _sequence; }
+
+    // Datagrams read, and those that were not a valid snapshot.
+    uint32_t received(void) const { return _received; }
+    uint32_t rejected(void) const { return _rejected; }
+
+
+    protected:
+
+    bool _isNewer(const uint8_t* packet) const
+    {
+        const uint32_t loadedAt = TimelineSnapshot::loadedAtOf(packet);
+        if (_sequence == 0 || loadedAt > _timeline.loadedAt()) {
+            return true;
+        }
+        return loadedAt == _timeline.loadedAt() && TimelineSnapshot::sequenceOf(packet) != _sequence;
+    }
+
+    UDP& _udp;
+    EventTimeline& _timeline;
+    uint32_t _sequence;
+    uint32_t _received;
+    uint32_t _rejected;
+    uint8_t _packet[SCHEDULAR_SNAPSHOT_SIZE];
+};
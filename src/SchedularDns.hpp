@@ -0,0 +1,86 @@
+#pragma once
+
+
+#include <Arduino.h>
+
+
+// How long a resolved address is reused before its host name is looked up
+// again, in seconds. 0 resolves on every connection.
+#ifndef SCHEDULAR_DNS_TTL
+#define SCHEDULAR_DNS_TTL 300
+#endif
+
+
+// The clock DnsCache ages its entries by: millis() on the devices. A host
+// build, whose millis() may be a test double, passes its own.
+struct SchedularMillis {
+    static unsigned long now(void) { return millis(); }
+};
+
+
+/**
+ * Addresses of the hosts a transport connects to, kept between connections.
+ *
+ * Every request opens a fresh connection, so without a cache each one starts
+ * with a name lookup on top of the TLS handshake. A transport keeps one
+ * DnsCache, connects to the cached address of the host while the name still
+ * goes out as SNI and in the Host header, and forgets the entry when a
+ * connection to it fails, so the next attempt resolves again.
+ *
+ * The resolvers at hand do not report the record's own TTL, so entries live
+ * for a fixed setTtl() (SCHEDULAR_DNS_TTL seconds): Google's records are
+ * short-lived, but the addresses behind them keep answering long after.
+ *
+ * Indexed by the transport's Host; TAddress is whatever the transport connects
+ * to (IPAddress, a sockaddr); TClock has a static now() in milliseconds.
+ */
+template <class TAddress, uint8_t HOSTS, class TClock = SchedularMillis>
+class DnsCache {
+
+    public:
+
+    DnsCache() : _ttlMs(SCHEDULAR_DNS_TTL * 1000UL) { clear(); }
+
+    void setTtl(const uint32_t seconds) { _ttlMs = seconds * 1000UL; }
+
+    uint32_t ttl(void) const { return _ttlMs / 1000UL; }
+
+    void clear(void)
+    {
+        for (uint8_t i = 0; i < HOSTS; ++i) {
+            _entries[i].valid = false;
+        }
+    }
+
+    // The address stored for `host` less than the TTL ago, or nullptr.
+    const TAddress* find(const uint8_t host) const
+    {
+        const Entry& e = _entries[host];
+        if (!e.valid || TClock::now() - e.storedAt >= _ttlMs) {
+            return nullptr;
+        }
+        return &e.address;
+    }
+
+    void store(const uint8_t host, const TAddress& address)
+    {
+        Entry& e = _entries[host];
+        e.address = address;
+        e.storedAt = TClock::now();
+        e.valid = true;
+    }
+
+    void forget(const uint8_t host) { _entries[host].valid = false; }
+
+
+    protected:
+
+    struct Entry {
+        TAddress address;
+        unsigned long storedAt;
+        bool valid;
+    };
+
+    Entry _entries[HOSTS];
+    unsigned long _ttlMs;
+};
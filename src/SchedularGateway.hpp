@@ -0,0 +1,388 @@
+#pragma once
+
+
+#if !defined(ESP8266) && !defined(ESP32) && (defined(__unix__) || defined(__APPLE__))
+
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "GoogleSchedular.hpp"
+#include "WorkStealingPool.hpp"
+
+#ifdef SCHEDULAR_STATIC
+#error "SchedularGateway is for hosts: build it without SCHEDULAR_STATIC"
+#endif
+
+
+// Bytes of event titles kept per calendar snapshot; longer lists are cut.
+#ifndef SCHEDULAR_GATEWAY_SNAPSHOT
+#define SCHEDULAR_GATEWAY_SNAPSHOT 256
+#endif
+
+
+/**
+ * Transport policy of the gateway: each worker thread gets its own
+ * PosixTransport, so the schedulers, which a calendar task may run on any
+ * worker, all share one GatewayTransport and never a connection.
+ *
+ * The endpoint and timeout are set once, before the gateway runs, and copied
+ * into the thread's transport on each acquire().
+ */
+class GatewayTransport : public SchedularTransportBase {
+
+    public:
+
+    typedef PosixTransport::Body Body;
+
+    GatewayTransport() : _endpoint(), _port(0), _timeoutMs(5000) {}
+
+    static GatewayTransport& shared(void)
+    {
+        static GatewayTransport transport;
+        return transport;
+    }
+
+    // See PosixTransport::setEndpoint() and setTimeout().
+    void setEndpoint(const char* address, const uint16_t port)
+    {
+        _endpoint = address != nullptr ? address : "";
+        _port = port;
+    }
+
+    void setTimeout(const unsigned long ms) { _timeoutMs = ms; }
+
+    bool acquire(const Host host)
+    {
+        PosixTransport& t = _local();
+        t.setEndpoint(_endpoint.c_str(), _port);
+        t.setTimeout(_timeoutMs);
+        return t.acquire(host);
+    }
+
+    int post(const char* path, const char* json)                { return _local().post(path, json); }
+    int get(const char* path, const char* authorization)        { return _local().get(path, authorization); }
+    Body& body(void)                                            { return _local().body(); }
+    void close(void)                                            { _local().close(); }
+    const Resolution& resolution(void) const                    { return _local().resolution(); }
+
+
+    protected:
+
+    static PosixTransport& _local(void)
+    {
+        static thread_local PosixTransport transport;
+        return transport;
+    }
+
+    std::string _endpoint;
+    uint16_t _port;
+    unsigned long _timeoutMs;
+};
+
+
+/**
+ * Wall clock for the gateway's schedulers (Ntp::time() is read from every
+ * worker thread, so the source must be thread-safe; the system clock is).
+ */
+class SystemClock : public Ntp {
+
+    public:
+
+    unsigned long time(void) const override { return static_cast<unsigned long>(::time(nullptr)); }
+};
+
+
+/**
+ * Host-native gateway: one Linux box keeps many calendars of many Google
+ * accounts in sync, for devices that then only read the result.
+ *
+ * Each calendar is a BasicGoogleSchedular driven through its usual states
+ * (AUTHENTICATED -> setCalendar() -> LINKED -> syncAt(), back to
+ * AUTHENTICATED after an ERROR). What changes is who holds the credentials:
+ *  - one scheduler per account owns the refresh_token and does the token
+ *    requests; the account's calendars copy its access_token when it changes.
+ *    A refresh is made by the first calendar task that needs it, under the
+ *    account's lock, so an account with 50 calendars still refreshes once. An
+ *    account whose refresh fails is not asked again in the same round.
+ *  - syncAll() deals one task per calendar to a WorkStealingPool and waits for
+ *    the round to finish; tasks only ever lock their account.
+ *
+ * Results are published per calendar as a fixed-size Snapshot, under a
+ * sequence lock: snapshot() never blocks and never allocates, and may be called
+ * from any thread at any time, including during a round. A snapshot keeps the
+ * titles of the last successful sync; `ok` tells whether the last attempt
+ * succeeded.
+ *
+ * Accounts and calendars are added before the first syncAll(), and syncAll()
+ * is called from one thread at a time.
+ */
+class SchedularGateway {
+
+    public:
+
+    typedef BasicGoogleSchedular<GatewayTransport> Schedular;
+
+    struct Snapshot {
+        uint32_t version;           // publications so far; 0: never synced
+        uint32_t syncedAt;          // clock time of the last successful sync
+        bool ok;                    // the last sync succeeded
+        bool truncated;             // some titles did not fit
+        uint8_t count;
+        char titles[SCHEDULAR_GATEWAY_SNAPSHOT];   // `count` NUL-terminated titles
+
+        // i-th title, i < count.
+        const char* title(uint8_t i) const
+        {
+            const char* p = titles;
+            while (i-- != 0) {
+                p += strlen(p) + 1;
+            }
+            return p;
+        }
+    };
+
+
+    SchedularGateway(Ntp* ntp, const unsigned threads = std::thread::hardware_concurrency())
+        : _ntp(ntp), _transport(), _pool(threads), _round(0), _synced(0) {}
+
+    SchedularGateway(const SchedularGateway&) = delete;
+    SchedularGateway& operator=(const SchedularGateway&) = delete;
+
+    GatewayTransport& transport(void) { return _transport; }
+
+    WorkStealingPool& pool(void) { return _pool; }
+
+    // Returns the account index, for addCalendar().
+    size_t addAccount(const String& clientId, const String& clientSecret, const String& refreshToken)
+    {
+        _accounts.push_back(std::unique_ptr<Account>(new Account(clientId, clientSecret, refreshToken, _ntp, _transport)));
+        return _accounts.size() - 1;
+    }
+
+    // Returns the calendar index, for snapshot().
+    size_t addCalendar(const size_t account, const String& calendarName)
+    {
+        _calendars.push_back(std::unique_ptr<Calendar>(new Calendar(*_accounts[account], calendarName, _ntp, _transport)));
+        return _calendars.size() - 1;
+    }
+
+    size_t accounts(void) const { return _accounts.size(); }
+    size_t calendars(void) const { return _calendars.size(); }
+
+    // Syncs every calendar at RFC3339 instant `ts` (see syncAt()), blocking
+    // until all are done. Returns how many succeeded.
+    size_t syncAll(const char* ts)
+    {
+        memcpy(_ts, ts, 20);
+        _ts[20] = '\0';
+        ++_round;
+        _synced = 0;
+        for (size_t i = 0; i < _calendars.size(); ++i) {
+            Calendar* c = _calendars[i].get();
+            _pool.submit([this, c] { _sync(*c); });
+        }
+        _pool.wait();
+        return _synced.load();
+    }
+
+    // Copies the latest published snapshot of a calendar. Lock-free: retries
+    // while a worker is publishing over it.
+    void snapshot(const size_t calendar, Snapshot& out) const
+    {
+        _calendars[calendar]->published.read(out);
+    }
+
+    // Access tokens obtained for an account so far (between rounds).
+    unsigned long tokenRefreshes(const size_t account) const { return _accounts[account]->refreshes; }
+
+
+    protected:
+
+    // A scheduler whose access_token is handed to it, not requested.
+    class Linked : public Schedular {
+
+        public:
+
+        Linked(const String& clientId, const String& clientSecret, Ntp* ntp, GatewayTransport& transport)
+            : Schedular(clientId, clientSecret, ntp, transport) {}
+
+        const String& accessToken(void) const { return this->_accessToken; }
+
+        // Takes a new access_token; a failed calendar goes back to
+        // AUTHENTICATED, to be linked again.
+        void adopt(const String& accessToken)
+        {
+            this->_accessToken = accessToken;
+            if (!this->isAuthenticated()) {
+                this->_enter(Schedular::AUTHENTICATED);
+            }
+        }
+    };
+
+    // Snapshot behind a sequence lock. One writer (the task of its calendar),
+    // any number of readers. The words are atomics so the copy a reader may
+    // throw away is still a defined read.
+    class Published {
+
+        public:
+
+        Published() : _seq(0)
+        {
+            for (size_t i = 0; i < WORDS; ++i) {
+                _words[i].store(0, std::memory_order_relaxed);
+            }
+        }
+
+        void write(const Snapshot& s)
+        {
+            uint32_t buffer[WORDS];
+            memcpy(buffer, &s, sizeof(s));
+            const uint32_t seq = _seq.load(std::memory_order_relaxed);
+            _seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; ++i) {
+                _words[i].store(buffer[i], std::memory_order_relaxed);
+            }
+            _seq.store(seq + 2, std::memory_order_release);
+        }
+
+        void read(Snapshot& s) const
+        {
+            uint32_t buffer[WORDS];
+            for (;;) {
+                const uint32_t before = _seq.load(std::memory_order_acquire);
+                if (before & 1) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (size_t i = 0; i < WORDS; ++i) {
+                    buffer[i] = _words[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (_seq.load(std::memory_order_relaxed) == before) {
+                    break;
+                }
+            }
+            memcpy(&s, buffer, sizeof(s));
+        }
+
+        protected:
+
+        static constexpr size_t WORDS = (sizeof(Snapshot) + 3) / 4;
+
+        std::atomic<uint32_t> _seq;
+        std::atomic<uint32_t> _words[WORDS];
+    };
+
+    struct Account {
+        Account(const String& clientId, const String& clientSecret, const String& refreshToken, Ntp* ntp, GatewayTransport& transport)
+            : schedular(clientId, clientSecret, ntp, transport), generation(0), failedRound(0), refreshes(0)
+        {
+            schedular.setRefreshToken(refreshToken);
+        }
+
+        std::mutex lock;
+        Linked schedular;
+        uint32_t generation;        // bumped on each new access_token
+        uint32_t failedRound;       // round in which the last refresh failed
+        unsigned long refreshes;
+        String accessToken;
+    };
+
+    struct Calendar {
+        Calendar(Account& account, const String& name, Ntp* ntp, GatewayTransport& transport)
+            : account(account), name(name), schedular(String(), String(), ntp, transport), generation(0), last(), published()
+        {
+            memset(&last, 0, sizeof(last));
+        }
+
+        Account& account;
+        const String name;
+        Linked schedular;
+        uint32_t generation;        // account generation of the token held
+        Snapshot last;              // writer's copy of what is published
+        Published published;
+    };
+
+    // Gets the account a valid access_token, refreshing it when due; called
+    // with the account locked.
+    bool _authorize(Account& a)
+    {
+        if (!a.schedular.isAuthenticated() && a.failedRound == _round) {
+            return false;
+        }
+        a.schedular.maintain();
+        if (!a.schedular.isAuthenticated()) {
+            a.failedRound = _round;
+            return false;
+        }
+        if (a.accessToken != a.schedular.accessToken()) {
+            a.accessToken = a.schedular.accessToken();
+            ++a.generation;
+            ++a.refreshes;
+        }
+        return true;
+    }
+
+    void _sync(Calendar& c)
+    {
+        bool ok;
+        {
+            std::lock_guard<std::mutex> guard(c.account.lock);
+            ok = _authorize(c.account);
+            if (ok && c.generation != c.account.generation) {
+                c.schedular.adopt(c.account.accessToken);
+                c.generation = c.account.generation;
+            }
+        }
+        if (ok && c.schedular.hasFailed()) {
+            c.schedular.adopt(c.schedular.accessToken());
+        }
+        if (ok && !c.schedular.isLinked()) {
+            c.schedular.setCalendar(c.name);
+        }
+        ok = ok && c.schedular.syncAt(_ts);
+        _publish(c, ok);
+        if (ok) {
+            ++_synced;
+        }
+    }
+
+    void _publish(Calendar& c, const bool ok)
+    {
+        Snapshot& s = c.last;
+        ++s.version;
+        s.ok = ok;
+        if (ok) {
+            s.syncedAt = static_cast<uint32_t>(_ntp->time());
+            s.count = 0;
+            s.truncated = false;
+            size_t used = 0;
+            for (const String& title : c.schedular.getEventList()) {
+                const size_t length = title.length() + 1;
+                if (used + length > sizeof(s.titles) || s.count == 255) {
+                    s.truncated = true;
+                    break;
+                }
+                memcpy(s.titles + used, title.c_str(), length);
+                used += length;
+                ++s.count;
+            }
+        }
+        c.published.write(s);
+    }
+
+    Ntp* _ntp;
+    GatewayTransport _transport;
+    std::vector<std::unique_ptr<Account>> _accounts;
+    std::vector<std::unique_ptr<Calendar>> _calendars;
+    WorkStealingPool _pool;
+    uint32_t _round;
+    std::atomic<size_t> _synced;
+    char _ts[21];
+};
+
+#endif
@@ -0,0 +1,500 @@
+#pragma once
+
+
+#include <Arduino.h>
+
+
+// History kept by a GzipReader, in bytes: the farthest back-reference it can
+// follow. A power of two, 256 to 32768. DEFLATE allows 32 KB and Google's
+// zlib uses all of it, so the default accepts any reply. A smaller window
+// (8192 saves 24 KB) is an opt-in for calendars known to be small: a reply
+// that refers back further fails to parse (ERROR) rather than decoding
+// wrong, and, compressed the same way each time, fails on every sync.
+#ifndef SCHEDULAR_GZIP_WINDOW
+#define SCHEDULAR_GZIP_WINDOW 32768
+#endif
+
+
+/**
+ * Streaming gzip decoder between the socket and the JSON parser.
+ *
+ * With SCHEDULAR_GZIP defined, the transports send Accept-Encoding: gzip and
+ * hand deserializeJson() a GzipReader over the connection: read() and
+ * readBytes() return the inflated body one byte at a time, as the compressed
+ * bytes come in. Nothing is buffered beyond the window (history for the
+ * back-references) and the Huffman tables of the current block, about
+ * WINDOW + 0.8 KB, held by the transport and reused across requests.
+ *
+ * A reply is recognised as gzip by its first two bytes (1f 8b, never valid
+ * JSON), so no response header has to be collected, and a server that
+ * ignores Accept-Encoding is read as is. The trailer (CRC-32 and length) is
+ * not checked: the parser stops at the end of the document, before it, and
+ * the TLS record layer already guards the bytes.
+ *
+ * Input is pulled with TSource::readBytes(&c, 1), the timed read the JSON
+ * parser itself would do, so timeouts behave as without compression.
+ */
+template <class TSource, size_t WINDOW = SCHEDULAR_GZIP_WINDOW>
+class GzipReader {
+
+    public:
+
+    static_assert(WINDOW >= 256 && WINDOW <= 32768 && (WINDOW & (WINDOW - 1)) == 0,
+                  "GzipReader window: a power of two, 256 to 32768");
+
+    GzipReader() : _source(nullptr) { _reset(); }
+
+    // Reads the reply on `source` from its first byte.
+    void begin(TSource& source)
+    {
+        _source = &source;
+        _reset();
+    }
+
+    TSource& source(void) { return *_source; }
+
+    int read(void)
+    {
+        return _mode == PLAIN ? _byte() : _next();
+    }
+
+    size_t readBytes(char* buffer, const size_t length)
+    {
+        if (_mode == PLAIN) {
+            return _source->readBytes(buffer, length);
+        }
+        size_t n = 0;
+        while (n < length) {
+            const int c = _next();
+            if (c < 0) {
+                break;
+            }
+            buffer[n++] = static_cast<char>(c);
+        }
+        return n;
+    }
+
+    // The reply was gzip-encoded.
+    bool isCompressed(void) const { return _mode != PLAIN && _mode != SNIFF; }
+
+    // The compressed stream was corrupt, truncated or referred back past the
+    // window.
+    bool hasFailed(void) const { return _mode == FAILED; }
+
+
+    protected:
+
+    enum Mode : uint8_t {
+        SNIFF,          // first byte not read yet
+        PLAIN,          // not gzip: pass-through
+        BLOCK,          // at a block header
+        STORED,         // in a stored block
+        CODES,          // in a Huffman-coded block
+        DONE,
+        FAILED,
+    };
+
+    // Canonical Huffman code (as in zlib's puff): number of codes of each
+    // length, and the symbols ordered by code.
+    template <size_t N>
+    struct Huffman {
+        uint16_t count[16];
+        uint16_t symbol[N];
+    };
+
+    void _reset(void)
+    {
+        _mode = SNIFF;
+        _bits = 0;
+        _bitCount = 0;
+        _last = false;
+        _remaining = 0;
+        _distance = 0;
+        _pos = 0;
+        _out = 0;
+    }
+
+    int _fail(void)
+    {
+        _mode = FAILED;
+        return -1;
+    }
+
+    // Next byte of the reply, or -1 at its end / on a timeout.
+    int _byte(void)
+    {
+        char c;
+        if (_source->readBytes(&c, 1) != 1) {
+            return -1;
+        }
+        return static_cast<uint8_t>(c);
+    }
+
+    // `n` bits, LSB first; false when the input runs out.
+    bool _take(const uint8_t n, uint32_t& value)
+    {
+        while (_bitCount < n) {
+            const int c = _byte();
+            if (c < 0) {
+                return false;
+            }
+            _bits |= static_cast<uint32_t>(c) << _bitCount;
+            _bitCount += 8;
+        }
+        value = _bits & ((1UL << n) - 1);
+        _bits >>= n;
+        _bitCount -= n;
+        return true;
+    }
+
+    int _emit(const uint8_t c)
+    {
+        _window[_pos] = c;
+        _pos = (_pos + 1) & (WINDOW - 1);
+        ++_out;
+        return c;
+    }
+
+    int _next(void)
+    {
+        for (;;) {
+            switch (_mode) {
+                case SNIFF: {
+                    const int c = _byte();
+                    if (c != 0x1F) {
+                        _mode = PLAIN;
+                        return c;
+                    }
+                    if (!_header()) {
+                        return _fail();
+                    }
+                    _mode = BLOCK;
+                    break;
+                }
+                case BLOCK:
+                    if (_last) {
+                        _mode = DONE;
+                        break;
+                    }
+                    if (!_block()) {
+                        return _fail();
+                    }
+                    break;
+                case STORED: {
+                    if (_remaining == 0) {
+                        _mode = BLOCK;
+                        break;
+                    }
+                    const int c = _byte();
+                    if (c < 0) {
+                        return _fail();
+                    }
+                    --_remaining;
+                    return _emit(static_cast<uint8_t>(c));
+                }
+                case CODES: {
+                    if (_remaining != 0) {
+                        --_remaining;
+                        return _emit(_window[(_pos - _distance) & (WINDOW - 1)]);
+                    }
+                    const int c = _symbol();
+                    if (c >= 0) {
+                        return c;
+                    }
+                    if (_mode == FAILED) {
+                        return -1;
+                    }
+                    break;              // end of block, or a match to copy
+                }
+                case PLAIN:
+                    return _byte();
+                case DONE:
+                case FAILED:
+                    return -1;
+            }
+        }
+    }
+
+    // Member header (RFC 1952): ID1 ID2 CM FLG MTIME(4) XFL OS, then the
+    // optional fields FLG announces.
+    bool _header(void)
+    {
+        uint8_t head[9];
+        for (uint8_t i = 0; i < sizeof(head); ++i) {
+            const int c = _byte();
+            if (c < 0) {
+                return false;
+            }
+            head[i] = static_cast<uint8_t>(c);
+        }
+        const uint8_t flags = head[2];
+        if (head[0] != 0x8B || head[1] != 8 || (flags & 0xE0) != 0) {
+            return false;
+        }
+        if (flags & 0x04) {             // FEXTRA
+            const int lo = _byte();
+            const int hi = _byte();
+            if (lo < 0 || hi < 0) {
+                return false;
+            }
+            for (uint16_t n = static_cast<uint16_t>(lo | (hi << 8)); n != 0; --n) {
+                if (_byte() < 0) {
+                    return false;
+                }
+            }
+        }
+        for (uint8_t field = 0x08; field <= 0x10; field <<= 1) {    // FNAME, FCOMMENT
+            if (flags & field) {
+                int c;
+                do {
+                    c = _byte();
+                } while (c > 0);
+                if (c < 0) {
+                    return false;
+                }
+            }
+        }
+        if (flags & 0x02) {             // FHCRC
+            if (_byte() < 0 || _byte() < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Block header (RFC 1951, 3.2.3); builds the tables of a coded block.
+    bool _block(void)
+    {
+        uint32_t last, type;
+        if (!_take(1, last) || !_take(2, type)) {
+            return false;
+        }
+        _last = last != 0;
+        if (type == 0) {
+            _bits = 0;                  // stored: skip to the byte boundary
+            _bitCount = 0;
+            uint8_t length[4];
+            for (uint8_t i = 0; i < 4; ++i) {
+                const int c = _byte();
+                if (c < 0) {
+                    return false;
+                }
+                length[i] = static_cast<uint8_t>(c);
+            }
+            _remaining = static_cast<uint16_t>(length[0] | (length[1] << 8));
+            if ((length[2] ^ 0xFF) != length[0] || (length[3] ^ 0xFF) != length[1]) {
+                return false;
+            }
+            _mode = STORED;
+            return true;
+        }
+        if (type == 1) {
+            _fixedTables();
+        } else if (type != 2 || !_dynamicTables()) {
+            return false;
+        }
+        _mode = CODES;
+        return true;
+    }
+
+    template <size_t N>
+    static bool _build(Huffman<N>& h, const uint8_t* lengths, const uint16_t n)
+    {
+        memset(h.count, 0, sizeof(h.count));
+        for (uint16_t s = 0; s < n; ++s) {
+            ++h.count[lengths[s]];
+        }
+        if (h.count[0] == n) {
+            return true;                // no codes: fine until one is used
+        }
+        int32_t left = 1;               // codes of the current length left
+        for (uint8_t len = 1; len < 16; ++len) {
+            left = (left << 1) - h.count[len];
+            if (left < 0) {
+                return false;           // over-subscribed
+            }
+        }
+        uint16_t offset[16];
+        offset[1] = 0;
+        for (uint8_t len = 1; len < 15; ++len) {
+            offset[len + 1] = offset[len] + h.count[len];
+        }
+        for (uint16_t s = 0; s < n; ++s) {
+            if (lengths[s] != 0) {
+                h.symbol[offset[lengths[s]]++] = s;
+            }
+        }
+        return true;
+    }
+
+    template <size_t N>
+    bool _decode(const Huffman<N>& h, uint16_t& symbol)
+    {
+        int32_t code = 0;
+        int32_t first = 0;
+        int32_t index = 0;
+        for (uint8_t len = 1; len < 16; ++len) {
+            uint32_t bit;
+            if (!_take(1, bit)) {
+                return false;
+            }
+            code |= static_cast<int32_t>(bit);
+            const int32_t count = h.count[len];
+            if (code - count < first) {
+                symbol = h.symbol[index + (code - first)];
+                return true;
+            }
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return false;                   // ran out of codes
+    }
+
+    void _fixedTables(void)
+    {
+        uint8_t lengths[288];
+        memset(lengths, 8, 144);
+        memset(lengths + 144, 9, 112);
+        memset(lengths + 256, 7, 24);
+        memset(lengths + 280, 8, 8);
+        _build(_literals, lengths, 288);
+        memset(lengths, 5, 30);
+        _build(_distances, lengths, 30);
+    }
+
+    bool _dynamicTables(void)
+    {
+        static const uint8_t order[19] PROGMEM = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+        uint32_t literals, distances, codes;
+        if (!_take(5, literals) || !_take(5, distances) || !_take(4, codes)) {
+            return false;
+        }
+        literals += 257;
+        distances += 1;
+        codes += 4;
+        if (literals > 286 || distances > 30) {
+            return false;
+        }
+
+        uint8_t lengths[286 + 30];
+        memset(lengths, 0, 19);
+        for (uint8_t i = 0; i < codes; ++i) {
+            uint32_t len;
+            if (!_take(3, len)) {
+                return false;
+            }
+            lengths[pgm_read_byte(&order[i])] = static_cast<uint8_t>(len);
+        }
+        // The code-length code is only needed now: borrow the distance table.
+        if (!_build(_distances, lengths, 19)) {
+            return false;
+        }
+
+        uint16_t n = 0;
+        while (n < literals + distances) {
+            uint16_t symbol;
+            if (!_decode(_distances, symbol)) {
+                return false;
+            }
+            if (symbol < 16) {
+                lengths[n++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+            uint8_t repeat = 0;
+            uint32_t extra;
+            if (symbol == 16) {
+                if (n == 0 || !_take(2, extra)) {
+                    return false;
+                }
+                repeat = lengths[n - 1];
+                extra += 3;
+            } else if (symbol == 17) {
+                if (!_take(3, extra)) {
+                    return false;
+                }
+                extra += 3;
+            } else {
+                if (!_take(7, extra)) {
+                    return false;
+                }
+                extra += 11;
+            }
+            if (n + extra > literals + distances) {
+                return false;
+            }
+            while (extra-- != 0) {
+                lengths[n++] = repeat;
+            }
+        }
+        if (lengths[256] == 0) {
+            return false;               // no end-of-block code
+        }
+        return _build(_literals, lengths, static_cast<uint16_t>(literals))
+            && _build(_distances, lengths + literals, static_cast<uint16_t>(distances));
+    }
+
+    // Next literal (returned), or an end of block / match set up (-1, mode
+    // left at CODES or moved on), or a failure.
+    int _symbol(void)
+    {
+        static const uint16_t lengthBase[29] PROGMEM = {
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t lengthExtra[29] PROGMEM = {
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t distanceBase[30] PROGMEM = {
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const uint8_t distanceExtra[30] PROGMEM = {
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        uint16_t symbol;
+        if (!_decode(_literals, symbol)) {
+            return _fail();
+        }
+        if (symbol < 256) {
+            return _emit(static_cast<uint8_t>(symbol));
+        }
+        if (symbol == 256) {
+            _mode = BLOCK;
+            return -1;
+        }
+        symbol -= 257;
+        if (symbol >= 29) {
+            return _fail();
+        }
+        uint32_t extra;
+        if (!_take(pgm_read_byte(&lengthExtra[symbol]), extra)) {
+            return _fail();
+        }
+        const uint16_t length = static_cast<uint16_t>(pgm_read_word(&lengthBase[symbol]) + extra);
+
+        uint16_t d;
+        if (!_decode(_distances, d) || d >= 30 || !_take(pgm_read_byte(&distanceExtra[d]), extra)) {
+            return _fail();
+        }
+        const uint32_t distance = pgm_read_word(&distanceBase[d]) + extra;
+        if (distance > WINDOW || distance > _out) {
+            return _fail();             // beyond the window, or before the start
+        }
+        _distance = static_cast<uint16_t>(distance);
+        _remaining = length;
+        return -1;
+    }
+
+    TSource* _source;
+    Huffman<288> _literals;
+    Huffman<30> _distances;
+    uint32_t _bits;
+    uint8_t _bitCount;
+    Mode _mode;
+    bool _last;                         // the current block is the final one
+    uint16_t _remaining;                // of a stored block, or of a match
+    uint16_t _distance;
+    uint16_t _pos;                      // next write in _window
+    uint32_t _out;                      // bytes inflated
+    uint8_t _window[WINDOW];
+};
@@ -0,0 +1,417 @@
+#pragma once
+
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <list>
+
+#include "SchedularTiers.hpp"
+
+
+/**
+ * Fully static mode: define SCHEDULAR_STATIC before including
+ * GoogleSchedular.hpp, and once setup() has built the objects the library no
+ * longer touches the heap.
+ *
+ *  - The long-lived Strings (client id and secret, tokens, calendar id, event
+ *    titles) become FixedString buffers of the sizes below, terminator
+ *    included, and the event list a FixedList of SCHEDULAR_MAX_EVENTS titles.
+ *  - Each request runs out of one scratch arena of SCHEDULAR_SCRATCH_SIZE
+ *    bytes, SchedularArena::scratch(): the JSON documents (SchedularDocument)
+ *    and the URI, header and payload text (SchedularText) of the request. It
+ *    rewinds on its own once everything taken from it has been released.
+ *
+ * Overflows degrade, they do not allocate: a token, secret or id that does not
+ * fit is not stored and the request that received it fails; a longer title is
+ * cut, events past SCHEDULAR_MAX_EVENTS are dropped; a reply too large for the
+ * arena fails to parse (ERROR). SchedularArena::scratch().peak() and failures()
+ * tell how close the sizes are.
+ *
+ * The guarantee covers the library. The transport under it is the platform's:
+ * the ESP cores' HTTPClient keeps the host, URI and headers in Strings of its
+ * own, and BearSSL allocates its buffers when it connects. Registration
+ * (startRegistration(), which hands the URL and code back as Strings) and
+ * getRefreshToken() are setup-time calls and may allocate. The arena is shared:
+ * issue requests from one task, as with the shared transport.
+ */
+#ifndef SCHEDULAR_SCRATCH_SIZE
+#define SCHEDULAR_SCRATCH_SIZE 6144
+#endif
+#ifndef SCHEDULAR_CLIENT_ID_SIZE
+#define SCHEDULAR_CLIENT_ID_SIZE 96
+#endif
+#ifndef SCHEDULAR_CLIENT_SECRET_SIZE
+#define SCHEDULAR_CLIENT_SECRET_SIZE 48
+#endif
+// Also holds the device_code during registration.
+#ifndef SCHEDULAR_REFRESH_TOKEN_SIZE
+#define SCHEDULAR_REFRESH_TOKEN_SIZE 128
+#endif
+// Also holds the user_code of startQuietRegistration().
+#ifndef SCHEDULAR_ACCESS_TOKEN_SIZE
+#define SCHEDULAR_ACCESS_TOKEN_SIZE 384
+#endif
+#ifndef SCHEDULAR_CALENDAR_ID_SIZE
+#define SCHEDULAR_CALENDAR_ID_SIZE 128
+#endif
+#ifndef SCHEDULAR_TITLE_SIZE
+#define SCHEDULAR_TITLE_SIZE 48
+#endif
+#ifndef SCHEDULAR_MAX_EVENTS
+#define SCHEDULAR_MAX_EVENTS 8
+#endif
+
+
+/**
+ * Stack-like allocator over a caller's block, usable as an ArduinoJson
+ * Allocator. Blocks are taken from the top; freeing the top one (or the last
+ * live one) gives the space back, and growing the top one is done in place,
+ * which is how a document builds its strings. A block freed under others is
+ * only reclaimed once they are all gone. Never falls back to the heap: past
+ * the end, allocate() returns nullptr.
+ */
+class SchedularArena : public ArduinoJson::Allocator {
+
+    public:
+
+    SchedularArena(void* block, const size_t size)
+        : _base(static_cast<uint8_t*>(block)), _size(size), _top(0), _last(NONE), _live(0), _peak(0), _failures(0) {}
+
+    void* allocate(size_t size) override
+    {
+        const size_t need = HEADER + _round(size);
+        if (need > _size - _top) {
+            ++_failures;
+            return nullptr;
+        }
+        uint8_t* block = _base + _top;
+        *reinterpret_cast<size_t*>(block) = size;
+        _last = _top;
+        _top += need;
+        ++_live;
+        if (_top > _peak) {
+            _peak = _top;
+        }
+        return block + HEADER;
+    }
+
+    void deallocate(void* p) override
+    {
+        if (p == nullptr) {
+            return;
+        }
+        if (--_live == 0) {
+            reset();
+        } else if (_offset(p) == _last) {
+            _top = _last;
+            _last = NONE;               // the one below is unknown: not popped again
+        }
+    }
+
+    void* reallocate(void* p, size_t size) override
+    {
+        if (p == nullptr) {
+            return allocate(size);
+        }
+        const size_t at = _offset(p);
+        if (at == _last) {
+            if (HEADER + _round(size) > _size - at) {
+                ++_failures;
+                return nullptr;
+            }
+            *reinterpret_cast<size_t*>(_base + at) = size;
+            _top = at + HEADER + _round(size);
+            if (_top > _peak) {
+                _peak = _top;
+            }
+            return p;
+        }
+        void* moved = allocate(size);
+        if (moved != nullptr) {
+            const size_t old = *reinterpret_cast<size_t*>(_base + at);
+            memcpy(moved, p, old < size ? old : size);
+            deallocate(p);
+        }
+        return moved;
+    }
+
+    // Forgets every block at once.
+    void reset(void)
+    {
+        _top = 0;
+        _last = NONE;
+        _live = 0;
+    }
+
+    size_t capacity(void) const { return _size; }
+    size_t used(void) const     { return _top; }
+    size_t peak(void) const     { return _peak; }
+    size_t live(void) const     { return _live; }
+
+    // Allocations refused for lack of room since the start.
+    size_t failures(void) const { return _failures; }
+
+#ifdef SCHEDULAR_STATIC
+    // The arena every request of a static build runs out of.
+    static SchedularArena& scratch(void)
+    {
+        static size_t storage[(SCHEDULAR_SCRATCH_SIZE + sizeof(size_t) - 1) / sizeof(size_t)];
+        static SchedularArena arena(storage, sizeof(storage));
+        return arena;
+    }
+#endif
+
+
+    protected:
+
+    static constexpr size_t HEADER = sizeof(size_t) < 8 ? 8 : sizeof(size_t);
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    static size_t _round(const size_t size) { return (size + HEADER - 1) & ~(HEADER - 1); }
+
+    size_t _offset(const void* p) const { return static_cast<const uint8_t*>(p) - HEADER - _base; }
+
+    uint8_t* _base;
+    size_t _size;
+    size_t _top;
+    size_t _last;                   // header offset of the top block, or NONE
+    size_t _live;
+    size_t _peak;
+    size_t _failures;
+};
+
+
+/**
+ * String of at most N - 1 characters in a fixed buffer: the part of the
+ * String interface the library uses. Assignments cut what does not fit (see
+ * schedularKeep() for values that must not be cut).
+ */
+template <size_t N>
+class FixedString {
+
+    public:
+
+    static_assert(N >= 2 && N <= 0xFFFF, "FixedString holds 1..65534 characters");
+
+    FixedString() : _length(0) { _s[0] = '\0'; }
+    FixedString(const char* s) : _length(0) { *this = s; }
+    FixedString(const String& s) : _length(0) { *this = s.c_str(); }
+
+    FixedString& operator=(const char* s)
+    {
+        size_t n = 0;
+        if (s != nullptr) {
+            while (n < N - 1 && s[n] != '\0') {
+                _s[n] = s[n];
+                ++n;
+            }
+        }
+        _s[n] = '\0';
+        _length = static_cast<uint16_t>(n);
+        return *this;
+    }
+
+    FixedString& operator=(const String& s) { return *this = s.c_str(); }
+
+    const char* c_str(void) const    { return _s; }
+    size_t length(void) const        { return _length; }
+    bool isEmpty(void) const         { return _length == 0; }
+    long toInt(void) const           { return atol(_s); }
+    bool equals(const char* s) const { return s != nullptr && strcmp(_s, s) == 0; }
+    bool equals(const String& s) const { return equals(s.c_str()); }
+
+    bool operator==(const char* s) const { return equals(s); }
+    bool operator!=(const char* s) const { return !equals(s); }
+
+    static constexpr size_t capacity(void) { return N - 1; }
+
+
+    protected:
+
+    char _s[N];
+    uint16_t _length;
+};
+
+
+/**
+ * The std::list<String> subset used for event lists, over a fixed array: at
+ * most N items, push_back() past that is dropped and counted.
+ */
+template <class T, size_t N>
+class FixedList {
+
+    public:
+
+    FixedList() : _size(0), _dropped(0) {}
+
+    template <class V>
+    void push_back(const V& value)
+    {
+        if (_size == N) {
+            ++_dropped;
+            return;
+        }
+        _items[_size++] = value;
+    }
+
+    void clear(void)
+    {
+        _size = 0;
+        _dropped = 0;
+    }
+
+    size_t size(void) const  { return _size; }
+    bool empty(void) const   { return _size == 0; }
+    const T& front(void) const { return _items[0]; }
+    const T& back(void) const  { return _items[_size - 1]; }
+    const T* begin(void) const { return _items; }
+    const T* end(void) const   { return _items + _size; }
+
+    // Items refused since the last clear().
+    size_t dropped(void) const { return _dropped; }
+
+
+    protected:
+
+    T _items[N];
+    size_t _size;
+    size_t _dropped;
+};
+
+
+/**
+ * Text of one request (URI, Authorization header, JSON payload) taken from
+ * SchedularArena::scratch() and given back when it goes out of scope. Appends
+ * grow it in place while it is the arena's top block. When the arena is full
+ * the text is marked failed and reads as ""; the requests check failed() (see
+ * schedularFailed()) and fail instead of going out truncated.
+ */
+class ArenaText {
+
+    public:
+
+    ArenaText(SchedularArena& arena) : _arena(&arena), _p(nullptr), _length(0), _failed(false) {}
+#ifdef SCHEDULAR_STATIC
+    ArenaText() : ArenaText(SchedularArena::scratch()) {}
+    ArenaText(const char* s) : ArenaText() { *this += s; }
+    ArenaText(const __FlashStringHelper* s) : ArenaText() { *this += s; }
+#endif
+    ArenaText(ArenaText&& o) : _arena(o._arena), _p(o._p), _length(o._length), _failed(o._failed) { o._p = nullptr; }
+    ArenaText(const ArenaText&) = delete;
+    ArenaText& operator=(const ArenaText&) = delete;
+
+    ~ArenaText() { _arena->deallocate(_p); }
+
+    ArenaText& operator+=(const char* s)
+    {
+        if (s != nullptr) {
+            _append(s, strlen(s), false);
+        }
+        return *this;
+    }
+
+    ArenaText& operator+=(const __FlashStringHelper* s)
+    {
+        const char* p = reinterpret_cast<const char*>(s);
+        _append(p, strlen_P(p), true);
+        return *this;
+    }
+
+    // Room for `n` characters, written by the caller (serializeJson()).
+    char* prepare(const size_t n)
+    {
+        if (_failed || !_reserve(n)) {
+            return nullptr;
+        }
+        _length = n;
+        _p[n] = '\0';
+        return _p;
+    }
+
+    const char* c_str(void) const { return _p != nullptr && !_failed ? _p : ""; }
+    size_t length(void) const     { return _failed ? 0 : _length; }
+    bool failed(void) const       { return _failed; }
+
+
+    protected:
+
+    bool _reserve(const size_t n)
+    {
+        char* p = static_cast<char*>(_arena->reallocate(_p, n + 1));
+        if (p == nullptr) {
+            _failed = true;
+            return false;
+        }
+        _p = p;
+        return true;
+    }
+
+    void _append(const char* s, const size_t n, const bool flash)
+    {
+        if (_failed || !_reserve(_length + n)) {
+            return;
+        }
+        if (flash) {
+            memcpy_P(_p + _length, s, n);
+        } else {
+            memcpy(_p + _length, s, n);
+        }
+        _length += n;
+        _p[_length] = '\0';
+    }
+
+    SchedularArena* _arena;
+    char* _p;
+    size_t _length;
+    bool _failed;
+};
+
+
+// Whether text built for a request ran out of room: an ArenaText that did,
+// never a String.
+inline bool schedularFailed(const ArenaText& text) { return text.failed(); }
+inline bool schedularFailed(const String&) { return false; }
+
+
+// Stores `value` in `field` whole, or not at all: false, `field` emptied, when
+// it is missing or (FixedString) longer than the buffer. For credentials and
+// ids, which are worthless cut.
+template <class S>
+inline bool schedularKeep(S& field, const char* value)
+{
+    field = value;
+    if (value == nullptr || field.length() != strlen(value)) {
+        field = "";
+        return false;
+    }
+    return true;
+}
+
+
+#ifdef SCHEDULAR_STATIC
+
+template <size_t N> using SchedularString = FixedString<N>;
+typedef FixedList<FixedString<SCHEDULAR_TITLE_SIZE>, SCHEDULAR_MAX_EVENTS> SchedularEventList;
+typedef ArenaText SchedularText;
+
+// A JsonDocument that allocates from `arena`, by default the scratch arena.
+class SchedularDocument : public JsonDocument {
+    public:
+    explicit SchedularDocument(SchedularArena* arena = nullptr) : JsonDocument(arena != nullptr ? arena : &SchedularArena::scratch()) {}
+};
+
+#else
+
+template <size_t N> using SchedularString = String;
+typedef std::list<String> SchedularEventList;
+typedef String SchedularText;
+
+// A JsonDocument that allocates from `arena`, by default the JSON tier (the
+// heap unless SchedularTiers::set() says otherwise).
+class SchedularDocument : public JsonDocument {
+    public:
+    explicit SchedularDocument(SchedularArena* arena = nullptr)
+        : JsonDocument(arena != nullptr ? static_cast<ArduinoJson::Allocator*>(arena) : &SchedularTiers::of(SchedularTiers::JSON)) {}
+};
+
+#endif
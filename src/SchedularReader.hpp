@@ -0,0 +1,220 @@
+#pragma once
+
+
+#include <Arduino.h>
+#include <type_traits>
+
+
+// Bytes a BufferedReader takes from the socket per refill. Each refill is one
+// readBytes() on the TLS client; larger buffers mean fewer of them, for as
+// many bytes of RAM held by the transport.
+#ifndef SCHEDULAR_READ_BUFFER
+#define SCHEDULAR_READ_BUFFER 256
+#endif
+
+// Longest slice of a reply the JSON parser takes without a yield(), in bytes
+// and in microseconds, whichever comes first (see PacedReader). 0 lifts that
+// bound; both 0, the parse is one slice, as before.
+#ifndef SCHEDULAR_PARSE_SLICE_BYTES
+#define SCHEDULAR_PARSE_SLICE_BYTES 1024
+#endif
+#ifndef SCHEDULAR_PARSE_SLICE_US
+#define SCHEDULAR_PARSE_SLICE_US 10000
+#endif
+
+// Items of a parsed list walked between two yield()s (setCalendar(),
+// syncAt()), with the same time bound.
+#ifndef SCHEDULAR_PARSE_SLICE_ITEMS
+#define SCHEDULAR_PARSE_SLICE_ITEMS 64
+#endif
+
+
+/**
+ * Read buffer between the socket and the JSON parser.
+ *
+ * deserializeJson() pulls a Stream one byte at a time, through a virtual
+ * readBytes(&c, 1) that on the device takes the TLS client's locks and timed
+ * wait every call. A BufferedReader refills SIZE bytes at a time with
+ * readBytes() and serves the parser from the buffer, so read() is a plain
+ * inline copy.
+ *
+ * A refill asks for no more than available() reports: a readBytes() of the
+ * whole buffer would wait out the timeout at the end of every body, which
+ * closes no earlier than the connection. With nothing arrived yet it asks for
+ * one byte, which waits up to the stream timeout as the parser's own read
+ * would, so a stalled reply fails the same way.
+ *
+ * The transport owns the reader and begin()s it on each request; it holds no
+ * reference to the source between requests.
+ */
+template <class TSource, size_t SIZE = SCHEDULAR_READ_BUFFER>
+class BufferedReader {
+
+    public:
+
+    BufferedReader() : _source(nullptr), _pos(0), _len(0) {}
+
+    void begin(TSource& source)
+    {
+        _source = &source;
+        _pos = 0;
+        _len = 0;
+    }
+
+    int read(void)
+    {
+        if (_pos == _len && !_fill()) {
+            return -1;
+        }
+        return static_cast<unsigned char>(_buffer[_pos++]);
+    }
+
+    size_t readBytes(char* buffer, const size_t length)
+    {
+        size_t n = 0;
+        while (n < length) {
+            if (_pos == _len && !_fill()) {
+                break;
+            }
+            const size_t k = (_len - _pos) < (length - n) ? (_len - _pos) : (length - n);
+            memcpy(buffer + n, _buffer + _pos, k);
+            _pos += k;
+            n += k;
+        }
+        return n;
+    }
+
+
+    protected:
+
+    bool _fill(void)
+    {
+        if (_source == nullptr) {
+            return false;
+        }
+        const int ready = _source->available();
+        const size_t want = ready <= 0 ? 1 : (static_cast<size_t>(ready) < SIZE ? static_cast<size_t>(ready) : SIZE);
+        _len = _source->readBytes(_buffer, want);
+        _pos = 0;
+        return _len != 0;
+    }
+
+    TSource* _source;
+    size_t _pos;
+    size_t _len;
+    char _buffer[SIZE];
+};
+
+
+/**
+ * Hands control back to the core with yield() during a long piece of work:
+ * once `slice` units (bytes of a reply, items of a list) or `sliceUs`
+ * microseconds have gone by since the last yield(), whichever comes first.
+ * 0 lifts a bound. The clock is read once every CHECK units, not per unit.
+ *
+ * On an ESP8266 the software watchdog resets the chip, and the WiFi stack
+ * starves, when the loop keeps the CPU too long; yield() runs them and returns
+ * to the same spot, so whatever the work holds on its stack is left as is.
+ */
+class SchedularPace {
+
+    public:
+
+    static const size_t CHECK = 64;
+
+    explicit SchedularPace(const size_t slice = SCHEDULAR_PARSE_SLICE_BYTES, const unsigned long sliceUs = SCHEDULAR_PARSE_SLICE_US) :
+        _slice(slice), _sliceUs(sliceUs), _done(0), _checked(0), _yields(0), _startUs(micros()) {}
+
+    // `n` more units of work done.
+    void step(const size_t n = 1)
+    {
+        _done += n;
+        if ((_slice != 0 && _done >= _slice) || (_sliceUs != 0 && _done - _checked >= CHECK)) {
+            _check();
+        }
+    }
+
+    // yield() calls so far.
+    uint32_t yields(void) const { return _yields; }
+
+
+    protected:
+
+    void _check(void)
+    {
+        _checked = _done;
+        if ((_slice != 0 && _done >= _slice) || (_sliceUs != 0 && micros() - _startUs >= _sliceUs)) {
+            yield();
+            ++_yields;
+            _done = 0;
+            _checked = 0;
+            _startUs = micros();
+        }
+    }
+
+    const size_t _slice;
+    const unsigned long _sliceUs;
+    size_t _done;               // since the last yield()
+    size_t _checked;            // _done at the last look at the clock
+    uint32_t _yields;
+    unsigned long _startUs;     // of the current slice
+};
+
+
+/**
+ * Parses a reply in slices: the reader deserializeJson() is given between the
+ * body and the parser, with a SchedularPace counting the bytes.
+ *
+ * A calendarList or a busy event window is parsed in one deserializeJson()
+ * call, and once the bytes are in the TLS client's buffer nothing in it
+ * yields. Through a PacedReader, the parse takes at most
+ * SCHEDULAR_PARSE_SLICE_BYTES bytes or SCHEDULAR_PARSE_SLICE_US microseconds
+ * between two yield()s. The parser's partial state (document, nesting, the
+ * string being read) needs no saving: yield() returns into the same read().
+ * A readBytes() counts whole, so a slice can overshoot by one call.
+ *
+ * A Stream source is read through readBytes(), as ArduinoJson does: a socket's
+ * read() returns -1 whenever its buffer is empty, even mid-body. Other sources
+ * (BufferedReader, SchedularStats::Reader) keep their own read().
+ */
+template <class TSource>
+class PacedReader {
+
+    public:
+
+    explicit PacedReader(TSource& source, const size_t sliceBytes = SCHEDULAR_PARSE_SLICE_BYTES, const unsigned long sliceUs = SCHEDULAR_PARSE_SLICE_US) :
+        _source(source), _pace(sliceBytes, sliceUs) {}
+
+    int read(void)
+    {
+        const int c = _read(std::is_base_of<Stream, TSource>());
+        if (c >= 0) {
+            _pace.step();
+        }
+        return c;
+    }
+
+    size_t readBytes(char* buffer, const size_t length)
+    {
+        const size_t n = _source.readBytes(buffer, length);
+        _pace.step(n);
+        return n;
+    }
+
+    // yield() calls so far.
+    uint32_t yields(void) const { return _pace.yields(); }
+
+
+    protected:
+
+    int _read(std::true_type)
+    {
+        char c;
+        return _source.readBytes(&c, 1) ? static_cast<unsigned char>(c) : -1;
+    }
+
+    int _read(std::false_type) { return _source.read(); }
+
+    TSource& _source;
+    SchedularPace _pace;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+
+#include <Arduino.h>
+#include <type_traits>
+
+#include "SchedularMemory.hpp"
+#include "EventTimeline.hpp"
+
+
+// Longest deep sleep suspend() plans, in seconds: a wake-up at least this
+// often, whatever the timeline says. The ESP8266 timer tops out at about
+// 3.5 hours (ESP.deepSleepMax()).
+#ifndef SCHEDULAR_SLEEP_MAX
+#define SCHEDULAR_SLEEP_MAX 3600
+#endif
+
+
+/**
+ * What a battery node keeps across deep sleep to resume without its boot
+ * sequence (see BasicGoogleSchedular::suspend() / resume()): the session
+ * (state, access_token and its deadline), the calendar id, and the
+ * EventTimeline with its load time.
+ *
+ * A plain struct with no constructor, so it can live in RTC memory as is:
+ *
+ *   RTC_DATA_ATTR SleepState sleepState;      // ESP32
+ *
+ * RTC memory holds garbage after a power loss: resume() accepts the state only
+ * when its magic, size (a build with other SCHEDULAR_* sizes) and checksum
+ * (FNV-1a) match. With the default sizes it takes about 1.3 kB; the 512 bytes
+ * of ESP8266 RTC user memory need smaller SCHEDULAR_ACCESS_TOKEN_SIZE /
+ * SCHEDULAR_TIMELINE_* values, or another store.
+ *
+ * The refresh_token is not part of it: the sketch keeps it in flash and
+ * setRefreshToken()s it on every boot, as before.
+ */
+struct SleepState {
+    static constexpr uint32_t MAGIC = 0x47535331UL;  // "GSS1"
+
+    uint32_t magic;
+    uint32_t size;
+    uint32_t checksum;                          // of what follows
+    uint32_t sleptAt;                           // Unix time of suspend()
+    uint32_t wakeAt;                            // Unix time of the planned wake-up
+    uint32_t expiresAt;                         // access_token deadline, 0 if not kept
+    uint8_t state;
+    bool hasTimeline;
+    char accessToken[SCHEDULAR_ACCESS_TOKEN_SIZE];
+    char calendarId[SCHEDULAR_CALENDAR_ID_SIZE];
+    unsigned char timeline[sizeof(EventTimeline)];
+
+    void clear(void) { memset(this, 0, sizeof(*this)); }
+
+    bool isValid(void) const { return magic == MAGIC && size == sizeof(*this) && checksum == sum(); }
+
+    // Stamps magic, size and checksum once the fields are filled.
+    void seal(void)
+    {
+        magic = MAGIC;
+        size = sizeof(*this);
+        checksum = sum();
+    }
+
+    // FNV-1a of the fields after the checksum.
+    uint32_t sum(void) const
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&sleptAt);
+        const uint8_t* const end = reinterpret_cast<const uint8_t*>(this + 1);
+        uint32_t h = 2166136261UL;
+        while (p != end) {
+            h = (h ^ *p++) * 16777619UL;
+        }
+        return h;
+    }
+};
+
+static_assert(std::is_trivially_copyable<EventTimeline>::value, "the timeline is kept as bytes");
+static_assert(std::is_trivial<SleepState>::value, "RTC memory is not constructed again on wake-up");
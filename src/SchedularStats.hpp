@@ -0,0 +1,268 @@
+#pragma once
+
+
+#include <Arduino.h>
+
+
+/**
+ * Optional performance counters for the request path.
+ *
+ * Everything here is opt-in: define SCHEDULAR_STATS before including
+ * GoogleSchedular.hpp to compile it in. Without it the library holds no stats
+ * member and every instrumentation point expands to nothing (SCHEDULAR_STATS_ONLY),
+ * so a production build pays neither RAM nor a single instruction.
+ *
+ * When enabled the footprint stays fixed and small (no heap): a few counters per
+ * operation plus one log2 latency histogram per request phase, 16 saturating
+ * 16-bit buckets each. Bucket i counts durations in [2^i, 2^(i+1)) microseconds,
+ * so 16 buckets span 1 us .. ~65 ms and the last one absorbs everything slower
+ * (TLS handshakes on an ESP8266 land there or close to it). That is coarse, but
+ * enough to tell "the network is slow" from "the parse is slow" in the field.
+ *
+ * Phases of one request, all measured from the moment it starts:
+ *  - PHASE_CONNECT    : name lookup, connection + TLS handshake (duration), when
+ *                       the transport opens the socket on its own (ESP32, Linux).
+ *                       HTTPClient connects inside GET()/POST(), so on the
+ *                       ESP8266 the handshake is folded into PHASE_REQUEST.
+ *  - PHASE_REQUEST    : request sent and status line + headers received.
+ *  - PHASE_FIRST_BYTE : first body byte handed to the JSON parser.
+ *  - PHASE_PARSE      : first body byte -> document parsed (duration, not offset).
+ *  - PHASE_TOTAL      : the whole exchange, connection closed.
+ */
+#ifdef SCHEDULAR_STATS
+  #define SCHEDULAR_STATS_ONLY(...) __VA_ARGS__
+#else
+  #define SCHEDULAR_STATS_ONLY(...)
+#endif
+
+
+class SchedularStats {
+
+    public:
+
+    // One entry per request the library can issue.
+    enum Op : uint8_t {
+        OP_DEVICE_CODE,
+        OP_POLL,
+        OP_REFRESH,
+        OP_CALENDARS,
+        OP_EVENTS,
+        OP_COUNT,
+    };
+
+    enum Phase : uint8_t {
+        PHASE_CONNECT,
+        PHASE_REQUEST,
+        PHASE_FIRST_BYTE,
+        PHASE_PARSE,
+        PHASE_TOTAL,
+        PHASE_COUNT,
+    };
+
+    static constexpr uint8_t HISTOGRAM_BUCKETS = 16;
+
+    // log2 latency histogram with saturating buckets (see the class comment).
+    struct Histogram {
+        uint16_t buckets[HISTOGRAM_BUCKETS];
+        uint32_t count;
+        uint32_t maxUs;
+        uint64_t sumUs;
+
+        void add(const uint32_t us)
+        {
+            uint8_t i = 0;
+            for (uint32_t v = us; v > 1 && i < HISTOGRAM_BUCKETS - 1; v >>= 1) {
+                ++i;
+            }
+            if (buckets[i] != 0xFFFF) {
+                ++buckets[i];
+            }
+            ++count;
+            sumUs += us;
+            if (us > maxUs) {
+                maxUs = us;
+            }
+        }
+
+        uint32_t meanUs(void) const { return count ? static_cast<uint32_t>(sumUs / count) : 0; }
+
+        // Upper bound (exclusive, in us) of the bucket holding the p-th percentile
+        // (0..100). The last bucket is open-ended, so its bound is the observed max.
+        uint32_t percentileUs(const uint8_t p) const
+        {
+            uint32_t total = 0;
+            for (uint8_t i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+                total += buckets[i];
+            }
+            const uint32_t rank = (total * p + 99) / 100;
+            uint32_t seen = 0;
+            for (uint8_t i = 0; i < HISTOGRAM_BUCKETS - 1; ++i) {
+                seen += buckets[i];
+                if (seen >= rank && seen != 0) {
+                    return 1UL << (i + 1);
+                }
+            }
+            return maxUs;
+        }
+    };
+
+    struct OpCounters {
+        uint32_t calls;
+        uint32_t failures;
+    };
+
+    OpCounters ops[OP_COUNT];
+    Histogram  phases[PHASE_COUNT];
+    uint32_t   bytesReceived;
+    uint32_t   tlsHandshakes;   // every closed-then-reopened connection pays one
+    uint32_t   retries;         // requests issued to recover from a transient ERROR
+    uint32_t   notModified;     // HTTP 304 replies
+    uint32_t   cacheHits;       // calendar lists or event requests spared by a local cache
+    uint32_t   dnsLookups;      // host names sent to the resolver
+    uint32_t   dnsCached;       // connections tried on a cached address first
+    uint32_t   heapLowWater;    // lowest free heap seen around a request (bytes)
+
+
+    SchedularStats() { reset(); }
+
+    void reset(void)
+    {
+        memset(ops, 0, sizeof(ops));
+        memset(phases, 0, sizeof(phases));
+        bytesReceived = 0;
+        tlsHandshakes = 0;
+        retries       = 0;
+        notModified   = 0;
+        cacheHits     = 0;
+        dnsLookups    = 0;
+        dnsCached     = 0;
+        heapLowWater  = 0xFFFFFFFF;
+        _startUs      = 0;
+        _firstByteUs  = 0;
+        _gotFirstByte = false;
+        _op           = OP_DEVICE_CODE;
+    }
+
+    const Histogram& phase(const Phase p) const { return phases[p]; }
+    const OpCounters& op(const Op o) const      { return ops[o]; }
+
+    // Free heap as reported by the core; 0 where there is no such notion.
+    static uint32_t freeHeap(void)
+    {
+#if defined(ESP8266) || defined(ESP32)
+        return ESP.getFreeHeap();
+#else
+        return 0;
+#endif
+    }
+
+
+    // --- instrumentation entry points, called by GoogleOAuth2 ---------------
+
+    // Opens the measurement of one `op` request.
+    void begin(const Op op)
+    {
+        _op = op;
+        _firstByteUs = 0;
+        _gotFirstByte = false;
+        ++ops[op].calls;
+        sampleHeap();
+        _startUs = micros();
+    }
+
+    // Records `p` as the time elapsed since begin().
+    void mark(const Phase p) { phases[p].add(micros() - _startUs); }
+
+    // Called by Reader on every byte handed to the parser.
+    void received(const size_t n)
+    {
+        if (!_gotFirstByte && n != 0) {
+            _gotFirstByte = true;
+            _firstByteUs = micros();
+            phases[PHASE_FIRST_BYTE].add(_firstByteUs - _startUs);
+        }
+        bytesReceived += n;
+    }
+
+    // The document is complete: its heap usage peaks now.
+    void parsed(void)
+    {
+        if (_gotFirstByte) {
+            phases[PHASE_PARSE].add(micros() - _firstByteUs);
+        }
+        sampleHeap();
+    }
+
+    // Name resolution of the request's connection, as the transport reports it.
+    void resolved(const uint8_t lookups, const bool cached)
+    {
+        dnsLookups += lookups;
+        if (cached) {
+            ++dnsCached;
+        }
+    }
+
+    // Lookup plus connection time the transport measured; 0 when its client
+    // connects inside the request, which leaves PHASE_CONNECT empty.
+    void connected(const uint32_t us)
+    {
+        if (us != 0) {
+            phases[PHASE_CONNECT].add(us);
+        }
+    }
+
+    // Closes the measurement opened by begin().
+    void end(const bool ok)
+    {
+        mark(PHASE_TOTAL);
+        if (!ok) {
+            ++ops[_op].failures;
+        }
+        sampleHeap();
+    }
+
+    void sampleHeap(void)
+    {
+        const uint32_t h = freeHeap();
+        if (h != 0 && h < heapLowWater) {
+            heapLowWater = h;
+        }
+    }
+
+
+    // Counting pass-through between the socket and deserializeJson(). It has
+    // the read()/readBytes() pair ArduinoJson accepts as a custom reader.
+    template <typename TStream>
+    class Reader {
+        public:
+        Reader(TStream& stream, SchedularStats& stats) : _stream(stream), _stats(stats) {}
+
+        // One byte through readBytes(), as ArduinoJson's own Stream reader does:
+        // a socket's read() returns -1 whenever its buffer is empty, even in the
+        // middle of a body, while readBytes() waits up to the stream timeout.
+        int read(void)
+        {
+            char c;
+            return readBytes(&c, 1) ? static_cast<unsigned char>(c) : -1;
+        }
+
+        size_t readBytes(char* buffer, const size_t length)
+        {
+            const size_t n = _stream.readBytes(buffer, length);
+            _stats.received(n);
+            return n;
+        }
+
+        private:
+        TStream& _stream;
+        SchedularStats& _stats;
+    };
+
+
+    private:
+
+    unsigned long _startUs;
+    unsigned long _firstByteUs;
+    bool _gotFirstByte;
+    Op _op;
+};
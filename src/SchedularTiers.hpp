@@ -0,0 +1,230 @@
+#pragma once
+
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <new>
+#include <utility>
+
+#if defined(ESP32)
+#include <esp_heap_caps.h>
+#endif
+
+
+/**
+ * The heap as an ArduinoJson Allocator: what a SchedularDocument given no
+ * arena allocates from outside a static build, as JsonDocument() would, and
+ * the default of every SchedularTiers category.
+ */
+class SchedularHeap : public ArduinoJson::Allocator {
+
+    public:
+
+    void* allocate(size_t size) override           { return malloc(size); }
+    void deallocate(void* p) override              { free(p); }
+    void* reallocate(void* p, size_t size) override { return realloc(p, size); }
+
+    static SchedularHeap& instance(void)
+    {
+        static SchedularHeap heap;
+        return heap;
+    }
+};
+
+
+#if defined(ESP32)
+
+/**
+ * One kind of ESP32 memory as an Allocator, through heap_caps_*():
+ * CapsHeap::psram() the external PSRAM, CapsHeap::internal() the internal
+ * RAM the WiFi stack needs, whatever CONFIG_SPIRAM_USE_MALLOC does with
+ * malloc(). psram() returns nullptr on every allocation of a board without
+ * PSRAM (psramFound()).
+ */
+class CapsHeap : public ArduinoJson::Allocator {
+
+    public:
+
+    explicit CapsHeap(const uint32_t caps) : _caps(caps | MALLOC_CAP_8BIT) {}
+
+    void* allocate(size_t size) override           { return heap_caps_malloc(size, _caps); }
+    void deallocate(void* p) override              { heap_caps_free(p); }
+    void* reallocate(void* p, size_t size) override { return heap_caps_realloc(p, size, _caps); }
+
+    static CapsHeap& psram(void)
+    {
+        static CapsHeap heap(MALLOC_CAP_SPIRAM);
+        return heap;
+    }
+
+    static CapsHeap& internal(void)
+    {
+        static CapsHeap heap(MALLOC_CAP_INTERNAL);
+        return heap;
+    }
+
+
+    protected:
+
+    const uint32_t _caps;
+};
+
+#endif
+
+
+/**
+ * Accounting over another Allocator, the backing: what a tier holds now and
+ * at worst, and the allocations it refused. Each block carries its size in a
+ * header of 8 bytes, which live() and peak() leave out.
+ */
+class SchedularTier : public ArduinoJson::Allocator {
+
+    public:
+
+    explicit SchedularTier(ArduinoJson::Allocator& backing)
+        : _backing(backing), _live(0), _peak(0), _allocations(0), _failures(0) {}
+
+    void* allocate(size_t size) override
+    {
+        uint8_t* block = static_cast<uint8_t*>(_backing.allocate(HEADER + size));
+        if (block == nullptr) {
+            ++_failures;
+            return nullptr;
+        }
+        *reinterpret_cast<size_t*>(block) = size;
+        ++_allocations;
+        _grow(size);
+        return block + HEADER;
+    }
+
+    void deallocate(void* p) override
+    {
+        if (p == nullptr) {
+            return;
+        }
+        uint8_t* block = static_cast<uint8_t*>(p) - HEADER;
+        _live -= *reinterpret_cast<size_t*>(block);
+        _backing.deallocate(block);
+    }
+
+    void* reallocate(void* p, size_t size) override
+    {
+        if (p == nullptr) {
+            return allocate(size);
+        }
+        uint8_t* block = static_cast<uint8_t*>(p) - HEADER;
+        const size_t old = *reinterpret_cast<size_t*>(block);
+        block = static_cast<uint8_t*>(_backing.reallocate(block, HEADER + size));
+        if (block == nullptr) {
+            ++_failures;
+            return nullptr;
+        }
+        *reinterpret_cast<size_t*>(block) = size;
+        _live -= old;
+        _grow(size);
+        return block + HEADER;
+    }
+
+    size_t live(void) const        { return _live; }
+    size_t peak(void) const        { return _peak; }
+    size_t allocations(void) const { return _allocations; }
+    size_t failures(void) const    { return _failures; }
+
+    // Starts a new peak from what is live now.
+    void resetPeak(void) { _peak = _live; }
+
+
+    protected:
+
+    static constexpr size_t HEADER = sizeof(size_t) < 8 ? 8 : sizeof(size_t);
+
+    void _grow(const size_t size)
+    {
+        _live += size;
+        if (_live > _peak) {
+            _peak = _live;
+        }
+    }
+
+    ArduinoJson::Allocator& _backing;
+    size_t _live;
+    size_t _peak;
+    size_t _allocations;
+    size_t _failures;
+};
+
+
+/**
+ * Where the library's bulk memory goes, by category, for boards with a large
+ * and slow external RAM next to a scarce internal one (ESP32 with PSRAM):
+ *
+ *  - JSON      : the documents of each request, built while the reply is
+ *                parsed and dropped on return;
+ *  - EVENTS    : the event stores a sketch keeps (EventTimeline,
+ *                RecurrenceStore), large with generous SCHEDULAR_TIMELINE_* or
+ *                SCHEDULAR_MAX_RECURRENCES;
+ *  - TRANSPORT : the transport and its buffers (read buffer, gzip window).
+ *
+ * Each category has an Allocator, the heap until set() gives it another.
+ * The documents of a request without an arena (setJsonArena()) come from the
+ * JSON one; stores and transports are built in theirs by the sketch with
+ * make<T>() and handed to the scheduler as before. What stays in internal RAM
+ * is small and hot: the scheduler, tokens and ids, the event titles, the TLS
+ * library's own buffers, and the WiFi stack.
+ *
+ *   SchedularTier slow(CapsHeap::psram());
+ *   SchedularTiers::set(SchedularTiers::JSON, &slow);
+ *   SchedularTiers::set(SchedularTiers::EVENTS, &slow);
+ *   EventTimeline* timeline = SchedularTiers::make<EventTimeline>(SchedularTiers::EVENTS, 24 * 3600);
+ *
+ * Set the tiers in setup(), before the first request; a category must not
+ * change while memory taken from it is still held.
+ */
+class SchedularTiers {
+
+    public:
+
+    enum Category : uint8_t {
+        JSON,
+        EVENTS,
+        TRANSPORT,
+        CATEGORY_COUNT,
+    };
+
+    static ArduinoJson::Allocator& of(const Category category) { return *_table()[category]; }
+
+    // nullptr gives the category back to the heap.
+    static void set(const Category category, ArduinoJson::Allocator* allocator)
+    {
+        _table()[category] = allocator != nullptr ? allocator : &SchedularHeap::instance();
+    }
+
+    // A T built in the category's memory, or nullptr when it has no room.
+    template <class T, class... Args>
+    static T* make(const Category category, Args&&... args)
+    {
+        void* p = of(category).allocate(sizeof(T));
+        return p != nullptr ? new (p) T(std::forward<Args>(args)...) : nullptr;
+    }
+
+    // Destroys a T from make(), given the same category.
+    template <class T>
+    static void destroy(const Category category, T* p)
+    {
+        if (p != nullptr) {
+            p->~T();
+            of(category).deallocate(p);
+        }
+    }
+
+
+    protected:
+
+    static ArduinoJson::Allocator** _table(void)
+    {
+        static ArduinoJson::Allocator* table[CATEGORY_COUNT] = {
+            &SchedularHeap::instance(), &SchedularHeap::instance(), &SchedularHeap::instance(),
+        };
+        return table;
+    }
+};
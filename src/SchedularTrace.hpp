@@ -0,0 +1,142 @@
+#pragma once
+
+
+#include <Arduino.h>
+
+
+/**
+ * Optional trace of what the library did, for boards in the field with no
+ * serial console attached.
+ *
+ * Opt-in like SchedularStats: define SCHEDULAR_TRACE before including
+ * GoogleSchedular.hpp. Without it there is no trace member and every trace
+ * point expands to nothing (SCHEDULAR_TRACE_ONLY).
+ *
+ * When enabled, each trace point writes one 12-byte Record into a ring of
+ * SCHEDULAR_TRACE_SIZE (a power of two): the newest records overwrite the
+ * oldest, so the ring always holds the last moments before a fault, to be
+ * read back (or sent somewhere) later with size() / at(). A record is a few
+ * stores and a micros() call; nothing is formatted on the device.
+ *
+ * Trace points, with the meaning of `code` and `durationUs`:
+ *  - EV_REQUEST  : a request starts; code is its SchedularStats::Op.
+ *  - EV_RESPONSE : status line in; code is the HTTP status or the transport's
+ *                  negative error (0: no connection); since EV_REQUEST, so
+ *                  with the lookup and connection below included.
+ *  - EV_DNS      : how the connection was resolved; code is the number of
+ *                  lookups, `arg` 1 when a cached address was tried first;
+ *                  the time in the resolver.
+ *  - EV_CONNECT  : connection and TLS handshake, where the transport opens
+ *                  the socket itself (ESP32, Linux; HTTPClient on the ESP8266
+ *                  connects inside the request, and leaves none); the
+ *                  connection alone, lookup excluded.
+ *  - EV_PARSE    : body parsed; code is the DeserializationError::Code (0:
+ *                  Ok); the parse alone.
+ *  - EV_END      : request closed; code is the final HTTP status (0 when the
+ *                  body did not parse); the whole request.
+ *  - EV_STATE    : GoogleSchedular moved to another State (code).
+ *  - EV_RETRY    : maintain() drops the access_token to recover from a
+ *                  transient failure.
+ *  - EV_SYNC     : syncAt() done; code is SYNC_* (where the answer came from),
+ *                  negated on failure; the whole call.
+ */
+#ifdef SCHEDULAR_TRACE
+  #define SCHEDULAR_TRACE_ONLY(...) __VA_ARGS__
+#else
+  #define SCHEDULAR_TRACE_ONLY(...)
+#endif
+
+// Records kept by a SchedularTrace; a power of two.
+#ifndef SCHEDULAR_TRACE_SIZE
+#define SCHEDULAR_TRACE_SIZE 64
+#endif
+
+
+class SchedularTrace {
+
+    public:
+
+    enum Event : uint8_t {
+        EV_REQUEST,
+        EV_RESPONSE,
+        EV_DNS,
+        EV_PARSE,
+        EV_END,
+        EV_STATE,
+        EV_RETRY,
+        EV_SYNC,
+        EV_CONNECT,
+    };
+
+    // EV_SYNC codes.
+    enum Sync : uint8_t {
+        SYNC_REQUEST     = 1,
+        SYNC_RECURRENCES = 2,
+        SYNC_TIMELINE    = 3,
+    };
+
+    struct Record {
+        uint32_t atMs;          // millis() when recorded
+        uint32_t durationUs;    // 0 for instants
+        int16_t  code;
+        uint8_t  event;         // an Event
+        uint8_t  arg;
+    };
+
+    static_assert((SCHEDULAR_TRACE_SIZE & (SCHEDULAR_TRACE_SIZE - 1)) == 0, "SCHEDULAR_TRACE_SIZE must be a power of two");
+
+
+    SchedularTrace() { clear(); }
+
+    void clear(void)
+    {
+        _count = 0;
+        _startUs = 0;
+    }
+
+    void record(const Event event, const int code, const uint32_t durationUs = 0, const uint8_t arg = 0)
+    {
+        Record& r = _ring[_count++ & (SCHEDULAR_TRACE_SIZE - 1)];
+        r.atMs = millis();
+        r.durationUs = durationUs;
+        r.code = static_cast<int16_t>(code);
+        r.event = event;
+        r.arg = arg;
+    }
+
+    // Records held, at most SCHEDULAR_TRACE_SIZE.
+    uint16_t size(void) const { return _count < SCHEDULAR_TRACE_SIZE ? static_cast<uint16_t>(_count) : SCHEDULAR_TRACE_SIZE; }
+
+    // Records written since clear(), and those overwritten since.
+    uint32_t count(void) const { return _count; }
+    uint32_t dropped(void) const { return _count - size(); }
+
+    // The i-th record held, oldest first.
+    const Record& at(const uint16_t i) const { return _ring[(_count - size() + i) & (SCHEDULAR_TRACE_SIZE - 1)]; }
+
+    static const char* name(const uint8_t event)
+    {
+        static const char* const names[] = { "request", "response", "dns", "parse", "end", "state", "retry", "sync", "connect" };
+        return event < sizeof(names) / sizeof(names[0]) ? names[event] : "?";
+    }
+
+
+    // --- request timing, called by GoogleOAuth2 ------------------------------
+
+    // EV_REQUEST, and the start of the request's durations.
+    void begin(const uint8_t op)
+    {
+        _startUs = micros();
+        record(EV_REQUEST, op);
+    }
+
+    // Microseconds since begin().
+    uint32_t elapsedUs(void) const { return micros() - _startUs; }
+
+
+    private:
+
+    Record _ring[SCHEDULAR_TRACE_SIZE];
+    uint32_t _count;
+    unsigned long _startUs;
+};
@@ -0,0 +1,368 @@
+#pragma once
+
+
+#include <Arduino.h>
+
+#include "SchedularDns.hpp"
+#include "SchedularGzip.hpp"
+#include "SchedularReader.hpp"
+
+
+/**
+ * Transport policies: the HTTP/TLS layer under GoogleOAuth2.
+ *
+ * GoogleOAuth2, GoogleApiCalendar and BasicGoogleSchedular take the transport
+ * as a template parameter, so it is resolved at compile time and a device build
+ * makes no virtual call for it. SchedularTransport names the platform's default
+ * policy: HttpClientTransport below on the ESP cores, PosixTransport
+ * (PosixTransport.hpp) on Linux. A policy provides:
+ *
+ *   typedef ... Body;             // what deserializeJson() reads the reply from
+ *                                 // (read() / readBytes(), with a timeout),
+ *                                 // inflated with SCHEDULAR_GZIP
+ *   static T& shared();           // instance used when none is given
+ *   bool acquire(Host);           // lend the connection for one request
+ *   int  post(path, json);        // const char*s; status code, or <= 0 on
+ *   int  get(path, authorization);//   failure; the reply body is then
+ *                                 //   readable from body()
+ *   Body& body();
+ *   void close();                 // close the connection and give it back
+ *
+ * A request is acquire() -> post()/get() -> body() -> close(), on one thread.
+ */
+class SchedularTransportBase {
+
+    public:
+
+    // The two Google endpoints the library talks to.
+    enum Host : uint8_t {
+        HOST_OAUTH2,    // oauth2.googleapis.com
+        HOST_API,       // www.googleapis.com
+        HOST_COUNT,
+    };
+
+    static const __FlashStringHelper* hostName(const Host host)
+    {
+        static const char oauth2[] PROGMEM = "oauth2.googleapis.com";
+        static const char api[] PROGMEM    = "www.googleapis.com";
+        return FPSTR(host == HOST_OAUTH2 ? oauth2 : api);
+    }
+
+    // Name resolution behind the last connection: whether a cached address
+    // was tried, how many lookups went to the resolver (1 on a cache miss or
+    // after the cached address failed), and how long the lookups and then the
+    // connection (TLS handshake included) took. Zeroes from a transport that
+    // neither resolves nor connects itself.
+    struct Resolution {
+        uint8_t  lookups;
+        bool     cached;
+        uint32_t resolveUs;
+        uint32_t connectUs;
+    };
+
+    SchedularTransportBase() : _resolution() {}
+
+    const Resolution& resolution(void) const { return _resolution; }
+
+
+    protected:
+
+    Resolution _resolution;
+};
+
+
+#if defined(ESP8266) || defined(ESP32)
+
+/**
+ * Transport policy of the ESP cores: the HTTPClient + WiFiClientSecure pair
+ * every request goes through, shared between schedulers.
+ *
+ * A GoogleOAuth2 used to own its HTTPClient + WiFiClientSecure, so each extra
+ * calendar or Google account paid for a full TLS client. Requests are
+ * synchronous and each one closes its connection before returning, so one pair
+ * can serve any number of instances, as long as they borrow it one request at a
+ * time. That is what this class is: a pool of one connection. By default every
+ * instance borrows SchedularTransport::shared(); pass your own to the
+ * constructor to give a set of schedulers (say, one per FreeRTOS task on an
+ * ESP32) a connection of their own. RAM then scales with the number of
+ * connections open at once, not with the number of calendars.
+ *
+ * Per-request state is not carried over between borrowers: HTTPClient::begin()
+ * clears the headers of the previous request, and each request sets its own
+ * Authorization header.
+ *
+ * Connection reuse: the body is streamed in HTTP/1.0 mode (see GoogleOAuth2),
+ * so the server closes the socket after every reply and keep-alive is not an
+ * option. What is kept per host instead is the TLS session: on the ESP8266,
+ * BearSSL resumes it on the next connection to the same host, whichever
+ * instance makes it, which turns the full handshake (the costly part of a
+ * request) into an abbreviated one. The ESP32 core has no session cache API, so
+ * there every connection does a full handshake.
+ *
+ * TLS memory profile: by default BearSSL reserves a receive buffer for a full
+ * 16 KB TLS record, the largest single RAM consumer of a request. With
+ * setTlsProfile(), the transport asks each host once (probeMaxFragmentLength)
+ * whether it accepts smaller records. If it does, both buffers shrink to the
+ * profile size; if not, or if the probe cannot connect, the receive buffer
+ * stays at 16 KB, which the server may fill, and only the transmit buffer
+ * shrinks, since the device decides the size of what it sends. A refusal
+ * looks like a probe that could not connect, so it is kept only once the
+ * request's own connection succeeds; until then each request probes again.
+ * tlsBuffers() reports what each host ended up with. ESP8266 only: the ESP32 core sizes its
+ * buffers itself, and there the profile has no effect.
+ *
+ * Name resolution: on the ESP32 the transport opens the connection itself, to
+ * the address kept for the host in a DnsCache (see SchedularDns.hpp), with the
+ * host name as SNI, and HTTPClient goes on over it. A failed connection drops
+ * the address and resolves again. The ESP8266 core only sends SNI when it
+ * resolves the name itself, so there HTTPClient connects by name, and the
+ * lookup is left to lwIP's own cache.
+ */
+class HttpClientTransport : public SchedularTransportBase {
+
+    public:
+
+    // Largest TLS record payload (maximum fragment length) asked of the hosts.
+    enum TlsProfile : uint16_t {
+        TLS_DEFAULT = 0,        // core defaults, no probe
+        TLS_4K      = 4096,
+        TLS_2K      = 2048,
+        TLS_1K      = 1024,
+        TLS_512     = 512,
+    };
+
+    // Record payload sizes set on the client for one host (BearSSL adds its
+    // own protocol overhead on top). Zeroes: core defaults, or not probed yet.
+    struct TlsBuffers {
+        uint16_t receive;
+        uint16_t transmit;
+        bool     reduced;       // the host accepted the maximum fragment length
+    };
+
+
+    // What the reply is read from: a BufferedReader over the TLS client (see
+    // SchedularReader.hpp), or a GzipReader over that with SCHEDULAR_GZIP
+    // (see SchedularGzip.hpp).
+    typedef BufferedReader<WiFiClientSecure> Reader;
+#ifdef SCHEDULAR_GZIP
+    typedef GzipReader<Reader> Body;
+#else
+    typedef Reader Body;
+#endif
+
+
+    HttpClientTransport() : _httpClient(), _wifiClient(), _tlsProfile(TLS_DEFAULT), _host(HOST_OAUTH2), _busy(false), _probeRefused(false)
+    {
+        memset(_buffers, 0, sizeof(_buffers));
+        _wifiClient.setInsecure();
+        _httpClient.useHTTP10(true);
+    }
+
+    // Process-wide pool, used by every instance not given its own.
+    static HttpClientTransport& shared(void)
+    {
+        static HttpClientTransport transport;
+        return transport;
+    }
+
+    // Lends the clients for one request to `host`. Returns false, and lends
+    // nothing, while another request holds them (a request issued from inside
+    // another one, or from another task on the same transport). Not a lock:
+    // tasks that run concurrently need a transport each.
+    bool acquire(const Host host)
+    {
+        if (_busy) {
+            return false;
+        }
+        _busy = true;
+        _host = host;
+#if defined(ESP8266)
+        _wifiClient.setSession(&_sessions[host]);
+        _applyTlsProfile(host);
+#else
+        (void) host;
+#endif
+        return true;
+    }
+
+    // Call from setup(), before the first request. Each host is probed on its
+    // first request under the new profile (one extra short connection).
+    void setTlsProfile(const TlsProfile profile)
+    {
+        _tlsProfile = profile;
+        memset(_buffers, 0, sizeof(_buffers));
+    }
+
+    TlsProfile tlsProfile(void) const { return _tlsProfile; }
+
+    const TlsBuffers& tlsBuffers(const Host host) const { return _buffers[host]; }
+
+#if defined(ESP32)
+    // How long a resolved address is reused, in seconds (SCHEDULAR_DNS_TTL by
+    // default; 0 resolves on every connection).
+    void setDnsTtl(const uint32_t seconds) { _dns.setTtl(seconds); }
+#endif
+
+    int post(const char* path, const char* json)
+    {
+        _httpClient.begin(_wifiClient, hostName(_host), 443, path, true);
+        _httpClient.addHeader(F("Content-Type"), F("application/json"));
+        _beginReply();
+#if defined(ESP32)
+        if (!_connectCached()) {
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+#endif
+        return _settleProbe(_httpClient.POST(reinterpret_cast<uint8_t*>(const_cast<char*>(json)), strlen(json)));
+    }
+
+    int get(const char* path, const char* authorization)
+    {
+        _httpClient.begin(_wifiClient, hostName(_host), 443, path, true);
+        _httpClient.addHeader(F("Authorization"), authorization);
+        _beginReply();
+#if defined(ESP32)
+        if (!_connectCached()) {
+            return HTTPC_ERROR_CONNECTION_REFUSED;
+        }
+#endif
+        return _settleProbe(_httpClient.GET());
+    }
+
+    Body& body(void)
+    {
+#ifdef SCHEDULAR_GZIP
+        return _gzip;
+#else
+        return _reader;
+#endif
+    }
+
+    void close(void)
+    {
+        _wifiClient.stop();
+        _httpClient.end();
+        release();
+    }
+
+    // Gives the clients back without a request (close() does it after one).
+    void release(void) { _busy = false; }
+
+    bool isBusy(void) const { return _busy; }
+
+
+    protected:
+
+    // Points the readers at the client for the coming reply. With gzip, the
+    // HTTP/1.0 request does not otherwise name an encoding (HTTPClient only
+    // sends its identity default over HTTP/1.1).
+    void _beginReply(void)
+    {
+        _reader.begin(_wifiClient);
+#ifdef SCHEDULAR_GZIP
+        _httpClient.addHeader(F("Accept-Encoding"), F("gzip"));
+        _gzip.begin(_reader);
+#endif
+    }
+
+#if defined(ESP32)
+    // Opens the connection HTTPClient then reuses (it keeps a client that is
+    // already connected): to the cached address of the host, or to a freshly
+    // resolved one. SNI and the Host header still name the host.
+    bool _connectCached(void)
+    {
+        const unsigned long t0 = micros();
+        _resolution = Resolution();
+        const bool ok = _dialCached();
+        _resolution.connectUs = micros() - t0 - _resolution.resolveUs;
+        return ok;
+    }
+
+    bool _dialCached(void)
+    {
+        const char* name = reinterpret_cast<const char*>(hostName(_host));
+        const IPAddress* cached = _dns.find(_host);
+        if (cached != nullptr) {
+            _resolution.cached = true;
+            if (_wifiClient.connect(*cached, 443, name, nullptr, nullptr, nullptr)) {
+                return true;
+            }
+            _wifiClient.stop();
+            _dns.forget(_host);
+        }
+        IPAddress address;
+        ++_resolution.lookups;
+        const unsigned long t0 = micros();
+        const bool found = WiFi.hostByName(name, address);
+        _resolution.resolveUs = micros() - t0;
+        if (!found || !_wifiClient.connect(address, 443, name, nullptr, nullptr, nullptr)) {
+            return false;
+        }
+        _dns.store(_host, address);
+        return true;
+    }
+#endif
+
+#if defined(ESP8266)
+    // Sizes the buffers of the next connection to `host`, probing the host
+    // the first time. The buffers are allocated on connect and freed on
+    // stop(), so switching sizes between hosts costs nothing.
+    void _applyTlsProfile(const Host host)
+    {
+        if (_tlsProfile == TLS_DEFAULT) {
+            return;
+        }
+        TlsBuffers& b = _buffers[host];
+        _probeRefused = false;
+        if (b.receive != 0) {
+            _wifiClient.setBufferSizes(b.receive, b.transmit);
+        } else if (WiFiClientSecure::probeMaxFragmentLength(String(hostName(host)), 443, _tlsProfile)) {
+            b.reduced  = true;
+            b.receive  = _tlsProfile;
+            b.transmit = _tlsProfile;
+            _wifiClient.setBufferSizes(b.receive, b.transmit);
+        } else {
+            _probeRefused = true;       // or the host was out of reach
+            _wifiClient.setBufferSizes(16384, _tlsProfile);
+        }
+    }
+#endif
+
+    // Keeps a refused probe once the request's connection shows the host was
+    // reachable (a positive status code).
+    int _settleProbe(const int httpCode)
+    {
+#if defined(ESP8266)
+        if (_probeRefused && httpCode > 0) {
+            TlsBuffers& b = _buffers[_host];
+            b.reduced  = false;
+            b.receive  = 16384;
+            b.transmit = _tlsProfile;
+        }
+        _probeRefused = false;
+#endif
+        return httpCode;
+    }
+
+    HTTPClient _httpClient;
+    WiFiClientSecure _wifiClient;
+    Reader _reader;
+#ifdef SCHEDULAR_GZIP
+    Body _gzip;
+#endif
+#if defined(ESP8266)
+    BearSSL::Session _sessions[HOST_COUNT];
+#endif
+#if defined(ESP32)
+    DnsCache<IPAddress, HOST_COUNT> _dns;
+#endif
+    TlsBuffers _buffers[HOST_COUNT];
+    TlsProfile _tlsProfile;
+    Host _host;
+    bool _busy;
+    bool _probeRefused;     // the probe of this request's host said no
+};
+
+typedef HttpClientTransport SchedularTransport;
+
+#endif
@@ -0,0 +1,173 @@
+#pragma once
+
+
+#if !defined(ESP8266) && !defined(ESP32) && (defined(__unix__) || defined(__APPLE__))
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * Fixed-size thread pool with one task queue per worker and work stealing,
+ * for the native gateway (SchedularGateway.hpp).
+ *
+ * submit() deals tasks round-robin over the workers' queues (a task submitted
+ * from a worker goes to that worker's own queue). A worker runs its own queue
+ * newest first, and when it is empty steals the oldest task of another queue,
+ * so a worker stuck on a slow calendar does not hold back the ones dealt after
+ * it. Each queue has its own small lock: workers only contend when stealing.
+ *
+ * wait() blocks until every task submitted so far has run. Tasks must not throw
+ * (the library reports errors through return values, not exceptions).
+ */
+class WorkStealingPool {
+
+    public:
+
+    typedef std::function<void(void)> Task;
+
+    explicit WorkStealingPool(unsigned threads = std::thread::hardware_concurrency())
+        : _queued(0), _pending(0), _next(0), _steals(0), _stop(false)
+    {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (unsigned i = 0; i < threads; ++i) {
+            _queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        }
+        for (unsigned i = 0; i < threads; ++i) {
+            _threads.push_back(std::thread(&WorkStealingPool::_run, this, i));
+        }
+    }
+
+    // Runs what is still queued, then joins the workers.
+    ~WorkStealingPool()
+    {
+        {
+            std::lock_guard<std::mutex> guard(_idleLock);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (std::thread& t : _threads) {
+            t.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    void submit(Task task)
+    {
+        const int self = _self(this);
+        const unsigned q = self >= 0 ? static_cast<unsigned>(self) : _next++ % size();
+        ++_pending;
+        ++_queued;
+        {
+            std::lock_guard<std::mutex> guard(_queues[q]->lock);
+            _queues[q]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> guard(_idleLock);
+        }
+        _wake.notify_one();
+    }
+
+    void wait(void)
+    {
+        std::unique_lock<std::mutex> lock(_idleLock);
+        _done.wait(lock, [this] { return _pending.load() == 0; });
+    }
+
+    unsigned size(void) const { return static_cast<unsigned>(_queues.size()); }
+
+    // Tasks run by another worker than the one they were dealt to.
+    unsigned long long steals(void) const { return _steals.load(); }
+
+
+    protected:
+
+    struct Queue {
+        std::mutex lock;
+        std::deque<Task> tasks;
+    };
+
+    // Index of the calling thread among `pool`'s workers, or -1.
+    static int _self(const WorkStealingPool* pool, const int set = -2)
+    {
+        static thread_local const WorkStealingPool* owner = nullptr;
+        static thread_local int index = -1;
+        if (set != -2) {
+            owner = pool;
+            index = set;
+        }
+        return owner == pool ? index : -1;
+    }
+
+    bool _pop(const unsigned self, Task& task)
+    {
+        Queue& q = *_queues[self];
+        std::lock_guard<std::mutex> guard(q.lock);
+        if (q.tasks.empty()) {
+            return false;
+        }
+        task = std::move(q.tasks.back());
+        q.tasks.pop_back();
+        return true;
+    }
+
+    bool _steal(const unsigned self, Task& task)
+    {
+        for (unsigned i = 1; i < size(); ++i) {
+            Queue& q = *_queues[(self + i) % size()];
+            std::lock_guard<std::mutex> guard(q.lock);
+            if (!q.tasks.empty()) {
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                ++_steals;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void _run(const unsigned self)
+    {
+        _self(this, static_cast<int>(self));
+        for (;;) {
+            Task task;
+            if (_pop(self, task) || _steal(self, task)) {
+                --_queued;
+                task();
+                if (--_pending == 0) {
+                    std::lock_guard<std::mutex> guard(_idleLock);
+                    _done.notify_all();
+                }
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(_idleLock);
+            _wake.wait(lock, [this] { return _stop || _queued.load() != 0; });
+            if (_stop && _queued.load() == 0) {
+                return;
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::mutex _idleLock;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    std::atomic<size_t> _queued;        // in a queue, not picked up yet
+    std::atomic<size_t> _pending;       // submitted, not finished yet
+    std::atomic<unsigned> _next;
+    std::atomic<unsigned long long> _steals;
+    bool _stop;
+};
+
+#endif
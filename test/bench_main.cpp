@@ -0,0 +1,468 @@
+// Native (host) benchmarks for the GoogleSchedular library.
+//
+// Measures how the request path scales with the payload: setCalendar() scanning
+// a calendarList, syncAt() turning an events reply into the event list (and,
+// as syncAt_channels, into a ChannelMatcher mask), and the bare
+// deserializeJson() of the same body for reference, straight from the client
+// (parse, one read call per byte) and through the transport's BufferedReader
+// (parse_buffered). Bodies are synthetic
+// and deterministic, swept over
+//   - size            : 10 .. 10,000 items,
+//   - title length    : short and long summaries,
+//   - escape density  : share of title characters written as JSON escapes.
+// They go through the same mocks as the unit tests (mockHttpPush -> HTTPClient
+// -> WiFiClientSecure -> ArduinoJson), so what is timed is the library code
+// plus the streaming parse, with no network.
+//
+// Output is one JSON object per line on stdout, so two runs can be diffed or
+// loaded side by side:
+//   ./test/run.sh bench > bench_output.txt
+// Fields: op, items, title, escapes (percent), body (bytes), iterations,
+// ns_per_item, bytes_per_s, allocs (per call) and peak_heap (bytes above the
+// level before the call, from MockHeap.h).
+//
+// A second set of lines replays syncAt(), a token refresh and both parses over
+// simulated links (MockHttpShape: latency, segment size and spacing, device read cost).
+// Their latency is on the fake clock, so it is exact and the same everywhere:
+// fields op, profile, body, ok, latency_us (request start -> list updated).
+//
+// The loop_latency lines are the longest the library keeps the CPU without a
+// yield() (PacedReader), on this host, over a whole setCalendar() / syncAt():
+// fields op, call, items, body, yields, worst_gap_us (median of 5 runs) and
+// total_us. The "unpaced" call is the bare parse, one slice, for reference.
+//
+// run.sh also builds this file with SCHEDULAR_TRACE: its sweep lines carry
+// "trace":1, to be compared with the "trace":0 ones for the cost of the trace
+// points, and it adds a trace line: the cost of one record (ns_per_record)
+// and the records one syncAt() and one token refresh write.
+
+#define ESP8266 1  // select the ESP8266 include branch of GoogleSchedular.hpp
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "MockHeap.h"
+#include "GoogleSchedular.hpp"
+
+unsigned long g_fakeMillis = 0;
+
+
+// --- fake clock -----------------------------------------------------------
+
+class FakeNtp : public Ntp {
+public:
+    unsigned long time(void) const override { return _t; }
+    void set(unsigned long t) { _t = t; }
+private:
+    unsigned long _t = 1000;
+};
+
+
+// --- synthetic payloads ---------------------------------------------------
+
+// Small deterministic LCG: the same bodies on every run and every machine.
+static uint32_t g_seed = 1;
+static uint32_t nextRandom() {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+// A JSON string body (without quotes) of `length` decoded characters, of which
+// about `escapePercent` % are written as escapes.
+static void appendTitle(std::string& out, unsigned index, unsigned length, unsigned escapePercent) {
+    static const char* const escapes[] = { "\\\"", "\\\\", "\\n", "\\u00e9", "\\/" };
+    char prefix[16];
+    std::snprintf(prefix, sizeof(prefix), "T%05u ", index);
+    out += prefix;
+    for (unsigned i = std::strlen(prefix); i < length; ++i) {
+        if (nextRandom() % 100 < escapePercent) {
+            out += escapes[nextRandom() % 5];
+        } else {
+            out += static_cast<char>('a' + nextRandom() % 26);
+        }
+    }
+}
+
+// calendarList reply, the wanted calendar ("Target") placed last so the scan
+// walks the whole list.
+static std::string makeCalendarList(unsigned items, unsigned titleLength, unsigned escapePercent) {
+    std::string body = "{\"items\":[";
+    for (unsigned i = 0; i + 1 < items; ++i) {
+        char id[64];
+        std::snprintf(id, sizeof(id), "{\"id\":\"c%05u@group.calendar.google.com\",\"summary\":\"", i);
+        body += id;
+        appendTitle(body, i, titleLength, escapePercent);
+        body += "\"},";
+    }
+    body += "{\"id\":\"target@group.calendar.google.com\",\"summary\":\"Target\"}]}";
+    return body;
+}
+
+// events reply shaped by fields=items(summary).
+static std::string makeEvents(unsigned items, unsigned titleLength, unsigned escapePercent) {
+    std::string body = "{\"items\":[";
+    for (unsigned i = 0; i < items; ++i) {
+        body += i ? ",{\"summary\":\"" : "{\"summary\":\"";
+        appendTitle(body, i, titleLength, escapePercent);
+        body += "\"}";
+    }
+    body += "]}";
+    return body;
+}
+
+
+// --- harness --------------------------------------------------------------
+
+class BenchSchedular : public GoogleSchedular {
+public:
+    BenchSchedular(Ntp* ntp) : GoogleSchedular(String("i"), String("s"), ntp) {}
+    void forceLinked(const char* calendarId) {
+        _state = State::LINKED;
+        _calendarId = calendarId;
+    }
+    void forceAuthenticated() { _state = State::AUTHENTICATED; }
+    Response refresh() {
+        JsonDocument doc;
+        return refreshAccessToken(doc);
+    }
+};
+
+#ifdef SCHEDULAR_TRACE
+static const int TRACED = 1;
+#else
+static const int TRACED = 0;
+#endif
+
+struct Sample {
+    double ns;
+    size_t allocs;
+    size_t peak;
+};
+
+static void report(const char* op, unsigned items, unsigned titleLength, unsigned escapePercent,
+                   size_t bodySize, unsigned iterations, const Sample& s) {
+    const double nsPerCall = s.ns / iterations;
+    std::printf("{\"op\":\"%s\",\"items\":%u,\"title\":%u,\"escapes\":%u,\"body\":%zu,"
+                "\"iterations\":%u,\"ns_per_item\":%.1f,\"bytes_per_s\":%.0f,"
+                "\"allocs\":%zu,\"peak_heap\":%zu,\"trace\":%d}\n",
+                op, items, titleLength, escapePercent, bodySize, iterations,
+                nsPerCall / items, bodySize * 1e9 / nsPerCall, s.allocs / iterations, s.peak, TRACED);
+}
+
+// Times `iterations` calls of `call`, each fed a fresh copy of `body`. Scripting
+// the reply is kept out of the timed region; allocations are counted per call
+// and the peak is the worst single call.
+template <typename Call>
+static Sample measure(const std::string& body, unsigned iterations, Call call) {
+    Sample s = {0, 0, 0};
+    for (unsigned i = 0; i < iterations; ++i) {
+        mockHttpReset();
+        mockHttpPush(200, body.c_str());
+        const size_t live = mockHeap().live;
+        mockHeapReset();
+        const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        call();
+        const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        s.ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+        s.allocs += mockHeap().allocations;
+        const size_t peak = mockHeapPeakGrowth(live);
+        if (peak > s.peak) s.peak = peak;
+    }
+    return s;
+}
+
+// Enough repetitions that the small payloads are not pure timer noise.
+static unsigned iterationsFor(unsigned items) {
+    const unsigned n = 20000 / items;
+    return n ? n : 1;
+}
+
+
+// Link profiles for the simulated-network lines. Segment sizes follow TCP
+// MSS (1460 on Wi-Fi, 536 on a poor link); read cost is the device time per
+// read call, about what an 80 MHz ESP8266 spends per byte through BearSSL.
+struct NetProfile {
+    const char* name;
+    MockHttpShape shape;
+};
+
+static void reportNet(const char* op, const char* profile, size_t bodySize, bool ok, unsigned long us) {
+    std::printf("{\"op\":\"%s\",\"profile\":\"%s\",\"body\":%zu,\"ok\":%s,\"latency_us\":%lu}\n",
+                op, profile, bodySize, ok ? "true" : "false", us);
+}
+
+static void benchNetwork(FakeNtp& ntp) {
+    const NetProfile profiles[] = {
+        { "instant",     MockHttpShape() },
+        { "wifi",        MockHttpShape().latency(180).firstByte(20).segments(1460, 2) },
+        { "congested",   MockHttpShape().latency(600).firstByte(150).segments(536, 40) },
+        { "slow-reader", MockHttpShape().latency(180).firstByte(20).segments(1460, 2).readCost(25) },
+        { "stalled",     MockHttpShape().latency(180).segments(1460, 2).stall(2048, 1200) },
+    };
+    g_seed = 7;
+    const std::string events = makeEvents(100, 32, 0);
+    const char* token = "{\"access_token\":\"ya29.a0AfH6SMBbenchAccessTokenValue\","
+                        "\"expires_in\":3599,\"token_type\":\"Bearer\"}";
+
+    for (const NetProfile& profile : profiles) {
+        {
+            BenchSchedular sched(&ntp);
+            sched.forceLinked("bench@group.calendar.google.com");
+            mockHttpReset();
+            mockHttpPush(200, events.c_str(), profile.shape);
+            const unsigned long t0 = micros();
+            const bool ok = sched.syncAt("2024-11-04T07:30:15Z");
+            reportNet("syncAt", profile.name, events.size(), ok, micros() - t0);
+        }
+        {
+            BenchSchedular sched(&ntp);
+            sched.setRefreshToken(String("1//0benchRefreshToken"));
+            mockHttpReset();
+            mockHttpPush(200, token, profile.shape);
+            const unsigned long t0 = micros();
+            const bool ok = sched.refresh() == GoogleSchedular::OK;
+            reportNet("refresh", profile.name, std::strlen(token), ok, micros() - t0);
+        }
+        {
+            WiFiClientSecure client;
+            HTTPClient http;
+            mockHttpReset();
+            mockHttpPush(200, events.c_str(), profile.shape);
+            const unsigned long t0 = micros();
+            http.GET();
+            JsonDocument doc;
+            const bool ok = !deserializeJson(doc, client);
+            reportNet("parse", profile.name, events.size(), ok, micros() - t0);
+            client.stop();
+        }
+        {
+            WiFiClientSecure client;
+            HTTPClient http;
+            BufferedReader<WiFiClientSecure> reader;
+            mockHttpReset();
+            mockHttpPush(200, events.c_str(), profile.shape);
+            const unsigned long t0 = micros();
+            http.GET();
+            reader.begin(client);
+            JsonDocument doc;
+            const bool ok = !deserializeJson(doc, reader);
+            reportNet("parse_buffered", profile.name, events.size(), ok, micros() - t0);
+            client.stop();
+        }
+    }
+    mockHttpReset();
+}
+
+
+// Gaps between yield()s, on the host's clock: the time the WiFi stack and the
+// watchdog would wait for the loop.
+static std::chrono::steady_clock::time_point g_lastYield;
+static double g_worstGapUs = 0;
+
+static void noteGap(void) {
+    const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    const double us = std::chrono::duration<double, std::micro>(now - g_lastYield).count();
+    if (us > g_worstGapUs) g_worstGapUs = us;
+    g_lastYield = now;
+}
+
+// Median over 5 runs of the worst gap in a call, start and return included.
+template <typename Call>
+static void reportLoopLatency(const char* call, unsigned items, const std::string& body, Call run) {
+    double worst[5];
+    double total = 0;
+    unsigned long yields = 0;
+    for (double& w : worst) {
+        mockHttpReset();
+        mockHttpPush(200, body.c_str());
+        const unsigned long before = mockYields();
+        g_worstGapUs = 0;
+        mockYieldHook() = noteGap;
+        const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        g_lastYield = t0;
+        run();
+        noteGap();
+        mockYieldHook() = nullptr;
+        total += std::chrono::duration<double, std::micro>(g_lastYield - t0).count();
+        yields = mockYields() - before;
+        w = g_worstGapUs;
+    }
+    std::sort(worst, worst + 5);
+    std::printf("{\"op\":\"loop_latency\",\"call\":\"%s\",\"items\":%u,\"body\":%zu,\"yields\":%lu,"
+                "\"worst_gap_us\":%.1f,\"total_us\":%.1f}\n",
+                call, items, body.size(), yields, worst[2], total / 5);
+}
+
+static void benchLoopLatency(FakeNtp& ntp) {
+    static const unsigned sizes[] = { 100, 1000, 10000 };
+    for (unsigned size : sizes) {
+        g_seed = size;
+        const std::string calendars = makeCalendarList(size, 32, 0);
+        const std::string events = makeEvents(size, 32, 0);
+        {
+            BenchSchedular sched(&ntp);
+            reportLoopLatency("setCalendar", size, calendars, [&sched]() {
+                sched.forceAuthenticated();
+                sched.setCalendar(String("Target"));
+            });
+        }
+        {
+            BenchSchedular sched(&ntp);
+            sched.forceLinked("bench@group.calendar.google.com");
+            reportLoopLatency("syncAt", size, events, [&sched]() {
+                sched.syncAt("2024-11-04T07:30:15Z");
+            });
+        }
+        reportLoopLatency("unpaced", size, events, []() {
+            WiFiClientSecure client;
+            HTTPClient http;
+            BufferedReader<WiFiClientSecure> reader;
+            http.GET();
+            reader.begin(client);
+            JsonDocument doc;
+            deserializeJson(doc, reader);
+            client.stop();
+        });
+    }
+    mockHttpReset();
+}
+
+
+#ifdef SCHEDULAR_TRACE
+// Cost of one trace record, and how many each kind of call writes: a bound on
+// what the trace points add to a request.
+static void benchTrace(FakeNtp& ntp) {
+    const unsigned iterations = 1000000;
+    SchedularTrace trace;
+    SchedularTrace* volatile ring = &trace;     // keeps the stores
+    const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; ++i) {
+        ring->record(SchedularTrace::EV_DNS, static_cast<int>(i));
+    }
+    const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+
+    g_seed = 7;
+    const std::string events = makeEvents(100, 32, 0);
+    BenchSchedular sched(&ntp);
+    sched.forceLinked("bench@group.calendar.google.com");
+    mockHttpReset();
+    mockHttpPush(200, events.c_str());
+    sched.syncAt("2024-11-04T07:30:15Z");
+    const uint32_t perSync = sched.trace().count();
+    sched.clearTrace();
+    mockHttpReset();
+    mockHttpPush(200, "{\"access_token\":\"AT\",\"expires_in\":3599}");
+    sched.refresh();
+    const uint32_t perRefresh = sched.trace().count();
+    mockHttpReset();
+
+    std::printf("{\"op\":\"trace\",\"iterations\":%u,\"ns_per_record\":%.1f,\"record_bytes\":%zu,"
+                "\"ring_bytes\":%zu,\"records_per_sync\":%u,\"records_per_refresh\":%u}\n",
+                iterations, ns, sizeof(SchedularTrace::Record), sizeof(SchedularTrace),
+                static_cast<unsigned>(perSync), static_cast<unsigned>(perRefresh));
+}
+#endif
+
+
+int main() {
+    static const unsigned sizes[]   = { 10, 100, 1000, 10000 };
+    static const unsigned titles[]  = { 16, 64 };
+    static const unsigned escapes[] = { 0, 25 };
+
+    FakeNtp ntp;
+
+    // Eight relay-style channels, two by prefix (titles start "T0xxxx ").
+    ChannelMatcher channels;
+    channels.add(0, "Relay1");
+    channels.add(1, "Relay2");
+    channels.add(2, "Heating", ChannelMatcher::PREFIX);
+    channels.add(3, "Lights living room");
+    channels.add(4, "Porch");
+    channels.add(5, "Sprinklers zone 4");
+    channels.add(6, "T00001", ChannelMatcher::PREFIX);
+    channels.add(7, "T00002 abc");
+
+    for (unsigned size : sizes) {
+        for (unsigned title : titles) {
+            for (unsigned esc : escapes) {
+                const unsigned iterations = iterationsFor(size);
+
+                g_seed = size * 131 + title * 7 + esc;
+                const std::string events = makeEvents(size, title, esc);
+                {
+                    BenchSchedular sched(&ntp);
+                    sched.forceLinked("bench@group.calendar.google.com");
+                    const Sample s = measure(events, iterations, [&sched]() {
+                        sched.syncAt("2024-11-04T07:30:15Z");
+                    });
+                    if (sched.getEventList().size() != size) {
+                        std::fprintf(stderr, "syncAt: expected %u events\n", size);
+                        return 1;
+                    }
+                    report("syncAt", size, title, esc, events.size(), iterations, s);
+                }
+                {
+                    BenchSchedular sched(&ntp);
+                    sched.forceLinked("bench@group.calendar.google.com");
+                    sched.setChannels(&channels);
+                    const Sample s = measure(events, iterations, [&sched]() {
+                        sched.syncAt("2024-11-04T07:30:15Z");
+                    });
+                    report("syncAt_channels", size, title, esc, events.size(), iterations, s);
+                }
+                {
+                    WiFiClientSecure client;
+                    HTTPClient http;
+                    const Sample s = measure(events, iterations, [&client, &http]() {
+                        http.GET();
+                        JsonDocument doc;
+                        deserializeJson(doc, client);
+                        client.stop();
+                    });
+                    report("parse", size, title, esc, events.size(), iterations, s);
+                }
+                {
+                    WiFiClientSecure client;
+                    HTTPClient http;
+                    BufferedReader<WiFiClientSecure> reader;
+                    const Sample s = measure(events, iterations, [&client, &http, &reader]() {
+                        http.GET();
+                        reader.begin(client);
+                        JsonDocument doc;
+                        deserializeJson(doc, reader);
+                        client.stop();
+                    });
+                    report("parse_buffered", size, title, esc, events.size(), iterations, s);
+                }
+
+                g_seed = size * 131 + title * 7 + esc;
+                const std::string calendars = makeCalendarList(size, title, esc);
+                {
+                    BenchSchedular sched(&ntp);
+                    bool linked = true;
+                    const Sample s = measure(calendars, iterations, [&sched, &linked]() {
+                        sched.forceAuthenticated();
+                        sched.setCalendar(String("Target"));
+                        linked = linked && sched.isLinked();
+                    });
+                    if (!linked) {
+                        std::fprintf(stderr, "setCalendar: target not found\n");
+                        return 1;
+                    }
+                    report("setCalendar", size, title, esc, calendars.size(), iterations, s);
+                }
+            }
+        }
+    }
+
+    benchNetwork(ntp);
+    benchLoopLatency(ntp);
+#ifdef SCHEDULAR_TRACE
+    benchTrace(ntp);
+#endif
+    return 0;
+}
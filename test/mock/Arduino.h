@@ -7,11 +7,13 @@
 // (PROGMEM) shims, which collapse to plain RAM accesses on a host.
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <cstddef>
 #include <cstring>
 #include <cstdlib>
 #include <string>
+#include <utility>
 
 typedef uint8_t byte;
 
@@ -22,6 +24,9 @@ typedef uint8_t byte;
 #ifndef pgm_read_byte
 #define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t*>(addr))
 #endif
+#ifndef pgm_read_word
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t*>(addr))
+#endif
 #ifndef memcpy_P
 #define memcpy_P memcpy
 #endif
@@ -52,28 +57,57 @@ class __FlashStringHelper {};
 //   c_str()/length()  -> mark it as an "Arduino String" to ArduinoJson
 //   concat()/operator=(const char*) -> the serializeJson(...) write path
 //   equals/toInt/isEmpty/remove + operator+/+= -> the library logic
+// Construction counters for the allocation-budget tests: every constructor
+// bumps `constructed`, and copies (copy-construct or copy-assign from another
+// String) also bump `copies`. Moves only hand a buffer over, so they count as
+// neither. Per thread, so the native gateway's workers do not race on them.
+struct MockStringStats {
+    size_t constructed;
+    size_t copies;
+};
+
+inline MockStringStats& mockStringStats() {
+    static thread_local MockStringStats stats = {0, 0};
+    return stats;
+}
+
+inline void mockStringReset() {
+    mockStringStats().constructed = 0;
+    mockStringStats().copies = 0;
+}
+
 class String {
 public:
-    String() : _s() {}
-    String(const char* p) : _s(p ? p : "") {}
+    String() : _s() { ++mockStringStats().constructed; }
+    String(const char* p) : _s(p ? p : "") { ++mockStringStats().constructed; }
     // Arduino's String(const __FlashStringHelper*): lets the library pass an
     // F("...")/FPSTR(...) literal wherever a String is expected (e.g. the
     // request paths handed to _postJsonRequest / _getRequest).
     String(const __FlashStringHelper* p)
-        : _s(p ? reinterpret_cast<const char*>(p) : "") {}
-    String(const String& o) : _s(o._s) {}
-    String(const std::string& o) : _s(o) {}
+        : _s(p ? reinterpret_cast<const char*>(p) : "") { ++mockStringStats().constructed; }
+    String(const String& o) : _s(o._s) {
+        ++mockStringStats().constructed;
+        ++mockStringStats().copies;
+    }
+    // Arduino's cores have move semantics too (not counted, see above).
+    String(String&& o) : _s(std::move(o._s)) {}
+    String(const std::string& o) : _s(o) { ++mockStringStats().constructed; }
     // Arduino's String(int) renders the number in base 10 (used for the
     // polling interval that GoogleSchedular stashes in _calendarId).
-    explicit String(int v) : _s(std::to_string(v)) {}
-    explicit String(unsigned int v) : _s(std::to_string(v)) {}
-    explicit String(long v) : _s(std::to_string(v)) {}
-    explicit String(unsigned long v) : _s(std::to_string(v)) {}
+    explicit String(int v) : _s(std::to_string(v)) { ++mockStringStats().constructed; }
+    explicit String(unsigned int v) : _s(std::to_string(v)) { ++mockStringStats().constructed; }
+    explicit String(long v) : _s(std::to_string(v)) { ++mockStringStats().constructed; }
+    explicit String(unsigned long v) : _s(std::to_string(v)) { ++mockStringStats().constructed; }
 
     // ArduinoJson assigns a decoded value with `dst = str.c_str()`, and its
     // String Writer clears the buffer with `str = (const char*)0`.
     String& operator=(const char* p) { _s = p ? p : ""; return *this; }
-    String& operator=(const String& o) { _s = o._s; return *this; }
+    String& operator=(const String& o) {
+        ++mockStringStats().copies;
+        _s = o._s;
+        return *this;
+    }
+    String& operator=(String&& o) { _s = std::move(o._s); return *this; }
 
     const char* c_str() const { return _s.c_str(); }
     // Unsigned length() is what ArduinoJson's string_traits keys on to route
@@ -156,7 +190,12 @@ public:
 // from this and feed a canned body; see test/mock/WiFiClientSecure.h.
 class Stream {
 public:
+    Stream() : _timeout(1000) {}
     virtual ~Stream() {}
+    // Arduino's Stream::readBytes() waits up to this long for each missing byte
+    // (timedRead). The mock WiFiClientSecure honours it on the fake clock.
+    void setTimeout(unsigned long timeout) { _timeout = timeout; }
+    unsigned long getTimeout(void) const { return _timeout; }
     virtual int available() = 0;
     virtual int read() = 0;
     virtual int peek() = 0;
@@ -171,10 +210,73 @@ public:
         }
         return n;
     }
+protected:
+    unsigned long _timeout;
 };
 
 
 // --- Fake clock -----------------------------------------------------------
 // Driven by the test: set g_fakeMillis, then call the code under test.
+// micros() derives from the same clock so durations measured in either unit
+// agree (SchedularStats times requests with micros()). The simulated network
+// (MockHttp.h) moves it forward with mockAdvanceMicros(): latency, gaps between
+// segments, stalls and read timeouts all elapse on this clock, never in real
+// time.
 extern unsigned long g_fakeMillis;
+
+// Sub-millisecond part of the clock, below g_fakeMillis.
+inline unsigned long& mockMicrosRemainder() {
+    static unsigned long us = 0;
+    return us;
+}
+
 inline unsigned long millis() { return g_fakeMillis; }
+inline unsigned long micros() { return g_fakeMillis * 1000UL + mockMicrosRemainder(); }
+
+inline void mockAdvanceMicros(unsigned long us) {
+    unsigned long& r = mockMicrosRemainder();
+    r += us;
+    g_fakeMillis += r / 1000UL;
+    r %= 1000UL;
+}
+
+
+// --- yield() --------------------------------------------------------------
+// On the cores, yield() lets the WiFi stack and the watchdog run. Here it only
+// counts the calls and runs the test's hook, if any, so a test can see where
+// the library hands control back and how long it kept it in between. The
+// count is atomic: the gateway build parses on several threads.
+inline std::atomic<unsigned long>& mockYields() {
+    static std::atomic<unsigned long> n(0);
+    return n;
+}
+
+inline void (*&mockYieldHook())() {
+    static void (*hook)() = nullptr;
+    return hook;
+}
+
+inline void yield() {
+    ++mockYields();
+    if (mockYieldHook() != nullptr) {
+        mockYieldHook()();
+    }
+}
+
+
+// --- ESP object -----------------------------------------------------------
+// The cores expose the chip through a global `ESP`; SchedularStats only reads
+// getFreeHeap(). A test scripts the value through mockFreeHeap(). Not there in
+// the native (non-ESP) builds, as on a real host.
+inline uint32_t& mockFreeHeap() {
+    static uint32_t heap = 0;
+    return heap;
+}
+
+#if defined(ESP8266) || defined(ESP32)
+class EspClass {
+public:
+    uint32_t getFreeHeap() { return mockFreeHeap(); }
+};
+static EspClass ESP;
+#endif
@@ -16,36 +16,66 @@
 #ifndef HTTP_CODE_OK
 #define HTTP_CODE_OK 200
 #endif
+#ifndef HTTP_CODE_NOT_MODIFIED
+#define HTTP_CODE_NOT_MODIFIED 304
+#endif
 #ifndef HTTP_CODE_PRECONDITION_REQUIRED
 #define HTTP_CODE_PRECONDITION_REQUIRED 428
 #endif
 
 class HTTPClient {
 public:
-    HTTPClient() {}
+    HTTPClient() : _client(nullptr) { _uri.reserve(512); }
 
     // begin(client, host, port, path, https): the library always passes the
     // full request path here; record it so tests can inspect the built URI.
-    bool begin(WiFiClientSecure& /*client*/, const String& /*host*/,
+    bool begin(WiFiClientSecure& client, const String& /*host*/,
                uint16_t /*port*/, const String& path, bool /*https*/) {
-        mockHttpUris().push_back(path.c_str());
+        _client = &client;
+        _record(path);
         return true;
     }
     // Overload accepting flash-string host/path, matching how the library may
     // pass F("...") literals.
-    bool begin(WiFiClientSecure& /*client*/, const __FlashStringHelper* /*host*/,
+    bool begin(WiFiClientSecure& client, const __FlashStringHelper* /*host*/,
                uint16_t /*port*/, const String& path, bool /*https*/) {
-        mockHttpUris().push_back(path.c_str());
+        _client = &client;
+        _record(path);
         return true;
     }
 
-    void addHeader(const String& /*name*/, const String& /*value*/) {}
+    void addHeader(const String& name, const String& value) {
+        if (mockHttpRecordUris()) {
+            mockHttpHeaders().push_back(std::string(name.c_str()) + ": " + value.c_str());
+        }
+    }
     void useHTTP10(bool /*use*/) {}
 
     // POST/GET consume the next scripted response (publishing its body for the
     // WiFiClientSecure to stream) and return its HTTP status code.
-    int POST(const String& /*payload*/) { return mockHttpConsume(); }
-    int GET() { return mockHttpConsume(); }
+    // A reply with a positive code means the connection, and so a TLS
+    // handshake, went through.
+    int POST(const String& /*payload*/) { return _connect(mockHttpConsume()); }
+    int POST(const uint8_t* /*payload*/, size_t /*size*/) { return _connect(mockHttpConsume()); }
+    int GET() { return _connect(mockHttpConsume()); }
+
+    void end() { _client = nullptr; }
+
+private:
+    int _connect(int code) {
+        if (code > 0 && _client) _client->mockHandshake();
+        return code;
+    }
+
+    // Kept, like the real client's _uri: the caller may pass a temporary.
+    void _record(const String& path) {
+        _uri = path.c_str();
+        mockHttpCurrentPath() = _uri.c_str();
+        if (mockHttpRecordUris()) {
+            mockHttpUris().push_back(path.c_str());
+        }
+    }
 
-    void end() {}
+    WiFiClientSecure* _client;
+    std::string _uri;                   // not a String: not counted as library work
 };
@@ -0,0 +1,96 @@
+// Transport policy for the static-mode tests (static_main.cpp): replies come
+// from a script of (code, body) pairs held by the caller, and the request path
+// is copied into a fixed buffer. Nothing here touches the heap, so whatever
+// MockHeap.h counts during a request was allocated by the library (or by
+// ArduinoJson on its behalf).
+//
+// Past the end of the script every request answers 0 with an empty body, as
+// the mock HTTPClient does when a test under-scripts a flow.
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+#include "Arduino.h"
+#include "SchedularTransport.hpp"
+
+struct FixedReply {
+    int code;
+    const char* body;
+};
+
+class FixedReplyTransport : public SchedularTransportBase {
+public:
+    class Body {
+    public:
+        Body() : _p(""), _end(_p) {}
+
+        void reset(const char* s) { _p = s; _end = s + std::strlen(s); }
+
+        int read(void) { return _p < _end ? static_cast<unsigned char>(*_p++) : -1; }
+
+        size_t readBytes(char* buffer, size_t length) {
+            size_t n = 0;
+            while (n < length && _p < _end) buffer[n++] = *_p++;
+            return n;
+        }
+
+    private:
+        const char* _p;
+        const char* _end;
+    };
+
+    FixedReplyTransport() : _script(nullptr), _count(0), _next(0), _requests(0), _busy(false) { _path[0] = '\0'; }
+
+    static FixedReplyTransport& shared(void) {
+        static FixedReplyTransport transport;
+        return transport;
+    }
+
+    // Replies for the next requests, in order. `script` must outlive them.
+    void play(const FixedReply* script, size_t count) {
+        _script = script;
+        _count = count;
+        _next = 0;
+    }
+
+    bool acquire(const Host) {
+        if (_busy) return false;
+        _busy = true;
+        return true;
+    }
+
+    int post(const char* path, const char*) { return _reply(path); }
+    int get(const char* path, const char*)  { return _reply(path); }
+
+    Body& body(void) { return _body; }
+
+    void close(void) { _busy = false; }
+
+    // Path of the last request, cut to the buffer.
+    const char* path(void) const { return _path; }
+    size_t requests(void) const { return _requests; }
+    size_t remaining(void) const { return _count - _next; }
+
+private:
+    int _reply(const char* path) {
+        std::strncpy(_path, path, sizeof(_path) - 1);
+        _path[sizeof(_path) - 1] = '\0';
+        ++_requests;
+        if (_next == _count) {
+            _body.reset("");
+            return 0;
+        }
+        const FixedReply& r = _script[_next++];
+        _body.reset(r.body);
+        return r.code;
+    }
+
+    Body _body;
+    const FixedReply* _script;
+    size_t _count;
+    size_t _next;
+    size_t _requests;
+    char _path[512];
+    bool _busy;
+};
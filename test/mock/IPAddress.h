@@ -1,10 +1,17 @@
 // Minimal host-side mock of IPAddress.h for native unit tests.
-// Required transitively by TimestampNtp.hpp.
+// Required transitively by TimestampNtp.hpp, and by the UDP mock: four octets,
+// in network order, as the Arduino core keeps them.
 #pragma once
 #include "Arduino.h"
 
 class IPAddress {
 public:
-    IPAddress() {}
-    IPAddress(uint8_t, uint8_t, uint8_t, uint8_t) {}
+    IPAddress() : _octets{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _octets{a, b, c, d} {}
+    uint8_t operator[](int i) const { return _octets[i]; }
+    bool operator==(const IPAddress& other) const {
+        return std::memcmp(_octets, other._octets, sizeof(_octets)) == 0;
+    }
+private:
+    uint8_t _octets[4];
 };
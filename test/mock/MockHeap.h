@@ -0,0 +1,158 @@
+// Host-side heap accounting for the benchmarks and allocation tests.
+//
+// Replaces malloc/calloc/realloc/free for the whole program (glibc lets an
+// executable interpose them) and forwards to glibc's own __libc_* entry points,
+// counting on the way. Everything the library touches ends up here: the mock
+// String (std::string -> operator new -> malloc), std::list nodes, and
+// ArduinoJson's default allocator (malloc/realloc/free), so the numbers cover
+// the real working set of a call, not only what the library allocates itself.
+//
+// While an arena is installed (mockHeapUseArena), new blocks come from it
+// instead of glibc; see MockUmmHeap.h. Frees always go back to whichever heap
+// owns the pointer, so a block may outlive the window it was allocated in.
+//
+// The definitions are not inline (the C library symbols cannot be), so include
+// this header from exactly one translation unit per binary.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <malloc.h>
+
+#include "MockUmmHeap.h"
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void  __libc_free(void* ptr);
+}
+
+struct MockHeapStats {
+    size_t allocations;   // malloc/calloc/realloc calls that returned a block
+    size_t frees;
+    size_t bytes;         // total bytes requested
+    size_t live;          // bytes currently allocated (usable size)
+    size_t peak;          // high-water mark of `live` since the last reset
+};
+
+inline MockHeapStats& mockHeap() {
+    static MockHeapStats stats = {0, 0, 0, 0, 0};
+    return stats;
+}
+
+// Start a new measurement window: counters to zero, peak down to what is live.
+inline void mockHeapReset() {
+    MockHeapStats& h = mockHeap();
+    h.allocations = 0;
+    h.frees = 0;
+    h.bytes = 0;
+    h.peak = h.live;
+}
+
+// Bytes allocated above the live level at reset time, at the worst moment.
+inline size_t mockHeapPeakGrowth(size_t liveAtReset) {
+    const MockHeapStats& h = mockHeap();
+    return h.peak > liveAtReset ? h.peak - liveAtReset : 0;
+}
+
+// Arena new blocks are taken from, or nullptr for glibc.
+inline MockHeapArena*& mockHeapArena() {
+    static MockHeapArena* arena = nullptr;
+    return arena;
+}
+
+inline void mockHeapUseArena(MockHeapArena* arena) { mockHeapArena() = arena; }
+
+// The arena that owns `p`, if any (only one can be installed at a time, but
+// blocks from an uninstalled one are still released into it).
+inline MockHeapArena*& mockHeapLastArena() {
+    static MockHeapArena* arena = nullptr;
+    return arena;
+}
+
+inline MockHeapArena* mockHeapOwner(const void* p) {
+    MockHeapArena* a = mockHeapLastArena();
+    return (p && a && a->owns(p)) ? a : nullptr;
+}
+
+inline size_t mockHeapUsableSize(const void* p) {
+    MockHeapArena* a = mockHeapOwner(p);
+    return a ? a->usableSize(p) : malloc_usable_size(const_cast<void*>(p));
+}
+
+inline void mockHeapOnAlloc(void* p, size_t requested) {
+    if (!p) return;
+    MockHeapStats& h = mockHeap();
+    ++h.allocations;
+    h.bytes += requested;
+    h.live += mockHeapUsableSize(p);
+    if (h.live > h.peak) h.peak = h.live;
+}
+
+inline void mockHeapOnFree(void* p) {
+    if (!p) return;
+    MockHeapStats& h = mockHeap();
+    ++h.frees;
+    h.live -= mockHeapUsableSize(p);
+}
+
+inline void* mockHeapAllocate(size_t size) {
+    MockHeapArena* a = mockHeapArena();
+    if (a) {
+        mockHeapLastArena() = a;
+        return a->allocate(size);
+    }
+    return __libc_malloc(size);
+}
+
+extern "C" {
+
+void* malloc(size_t size) noexcept {
+    void* p = mockHeapAllocate(size);
+    mockHeapOnAlloc(p, size);
+    return p;
+}
+
+void* calloc(size_t n, size_t size) noexcept {
+    void* p;
+    if (mockHeapArena()) {
+        p = mockHeapAllocate(n * size);
+        if (p) std::memset(p, 0, n * size);
+    } else {
+        p = __libc_calloc(n, size);
+    }
+    mockHeapOnAlloc(p, n * size);
+    return p;
+}
+
+// A failed realloc leaves the old block alive, so only account for the move
+// once it has happened. A block stays in the heap it was born in.
+void* realloc(void* ptr, size_t size) noexcept {
+    const size_t old = ptr ? mockHeapUsableSize(ptr) : 0;
+    MockHeapArena* owner = mockHeapOwner(ptr);
+    void* p = owner ? owner->reallocate(ptr, size)
+            : ptr   ? __libc_realloc(ptr, size)
+                    : mockHeapAllocate(size);
+    if (p || size == 0) {
+        if (ptr) {
+            ++mockHeap().frees;
+            mockHeap().live -= old;
+        }
+        mockHeapOnAlloc(p, size);
+    }
+    return p;
+}
+
+void free(void* ptr) noexcept {
+    mockHeapOnFree(ptr);
+    MockHeapArena* owner = mockHeapOwner(ptr);
+    if (owner) {
+        owner->release(ptr);
+    } else {
+        __libc_free(ptr);
+    }
+}
+
+}
@@ -7,16 +7,66 @@
 // WiFiClientSecure streams to ArduinoJson's deserializeJson(). The mock
 // HTTPClient and WiFiClientSecure are otherwise decoupled, exactly like the
 // real ones, so the library code runs unmodified.
+//
+// By default a reply is all there the moment POST()/GET() returns. A
+// MockHttpShape passed as third argument makes it behave like a real link
+// instead: request latency, body segments arriving at intervals, a stall, a
+// connection dropped mid-body, a device slow to read. Everything happens on the
+// fake clock (mockAdvanceMicros), so a test or a benchmark gets deterministic
+// latencies and timeouts without sleeping.
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
+#include "Arduino.h"
+
+// How one reply travels over the simulated network. Chainable:
+//   mockHttpPush(200, body, MockHttpShape().latency(300).segments(536, 20));
+// Times are counted from the previous step: the request is sent when POST()/GET()
+// is called, the status line arrives `latencyMs` later (when POST()/GET()
+// returns), body byte i arrives at
+//   firstByteMs + (i / segmentBytes) * segmentGapMs (+ stallMs past stallAt)
+// after that, and nothing arrives from `dropAt` on.
+struct MockHttpShape {
+    unsigned long latencyMs;     // request sent -> status line and headers
+    unsigned long firstByteMs;   // headers -> first body byte
+    size_t        segmentBytes;  // body split into segments of this size (0: one)
+    unsigned long segmentGapMs;  // between two segments
+    size_t        stallAt;       // body offset the server pauses at...
+    unsigned long stallMs;       // ...for this long
+    size_t        dropAt;        // connection lost after this many body bytes
+    unsigned long readCostUs;    // device time spent per read()/readBytes() call
+
+    static const size_t NEVER = SIZE_MAX;
+
+    MockHttpShape()
+        : latencyMs(0), firstByteMs(0), segmentBytes(0), segmentGapMs(0),
+          stallAt(NEVER), stallMs(0), dropAt(NEVER), readCostUs(0) {}
+
+    MockHttpShape& latency(unsigned long ms)                  { latencyMs = ms; return *this; }
+    MockHttpShape& firstByte(unsigned long ms)                { firstByteMs = ms; return *this; }
+    MockHttpShape& segments(size_t bytes, unsigned long gapMs) { segmentBytes = bytes; segmentGapMs = gapMs; return *this; }
+    MockHttpShape& stall(size_t at, unsigned long ms)         { stallAt = at; stallMs = ms; return *this; }
+    MockHttpShape& drop(size_t at)                            { dropAt = at; return *this; }
+    MockHttpShape& readCost(unsigned long us)                 { readCostUs = us; return *this; }
+
+    // Offset of byte i from the first body byte, in microseconds.
+    unsigned long arrivalUs(size_t i) const {
+        unsigned long ms = firstByteMs;
+        if (segmentBytes != 0) ms += static_cast<unsigned long>(i / segmentBytes) * segmentGapMs;
+        if (i >= stallAt) ms += stallMs;
+        return ms * 1000UL;
+    }
+};
+
 // One scripted HTTP exchange.
 struct MockHttpResponse {
     int code;
     std::string body;
+    MockHttpShape shape;
 };
 
 // FIFO of scripted responses, consumed by POST()/GET().
@@ -39,6 +89,49 @@ inline std::string& mockHttpCurrentBody() {
     return body;
 }
 
+// How the current body travels, and when (micros()) its headers arrived, i.e.
+// when POST()/GET() returned. Read by the WiFiClientSecure with the body.
+inline MockHttpShape& mockHttpCurrentShape() {
+    static MockHttpShape shape;
+    return shape;
+}
+
+inline unsigned long& mockHttpCurrentStartUs() {
+    static unsigned long start = 0;
+    return start;
+}
+
+// TLS handshakes made by the mock WiFiClientSecure, split by whether a cached
+// session was resumed (see WiFiClientSecure::setSession), plus the maximum
+// fragment length probes and the buffer sizes of the last handshake (0 until
+// setBufferSizes() is called).
+struct MockTlsStats {
+    size_t full;
+    size_t resumed;
+    size_t probes;
+    int    receiveBuffer;
+    int    transmitBuffer;
+};
+
+inline MockTlsStats& mockTls() {
+    static MockTlsStats stats = {0, 0, 0, 0, 0};
+    return stats;
+}
+
+// Hosts that accept a reduced maximum fragment length when probed.
+inline std::vector<std::string>& mockTlsMflnHosts() {
+    static std::vector<std::string> hosts;
+    return hosts;
+}
+
+// Shape given to replies that do not carry their own: the FIFO's two-argument
+// mockHttpPush() and the responder. An "instant" link unless a test or the
+// benchmark sets a network profile for a whole run.
+inline MockHttpShape& mockHttpDefaultShape() {
+    static MockHttpShape shape;
+    return shape;
+}
+
 // Records every URI passed to HTTPClient::begin(), newest last, so a test can
 // assert how the request (e.g. the events time window) was built.
 inline std::vector<std::string>& mockHttpUris() {
@@ -46,9 +139,54 @@ inline std::vector<std::string>& mockHttpUris() {
     return uris;
 }
 
+// Request headers set with addHeader() since the last reset, as "Name: value".
+inline std::vector<std::string>& mockHttpHeaders() {
+    static std::vector<std::string> headers;
+    return headers;
+}
+
+// Whether begin() appends to mockHttpUris(), and addHeader() to
+// mockHttpHeaders(). Long runs (the soak test) turn it off so the history
+// neither grows nor allocates.
+inline bool& mockHttpRecordUris() {
+    static bool record = true;
+    return record;
+}
+
+// Path of the request in flight, as passed to HTTPClient::begin(). Borrowed
+// from the client's copy, so only valid until the next begin().
+inline const char*& mockHttpCurrentPath() {
+    static const char* path = "";
+    return path;
+}
+
+// Alternative to the FIFO for open-ended runs: when the queue is exhausted,
+// POST()/GET() ask the responder for a reply to the current path instead. The
+// body is copied into mockHttpCurrentBody(), so a static string will do.
+struct MockHttpReply {
+    int code;
+    const char* body;
+};
+typedef MockHttpReply (*MockHttpResponder)(const char* path);
+
+inline MockHttpResponder& mockHttpResponder() {
+    static MockHttpResponder responder = nullptr;
+    return responder;
+}
+
 // Queue a scripted response. Call once per expected POST()/GET(), in order.
+inline void mockHttpPush(int code, const char* body, const MockHttpShape& shape) {
+    mockHttpQueue().push_back(MockHttpResponse{code, body ? body : "", shape});
+}
+
 inline void mockHttpPush(int code, const char* body) {
-    mockHttpQueue().push_back(MockHttpResponse{code, body ? body : ""});
+    mockHttpPush(code, body, mockHttpDefaultShape());
+}
+
+// Binary body (e.g. gzip), which may hold NULs.
+inline void mockHttpPush(int code, const uint8_t* body, size_t length) {
+    mockHttpQueue().push_back(MockHttpResponse{code, std::string(reinterpret_cast<const char*>(body), length),
+                                               mockHttpDefaultShape()});
 }
 
 // Reset all mock state between tests.
@@ -57,19 +195,41 @@ inline void mockHttpReset() {
     mockHttpCursor() = 0;
     mockHttpCurrentBody().clear();
     mockHttpUris().clear();
+    mockHttpHeaders().clear();
+    mockHttpCurrentPath() = "";
+    mockHttpCurrentShape() = MockHttpShape();
+    mockHttpDefaultShape() = MockHttpShape();
+    mockTls() = MockTlsStats{0, 0, 0, 0, 0};
+    mockTlsMflnHosts().clear();
 }
 
 // Pop the next scripted response, publish its body for the WiFiClientSecure,
 // and return its HTTP code. If the queue is exhausted (a test under-scripted a
-// flow) it returns 0 and an empty body, which the library treats as a failure.
+// flow) it returns 0 and an empty body, which the library treats as a failure,
+// unless a responder is installed.
+//
+// The request latency of the reply's shape elapses on the fake clock before it
+// returns, as POST()/GET() block until the status line is in.
+inline int mockHttpPublish(int code, const MockHttpShape& shape) {
+    mockHttpCurrentShape() = shape;
+    mockAdvanceMicros(shape.latencyMs * 1000UL);
+    mockHttpCurrentStartUs() = micros();
+    return code;
+}
+
 inline int mockHttpConsume() {
     std::vector<MockHttpResponse>& q = mockHttpQueue();
     size_t& cursor = mockHttpCursor();
     if (cursor >= q.size()) {
+        if (mockHttpResponder()) {
+            const MockHttpReply r = mockHttpResponder()(mockHttpCurrentPath());
+            mockHttpCurrentBody() = r.body ? r.body : "";
+            return mockHttpPublish(r.code, mockHttpDefaultShape());
+        }
         mockHttpCurrentBody().clear();
-        return 0;
+        return mockHttpPublish(0, MockHttpShape());
     }
     const MockHttpResponse& r = q[cursor++];
     mockHttpCurrentBody() = r.body;
-    return r.code;
+    return mockHttpPublish(r.code, r.shape);
 }
@@ -0,0 +1,211 @@
+// Host-side emulation of the ESP8266 heap (umm_malloc) for the soak test.
+//
+// umm_malloc carves a small fixed arena into 8-byte blocks. Every allocation
+// takes a run of whole blocks, the first of which spends 4 bytes on the
+// next/prev block indices, and free runs are coalesced with their neighbours.
+// This class reproduces that geometry with a first-fit search, so a long
+// sequence of malloc/free from the library fragments it the way it would
+// fragment the device heap. The bookkeeping lives in side arrays rather than in
+// the arena itself, which keeps it readable without changing the layout. The
+// one deliberate difference: the header is 8 bytes, not 4, so payloads keep
+// the pointer alignment a 64-bit host expects from malloc.
+//
+// The figures mirror what the ESP8266 core reports:
+//   freeBytes()         ~ ESP.getFreeHeap()
+//   maxFreeBlockSize()  ~ ESP.getMaxFreeBlockSize()
+//   fragmentation()     ~ ESP.getHeapFragmentation() (0..100 %)
+//
+// MockHeap.h routes malloc/free into an instance while it is installed with
+// mockHeapUseArena(); see test/soak_main.cpp.
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Interface MockHeap.h routes allocations through when an arena is installed.
+class MockHeapArena {
+public:
+    virtual ~MockHeapArena() {}
+    virtual void*  allocate(size_t size) = 0;
+    virtual void   release(void* p) = 0;
+    virtual void*  reallocate(void* p, size_t size) = 0;
+    virtual bool   owns(const void* p) const = 0;
+    virtual size_t usableSize(const void* p) const = 0;
+};
+
+template <uint16_t BLOCKS>
+class MockUmmHeap : public MockHeapArena {
+public:
+    static constexpr size_t BLOCK_SIZE = 8;
+    static constexpr size_t HEADER_SIZE = 8;
+
+    MockUmmHeap() {
+        // Block 0 is umm's sentinel: never handed out. One free run follows.
+        std::memset(_used, 0, sizeof(_used));
+        _next[1] = BLOCKS;
+        _prev[1] = 0;
+        _used[0] = true;
+        _next[0] = 1;
+        resetLowWater();
+    }
+
+    void* allocate(size_t size) override {
+        const uint16_t need = blocksFor(size);
+        for (uint16_t i = 1; i < BLOCKS; i = _next[i]) {
+            if (!_used[i] && runLength(i) >= need) {
+                split(i, need);
+                _used[i] = true;
+                sampleLowWater();
+                return _mem + i * BLOCK_SIZE + HEADER_SIZE;
+            }
+        }
+        return nullptr;
+    }
+
+    void release(void* p) override {
+        if (!p) return;
+        uint16_t i = indexOf(p);
+        _used[i] = false;
+        const uint16_t n = _next[i];
+        if (n < BLOCKS && !_used[n]) {
+            merge(i);
+        }
+        const uint16_t prev = _prev[i];
+        if (prev != 0 && !_used[prev]) {
+            merge(prev);
+        }
+    }
+
+    // Shrink or grow in place when the following run allows it, otherwise
+    // move -- the same order of preference as umm_realloc.
+    void* reallocate(void* p, size_t size) override {
+        if (!p) return allocate(size);
+        if (size == 0) { release(p); return nullptr; }
+        const uint16_t i = indexOf(p);
+        const uint16_t need = blocksFor(size);
+        const uint16_t n = _next[i];
+        if (runLength(i) < need && n < BLOCKS && !_used[n] && runLength(i) + runLength(n) >= need) {
+            merge(i);
+        }
+        if (runLength(i) >= need) {
+            split(i, need);
+            const uint16_t tail = _next[i];
+            if (tail < BLOCKS && !_used[tail] && _next[tail] < BLOCKS && !_used[_next[tail]]) {
+                merge(tail);
+            }
+            return p;
+        }
+        void* q = allocate(size);
+        if (!q) return nullptr;
+        std::memcpy(q, p, usableSize(p));
+        release(p);
+        return q;
+    }
+
+    bool owns(const void* p) const override {
+        const uint8_t* b = static_cast<const uint8_t*>(p);
+        return b >= _mem && b < _mem + sizeof(_mem);
+    }
+
+    size_t usableSize(const void* p) const override {
+        return runLength(indexOf(p)) * BLOCK_SIZE - HEADER_SIZE;
+    }
+
+    size_t capacity() const { return (BLOCKS - 1) * BLOCK_SIZE; }
+
+    size_t freeBytes() const {
+        size_t total = 0;
+        for (uint16_t i = 1; i < BLOCKS; i = _next[i]) {
+            if (!_used[i]) total += runLength(i) * BLOCK_SIZE;
+        }
+        return total;
+    }
+
+    size_t maxFreeBlockSize() const {
+        size_t best = 0;
+        for (uint16_t i = 1; i < BLOCKS; i = _next[i]) {
+            if (!_used[i] && runLength(i) > best) best = runLength(i);
+        }
+        return best ? best * BLOCK_SIZE - HEADER_SIZE : 0;
+    }
+
+    // 100 - 100 * sqrt(sum(free_i^2)) / sum(free_i): 0 for a single free run,
+    // close to 100 when the free space is shredded into many small runs.
+    uint8_t fragmentation() const {
+        double sum = 0, squares = 0;
+        for (uint16_t i = 1; i < BLOCKS; i = _next[i]) {
+            if (!_used[i]) {
+                const double b = static_cast<double>(runLength(i) * BLOCK_SIZE);
+                sum += b;
+                squares += b * b;
+            }
+        }
+        if (sum == 0) return 0;
+        return static_cast<uint8_t>(100.0 - 100.0 * std::sqrt(squares) / sum);
+    }
+
+    // Worst free heap / largest free block seen right after any allocation
+    // since the last resetLowWater(): the peak of a call, not its aftermath.
+    size_t lowWaterFree() const     { return _lowFree; }
+    size_t lowWaterMaxBlock() const { return _lowMaxBlock; }
+
+    void resetLowWater() {
+        _lowFree = freeBytes();
+        _lowMaxBlock = maxFreeBlockSize();
+    }
+
+    size_t usedRuns() const {
+        size_t n = 0;
+        for (uint16_t i = 1; i < BLOCKS; i = _next[i]) {
+            if (_used[i]) ++n;
+        }
+        return n;
+    }
+
+private:
+    void sampleLowWater() {
+        const size_t f = freeBytes();
+        if (f < _lowFree) _lowFree = f;
+        const size_t b = maxFreeBlockSize();
+        if (b < _lowMaxBlock) _lowMaxBlock = b;
+    }
+
+    static uint16_t blocksFor(size_t size) {
+        const size_t n = (size + HEADER_SIZE + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        return static_cast<uint16_t>(n ? n : 1);
+    }
+
+    uint16_t indexOf(const void* p) const {
+        const uint8_t* b = static_cast<const uint8_t*>(p) - HEADER_SIZE;
+        return static_cast<uint16_t>((b - _mem) / BLOCK_SIZE);
+    }
+
+    uint16_t runLength(uint16_t i) const { return static_cast<uint16_t>(_next[i] - i); }
+
+    // Cut run i down to `need` blocks; the remainder becomes a free run.
+    void split(uint16_t i, uint16_t need) {
+        if (runLength(i) <= need) return;
+        const uint16_t rest = static_cast<uint16_t>(i + need);
+        _next[rest] = _next[i];
+        _prev[rest] = i;
+        _used[rest] = false;
+        if (_next[i] < BLOCKS) _prev[_next[i]] = rest;
+        _next[i] = rest;
+    }
+
+    // Absorb the run following i into i.
+    void merge(uint16_t i) {
+        const uint16_t n = _next[i];
+        _next[i] = _next[n];
+        if (_next[n] < BLOCKS) _prev[_next[n]] = i;
+    }
+
+    alignas(16) uint8_t _mem[BLOCKS * BLOCK_SIZE];
+    uint16_t _next[BLOCKS];
+    uint16_t _prev[BLOCKS];
+    bool     _used[BLOCKS];
+    size_t   _lowFree;
+    size_t   _lowMaxBlock;
+};
@@ -0,0 +1,101 @@
+// Google-like handler for StandInServer, for the gateway tests and benchmark:
+// a building of `accounts` Google accounts with `rooms` calendars each.
+//
+//   refresh_token  "1//account-<a>"            -> access_token "AT-<a>-<n>"
+//   calendar       "room-<a>-<r>"  (id "a<a>r<r>@group")
+//   events         "Meeting a<a>r<r>", "Heating"
+//
+// A calendar read with another account's token gets 401, a refresh of an
+// account in `dead` gets 400 invalid_grant. Every reply waits `latencyMs`
+// first (a round trip to Google), and requests are counted per endpoint.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "StandInServer.h"
+
+class StandInGoogle {
+public:
+    StandInGoogle(unsigned accounts, unsigned rooms, unsigned latencyMs = 0)
+        : accounts(accounts), rooms(rooms), latencyMs(latencyMs),
+          tokenRequests(0), listRequests(0), eventRequests(0), unauthorized(0), _issued(0) {}
+
+    static std::string refreshToken(unsigned account) { return "1//account-" + std::to_string(account); }
+    static std::string calendarName(unsigned account, unsigned room) {
+        return "room-" + std::to_string(account) + "-" + std::to_string(room);
+    }
+
+    StandInServer::Handler handler() {
+        return [this](const StandInServer::Request& r) { return handle(r); };
+    }
+
+    StandInServer::Reply handle(const StandInServer::Request& r) {
+        if (latencyMs) std::this_thread::sleep_for(std::chrono::milliseconds(latencyMs));
+        if (r.path == "/token") {
+            ++tokenRequests;
+            const long a = _number(r.body, "\"refresh_token\":\"1//account-");
+            if (a < 0 || static_cast<unsigned>(a) >= accounts || dead.count(static_cast<unsigned>(a))) {
+                return { 400, "{\"error\":\"invalid_grant\"}" };
+            }
+            return { 200, "{\"access_token\":\"AT-" + std::to_string(a) + "-" + std::to_string(++_issued) +
+                          "\",\"expires_in\":3599}" };
+        }
+        const long a = _number(r.authorization, "Bearer AT-");
+        if (a < 0 || static_cast<unsigned>(a) >= accounts) {
+            ++unauthorized;
+            return { 401, "{}" };
+        }
+        if (r.path.find("/calendar/v3/users/me/calendarList") == 0) {
+            ++listRequests;
+            std::string body = "{\"items\":[";
+            for (unsigned room = 0; room < rooms; ++room) {
+                body += room ? "," : "";
+                body += "{\"id\":\"" + _id(a, room) + "\",\"summary\":\"" + calendarName(a, room) + "\"}";
+            }
+            return { 200, body + "]}" };
+        }
+        const std::string prefix = "/calendar/v3/calendars/";
+        if (r.path.find(prefix) == 0) {
+            ++eventRequests;
+            const std::string id = r.path.substr(prefix.size(), r.path.find('/', prefix.size()) - prefix.size());
+            if (_number(id, "a") != a) {
+                ++unauthorized;
+                return { 401, "{}" };
+            }
+            const std::string room = id.substr(0, id.find('@'));
+            return { 200, "{\"items\":[{\"summary\":\"Meeting " + room + "\"},{\"summary\":\"Heating\"}]}" };
+        }
+        return { 404, "{}" };
+    }
+
+    const unsigned accounts;
+    const unsigned rooms;
+    unsigned latencyMs;
+    std::set<unsigned> dead;            // set before serving
+    std::atomic<unsigned> tokenRequests;
+    std::atomic<unsigned> listRequests;
+    std::atomic<unsigned> eventRequests;
+    std::atomic<unsigned> unauthorized;
+
+private:
+    static std::string _id(long account, unsigned room) {
+        return "a" + std::to_string(account) + "r" + std::to_string(room) + "@group";
+    }
+
+    // Number right after `key` in `s`, or -1.
+    static long _number(const std::string& s, const char* key) {
+        const size_t at = s.find(key);
+        if (at == std::string::npos) return -1;
+        const char* p = s.c_str() + at + std::strlen(key);
+        char* end = nullptr;
+        const long n = std::strtol(p, &end, 10);
+        return end == p ? -1 : n;
+    }
+
+    std::atomic<unsigned> _issued;
+};
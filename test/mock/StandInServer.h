@@ -0,0 +1,154 @@
+// Local stand-in for the Google endpoints, for the native (PosixTransport)
+// builds.
+//
+// A minimal HTTP/1.0 server on 127.0.0.1 (ephemeral port): it reads one
+// request per connection -- method, path, Authorization header and body --
+// hands it to a handler, writes the handler's reply with a Content-Length and
+// closes, as Google does for an HTTP/1.0 client. `threads` accept loops run
+// in parallel on the same listening socket, so concurrent clients (the gateway
+// benchmark) are served concurrently. Linux/POSIX only.
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+class StandInServer {
+public:
+    struct Request {
+        std::string method;
+        std::string path;
+        std::string authorization;
+        std::string body;
+    };
+    struct Reply {
+        int code;
+        std::string body;
+    };
+    typedef std::function<Reply(const Request&)> Handler;
+
+    explicit StandInServer(Handler handler, unsigned threads = 1)
+        : _handler(handler), _threads(threads ? threads : 1), _fd(-1), _port(0), _served(0) {}
+
+    ~StandInServer() { stop(); }
+
+    StandInServer(const StandInServer&) = delete;
+    StandInServer& operator=(const StandInServer&) = delete;
+
+    bool start() {
+        _fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (_fd < 0) return false;
+        const int one = 1;
+        setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = 0;
+        socklen_t len = sizeof(addr);
+        if (bind(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(_fd, 128) != 0 ||
+            getsockname(_fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0) {
+            ::close(_fd);
+            _fd = -1;
+            return false;
+        }
+        _port = ntohs(addr.sin_port);
+        for (unsigned i = 0; i < _threads; ++i) {
+            _workers.push_back(std::thread(&StandInServer::_serve, this));
+        }
+        return true;
+    }
+
+    // Stops accepting (shutdown() wakes the blocked accept calls) and joins.
+    void stop() {
+        if (_fd < 0) return;
+        shutdown(_fd, SHUT_RDWR);
+        for (std::thread& t : _workers) t.join();
+        _workers.clear();
+        ::close(_fd);
+        _fd = -1;
+    }
+
+    uint16_t port() const { return _port; }
+    size_t served() const { return _served.load(); }
+
+private:
+    void _serve() {
+        for (;;) {
+            const int c = accept(_fd, nullptr, nullptr);
+            if (c < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                return;
+            }
+            _handle(c);
+            ::close(c);
+        }
+    }
+
+    void _handle(int c) {
+        std::string in;
+        char buf[2048];
+        size_t headerEnd;
+        while ((headerEnd = in.find("\r\n\r\n")) == std::string::npos) {
+            const ssize_t n = recv(c, buf, sizeof(buf), 0);
+            if (n <= 0) return;
+            in.append(buf, static_cast<size_t>(n));
+        }
+        Request req;
+        const size_t sp1 = in.find(' ');
+        const size_t sp2 = in.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos || sp2 == std::string::npos) return;
+        req.method = in.substr(0, sp1);
+        req.path = in.substr(sp1 + 1, sp2 - sp1 - 1);
+        req.authorization = _header(in, headerEnd, "Authorization");
+        const size_t length = std::strtoul(_header(in, headerEnd, "Content-Length").c_str(), nullptr, 10);
+        req.body = in.substr(headerEnd + 4);
+        while (req.body.size() < length) {
+            const ssize_t n = recv(c, buf, sizeof(buf), 0);
+            if (n <= 0) return;
+            req.body.append(buf, static_cast<size_t>(n));
+        }
+
+        const Reply reply = _handler(req);
+        char head[128];
+        std::snprintf(head, sizeof(head),
+                      "HTTP/1.0 %d X\r\nContent-Type: application/json; charset=UTF-8\r\n"
+                      "Content-Length: %zu\r\n\r\n", reply.code, reply.body.size());
+        std::string out = head;
+        out += reply.body;
+        size_t sent = 0;
+        while (sent < out.size()) {
+            const ssize_t n = send(c, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += static_cast<size_t>(n);
+        }
+        ++_served;
+    }
+
+    static std::string _header(const std::string& in, size_t end, const char* name) {
+        std::string key = "\r\n";
+        key += name;
+        key += ": ";
+        const size_t at = in.find(key);
+        if (at == std::string::npos || at > end) return std::string();
+        const size_t from = at + key.size();
+        return in.substr(from, in.find("\r\n", from) - from);
+    }
+
+    Handler _handler;
+    unsigned _threads;
+    int _fd;
+    uint16_t _port;
+    std::atomic<size_t> _served;
+    std::vector<std::thread> _workers;
+};
@@ -1,5 +1,24 @@
 // Minimal host-side mock of Udp.h for native unit tests.
-// Required transitively by TimestampNtp.hpp; the tests drive time through a
-// fake Ntp instead of real UDP, so nothing more is needed here.
+// Required transitively by TimestampNtp.hpp, which the tests drive through a
+// fake Ntp instead. The UDP interface below is the core's, for the snapshot
+// broadcast (SchedularBroadcast.hpp): test_main.cpp loops it back in memory,
+// native_main.cpp runs it over PosixUdp.
 #pragma once
 #include "Arduino.h"
+#include "IPAddress.h"
+
+class UDP : public Stream {
+public:
+    virtual uint8_t begin(uint16_t port) = 0;
+    virtual void stop() = 0;
+    virtual int beginPacket(IPAddress ip, uint16_t port) = 0;
+    virtual int endPacket() = 0;
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+    virtual int parsePacket() = 0;
+    virtual int read(unsigned char* buffer, size_t len) = 0;
+    virtual int read(char* buffer, size_t len) = 0;
+    virtual IPAddress remoteIP() = 0;
+    virtual uint16_t remotePort() = 0;
+    using Stream::read;
+};
@@ -5,39 +5,118 @@
 // from mockHttpCurrentBody(), which the mock HTTPClient publishes when it
 // consumes the next scripted response. A fresh read window opens on stop(),
 // which the library calls once per request.
+//
+// Bytes become readable as the reply's MockHttpShape lets them arrive on the
+// fake clock, with the semantics of the real client: available() and read()
+// only see what has arrived and never wait (read() returns -1 on an empty
+// buffer, even mid-body), while readBytes() waits for each missing byte up to
+// the Stream timeout, like Arduino's timedRead(), and returns short when it
+// expires or the connection is gone.
+//
+// TLS sessions follow BearSSL on the ESP8266: a Session handed to setSession()
+// is filled by the first handshake and resumed by the next connection that uses
+// it. mockTls() counts both kinds of handshake. probeMaxFragmentLength()
+// accepts the hosts listed in mockTlsMflnHosts(), and the sizes given to
+// setBufferSizes() are reported per handshake.
 #pragma once
 
+#include <cstring>
+
 #include "Arduino.h"
 #include "MockHttp.h"
 
+class WiFiClientSecure;
+
+namespace BearSSL {
+class Session {
+public:
+    Session() : _resumable(false) {}
+private:
+    friend class ::WiFiClientSecure;
+    bool _resumable;
+};
+}
+
 class WiFiClientSecure : public Stream {
 public:
-    WiFiClientSecure() : _pos(0), _bodyReadable(false) {}
+    WiFiClientSecure() : _pos(0), _bodyReadable(false), _session(nullptr), _receiveBuffer(0), _transmitBuffer(0) {}
 
     // No-op TLS knobs the library calls; kept for API parity with the real one.
     void setInsecure() {}
 
+    void setSession(BearSSL::Session* session) { _session = session; }
+
+    void setBufferSizes(int recv, int xmit) {
+        _receiveBuffer = recv;
+        _transmitBuffer = xmit;
+    }
+
+    static bool probeMaxFragmentLength(const String& host, uint16_t /*port*/, uint16_t /*len*/) {
+        ++mockTls().probes;
+        for (const std::string& h : mockTlsMflnHosts()) {
+            if (h == host.c_str()) return true;
+        }
+        return false;
+    }
+
+    // Called by the mock HTTPClient when POST()/GET() opens the connection.
+    void mockHandshake() {
+        mockTls().receiveBuffer = _receiveBuffer;
+        mockTls().transmitBuffer = _transmitBuffer;
+        if (_session && _session->_resumable) {
+            ++mockTls().resumed;
+        } else {
+            ++mockTls().full;
+            if (_session) _session->_resumable = true;
+        }
+    }
+
     // Streaming surface consumed by ArduinoJson's Reader<Stream>.
     // The body only becomes readable once an HTTPClient POST()/GET() has run,
     // i.e. once mockHttpCurrentBody() holds this request's reply.
     int available() override {
         _sync();
-        const std::string& b = mockHttpCurrentBody();
-        return _pos < b.size() ? static_cast<int>(b.size() - _pos) : 0;
+        const size_t ready = _arrived();
+        return _pos < ready ? static_cast<int>(ready - _pos) : 0;
     }
 
     int read() override {
         _sync();
-        const std::string& b = mockHttpCurrentBody();
-        if (_pos >= b.size()) return -1;
-        return static_cast<unsigned char>(b[_pos++]);
+        _spend();
+        if (_pos >= _arrived()) return -1;
+        return static_cast<unsigned char>(mockHttpCurrentBody()[_pos++]);
     }
 
     int peek() override {
         _sync();
+        if (_pos >= _arrived()) return -1;
+        return static_cast<unsigned char>(mockHttpCurrentBody()[_pos]);
+    }
+
+    size_t readBytes(char* buffer, size_t length) override {
+        _sync();
+        _spend();
         const std::string& b = mockHttpCurrentBody();
-        if (_pos >= b.size()) return -1;
-        return static_cast<unsigned char>(b[_pos]);
+        size_t n = 0;
+        while (n < length) {
+            const size_t ready = _arrived();
+            if (_pos < ready) {
+                const size_t k = ready - _pos < length - n ? ready - _pos : length - n;
+                std::memcpy(buffer + n, b.data() + _pos, k);
+                _pos += k;
+                n += k;
+                continue;
+            }
+            // Nothing buffered: timedRead() polls until the next byte lands or
+            // the timeout runs out, whichever comes first.
+            const unsigned long timeoutUs = _timeout * 1000UL;
+            if (_pos >= _limit() || _untilNextUs() > timeoutUs) {
+                mockAdvanceMicros(timeoutUs);
+                break;
+            }
+            mockAdvanceMicros(_untilNextUs());
+        }
+        return n;
     }
 
     // The library calls stop() at the end of every request. Arm the next read
@@ -57,6 +136,38 @@ private:
         }
     }
 
+    // The device's own processing time for one read call (slow reader).
+    void _spend() { mockAdvanceMicros(mockHttpCurrentShape().readCostUs); }
+
+    // Body bytes that will ever arrive: all of them, unless the link drops.
+    size_t _limit() const {
+        const size_t size = mockHttpCurrentBody().size();
+        const size_t drop = mockHttpCurrentShape().dropAt;
+        return drop < size ? drop : size;
+    }
+
+    // Body bytes arrived so far. Arrival times never decrease with the offset,
+    // so a binary search finds the first byte still in flight.
+    size_t _arrived() const {
+        const MockHttpShape& shape = mockHttpCurrentShape();
+        const unsigned long elapsed = micros() - mockHttpCurrentStartUs();
+        size_t lo = 0, hi = _limit();
+        while (lo < hi) {
+            const size_t mid = lo + (hi - lo) / 2;
+            if (shape.arrivalUs(mid) <= elapsed) lo = mid + 1; else hi = mid;
+        }
+        return lo;
+    }
+
+    // Time until byte _pos arrives (it is in flight, so this is > 0).
+    unsigned long _untilNextUs() const {
+        const unsigned long elapsed = micros() - mockHttpCurrentStartUs();
+        return mockHttpCurrentShape().arrivalUs(_pos) - elapsed;
+    }
+
     size_t _pos;
     bool _bodyReadable;
+    BearSSL::Session* _session;
+    int _receiveBuffer;
+    int _transmitBuffer;
 };
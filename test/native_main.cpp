@@ -0,0 +1,448 @@
+// Native Linux run of the GoogleSchedular library over real sockets.
+//
+// The unit tests swap HTTPClient/WiFiClientSecure for mocks. This binary does
+// not: it is built without ESP8266/ESP32, so the library picks PosixTransport
+// (src/PosixTransport.hpp) as its transport policy and talks HTTP/1.0 over
+// TCP to a stand-in for the Google endpoints on 127.0.0.1 (StandInServer.h).
+// Only the Arduino core types (String, F(), ...) still come from test/mock.
+//
+// Covered:
+//   1. full flow             (device code -> pending -> token -> calendar -> events)
+//   2. request shape         (method, path, Authorization, JSON body)
+//   3. failures              (invalid_grant, server gone, read timeout)
+//   4. gateway               (thread pool, one refresh per account, snapshots)
+//   5. name resolution       (cached address, TTL, re-resolution after a failure)
+//   6. snapshot broadcast    (leader syncs, followers hear it over loopback UDP)
+//
+//   ./test/run.sh            (built and run with the unit tests)
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "StandInServer.h"
+#include "StandInGoogle.h"
+#include "GoogleSchedular.hpp"
+#include "SchedularGateway.hpp"
+#include "SchedularBroadcast.hpp"
+#include "PosixUdp.hpp"
+
+unsigned long g_fakeMillis = 0;
+
+
+// --- test harness ---------------------------------------------------------
+
+static int g_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        ++g_failures; \
+        std::printf("  FAIL %s:%d  %s\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+
+class FakeNtp : public Ntp {
+public:
+    unsigned long time(void) const override { return _t; }
+    void set(unsigned long t) { _t = t; }
+private:
+    unsigned long _t = 1000;
+};
+
+class NativeSchedular : public GoogleSchedular {
+public:
+    NativeSchedular(Ntp* ntp, PosixTransport& transport)
+        : GoogleSchedular(String("native-client"), String("native-secret"), ntp, transport) {}
+    State state() const { return _state; }
+    const String& calendarId() const { return _calendarId; }
+    Response refresh() {
+        JsonDocument doc;
+        return refreshAccessToken(doc);
+    }
+};
+
+
+// --- stand-in Google ------------------------------------------------------
+
+// Scripted like the real endpoints; every request is logged for section 2.
+struct FakeGoogle {
+    std::mutex lock;
+    std::vector<StandInServer::Request> log;
+    unsigned polls = 0;
+    std::atomic<bool> rejectRefresh{false};
+    std::atomic<unsigned> delayMs{0};
+
+    StandInServer::Reply handle(const StandInServer::Request& r) {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            log.push_back(r);
+        }
+        if (delayMs) std::this_thread::sleep_for(std::chrono::milliseconds(delayMs));
+        if (r.path == "/device/code") {
+            return { 200, "{\"device_code\":\"DEV\",\"user_code\":\"ABCD-EFGH\","
+                          "\"verification_url\":\"https://www.google.com/device\",\"interval\":5}" };
+        }
+        if (r.path == "/token") {
+            if (r.body.find("device_code") != std::string::npos) {
+                return ++polls == 1
+                    ? StandInServer::Reply{ 428, "{\"error\":\"authorization_pending\"}" }
+                    : StandInServer::Reply{ 200, "{\"access_token\":\"AT1\",\"refresh_token\":\"1//REFRESH_TOKEN\","
+                                                 "\"expires_in\":3599}" };
+            }
+            if (rejectRefresh) return { 400, "{\"error\":\"invalid_grant\"}" };
+            return { 200, "{\"access_token\":\"AT2\",\"expires_in\":3599}" };
+        }
+        if (r.path.find("/calendar/v3/users/me/calendarList") == 0) {
+            return { 200, "{\"items\":[{\"id\":\"home@group\",\"summary\":\"Home\"},"
+                          "{\"id\":\"relay@group\",\"summary\":\"ArduinoRelay\"}]}" };
+        }
+        if (r.path.find("/calendar/v3/calendars/relay@group/events?fields=items(summary,start,end)") == 0) {
+            return { 200, "{\"items\":[{\"summary\":\"Relay1\","
+                          "\"start\":{\"dateTime\":\"2024-11-04T07:30:00Z\"},\"end\":{\"dateTime\":\"2024-11-04T07:45:00Z\"}},"
+                          "{\"summary\":\"Heating\","
+                          "\"start\":{\"dateTime\":\"2024-11-04T06:00:00Z\"},\"end\":{\"dateTime\":\"2024-11-04T08:00:00Z\"}}]}" };
+        }
+        if (r.path.find("/calendar/v3/calendars/relay@group/events") == 0) {
+            return { 200, "{\"items\":[{\"summary\":\"Relay1\"},{\"summary\":\"Heating\"}]}" };
+        }
+        return { 404, "{}" };
+    }
+};
+
+
+// --- 1. + 2. full flow and request shape ----------------------------------
+
+static void test_flow(FakeGoogle& google, uint16_t port) {
+    std::printf("full flow over loopback\n");
+    FakeNtp ntp;
+    PosixTransport transport;
+    transport.setEndpoint("127.0.0.1", port);
+    NativeSchedular sched(&ntp, transport);
+
+    String url, code;
+    sched.startRegistration(url, code);
+    CHECK(sched.isInitialized());
+    CHECK(code == "ABCD-EFGH");
+
+    ntp.set(1000 + 6);
+    sched.maintain();                       // 428 pending
+    CHECK(sched.isInitialized());
+    ntp.set(1000 + 12);
+    sched.maintain();                       // token
+    CHECK(sched.isAuthenticated());
+    CHECK(sched.getRefreshToken() == "1//REFRESH_TOKEN");
+
+    sched.setCalendar(String("ArduinoRelay"));
+    CHECK(sched.isLinked());
+    CHECK(sched.calendarId() == "relay@group");
+
+    CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(sched.getEventList().size() == 2);
+    CHECK(sched.getEventList().front() == "Relay1");
+
+    std::printf("request shape\n");
+    std::lock_guard<std::mutex> guard(google.lock);
+    CHECK(google.log.size() == 5);
+    CHECK(google.log[0].method == "POST");
+    CHECK(google.log[0].body.find("\"client_id\":\"native-client\"") != std::string::npos);
+    CHECK(google.log[2].body.find("\"device_code\":\"DEV\"") != std::string::npos);
+    CHECK(google.log[3].method == "GET");
+    CHECK(google.log[3].authorization == "Bearer AT1");
+    CHECK(google.log[4].path.find("timeMin=2024-11-04T07:30:10Z") != std::string::npos);
+}
+
+
+// --- 3. failures ----------------------------------------------------------
+
+static void test_failures(FakeGoogle& google, StandInServer& server) {
+    std::printf("failures (invalid_grant, timeout, server gone)\n");
+    FakeNtp ntp;
+    PosixTransport transport;
+    transport.setEndpoint("127.0.0.1", server.port());
+
+    // 3a. A rejected refresh_token is reported as such.
+    {
+        NativeSchedular sched(&ntp, transport);
+        sched.setRefreshToken(String("1//DEAD_REFRESH_TOKEN"));
+        google.rejectRefresh = true;
+        sched.maintain();
+        google.rejectRefresh = false;
+        CHECK(sched.hasFailed());
+        CHECK(sched.isAuthInvalid());
+    }
+
+    // 3b. A reply slower than the read timeout fails the request, transiently.
+    {
+        NativeSchedular sched(&ntp, transport);
+        sched.setRefreshToken(String("1//REFRESH_TOKEN"));
+        transport.setTimeout(100);
+        google.delayMs = 400;
+        sched.maintain();
+        google.delayMs = 0;
+        transport.setTimeout(5000);
+        CHECK(sched.hasFailed());
+        CHECK(!sched.isAuthInvalid());
+        sched.maintain();                   // recovers on the next call
+        CHECK(sched.isAuthenticated());
+    }
+
+    // 3c. Nobody listening: connection refused, negative code, no crash.
+    {
+        const uint16_t port = server.port();
+        server.stop();
+        NativeSchedular sched(&ntp, transport);
+        transport.setEndpoint("127.0.0.1", port);
+        sched.setRefreshToken(String("1//REFRESH_TOKEN"));
+        sched.maintain();
+        CHECK(sched.hasFailed());
+        CHECK(sched.lastAuthHttpCode() == PosixTransport::ERROR_CONNECT);
+        CHECK(!transport.isBusy());
+    }
+}
+
+
+// --- 4. gateway -----------------------------------------------------------
+
+static void test_gateway() {
+    std::printf("gateway (thread pool, one refresh per account, snapshots)\n");
+    StandInGoogle google(3, 4);
+    google.dead.insert(2);
+    StandInServer server(google.handler(), 4);
+    CHECK(server.start());
+
+    FakeNtp ntp;
+    SchedularGateway gateway(&ntp, 4);
+    gateway.transport().setEndpoint("127.0.0.1", server.port());
+    for (unsigned a = 0; a < 3; ++a) {
+        gateway.addAccount(String("gw-client"), String("gw-secret"), String(StandInGoogle::refreshToken(a).c_str()));
+        for (unsigned r = 0; r < 4; ++r) {
+            gateway.addCalendar(a, String(StandInGoogle::calendarName(a, r).c_str()));
+        }
+    }
+    const size_t missing = gateway.addCalendar(0, String("room-0-99"));
+    CHECK(gateway.calendars() == 13);
+
+    // 4a. First round: each account refreshes once, whatever its calendar count.
+    CHECK(gateway.syncAll("2024-11-04T07:30:15Z") == 8);
+    CHECK(google.tokenRequests == 3);
+    CHECK(gateway.tokenRefreshes(0) == 1);
+    CHECK(gateway.tokenRefreshes(2) == 0);
+    CHECK(google.listRequests == 9);
+    CHECK(google.unauthorized == 0);
+
+    SchedularGateway::Snapshot s;
+    gateway.snapshot(1, s);                 // room-0-1
+    CHECK(s.version == 1 && s.ok && !s.truncated);
+    CHECK(s.count == 2);
+    CHECK(std::strcmp(s.title(0), "Meeting a0r1") == 0);
+    CHECK(std::strcmp(s.title(1), "Heating") == 0);
+    CHECK(s.syncedAt == 1000);
+    gateway.snapshot(8, s);                 // room-2-0: account rejected
+    CHECK(s.version == 1 && !s.ok && s.count == 0);
+    gateway.snapshot(missing, s);
+    CHECK(!s.ok);
+
+    // 4b. Next round: tokens and links are reused; a rejected refresh_token is
+    // not tried again (isAuthInvalid() is sticky), the unknown calendar is
+    // looked up again.
+    ntp.set(1060);
+    CHECK(gateway.syncAll("2024-11-04T07:31:15Z") == 8);
+    CHECK(google.tokenRequests == 3);
+    CHECK(google.listRequests == 10);
+    gateway.snapshot(1, s);
+    CHECK(s.version == 2 && s.syncedAt == 1060);
+
+    // 4c. Token expiry: one refresh per live account, calendars follow.
+    ntp.set(1000 + 3600);
+    CHECK(gateway.syncAll("2024-11-04T08:30:15Z") == 8);
+    CHECK(google.tokenRequests == 5);
+    CHECK(gateway.tokenRefreshes(0) == 2);
+    CHECK(google.unauthorized == 0);
+
+    // 4d. Readers never see a torn snapshot while a round publishes.
+    std::atomic<bool> running(true);
+    std::atomic<unsigned> torn(0);
+    std::atomic<unsigned> reads(0);
+    std::thread reader([&] {
+        SchedularGateway::Snapshot r;
+        while (running) {
+            for (size_t i = 0; i < 8; ++i) {
+                gateway.snapshot(i, r);
+                const std::string room = "Meeting a" + std::to_string(i / 4) + "r" + std::to_string(i % 4);
+                if (r.count != 2 || room != r.title(0) || std::strcmp(r.title(1), "Heating") != 0) ++torn;
+                ++reads;
+            }
+        }
+    });
+    for (unsigned round = 0; round < 5; ++round) {
+        gateway.syncAll("2024-11-04T08:31:15Z");
+    }
+    running = false;
+    reader.join();
+    CHECK(torn == 0);
+    CHECK(reads > 0);
+    gateway.snapshot(0, s);
+    CHECK(s.version == 8);
+
+    server.stop();
+}
+
+
+// --- 5. name resolution ---------------------------------------------------
+
+static void test_dns(FakeGoogle& google) {
+    std::printf("name resolution (cached address, TTL, re-resolution after a failure)\n");
+    StandInServer server([&google](const StandInServer::Request& r) { return google.handle(r); });
+    if (!server.start()) {
+        CHECK(false);
+        return;
+    }
+    FakeNtp ntp;
+    PosixTransport transport;
+    // By name: "localhost" may list ::1 first, which nothing listens on, so the
+    // address kept is the one that answered.
+    transport.setEndpoint("localhost", server.port());
+    NativeSchedular sched(&ntp, transport);
+    sched.setRefreshToken(String("1//REFRESH_TOKEN"));
+    g_fakeMillis = 0;
+
+    // 5a. First request: looked up. Second: straight to the cached address.
+    //     Both are timed on the monotonic clock, millis() or not.
+    CHECK(sched.refresh() == NativeSchedular::Response::OK);
+    CHECK(transport.resolution().lookups == 1 && !transport.resolution().cached);
+    CHECK(transport.resolution().resolveUs > 0 && transport.resolution().connectUs > 0);
+    CHECK(sched.refresh() == NativeSchedular::Response::OK);
+    CHECK(transport.resolution().lookups == 0 && transport.resolution().cached);
+    CHECK(transport.resolution().resolveUs == 0 && transport.resolution().connectUs > 0);
+
+    // 5b. Setting the same endpoint again (as the gateway does per request)
+    //     keeps the cache; past the TTL the name is looked up again. The TTL
+    //     runs on the monotonic clock, not on millis(), which stays at 0 here.
+    transport.setEndpoint("localhost", server.port());
+    transport.setDnsTtl(1);
+    CHECK(sched.refresh() == NativeSchedular::Response::OK);
+    CHECK(transport.resolution().cached);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    CHECK(sched.refresh() == NativeSchedular::Response::OK);
+    CHECK(transport.resolution().lookups == 1 && !transport.resolution().cached);
+    transport.setDnsTtl(SCHEDULAR_DNS_TTL);
+
+    // 5c. The cached address stops answering: resolved again in the same
+    //     request, and forgotten, so the next one does not try it first.
+    server.stop();
+    CHECK(sched.refresh() == NativeSchedular::Response::ERROR);
+    CHECK(transport.resolution().lookups == 1 && transport.resolution().cached);
+    CHECK(sched.refresh() == NativeSchedular::Response::ERROR);
+    CHECK(transport.resolution().lookups == 1 && !transport.resolution().cached);
+
+    // 5d. TTL 0: every connection resolves.
+    StandInServer again([&google](const StandInServer::Request& r) { return google.handle(r); });
+    CHECK(again.start());
+    transport.setEndpoint("localhost", again.port());
+    transport.setDnsTtl(0);
+    CHECK(sched.refresh() == NativeSchedular::Response::OK);
+    CHECK(sched.refresh() == NativeSchedular::Response::OK);
+    CHECK(transport.resolution().lookups == 1 && !transport.resolution().cached);
+    again.stop();
+    g_fakeMillis = 0;
+}
+
+
+// --- 6. snapshot broadcast ------------------------------------------------
+
+// Waits a little for a datagram sent on the loopback.
+static bool pollFor(TimelineFollower& follower) {
+    for (int i = 0; i < 100; ++i) {
+        if (follower.poll()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return false;
+}
+
+static void test_broadcast(FakeGoogle& google) {
+    std::printf("snapshot broadcast (leader syncs, followers hear it over loopback UDP)\n");
+    StandInServer server([&google](const StandInServer::Request& r) { return google.handle(r); });
+    if (!server.start()) {
+        CHECK(false);
+        return;
+    }
+    const IPAddress loopback(127, 0, 0, 1);
+    const IPAddress group(239, 255, 42, 99);
+
+    // Two followers on one multicast group; hosts without multicast on the
+    // loopback fall back to one follower, by unicast.
+    PosixUdp udp1, udp2, leaderUdp;
+    bool multicast = udp1.beginMulticast(loopback, group, 0) != 0;
+    const uint16_t udpPort = multicast ? udp1.localPort() : 0;
+    multicast = multicast && udp2.beginMulticast(loopback, group, udpPort) && leaderUdp.beginMulticast(loopback, group, udpPort);
+    if (!multicast) {
+        std::printf("  (no multicast on the loopback: unicast)\n");
+        CHECK(udp1.begin(0));
+        CHECK(leaderUdp.begin(0));
+    }
+
+    FakeNtp ntp;
+    PosixTransport transport;
+    transport.setEndpoint("127.0.0.1", server.port());
+    NativeSchedular sched(&ntp, transport);
+    sched.setRefreshToken(String("1//REFRESH_TOKEN"));
+    sched.maintain();
+    sched.setCalendar(String("ArduinoRelay"));
+    CHECK(sched.isLinked());
+    EventTimeline timeline(3600);
+    sched.setTimeline(&timeline);
+    CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(sched.getEventList().size() == 2);
+
+    TimelineLeader leader(leaderUdp, multicast ? group : loopback, multicast ? udpPort : udp1.localPort());
+    CHECK(leader.publish(timeline) > 0);
+
+    // 2024-11-04T07:40:00Z
+    const uint32_t t = 1730678400UL + 7 * 3600 + 40 * 60;
+    EventTimeline mirror1, mirror2;
+    TimelineFollower follower1(udp1, mirror1), follower2(udp2, mirror2);
+    CHECK(pollFor(follower1));
+    CHECK(mirror1.activeCount(t) == 2);
+    CHECK(mirror1.nextTransition(t) == t + 5 * 60);
+    CHECK(follower1.rejected() == 0);
+    if (multicast) {
+        CHECK(pollFor(follower2));
+        CHECK(mirror2.size() == 2);
+        CHECK(follower2.sequence() == leader.sequence());
+    }
+
+    // Once again, unchanged: heard and dropped.
+    CHECK(leader.publish(timeline) > 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(!follower1.poll());
+    CHECK(follower1.received() == 2);
+    server.stop();
+}
+
+
+int main() {
+    FakeGoogle google;
+    StandInServer server([&google](const StandInServer::Request& r) { return google.handle(r); }, 2);
+    if (!server.start()) {
+        std::printf("FAILED - cannot listen on 127.0.0.1\n");
+        return 1;
+    }
+
+    test_flow(google, server.port());
+    test_failures(google, server);
+    test_gateway();
+    test_dns(google);
+    test_broadcast(google);
+
+    if (g_failures == 0) {
+        std::printf("OK - all native tests passed\n");
+        return 0;
+    }
+    std::printf("FAILED - %d check(s)\n", g_failures);
+    return 1;
+}
@@ -2,6 +2,13 @@
 # Build and run the native (host) unit tests for GoogleSchedular.
 # Compiled as gnu++11 to mirror the AVR/ESP core (also guards the odr-use fix).
 #
+#   ./test/run.sh          unit tests (test_main.cpp, static_main.cpp)
+#   ./test/run.sh bench    benchmarks (bench_main.cpp), JSON lines on stdout,
+#                          without then with SCHEDULAR_TRACE
+#   ./test/run.sh soak [days]  heap-fragmentation soak (soak_main.cpp)
+#   ./test/run.sh native   native Linux build over real sockets (native_main.cpp)
+#   ./test/run.sh gateway [calendars]  native gateway throughput (gateway_main.cpp)
+#
 # The tests compile the real, unmodified library against the mocks in
 # test/mock/, plus the real portable dependencies (ArduinoJson, FastTimer's
 # TimestampNtp). ESP8266 selects the library's include branch; ARDUINO makes
@@ -12,6 +19,7 @@
 # environment to point at a different checkout/install.
 set -e
 here="$(cd "$(dirname "$0")" && pwd)"
+target="${1:-test}"
 
 FASTTIMER_SRC="${FASTTIMER_SRC:-$here/../../Arduino-FastTimer/src}"
 ARDUINOJSON_SRC="${ARDUINOJSON_SRC:-$HOME/Documents/Arduino/libraries/ArduinoJson/src}"
@@ -27,16 +35,74 @@ if [ ! -f "$ARDUINOJSON_SRC/ArduinoJson.h" ]; then
     exit 2
 fi
 
-out="$(mktemp -d)/googleschedular_tests"
+out="$(mktemp -d)"
 
 # -Werror so warnings in the library or the tests fail the native-test job.
 # ArduinoJson is a third-party dependency included with -isystem so its own
 # headers do not trip -Werror; the mocks, the library and the tests are held to
 # -Wall -Wextra -Werror.
-${CXX:-c++} -std=gnu++11 -Wall -Wextra -Werror \
-    -DARDUINO=10805 -DESP8266=1 -DARDUINOJSON_ENABLE_ARDUINO_PRINT=0 \
-    -I "$here/mock" -I "$here/../src" -I "$FASTTIMER_SRC" \
-    -isystem "$ARDUINOJSON_SRC" \
-    "$here/test_main.cpp" -o "$out"
+#
+# build <name> <source> [flags...]: compile <source> into $out/<name>. Opt-in
+# features (SCHEDULAR_STATS, ...) get their own binary so the default build also
+# proves they compile out cleanly. $platform selects the library's transport:
+# the ESP8266 one over the mocks, or none for PosixTransport (native_main.cpp).
+platform="-DESP8266=1"
+libs=""
+build() {
+    name="$1"; src="$2"; shift 2
+    ${CXX:-c++} -std=gnu++11 -Wall -Wextra -Werror \
+        -DARDUINO=10805 $platform -DARDUINOJSON_ENABLE_ARDUINO_PRINT=0 \
+        -I "$here/mock" -I "$here/../src" -I "$FASTTIMER_SRC" \
+        -isystem "$ARDUINOJSON_SRC" \
+        "$@" "$here/$src" -o "$out/$name" $libs
+}
+
+if [ "$target" = "bench" ]; then
+    build googleschedular_bench bench_main.cpp -O2
+    build googleschedular_bench_trace bench_main.cpp -O2 -DSCHEDULAR_TRACE=1
+    "$out/googleschedular_bench"
+    exec "$out/googleschedular_bench_trace"
+fi
+if [ "$target" = "soak" ]; then
+    shift
+    build googleschedular_soak soak_main.cpp -O2
+    exec "$out/googleschedular_soak" "$@"
+fi
+
+
+# Native: no ESP8266, so the library builds on PosixTransport and the test talks
+# to a loopback server. Also built against OpenSSL when its headers are there.
+build_native() {
+    platform=""
+    build googleschedular_native native_main.cpp -pthread
+    if [ -f /usr/include/openssl/ssl.h ]; then
+        libs="-lssl -lcrypto"
+        build googleschedular_native_tls native_main.cpp -pthread -DSCHEDULAR_OPENSSL=1
+        libs=""
+    fi
+    platform="-DESP8266=1"
+}
+if [ "$target" = "gateway" ]; then
+    shift
+    platform=""
+    build googleschedular_gateway gateway_main.cpp -O2 -pthread
+    exec "$out/googleschedular_gateway" "$@"
+fi
+if [ "$target" = "native" ]; then
+    build_native
+    exec "$out/googleschedular_native"
+fi
+
+build googleschedular_tests test_main.cpp
+build googleschedular_tests_stats test_main.cpp -DSCHEDULAR_STATS=1
+build googleschedular_tests_static static_main.cpp -DSCHEDULAR_STATIC=1
+build googleschedular_tests_gzip test_main.cpp -DSCHEDULAR_GZIP=1
+build googleschedular_tests_trace test_main.cpp -DSCHEDULAR_TRACE=1
+build_native
 
-exec "$out"
+"$out/googleschedular_tests"
+"$out/googleschedular_tests_stats"
+"$out/googleschedular_tests_static"
+"$out/googleschedular_tests_gzip"
+"$out/googleschedular_tests_trace"
+exec "$out/googleschedular_native"
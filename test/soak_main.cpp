@@ -0,0 +1,235 @@
+// Heap-fragmentation soak test for the GoogleSchedular library.
+//
+// syncAt() is written to keep the per-sync heap footprint constant so that an
+// always-on board survives months of uptime (see the comment on syncAt). This
+// binary checks that claim: it installs an emulated ESP8266 heap (a small
+// umm_malloc-style arena, MockUmmHeap.h) under every allocation the library
+// makes, then replays months of one-minute loop() iterations -- maintain() and
+// syncAt() -- in a few seconds of host time.
+//
+// Simulated world, driven by a FakeNtp:
+//   - access_token lifetime of ~1 h, so a refresh every hour;
+//   - a daily pattern of events (heating, a relay pulse, lights) plus one
+//     meeting per day with a random time, length and title;
+//   - a 20-minute outage (HTTP 503) every third night, which goes through the
+//     ERROR -> maintain() recovery -> setCalendar() path.
+// Replies come from a MockHttpResponder, so nothing outside the library
+// allocates while the arena is installed.
+//
+// Output: one JSON line per simulated day with the worst free heap and largest
+// free block seen at any allocation that day (so mid-call peaks count), the
+// worst fragmentation between calls, and the runs still allocated at the end
+// of the day. The run fails (exit 1) if an allocation fails, if a sync fails
+// outside an outage, or if the largest free block ever drops below
+// SOAK_TOLERANCE % of its day-1 value -- i.e. if a change makes the heap drift
+// over time.
+//
+//   ./test/run.sh soak [days]     (default 90)
+
+#define ESP8266 1  // select the ESP8266 include branch of GoogleSchedular.hpp
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "MockHeap.h"
+#include "GoogleSchedular.hpp"
+
+unsigned long g_fakeMillis = 0;
+
+#ifndef SOAK_TOLERANCE
+#define SOAK_TOLERANCE 75
+#endif
+
+// 3072 blocks of 8 bytes: the ~24 KB an ESP8266 sketch typically has left once
+// Wi-Fi and the TLS buffers are up.
+static MockUmmHeap<3072> g_heap;
+
+
+// --- fake clock -----------------------------------------------------------
+
+class FakeNtp : public Ntp {
+public:
+    unsigned long time(void) const override { return _t; }
+    void set(unsigned long t) { _t = t; }
+private:
+    unsigned long _t = 0;
+};
+
+// "YYYY-MM-DDThh:mm:ssZ" for a Unix time, into a caller buffer (no heap).
+static void formatRFC3339(unsigned long t, char out[21]) {
+    const long days = static_cast<long>(t / 86400);
+    const unsigned long secs = t % 86400;
+    // civil_from_days (H. Hinnant), valid for the whole Unix era.
+    const long z = days + 719468;
+    const long era = z / 146097;
+    const unsigned long doe = static_cast<unsigned long>(z - era * 146097);
+    const unsigned long yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned long doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned long mp = (5 * doy + 2) / 153;
+    const unsigned long d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned long m = mp < 10 ? mp + 3 : mp - 9;
+    const long y = static_cast<long>(yoe) + era * 400 + (m <= 2);
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "%04ld-%02lu-%02luT%02lu:%02lu:%02luZ",
+                  y, m, d, secs / 3600, (secs / 60) % 60, secs % 60);
+    std::memcpy(out, buf, 20);
+    out[20] = '\0';
+}
+
+
+// --- simulated Google ------------------------------------------------------
+
+static const unsigned long START = 1704067200UL;   // 2024-01-01T00:00:00Z
+static unsigned long g_now = START;
+static bool g_outage = false;
+
+static uint32_t g_seed = 1;
+static uint32_t nextRandom() {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 8;
+}
+
+// Today's meeting: start minute, duration and title, redrawn once a day.
+static unsigned g_meetingStart = 0;
+static unsigned g_meetingLength = 0;
+static char g_meetingTitle[64];
+
+static void planDay() {
+    g_meetingStart = 9 * 60 + nextRandom() % (8 * 60);
+    g_meetingLength = 15 + nextRandom() % 106;
+    const unsigned len = 5 + nextRandom() % 55;
+    std::snprintf(g_meetingTitle, sizeof(g_meetingTitle), "Meeting ");
+    for (unsigned i = 8; i < len && i + 1 < sizeof(g_meetingTitle); ++i) {
+        g_meetingTitle[i] = static_cast<char>('a' + nextRandom() % 26);
+        g_meetingTitle[i + 1] = '\0';
+    }
+}
+
+static void addEvent(char* body, size_t size, bool& first, const char* title) {
+    std::strncat(body, first ? "{\"summary\":\"" : ",{\"summary\":\"", size - std::strlen(body) - 1);
+    std::strncat(body, title, size - std::strlen(body) - 1);
+    std::strncat(body, "\"}", size - std::strlen(body) - 1);
+    first = false;
+}
+
+static MockHttpReply respond(const char* path) {
+    static char body[512];
+    if (g_outage) {
+        return MockHttpReply{503, "{}"};
+    }
+    if (std::strcmp(path, "/token") == 0) {
+        return MockHttpReply{200, "{\"access_token\":\"ya29.a0AfH6SMBsoakAccessTokenValue\","
+                                  "\"expires_in\":3599,\"token_type\":\"Bearer\"}"};
+    }
+    if (std::strstr(path, "calendarList")) {
+        return MockHttpReply{200, "{\"items\":["
+                                  "{\"id\":\"home@group.calendar.google.com\",\"summary\":\"Home\"},"
+                                  "{\"id\":\"relay@group.calendar.google.com\",\"summary\":\"ArduinoRelay\"}]}"};
+    }
+    const unsigned minute = static_cast<unsigned>((g_now % 86400) / 60);
+    bool first = true;
+    std::strcpy(body, "{\"items\":[");
+    if ((minute >= 6 * 60 && minute < 8 * 60) || (minute >= 18 * 60 && minute < 23 * 60)) {
+        addEvent(body, sizeof(body), first, "Heating");
+    }
+    if (minute >= 7 * 60 && minute < 7 * 60 + 15) {
+        addEvent(body, sizeof(body), first, "Relay1");
+    }
+    if (minute >= 19 * 60 && minute < 23 * 60 + 30) {
+        addEvent(body, sizeof(body), first, "Lights living room");
+    }
+    if (minute >= g_meetingStart && minute < g_meetingStart + g_meetingLength) {
+        addEvent(body, sizeof(body), first, g_meetingTitle);
+    }
+    std::strncat(body, "]}", sizeof(body) - std::strlen(body) - 1);
+    return MockHttpReply{200, body};
+}
+
+
+// --- run ------------------------------------------------------------------
+
+int main(int argc, char** argv) {
+    const unsigned days = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : 90;
+
+    mockHttpReset();
+    mockHttpRecordUris() = false;
+    mockHttpResponder() = respond;
+    mockHttpCurrentBody().reserve(1024);   // the "socket buffer" is not heap
+
+    FakeNtp ntp;
+    ntp.set(START);
+
+    // The object itself is a global on a device; only what it allocates lives
+    // in the arena.
+    mockHeapUseArena(&g_heap);
+    GoogleSchedular gs(String("soak-client-id.apps.googleusercontent.com"),
+                       String("soak-client-secret"), &ntp);
+    gs.setRefreshToken(String("1//0soakRefreshTokenValueForTheSimulatedBoard"));
+    mockHeapUseArena(nullptr);
+
+    size_t baselineLargest = 0;
+    size_t worstLargest = g_heap.capacity();
+    unsigned unexpectedFailures = 0;
+    bool ok = true;
+
+    try {
+        for (unsigned day = 0; day < days && ok; ++day) {
+            planDay();
+            g_heap.resetLowWater();
+            uint8_t dayFrag = 0;
+
+            for (unsigned minute = 0; minute < 24 * 60; ++minute) {
+                g_now = START + day * 86400UL + minute * 60UL;
+                g_outage = (day % 3 == 2) && minute >= 3 * 60 && minute < 3 * 60 + 20;
+                ntp.set(g_now);
+                char ts[21];
+                formatRFC3339(g_now, ts);
+
+                mockHeapUseArena(&g_heap);
+                gs.maintain();
+                if (gs.isAuthenticated() && !gs.isLinked()) {
+                    gs.setCalendar(String("ArduinoRelay"));
+                }
+                const bool synced = gs.syncAt(ts);
+                mockHeapUseArena(nullptr);
+
+                if (!synced && !g_outage) {
+                    ++unexpectedFailures;
+                }
+                if (g_heap.fragmentation() > dayFrag) dayFrag = g_heap.fragmentation();
+            }
+            const size_t dayFree = g_heap.lowWaterFree();
+            const size_t dayLargest = g_heap.lowWaterMaxBlock();
+
+            if (day == 0) {
+                baselineLargest = dayLargest;
+            }
+            if (dayLargest < worstLargest) {
+                worstLargest = dayLargest;
+            }
+            std::printf("{\"day\":%u,\"free_min\":%zu,\"largest_min\":%zu,\"frag_max\":%u,"
+                        "\"used_runs\":%zu,\"failures\":%u}\n",
+                        day + 1, dayFree, dayLargest, dayFrag, g_heap.usedRuns(), unexpectedFailures);
+            if (day > 0 && dayLargest * 100 < baselineLargest * SOAK_TOLERANCE) {
+                std::printf("largest free block drifted below %d%% of day 1 (%zu -> %zu)\n",
+                            SOAK_TOLERANCE, baselineLargest, dayLargest);
+                ok = false;
+            }
+        }
+    } catch (const std::bad_alloc&) {
+        mockHeapUseArena(nullptr);
+        std::printf("out of memory on the emulated heap\n");
+        ok = false;
+    }
+
+    if (unexpectedFailures != 0) {
+        std::printf("%u sync(s) failed outside an outage\n", unexpectedFailures);
+        ok = false;
+    }
+
+    std::printf(ok ? "OK - heap stable over %u days (largest free block >= %zu bytes)\n"
+                   : "FAILED - heap soak over %u days (largest free block >= %zu bytes)\n",
+                days, worstLargest);
+    return ok ? 0 : 1;
+}
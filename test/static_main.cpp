@@ -0,0 +1,365 @@
+// Static-mode tests: the library built with SCHEDULAR_STATIC must not touch the
+// heap once setup() has built its objects (see SchedularMemory.hpp).
+//
+// Same approach as test_main.cpp (real library, mocks from test/mock/), with
+// two differences: every allocation is counted by MockHeap.h and must be zero,
+// and the transport is FixedReplyTransport, which serves scripted replies
+// without allocating -- the mock HTTPClient keeps Strings of its own, as the
+// real one does, and would blur the count.
+//
+// Covered:
+//   1. steady state  (bootstrap from refresh_token, setCalendar, syncAt,
+//                     token refresh: zero allocations, arena released)
+//   2. channels, filters and recurrences
+//   3. DeadlineSchedular
+//   4. overflows     (token, calendar id, titles, event count, arena, requests
+//                     that do not fit not sent)
+
+#define ESP8266 1  // select the ESP8266 include branch of GoogleSchedular.hpp
+#define SCHEDULAR_MAX_EVENTS 4  // a sketch may size the buffers; keeps 4c short
+
+#include <cstdio>
+#include <cstring>
+
+#include "MockHeap.h"
+#include "GoogleSchedular.hpp"
+#include "DeadlineSchedular.hpp"
+#include "FixedReplyTransport.h"
+
+#ifndef SCHEDULAR_STATIC
+#error "static_main.cpp is built with -DSCHEDULAR_STATIC=1 (see run.sh)"
+#endif
+
+unsigned long g_fakeMillis = 0;
+
+// --- test harness ---------------------------------------------------------
+
+static int g_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        ++g_failures; \
+        std::printf("  FAIL %s:%d  %s\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+#define CHECK_STR(got, want) do { \
+    if (std::strcmp((got), (want)) != 0) { \
+        ++g_failures; \
+        std::printf("  FAIL %s:%d  got \"%s\" want \"%s\"\n", __FILE__, __LINE__, (got), (want)); \
+    } \
+} while (0)
+
+// Heap allocations made by `call` (ArduinoJson's and the mocks' included).
+template <typename Call>
+static size_t allocations(Call call) {
+    mockHeapReset();
+    call();
+    return mockHeap().allocations;
+}
+
+// Runs `call` and checks it allocated nothing and left the arena empty.
+#define CHECK_STATIC(what, call) do { \
+    const size_t n = allocations([&]() { call; }); \
+    std::printf("      %-38s allocs %zu, arena peak %zu/%zu\n", (what), n, \
+                SchedularArena::scratch().peak(), SchedularArena::scratch().capacity()); \
+    CHECK(n == 0); \
+    CHECK(SchedularArena::scratch().live() == 0); \
+} while (0)
+
+
+// --- fake clock -----------------------------------------------------------
+
+class FakeNtp : public Ntp {
+public:
+    unsigned long time(void) const override { return _t; }
+    void set(unsigned long t) { _t = t; }
+private:
+    unsigned long _t = 1000;
+};
+
+typedef BasicGoogleSchedular<FixedReplyTransport> StaticSchedular;
+typedef BasicDeadlineSchedular<FixedReplyTransport> StaticDeadlineSchedular;
+
+static const char* TOKEN = "{\"access_token\":\"ACCESS_TOKEN\",\"expires_in\":3600}";
+static const char* CALENDARS = "{\"items\":[{\"id\":\"home@group\",\"summary\":\"Home\"},"
+                               "{\"id\":\"c\",\"summary\":\"Cal\"}]}";
+static const char* THREE_EVENTS = "{\"items\":[{\"summary\":\"Heating\"},{\"summary\":\"Relay1\"},"
+                                  "{\"summary\":\"Lights living room\"}]}";
+
+
+// --- 1. steady state ------------------------------------------------------
+
+static void test_steady_state() {
+    std::printf("steady state (bootstrap, setCalendar, syncAt, refresh)\n");
+
+    FixedReplyTransport transport;
+    FakeNtp ntp;
+    StaticSchedular sched(String("client"), String("secret"), &ntp, transport);
+    sched.setRefreshToken(String("REFRESH_TOKEN"));
+    const String name("Cal");
+    CalendarCache cache;
+    std::memset(&cache, 0, sizeof(cache));
+    sched.setCalendarCache(&cache);
+
+    const FixedReply script[] = {
+        {200, TOKEN},
+        {200, CALENDARS},
+        {200, THREE_EVENTS},
+        {200, THREE_EVENTS},
+        {200, "{\"access_token\":\"AT_NEW\",\"expires_in\":3600}"},
+        {200, "{\"summary\":\"Cal\"}"},
+        {200, "{\"items\":[]}"},
+    };
+    transport.play(script, sizeof(script) / sizeof(script[0]));
+
+    CHECK_STATIC("maintain (bootstrap from refresh_token)", sched.maintain());
+    CHECK(sched.isAuthenticated());
+    CHECK_STATIC("setCalendar (2 calendars)", sched.setCalendar(name));
+    CHECK(sched.isLinked());
+
+    CHECK_STATIC("syncAt (3 events)", sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(sched.getEventList().size() == 3);
+    CHECK_STR(sched.getEventList().back().c_str(), "Lights living room");
+    CHECK_STR(transport.path(), "/calendar/v3/calendars/c/events?fields=items(summary)&singleEvents=true"
+                                "&timeMin=2024-11-04T07:30:10Z&timeMax=2024-11-04T07:30:19Z");
+    CHECK_STATIC("syncAt (same 3 events)", sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(sched.getEventList().size() == 3);
+
+    ntp.set(1000000);
+    CHECK_STATIC("maintain (token refresh)", sched.maintain());
+    CHECK(sched.isAuthenticated());
+    CHECK_STATIC("maintain (idle)", sched.maintain());
+    CHECK_STATIC("setCalendar (cached id checked)", sched.setCalendar(name));
+    CHECK(sched.isLinked());
+    CHECK_STR(transport.path(), "/calendar/v3/calendars/c?fields=summary");
+    CHECK_STATIC("syncAt (no event)", sched.syncAt("2024-11-04T07:31:15Z"));
+    CHECK(sched.getEventList().empty());
+
+    // A failed request is an ERROR like any other, still without the heap.
+    CHECK_STATIC("syncAt (no reply)", sched.syncAt("2024-11-04T07:32:15Z"));
+    CHECK(sched.hasFailed());
+    CHECK(transport.remaining() == 0);
+}
+
+
+// --- 2. channels, filters and recurrences ---------------------------------
+
+static void test_channels_and_recurrences() {
+    std::printf("channels, filters and recurrences\n");
+
+    FixedReplyTransport transport;
+    FakeNtp ntp;
+    StaticSchedular sched(String("client"), String("secret"), &ntp, transport);
+    sched.setRefreshToken(String("REFRESH_TOKEN"));
+    const String name("Cal");
+    ChannelMatcher channels;
+    channels.add(0, "Heating", ChannelMatcher::PREFIX);
+    channels.add(1, "Standup", ChannelMatcher::PREFIX);
+    RecurrenceStore recurrences(86400);
+
+    const FixedReply script[] = {
+        {200, TOKEN},
+        {200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}"},
+        {200, THREE_EVENTS},
+        {200, "{\"items\":[{\"summary\":\"Heating\",\"transparency\":\"transparent\"},{\"summary\":\"Standup\"}]}"},
+        {200, "{\"items\":["
+              "{\"id\":\"m1\",\"summary\":\"Standup\","
+               "\"start\":{\"dateTime\":\"2024-11-04T09:00:00+01:00\"},\"end\":{\"dateTime\":\"2024-11-04T09:15:00+01:00\"},"
+               "\"recurrence\":[\"RRULE:FREQ=WEEKLY;BYDAY=MO,TU,WE,TH,FR\"]},"
+              "{\"id\":\"m1_20241106T080000Z\",\"status\":\"cancelled\",\"recurringEventId\":\"m1\","
+               "\"originalStartTime\":{\"dateTime\":\"2024-11-06T09:00:00+01:00\"}}"
+              "]}"},
+    };
+    transport.play(script, sizeof(script) / sizeof(script[0]));
+    sched.maintain();
+    sched.setCalendar(name);
+    CHECK(sched.isLinked());
+
+    sched.setChannels(&channels);
+    CHECK_STATIC("syncAt (channel mask)", sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(sched.getActiveChannels() == 1);
+
+    EventFilter filter;
+    filter.tag("device", "relay");
+    filter.skip(EventFilter::SKIP_TRANSPARENT);
+    sched.setEventFilter(&filter);
+    CHECK_STATIC("syncAt (filtered channel mask)", sched.syncAt("2024-11-04T07:31:15Z"));
+    CHECK(sched.getActiveChannels() == 2);
+    CHECK(std::strstr(transport.path(), "&privateExtendedProperty=device%3Drelay&") != nullptr);
+    sched.setEventFilter(nullptr);
+
+    sched.setRecurrences(&recurrences);
+    CHECK_STATIC("syncAt (recurrences loaded)", sched.syncAt("2024-11-04T08:05:00Z"));
+    CHECK(recurrences.isUsable());
+    CHECK(sched.getActiveChannels() == 2);
+    sched.setChannels(nullptr);
+    CHECK_STATIC("syncAt (recurrences expanded)", sched.syncAt("2024-11-05T08:04:00Z"));
+    CHECK(sched.getEventList().size() == 1);
+    CHECK_STR(sched.getEventList().front().c_str(), "Standup");
+    CHECK(transport.remaining() == 0);
+}
+
+
+// --- 3. DeadlineSchedular -------------------------------------------------
+
+static void test_deadline_schedular() {
+    std::printf("DeadlineSchedular\n");
+
+    FixedReplyTransport transport;
+    FakeNtp ntp;
+    StaticDeadlineSchedular sched(String("client"), String("secret"), &ntp, transport);
+    sched.setRefreshToken(String("REFRESH_TOKEN"));
+    const int8_t door = sched.addCalendar(String("Door"), 60, 1);
+    const int8_t heat = sched.addCalendar(String("Heat"), 300);
+
+    const FixedReply script[] = {
+        {200, TOKEN},
+        {200, "{\"items\":[{\"id\":\"door\",\"summary\":\"Door\"},{\"id\":\"heat\",\"summary\":\"Heat\"}]}"},
+        {200, "{\"items\":[{\"summary\":\"Unlock\"}]}"},
+        {200, "{\"items\":[{\"summary\":\"Heating\"},{\"summary\":\"Boost\"}]}"},
+        {200, "{\"items\":[]}"},
+    };
+    transport.play(script, sizeof(script) / sizeof(script[0]));
+
+    CHECK_STATIC("maintain(ts) (token, list, 2 calendars)", sched.maintain("2024-11-04T07:30:15Z"));
+    CHECK(sched.lastTickSyncs() == 2);
+    CHECK(sched.getEventList(door).size() == 1);
+    CHECK(sched.getEventList(heat).size() == 2);
+    ntp.set(1060);
+    CHECK_STATIC("maintain(ts) (door due)", sched.maintain("2024-11-04T07:31:15Z"));
+    CHECK(sched.lastTickSyncs() == 1);
+    CHECK(sched.getEventList(door).empty());
+    CHECK(transport.remaining() == 0);
+}
+
+
+// --- 4. overflows ---------------------------------------------------------
+
+static void test_overflows() {
+    std::printf("overflows (token, calendar id, titles, event count, arena)\n");
+
+    FixedReplyTransport transport;
+    FakeNtp ntp;
+
+    // 4a. A token longer than its buffer is not stored, and the request fails.
+    {
+        char body[SCHEDULAR_ACCESS_TOKEN_SIZE + 64];
+        char token[SCHEDULAR_ACCESS_TOKEN_SIZE + 1];
+        std::memset(token, 'T', sizeof(token) - 1);
+        token[sizeof(token) - 1] = '\0';
+        std::snprintf(body, sizeof(body), "{\"access_token\":\"%s\",\"expires_in\":3600}", token);
+        const FixedReply script[] = { {200, body} };
+        transport.play(script, 1);
+        StaticSchedular sched(String("client"), String("secret"), &ntp, transport);
+        sched.setRefreshToken(String("REFRESH_TOKEN"));
+        CHECK_STATIC("maintain (access_token too long)", sched.maintain());
+        CHECK(sched.hasFailed());
+    }
+
+    // 4b. So does a calendar id: the calendar is not linked.
+    {
+        char body[SCHEDULAR_CALENDAR_ID_SIZE + 64];
+        char id[SCHEDULAR_CALENDAR_ID_SIZE + 1];
+        std::memset(id, 'c', sizeof(id) - 1);
+        id[sizeof(id) - 1] = '\0';
+        std::snprintf(body, sizeof(body), "{\"items\":[{\"id\":\"%s\",\"summary\":\"Cal\"}]}", id);
+        const FixedReply script[] = { {200, TOKEN}, {200, body} };
+        transport.play(script, 2);
+        StaticSchedular sched(String("client"), String("secret"), &ntp, transport);
+        sched.setRefreshToken(String("REFRESH_TOKEN"));
+        sched.maintain();
+        const String name("Cal");
+        CHECK_STATIC("setCalendar (id too long)", sched.setCalendar(name));
+        CHECK(sched.isAuthenticated() && !sched.isLinked());
+    }
+
+    // 4c. Titles are cut, events past SCHEDULAR_MAX_EVENTS dropped.
+    {
+        static char body[1024];
+        size_t n = std::snprintf(body, sizeof(body), "{\"items\":[");
+        for (int i = 0; i < SCHEDULAR_MAX_EVENTS + 1; ++i) {
+            n += std::snprintf(body + n, sizeof(body) - n, "%s{\"summary\":\"Event %d, a title too long to fit in its buffer whole\"}",
+                               i ? "," : "", i);
+        }
+        std::snprintf(body + n, sizeof(body) - n, "]}");
+        const FixedReply script[] = { {200, TOKEN}, {200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}"}, {200, body} };
+        transport.play(script, 3);
+        StaticSchedular sched(String("client"), String("secret"), &ntp, transport);
+        sched.setRefreshToken(String("REFRESH_TOKEN"));
+        sched.maintain();
+        sched.setCalendar(String("Cal"));
+        CHECK_STATIC("syncAt (too many, too long)", sched.syncAt("2024-11-04T07:30:15Z"));
+        CHECK(sched.isLinked());
+        CHECK(sched.getEventList().size() == SCHEDULAR_MAX_EVENTS);
+        CHECK(sched.getEventList().dropped() == 1);
+        CHECK(sched.getEventList().front().length() == SCHEDULAR_TITLE_SIZE - 1);
+        CHECK(std::strncmp(sched.getEventList().back().c_str(), "Event 3, a title", 16) == 0);
+    }
+
+    // 4d. A reply larger than the arena fails to parse: ERROR, arena released.
+    {
+        static char body[SCHEDULAR_SCRATCH_SIZE * 2];
+        size_t n = std::snprintf(body, sizeof(body), "{\"items\":[");
+        for (int i = 0; n + 64 < sizeof(body); ++i) {
+            n += std::snprintf(body + n, sizeof(body) - n, "%s{\"summary\":\"Event %d\"}", i ? "," : "", i);
+        }
+        std::snprintf(body + n, sizeof(body) - n, "]}");
+        const FixedReply script[] = { {200, TOKEN}, {200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}"}, {200, body} };
+        transport.play(script, 3);
+        StaticSchedular sched(String("client"), String("secret"), &ntp, transport);
+        sched.setRefreshToken(String("REFRESH_TOKEN"));
+        sched.maintain();
+        sched.setCalendar(String("Cal"));
+        const size_t failures = SchedularArena::scratch().failures();
+        CHECK_STATIC("syncAt (reply larger than the arena)", sched.syncAt("2024-11-04T07:30:15Z"));
+        CHECK(sched.hasFailed());
+        CHECK(SchedularArena::scratch().failures() > failures);
+    }
+
+    // 4e. An arena too full for the path, header or body of a request: nothing
+    //     is sent (no empty path, no token-less Authorization header), and the
+    //     failure reads as transient, not as a revoked credential.
+    {
+        const FixedReply script[] = { {200, TOKEN}, {200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}"},
+                                      {401, "{}"}, {400, "{\"error\":\"invalid_grant\"}"} };
+        transport.play(script, 4);
+        StaticSchedular sched(String("client"), String("secret"), &ntp, transport);
+        sched.setRefreshToken(String("REFRESH_TOKEN"));
+        ntp.set(1000);
+        sched.maintain();
+        sched.setCalendar(String("Cal"));
+        CHECK(sched.isLinked());
+
+        SchedularArena& scratch = SchedularArena::scratch();
+        void* hog = scratch.allocate(scratch.capacity() - scratch.used() - 64);
+        CHECK(hog != nullptr);
+        const size_t requests = transport.requests();
+        CHECK(!sched.syncAt("2024-11-04T07:30:15Z"));
+        CHECK(transport.requests() == requests);
+
+        ntp.set(1000 + 3600);                   // token expired: a refresh is due
+        sched.maintain();
+        CHECK(transport.requests() == requests);
+        CHECK(sched.lastAuthHttpCode() == 0);
+        CHECK(!sched.isAuthInvalid());
+        CHECK(transport.remaining() == 2);
+        scratch.deallocate(hog);
+        CHECK(scratch.live() == 0);
+    }
+}
+
+
+int main() {
+    test_steady_state();
+    test_channels_and_recurrences();
+    test_deadline_schedular();
+    test_overflows();
+
+    if (g_failures == 0) {
+        std::printf("OK - all static tests passed\n");
+        return 0;
+    }
+    std::printf("FAILED - %d check(s)\n", g_failures);
+    return 1;
+}
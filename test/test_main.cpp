@@ -19,17 +19,45 @@
 //   5. setCalendar            (match -> LINKED, no match -> AUTHENTICATED)
 //   6. syncAt                 (event list + time window, const char* and String)
 //   7. malformed body on 200  (demoted to a failure -> ERROR)
+//   8. isValidTimestamp
+//   9. auth failure cause     (isAuthInvalid, token kept)
+//  10. SchedularStats         (only in the -DSCHEDULAR_STATS build)
+//  11. allocation budgets     (heap allocations / String constructions per call)
+//  12. simulated network      (segments, latency, stalls, drops, slow reads)
+//  13. shared transport       (several accounts on one client pair, TLS resumption)
+//  14. TLS memory profile     (fragment length probe, buffer sizes, fallback)
+//  15. DeadlineSchedular      (per-calendar deadlines, priorities, tick budget)
+//  16. ChannelMatcher         (trie, case/prefix options, syncAt channel mask)
+//  17. Recurrence             (RRULE subset, exceptions, syncAt local expansion)
+//  18. gzip                   (inflater, window, pass-through, Accept-Encoding)
+//  19. calendar cache         (check instead of list, trust period, fallback)
+//  20. EventFilter            (query assembly, encoding, device-side skips)
+//  21. EventTimeline          (epoch records, sorted, time queries, syncAt)
+//  22. Deep sleep             (SleepState, wake-up times, a day of wake-ups)
+//  23. Snapshot broadcast     (format, CRC, leader / follower, copies, staleness)
+//  24. SchedularTrace         (only in the -DSCHEDULAR_TRACE build)
+//  25. Paced parsing          (byte / time slices, yield() mid-parse, same result)
+//  26. JSON arena             (documents off the heap, rewinds, bounded, no fallback,
+//                              requests that do not fit not sent)
+//  27. Memory tiers           (two simulated heaps, per-tier accounting, make<T>)
 
 #define ESP8266 1  // select the ESP8266 include branch of GoogleSchedular.hpp
 
 #include <cstdio>
 #include <cstring>
+#include <deque>
 #include <list>
+#include <string>
 
+#include "MockHeap.h"
 #include "GoogleSchedular.hpp"
+#include "DeadlineSchedular.hpp"
+#include "SchedularGzip.hpp"
+#include "SchedularBroadcast.hpp"
 
 // Backing storage for the mocked millis() (declared extern in the Arduino mock).
-// Time under test comes from FakeNtp below; this only satisfies FastTimer code.
+// Time under test comes from FakeNtp below; the simulated network (section 12)
+// advances this clock, and SchedularStats reads it through micros().
 unsigned long g_fakeMillis = 0;
 
 // --- test harness ---------------------------------------------------------
@@ -70,8 +98,9 @@ private:
 // reads private fields so the assertions can be precise.
 class TestSchedular : public GoogleSchedular {
 public:
-    TestSchedular(const String& id, const String& secret, Ntp* ntp)
-        : GoogleSchedular(id, secret, ntp) {}
+    TestSchedular(const String& id, const String& secret, Ntp* ntp,
+                  SchedularTransport& transport = SchedularTransport::shared())
+        : GoogleSchedular(id, secret, ntp, transport) {}
     State state() const { return _state; }
     const String& calendarIdRaw() const { return _calendarId; }
     unsigned long expiration() const { return _expirationTimestamp; }
@@ -703,6 +732,2236 @@ static void test_auth_failure_cause() {
 }
 
 
+// --- 10. SchedularStats ---------------------------------------------------
+
+#ifdef SCHEDULAR_STATS
+static void test_stats() {
+    std::printf("SchedularStats (counters, bytes, histograms)\n");
+
+    // 10a. log2 buckets: 1 us -> bucket 0, 1000 us -> bucket 9 ([512, 1024)).
+    {
+        SchedularStats st;
+        st.phases[SchedularStats::PHASE_TOTAL].add(1);
+        st.phases[SchedularStats::PHASE_TOTAL].add(1000);
+        st.phases[SchedularStats::PHASE_TOTAL].add(1000);
+        const SchedularStats::Histogram& h = st.phase(SchedularStats::PHASE_TOTAL);
+        CHECK(h.buckets[0] == 1);
+        CHECK(h.buckets[9] == 2);
+        CHECK(h.count == 3);
+        CHECK(h.maxUs == 1000);
+        CHECK(h.meanUs() == 667);
+        CHECK(h.percentileUs(10) == 2);
+        CHECK(h.percentileUs(50) == 1024);
+        // Beyond the last bucket's lower bound the max is the only honest answer.
+        st.phases[SchedularStats::PHASE_TOTAL].add(10000000);
+        CHECK(st.phase(SchedularStats::PHASE_TOTAL).buckets[15] == 1);
+        CHECK(st.phase(SchedularStats::PHASE_TOTAL).percentileUs(100) == 10000000);
+
+        // A transport that connects on its own reports the time; one whose
+        // client connects inside the request (HTTPClient) leaves it empty.
+        st.connected(0);
+        CHECK(st.phase(SchedularStats::PHASE_CONNECT).count == 0);
+        st.connected(1500);
+        CHECK(st.phase(SchedularStats::PHASE_CONNECT).count == 1 && st.phase(SchedularStats::PHASE_CONNECT).maxUs == 1500);
+    }
+
+    // 10b. A bootstrap that fails once, recovers, links and syncs: every request
+    //      is counted per operation, every body byte is seen, and the heap
+    //      low-water mark follows the scripted free heap.
+    {
+        FakeNtp ntp;
+        TestSchedular sched(String("i"), String("s"), &ntp);
+        sched.setRefreshToken(String("A_LONG_REFRESH_TOKEN"));
+        mockFreeHeap() = 30000;
+
+        mockHttpReset();
+        mockHttpPush(503, "{}");
+        sched.maintain();                                 // transient failure
+        CHECK(sched.hasFailed());
+
+        const char* token = "{\"access_token\":\"AT\",\"expires_in\":3600}";
+        const char* cals  = "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}";
+        const char* evts  = "{\"items\":[{\"summary\":\"P1\"},{\"summary\":\"P2\"}]}";
+        mockHttpReset();
+        mockHttpPush(200, token);
+        mockFreeHeap() = 21000;
+        sched.maintain();                                 // retry succeeds
+        CHECK(sched.isAuthenticated());
+
+        mockHttpReset();
+        mockHttpPush(200, cals);
+        sched.setCalendar(String("Cal"));
+        mockHttpReset();
+        mockHttpPush(200, evts);
+        mockFreeHeap() = 25000;
+        CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+
+        const SchedularStats& st = sched.stats();
+        CHECK(st.op(SchedularStats::OP_REFRESH).calls == 2);
+        CHECK(st.op(SchedularStats::OP_REFRESH).failures == 1);
+        CHECK(st.op(SchedularStats::OP_CALENDARS).calls == 1);
+        CHECK(st.op(SchedularStats::OP_EVENTS).calls == 1);
+        CHECK(st.op(SchedularStats::OP_EVENTS).failures == 0);
+        CHECK(st.retries == 1);
+        CHECK(st.tlsHandshakes == 4);
+        CHECK(st.bytesReceived == 2 + std::strlen(token) + std::strlen(cals) + std::strlen(evts));
+        CHECK(st.phase(SchedularStats::PHASE_TOTAL).count == 4);
+        CHECK(st.phase(SchedularStats::PHASE_REQUEST).count == 4);
+        CHECK(st.phase(SchedularStats::PHASE_FIRST_BYTE).count == 4);
+        CHECK(st.phase(SchedularStats::PHASE_PARSE).count == 4);
+        CHECK(st.phase(SchedularStats::PHASE_CONNECT).count == 0);  // folded into PHASE_REQUEST
+        CHECK(st.cacheHits == 0);
+        CHECK(st.heapLowWater == 21000);
+
+        // A 304 is counted as such (and as a failed events request).
+        mockHttpReset();
+        mockHttpPush(304, "");
+        CHECK(!sched.syncAt("2024-11-04T07:30:15Z"));
+        CHECK(sched.stats().notModified == 1);
+        CHECK(sched.stats().op(SchedularStats::OP_EVENTS).failures == 1);
+
+        sched.resetStats();
+        CHECK(sched.stats().op(SchedularStats::OP_REFRESH).calls == 0);
+        CHECK(sched.stats().bytesReceived == 0);
+        CHECK(sched.stats().phase(SchedularStats::PHASE_TOTAL).count == 0);
+    }
+}
+#endif
+
+
+// --- 11. allocation budgets -----------------------------------------------
+
+// Heap allocations (MockHeap.h counts every malloc, ArduinoJson's included) and
+// String constructions / copies (counted by the mock String) of one call.
+struct Usage {
+    size_t allocs;
+    size_t strings;
+    size_t copies;
+};
+
+template <typename Call>
+static Usage measureUsage(Call call) {
+    mockHeapReset();
+    mockStringReset();
+    call();
+    const Usage u = { mockHeap().allocations, mockStringStats().constructed, mockStringStats().copies };
+    return u;
+}
+
+// Fails the run when `u` exceeds a budget, and prints the usage either way so
+// a deliberate change can re-tune the numbers from the log.
+static void checkBudget(const char* what, const Usage& u,
+                        size_t maxAllocs, size_t maxStrings, size_t maxCopies, int line) {
+    const bool ok = u.allocs <= maxAllocs && u.strings <= maxStrings && u.copies <= maxCopies;
+    std::printf("  %s %-34s allocs %3zu/%-3zu Strings %2zu/%-2zu copies %zu/%zu\n",
+                ok ? "    " : "FAIL", what, u.allocs, maxAllocs, u.strings, maxStrings, u.copies, maxCopies);
+    if (!ok) {
+        ++g_failures;
+        std::printf("  FAIL %s:%d  over budget\n", __FILE__, line);
+    }
+}
+#define CHECK_BUDGET(what, usage, allocs, strings, copies) \
+    checkBudget((what), (usage), (allocs), (strings), (copies), __LINE__)
+
+// With SCHEDULAR_GZIP every request also sets Accept-Encoding, which
+// HTTPClient's String interface turns into two more Strings.
+#ifdef SCHEDULAR_GZIP
+static const size_t GZIP_STRINGS = 2;
+#else
+static const size_t GZIP_STRINGS = 0;
+#endif
+
+// Scripts one reply outside the measured window. The mock's own bookkeeping
+// (URI history, body buffer growth) is switched off so only library work counts.
+static void scriptReply(int code, const char* body) {
+    mockHttpReset();
+    mockHttpPush(code, body);
+    mockHttpCurrentBody().reserve(1024);
+}
+
+static void test_allocation_budgets() {
+    std::printf("allocation budgets\n");
+    mockHttpRecordUris() = false;
+
+    const char* threeEvents = "{\"items\":[{\"summary\":\"Heating\"},{\"summary\":\"Relay1\"},"
+                              "{\"summary\":\"Lights living room\"}]}";
+    const char* sixEvents = "{\"items\":[{\"summary\":\"Heating\"},{\"summary\":\"Relay1\"},"
+                            "{\"summary\":\"Lights living room\"},{\"summary\":\"Relay2\"},"
+                            "{\"summary\":\"Porch\"},{\"summary\":\"Sprinklers zone 4\"}]}";
+
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp);
+    driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+
+    // setCalendar: the name is taken by reference, and the list is scanned
+    // as const char*, so the only String work is the request itself.
+    const String name("Cal");
+    scriptReply(200, "{\"items\":[{\"id\":\"home@group\",\"summary\":\"Home\"},"
+                     "{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    const Usage link = measureUsage([&]() { sched.setCalendar(name); });
+    CHECK(sched.isLinked());
+    CHECK_BUDGET("setCalendar (2 calendars)", link, 32, 6 + GZIP_STRINGS, 0);
+
+    // Steady-state syncAt: same three events as the previous sync.
+    scriptReply(200, threeEvents);
+    sched.syncAt("2024-11-04T07:30:15Z");
+    scriptReply(200, threeEvents);
+    const Usage three = measureUsage([&]() { sched.syncAt("2024-11-04T07:30:15Z"); });
+    CHECK(sched.getEventList().size() == 3);
+    CHECK_BUDGET("syncAt (3 events, steady state)", three, 40, 8 + GZIP_STRINGS, 0);
+
+    // Each extra event may cost a list node, its title and its JSON string --
+    // not a copy of anything.
+    scriptReply(200, sixEvents);
+    sched.syncAt("2024-11-04T07:30:15Z");
+    scriptReply(200, sixEvents);
+    const Usage six = measureUsage([&]() { sched.syncAt("2024-11-04T07:30:15Z"); });
+    CHECK(sched.getEventList().size() == 6);
+    const Usage perEvent = { (six.allocs - three.allocs) / 3, (six.strings - three.strings) / 3,
+                             (six.copies - three.copies) / 3 };
+    CHECK_BUDGET("syncAt, per extra event", perEvent, 5, 1, 0);
+
+    // Reading the result is free.
+    const Usage read = measureUsage([&]() {
+        size_t n = 0;
+        for (const String& e : sched.getEventList()) n += e.length();
+        CHECK(n != 0);
+    });
+    CHECK_BUDGET("getEventList + iterate", read, 0, 0, 0);
+
+    // Token refresh (maintain() with an expired token).
+    ntp.set(1000000);
+    scriptReply(200, "{\"access_token\":\"AT_NEW\",\"expires_in\":3600}");
+    const Usage refresh = measureUsage([&]() { sched.maintain(); });
+    CHECK(sched.isAuthenticated());
+    CHECK_BUDGET("maintain (token refresh)", refresh, 64, 12 + GZIP_STRINGS, 0);
+
+    // maintain() with nothing due does nothing at all.
+    const Usage idle = measureUsage([&]() { sched.maintain(); });
+    CHECK_BUDGET("maintain (idle)", idle, 0, 0, 0);
+
+    // Rejected preconditions allocate nothing.
+    const Usage reject = measureUsage([&]() { sched.syncAt(static_cast<const char*>(nullptr)); });
+    CHECK_BUDGET("syncAt (null timestamp)", reject, 0, 0, 0);
+
+    mockHttpRecordUris() = true;
+}
+
+
+
+// --- 12. simulated network ------------------------------------------------
+
+// Replies shaped by a MockHttpShape arrive over the fake clock: the library must
+// parse a body that trickles in segment by segment, wait through a short stall,
+// and give up cleanly -- ERROR, previous events kept -- when the server stalls
+// past the stream timeout or the connection drops mid-body. Latencies are
+// exact, since nothing but the simulated link moves the clock.
+static void test_simulated_network() {
+    std::printf("simulated network (segments, latency, stalls, drops)\n");
+
+    const char* evts = "{\"items\":[{\"summary\":\"Relay1\"},{\"summary\":\"Heating\"}]}";
+    const size_t len = std::strlen(evts);
+
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp);
+    driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.isLinked());
+
+    // 12a. 5-byte segments 10 ms apart, after 200 ms of request latency and a
+    //      50 ms wait for the first byte. read() finds the buffer empty between
+    //      segments; the parse must not take that for the end of the body.
+    {
+        mockHttpReset();
+        mockHttpPush(200, evts, MockHttpShape().latency(200).firstByte(50).segments(5, 10));
+#ifdef SCHEDULAR_STATS
+        sched.resetStats();
+#endif
+        const unsigned long t0 = micros();
+        CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+        CHECK(sched.getEventList().size() == 2);
+        CHECK(sched.getEventList().front() == "Relay1");
+        const unsigned long elapsedMs = (200 + 50 + ((len - 1) / 5) * 10);
+        CHECK(micros() - t0 == elapsedMs * 1000UL);
+#ifdef SCHEDULAR_STATS
+        const SchedularStats& st = sched.stats();
+        CHECK(st.phase(SchedularStats::PHASE_REQUEST).maxUs == 200000UL);
+        CHECK(st.phase(SchedularStats::PHASE_FIRST_BYTE).maxUs == 250000UL);
+        CHECK(st.phase(SchedularStats::PHASE_TOTAL).maxUs == elapsedMs * 1000UL);
+        CHECK(st.bytesReceived == len);
+#endif
+    }
+
+    // 12b. A stall shorter than the 1 s stream timeout is waited out.
+    {
+        mockHttpReset();
+        mockHttpPush(200, evts, MockHttpShape().stall(20, 900));
+        CHECK(sched.syncAt("2024-11-04T07:31:15Z"));
+        CHECK(sched.getEventList().size() == 2);
+    }
+
+    // 12c. A longer one is not: readBytes() gives up after the timeout, the
+    //      truncated 200 is demoted to a failure, and the list is left alone.
+    {
+        mockHttpReset();
+        mockHttpPush(200, "{\"items\":[{\"summary\":\"Lights\"}]}", MockHttpShape().latency(100).stall(12, 1500));
+        const unsigned long t0 = micros();
+        CHECK(!sched.syncAt("2024-11-04T07:32:15Z"));
+        CHECK(sched.hasFailed());
+        CHECK(micros() - t0 == (100 + 1000) * 1000UL);
+        CHECK(sched.getEventList().size() == 2);
+        CHECK(sched.getEventList().front() == "Relay1");
+    }
+
+    // 12d. Connection lost mid-body on the token refresh (POST path): ERROR,
+    //      not a half-read token. The next maintain() recovers.
+    {
+        ntp.set(2000 + 3600);   // access_token due for refresh
+        mockHttpReset();
+        mockHttpPush(200, "{\"access_token\":\"NEW_ACCESS_TOKEN\",\"expires_in\":3600}",
+                     MockHttpShape().segments(8, 30).drop(24));
+        sched.maintain();
+        CHECK(sched.hasFailed());
+        mockHttpReset();
+        mockHttpPush(200, "{\"access_token\":\"NEW_ACCESS_TOKEN\",\"expires_in\":3600}",
+                     MockHttpShape().segments(8, 30));
+        sched.maintain();
+        CHECK(sched.isAuthenticated());
+    }
+
+    // 12e. A slow reader: every read call costs the device 40 us. The body
+    //      arrived at once, so the transport's read buffer takes it in a
+    //      single call rather than one per byte.
+    {
+        mockHttpReset();
+        mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}", MockHttpShape().readCost(40));
+        const unsigned long t0 = micros();
+        sched.setCalendar(String("Cal"));
+        CHECK(sched.isLinked());
+        CHECK(micros() - t0 == 40UL);
+    }
+
+    // 12f. A run-wide profile: replies without their own shape use the default.
+    {
+        mockHttpReset();
+        mockHttpDefaultShape() = MockHttpShape().latency(300).segments(16, 5);
+        mockHttpPush(200, evts);
+        const unsigned long t0 = micros();
+        CHECK(sched.syncAt("2024-11-04T07:33:15Z"));
+        CHECK(micros() - t0 == (300 + ((len - 1) / 16) * 5) * 1000UL);
+        mockHttpReset();
+    }
+}
+
+
+// --- 13. shared transport -------------------------------------------------
+
+// Two accounts, each with its own calendar, borrow one SchedularTransport in
+// turn. Only the first connection to each host pays a full TLS handshake; the
+// others resume the session, whichever scheduler opens them. A transport that
+// is already lent out refuses the request instead of interleaving it.
+static void test_shared_transport() {
+    std::printf("shared transport (two accounts, one client pair)\n");
+
+    // 13a. Session per host, shared across instances.
+    {
+        FakeNtp ntp;
+        ntp.set(5000);
+        SchedularTransport transport;
+        TestSchedular alice(String("i"), String("s"), &ntp, transport);
+        TestSchedular bob(String("i"), String("s"), &ntp, transport);
+        alice.setRefreshToken(String("ALICE_REFRESH"));
+        bob.setRefreshToken(String("BOB_REFRESH"));
+
+        mockHttpReset();
+        mockHttpPush(200, "{\"access_token\":\"ALICE\",\"expires_in\":3600}");
+        mockHttpPush(200, "{\"access_token\":\"BOB\",\"expires_in\":3600}");
+        mockHttpPush(200, "{\"items\":[{\"id\":\"a@group\",\"summary\":\"Home\"}]}");
+        mockHttpPush(200, "{\"items\":[{\"id\":\"b@group\",\"summary\":\"Office\"}]}");
+        mockHttpPush(200, "{\"items\":[{\"summary\":\"Heating\"}]}");
+        mockHttpPush(200, "{\"items\":[{\"summary\":\"Standup\"}]}");
+        alice.maintain();
+        bob.maintain();
+        alice.setCalendar(String("Home"));
+        bob.setCalendar(String("Office"));
+        CHECK(alice.syncAt("2024-11-04T07:30:15Z"));
+        CHECK(bob.syncAt("2024-11-04T07:30:15Z"));
+
+        CHECK(alice.calendarIdRaw() == "a@group");
+        CHECK(bob.calendarIdRaw() == "b@group");
+        CHECK(alice.getEventList().front() == "Heating");
+        CHECK(bob.getEventList().front() == "Standup");
+        CHECK(mockTls().full == 2);        // one per host
+        CHECK(mockTls().resumed == 4);
+        CHECK(!transport.isBusy());
+    }
+
+    // 13b. Instances built without a transport borrow the shared one; while it
+    //      is lent out their requests fail without touching the network.
+    {
+        FakeNtp ntp;
+        TestSchedular sched(String("i"), String("s"), &ntp);
+        driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+        mockHttpReset();
+        mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+        sched.setCalendar(String("Cal"));
+        CHECK(sched.isLinked());
+
+        mockHttpReset();
+        mockHttpPush(200, "{\"items\":[{\"summary\":\"P1\"}]}");
+        CHECK(SchedularTransport::shared().acquire(SchedularTransport::HOST_API));
+        CHECK(!sched.syncAt("2024-11-04T07:30:15Z"));
+        CHECK(sched.hasFailed());
+        CHECK(mockHttpCursor() == 0);
+        CHECK(SchedularTransport::shared().isBusy());
+        SchedularTransport::shared().release();
+    }
+}
+
+
+// --- 14. TLS memory profile -----------------------------------------------
+
+// With a profile set, each host is probed once for a reduced maximum fragment
+// length. A host that accepts gets small buffers both ways; one that does not
+// keeps a full 16 KB receive buffer (it may send full records) with a small
+// transmit buffer. Without a profile the client is left at the core defaults.
+static void test_tls_profile() {
+    std::printf("TLS memory profile (MFLN probe, buffer sizes, fallback)\n");
+
+    FakeNtp ntp;
+    ntp.set(5000);
+    SchedularTransport transport;
+    TestSchedular sched(String("i"), String("s"), &ntp, transport);
+    sched.setRefreshToken(String("A_LONG_REFRESH_TOKEN"));
+
+    // 14a. Default profile: no probe, buffers untouched.
+    mockHttpReset();
+    mockHttpPush(200, "{\"access_token\":\"AT\",\"expires_in\":3600}");
+    sched.maintain();
+    CHECK(sched.isAuthenticated());
+    CHECK(mockTls().probes == 0);
+    CHECK(mockTls().receiveBuffer == 0);
+    CHECK(transport.tlsBuffers(SchedularTransport::HOST_OAUTH2).receive == 0);
+
+    // 14b. 512-byte profile, accepted by the OAuth host only.
+    transport.setTlsProfile(SchedularTransport::TLS_512);
+    mockHttpReset();
+    mockTlsMflnHosts().push_back("oauth2.googleapis.com");
+    mockHttpPush(200, "{\"access_token\":\"AT\",\"expires_in\":3600}");
+    ntp.set(5000 + 3600);
+    sched.maintain();
+    CHECK(sched.isAuthenticated());
+    CHECK(mockTls().probes == 1);
+    CHECK(mockTls().receiveBuffer == 512);
+    CHECK(mockTls().transmitBuffer == 512);
+    const SchedularTransport::TlsBuffers& oauth = transport.tlsBuffers(SchedularTransport::HOST_OAUTH2);
+    CHECK(oauth.reduced);
+    CHECK(oauth.receive == 512 && oauth.transmit == 512);
+
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.isLinked());
+    CHECK(mockTls().probes == 2);
+    CHECK(mockTls().receiveBuffer == 16384);
+    CHECK(mockTls().transmitBuffer == 512);
+    const SchedularTransport::TlsBuffers& api = transport.tlsBuffers(SchedularTransport::HOST_API);
+    CHECK(!api.reduced);
+    CHECK(api.receive == 16384 && api.transmit == 512);
+
+    // 14c. Probed once per host: later requests reuse the result.
+    mockHttpPush(200, "{\"items\":[{\"summary\":\"P1\"}]}");
+    CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(mockTls().probes == 2);
+    CHECK(mockTls().receiveBuffer == 16384);
+
+    // 14d. A probe that says no while the host is out of reach is not kept:
+    //      the request fails too, and the next one probes again.
+    transport.setTlsProfile(SchedularTransport::TLS_1K);
+    mockHttpPush(-1, "");
+    CHECK(!sched.syncAt("2024-11-04T07:31:15Z"));
+    CHECK(mockTls().probes == 3);
+    CHECK(api.receive == 0);
+    mockHttpReset();
+    mockHttpPush(200, "{\"access_token\":\"AT\",\"expires_in\":3600}");
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    mockHttpPush(200, "{\"items\":[{\"summary\":\"P1\"}]}");
+    sched.maintain();                                   // OAuth host probed, accepts
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.isLinked());
+    CHECK(mockTls().probes == 2);                       // since the reset: both hosts again
+    CHECK(!api.reduced && api.receive == 16384 && api.transmit == 1024);
+    CHECK(sched.syncAt("2024-11-04T07:32:15Z"));
+    CHECK(mockTls().probes == 2);                       // kept since
+}
+
+// --- 15. DeadlineSchedular -----------------------------------------------
+
+// Three calendars of one account: "Door" every minute at top priority, "Heat"
+// every 5 min, "Light" every 10 min. The responder answers by path, and the
+// recorded URIs show which calendars each tick synced, in order.
+static bool g_deadlineOutage = false;
+
+static MockHttpReply deadlineResponder(const char* path) {
+    if (std::strcmp(path, "/token") == 0) {
+        return MockHttpReply{200, "{\"access_token\":\"AT\",\"expires_in\":3600}"};
+    }
+    if (std::strstr(path, "calendarList")) {
+        return MockHttpReply{200, "{\"items\":[{\"id\":\"door\",\"summary\":\"Door\"},"
+                                  "{\"id\":\"heat\",\"summary\":\"Heat\"},"
+                                  "{\"id\":\"light\",\"summary\":\"Light\"}]}"};
+    }
+    if (g_deadlineOutage) {
+        return MockHttpReply{503, "{}"};
+    }
+    if (std::strstr(path, "/door/")) return MockHttpReply{200, "{\"items\":[{\"summary\":\"Unlock\"}]}"};
+    if (std::strstr(path, "/heat/")) return MockHttpReply{200, "{\"items\":[{\"summary\":\"Heating\"}]}"};
+    return MockHttpReply{200, "{\"items\":[]}"};
+}
+
+// Calendar ids of the event requests recorded since the last reset.
+static std::string syncedIds() {
+    std::string ids;
+    for (const std::string& uri : mockHttpUris()) {
+        const size_t at = uri.find("/calendars/");
+        if (at != std::string::npos) {
+            ids += ids.empty() ? "" : ",";
+            ids += uri.substr(at + 11, uri.find('/', at + 11) - at - 11);
+        }
+    }
+    return ids;
+}
+
+static void test_deadline_schedular() {
+    std::printf("DeadlineSchedular (per-calendar deadlines, priorities, tick budget)\n");
+
+    FakeNtp ntp;
+    ntp.set(1000);
+    mockHttpReset();
+    mockHttpResponder() = deadlineResponder;
+    DeadlineSchedular sched(String("i"), String("s"), &ntp);
+    sched.setRefreshToken(String("A_LONG_REFRESH_TOKEN"));
+    const int8_t light = sched.addCalendar(String("Light"), 600);
+    const int8_t door  = sched.addCalendar(String("Door"), 60, 2);
+    const int8_t heat  = sched.addCalendar(String("Heat"), 300, 1);
+    CHECK(light == 0 && door == 1 && heat == 2);
+
+    // 15a. First tick: token, one calendar list, then all three by priority.
+    sched.maintain("2024-11-04T07:30:15Z");
+    CHECK(sched.isAuthenticated());
+    CHECK(sched.lastTickSyncs() == 3);
+    CHECK(mockHttpUris().size() == 5);
+    CHECK(syncedIds() == "door,heat,light");
+    CHECK(sched.isResolved(door) && sched.isResolved(light));
+    CHECK(sched.isFresh(door) && sched.isFresh(light));
+    CHECK(sched.getEventList(door).size() == 1);
+    CHECK(sched.getEventList(door).front() == "Unlock");
+    CHECK(sched.getEventList(light).empty());
+    CHECK(sched.nextDue() == 1060);
+
+    // 15b. Nothing due: no request. Then only the door.
+    mockHttpUris().clear();
+    ntp.set(1030);
+    sched.maintain("2024-11-04T07:30:45Z");
+    CHECK(sched.lastTickSyncs() == 0);
+    CHECK(mockHttpUris().empty());
+    ntp.set(1060);
+    sched.maintain("2024-11-04T07:31:15Z");
+    CHECK(syncedIds() == "door");
+    CHECK(sched.nextDue() == 1120);
+
+    // 15c. Tick budget: each reply takes 100 ms. Once the costs are known, a
+    // 250 ms tick fits two syncs; the least urgent waits for the next tick.
+    mockHttpDefaultShape().latency(100);
+    ntp.set(1700);
+    sched.maintain("2024-11-04T07:41:55Z");          // learns the costs
+    CHECK(sched.lastTickSyncs() == 3);
+    sched.setTickBudget(250);
+    mockHttpUris().clear();
+    ntp.set(2300);
+    sched.maintain("2024-11-04T07:51:55Z");
+    CHECK(syncedIds() == "door,heat");
+    CHECK(!sched.isFresh(light));
+    mockHttpUris().clear();
+    ntp.set(2301);
+    sched.maintain("2024-11-04T07:51:56Z");
+    CHECK(syncedIds() == "light");
+    CHECK(sched.isFresh(light));
+
+    // 15d. A failed sync ends the tick in ERROR; maintain() recovers the token
+    // and the calendar is retried after a quarter of its period.
+    g_deadlineOutage = true;
+    mockHttpUris().clear();
+    ntp.set(2360);
+    sched.maintain("2024-11-04T07:52:55Z");
+    CHECK(sched.hasFailed());
+    CHECK(!sched.isFresh(door));
+    CHECK(sched.getEventList(door).front() == "Unlock");   // previous list kept
+    g_deadlineOutage = false;
+    ntp.set(2370);
+    sched.maintain("2024-11-04T07:53:05Z");
+    CHECK(sched.isAuthenticated());
+    CHECK(sched.lastTickSyncs() == 0);
+    ntp.set(2375);
+    sched.maintain("2024-11-04T07:53:10Z");
+    CHECK(sched.lastTickSyncs() == 1);
+    CHECK(sched.isFresh(door));
+
+    // 15e. Names the account does not have: one list per tick for all of
+    //      them, then looked for again after 2, 4, ... periods only.
+    {
+        mockHttpDefaultShape() = MockHttpShape();
+        ntp.set(5000);
+        DeadlineSchedular missing(String("i"), String("s"), &ntp);
+        missing.setRefreshToken(String("A_LONG_REFRESH_TOKEN"));
+        const int8_t garage = missing.addCalendar(String("Garage"), 60);
+        const int8_t shed = missing.addCalendar(String("Shed"), 60);
+        const int8_t lock = missing.addCalendar(String("Door"), 60);
+        const auto lists = []() {
+            size_t n = 0;
+            for (const std::string& uri : mockHttpUris()) n += uri.find("calendarList") != std::string::npos;
+            return n;
+        };
+        mockHttpUris().clear();
+        missing.maintain("2024-11-04T08:53:20Z");
+        CHECK(lists() == 1);
+        CHECK(syncedIds() == "door");
+        CHECK(missing.isMissing(garage) && missing.isMissing(shed) && !missing.isMissing(lock));
+        CHECK(!missing.isFresh(garage) && !missing.hasFailed());
+
+        mockHttpUris().clear();
+        ntp.set(5060);
+        missing.maintain("2024-11-04T08:54:20Z");
+        CHECK(lists() == 0 && syncedIds() == "door");
+        mockHttpUris().clear();
+        ntp.set(5120);
+        missing.maintain("2024-11-04T08:55:20Z");
+        CHECK(lists() == 1);                                // 2 periods on
+        CHECK(missing.lastTickSyncs() == 3);
+        mockHttpUris().clear();
+        ntp.set(5240);
+        missing.maintain("2024-11-04T08:57:20Z");
+        CHECK(lists() == 0);                                // now 4 periods
+        mockHttpUris().clear();
+        ntp.set(5360);
+        missing.maintain("2024-11-04T08:59:20Z");
+        CHECK(lists() == 1);
+    }
+
+    // 15f. Capacity.
+    DeadlineSchedular full(String("i"), String("s"), &ntp);
+    for (uint8_t i = 0; i < SCHEDULAR_MAX_CALENDARS; ++i) {
+        CHECK(full.addCalendar(String("C"), 60) == static_cast<int8_t>(i));
+    }
+    CHECK(full.addCalendar(String("C"), 60) == DeadlineSchedular::FULL);
+
+    mockHttpResponder() = nullptr;
+    mockHttpReset();
+}
+
+// --- 16. ChannelMatcher --------------------------------------------------
+
+static void test_channel_matcher() {
+    std::printf("ChannelMatcher (trie, case/prefix options, syncAt channel mask)\n");
+
+    // 16a. Exact and prefix names, shared prefixes, aliases.
+    ChannelMatcher m;
+    CHECK(m.add(0, "Relay1"));
+    CHECK(m.add(1, "Relay2"));
+    CHECK(m.add(2, "Heating", ChannelMatcher::PREFIX));
+    CHECK(m.add(3, "Porch"));
+    CHECK(m.add(3, "Front door"));                  // alias
+    CHECK(m.add(31, "Relay", ChannelMatcher::PREFIX));
+    CHECK(m.nodes() == 1 + 6 + 1 + 7 + 5 + 10);      // "Relay" shared by three names
+    CHECK(m.match("Relay1") == ((1UL << 0) | (1UL << 31)));
+    CHECK(m.match("Relay2") == ((1UL << 1) | (1UL << 31)));
+    CHECK(m.match("Relay12") == (1UL << 31));
+    CHECK(m.match("Rela") == 0);
+    CHECK(m.match("Heating") == (1UL << 2));
+    CHECK(m.match("Heating (eco)") == (1UL << 2));
+    CHECK(m.match("heating") == 0);
+    CHECK(m.match("Front door") == (1UL << 3));
+    CHECK(m.match("Porch light") == 0);
+    CHECK(m.match("") == 0);
+
+    // 16b. Case-insensitive matcher.
+    ChannelMatcher ci(ChannelMatcher::IGNORE_CASE);
+    CHECK(ci.add(4, "Heating"));
+    CHECK(ci.add(5, "LIGHTS", ChannelMatcher::PREFIX));
+    CHECK(ci.match("HEATING") == (1UL << 4));
+    CHECK(ci.match("heating") == (1UL << 4));
+    CHECK(ci.match("lights living room") == (1UL << 5));
+
+    // 16c. Out of range / full table: rejected, matcher unchanged.
+    CHECK(!m.add(32, "X"));
+    ChannelMatcher tiny;
+    char longName[SCHEDULAR_MATCHER_NODES + 1];
+    std::memset(longName, 'a', sizeof(longName) - 1);
+    longName[sizeof(longName) - 1] = '\0';
+    CHECK(!tiny.add(0, longName));
+    CHECK(tiny.nodes() == 1);
+    longName[SCHEDULAR_MATCHER_NODES - 1] = '\0';
+    CHECK(tiny.add(0, longName));
+    CHECK(tiny.nodes() == SCHEDULAR_MATCHER_NODES);
+    CHECK(!tiny.add(1, "b"));
+    CHECK(tiny.add(1, "aaa", ChannelMatcher::PREFIX));   // no new node needed
+
+    // 16d. syncAt() with channels: a mask, no event list, no String per event.
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp);
+    driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.isLinked());
+    mockHttpPush(200, "{\"items\":[{\"summary\":\"Heating\"}]}");
+    CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(sched.getEventList().size() == 1);
+
+    sched.setChannels(&m);
+    CHECK(sched.getEventList().empty());
+    const char* events = "{\"items\":[{\"summary\":\"Heating (eco)\"},{\"summary\":\"Relay2\"},"
+                         "{\"summary\":\"Dentist\"},{\"summary\":\"Porch\"}]}";
+    mockHttpRecordUris() = false;
+    scriptReply(200, events);
+    CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(sched.getActiveChannels() == ((1UL << 1) | (1UL << 2) | (1UL << 3) | (1UL << 31)));
+    CHECK(sched.getEventList().empty());
+
+    // The Strings left are the request's own (URI, Authorization, and what
+    // HTTPClient's String interface makes of them); the event count no longer
+    // shows in them.
+    scriptReply(200, events);
+    const Usage masked = measureUsage([&]() { sched.syncAt("2024-11-04T07:30:15Z"); });
+    CHECK_BUDGET("syncAt (4 events, channel mask)", masked, 40, 5 + GZIP_STRINGS, 0);
+    scriptReply(200, "{\"items\":[{\"summary\":\"A\"},{\"summary\":\"B\"},{\"summary\":\"C\"},"
+                     "{\"summary\":\"D\"},{\"summary\":\"E\"},{\"summary\":\"F\"},"
+                     "{\"summary\":\"G\"},{\"summary\":\"H\"}]}");
+    const Usage eight = measureUsage([&]() { sched.syncAt("2024-11-04T07:30:15Z"); });
+    CHECK(sched.getActiveChannels() == 0);
+    CHECK(eight.strings == masked.strings);        // nothing per event
+
+    // A failed sync keeps the previous mask.
+    scriptReply(200, events);
+    sched.syncAt("2024-11-04T07:30:15Z");
+    scriptReply(503, "{}");
+    CHECK(!sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(sched.getActiveChannels() != 0);
+    mockHttpRecordUris() = true;
+
+    sched.setChannels(nullptr);
+    CHECK(sched.getActiveChannels() == 0);
+}
+
+// --- 17. Recurrence ------------------------------------------------------
+
+static int32_t civilDay(int32_t y, uint8_t m, uint8_t d) { return CivilTime::daysFromCivil(y, m, d); }
+
+// Unix time of local `hh:mm` on day (y, m, d) at UTC offset `offset`.
+static int32_t localTime(int32_t y, uint8_t m, uint8_t d, int32_t hh, int32_t mm, int32_t offset) {
+    return civilDay(y, m, d) * 86400 + hh * 3600 + mm * 60 - offset;
+}
+
+// A week of stand-ups (Paris, +01:00): Wednesday's moved to 11:00, Thursday's
+// cancelled, plus an all-day holiday on the Friday.
+static const char* RECURRING_WEEK =
+    "{\"items\":["
+    "{\"id\":\"m1\",\"summary\":\"Standup\","
+     "\"start\":{\"dateTime\":\"2024-11-04T09:00:00+01:00\"},\"end\":{\"dateTime\":\"2024-11-04T09:15:00+01:00\"},"
+     "\"recurrence\":[\"RRULE:FREQ=WEEKLY;BYDAY=MO,TU,WE,TH,FR\"]},"
+    "{\"id\":\"m1_20241106T080000Z\",\"summary\":\"Standup (moved)\",\"recurringEventId\":\"m1\","
+     "\"originalStartTime\":{\"dateTime\":\"2024-11-06T09:00:00+01:00\"},"
+     "\"start\":{\"dateTime\":\"2024-11-06T11:00:00+01:00\"},\"end\":{\"dateTime\":\"2024-11-06T11:15:00+01:00\"}},"
+    "{\"id\":\"m1_20241107T080000Z\",\"status\":\"cancelled\",\"recurringEventId\":\"m1\","
+     "\"originalStartTime\":{\"dateTime\":\"2024-11-07T09:00:00+01:00\"}},"
+    "{\"id\":\"h\",\"summary\":\"Holiday\",\"start\":{\"date\":\"2024-11-08\"},\"end\":{\"date\":\"2024-11-09\"}}"
+    "]}";
+
+static std::string activeAt(const RecurrenceStore& store, const char* ts) {
+    int32_t utc, offset;
+    bool allDay;
+    CivilTime::parseRfc3339(ts, utc, offset, allDay);
+    std::string titles;
+    store.forEachActive(utc, [&titles](const String& title) {
+        titles += titles.empty() ? "" : ",";
+        titles += title.c_str();
+    });
+    return titles;
+}
+
+static void test_recurrence() {
+    std::printf("Recurrence (RRULE subset, exceptions, syncAt local expansion)\n");
+
+    // 17a. Calendar arithmetic and the date-time forms.
+    CHECK(civilDay(1970, 1, 1) == 0);
+    CHECK(civilDay(2024, 3, 1) - civilDay(2024, 2, 28) == 2);
+    CHECK(CivilTime::weekday(civilDay(2024, 11, 4)) == 0);           // Monday
+    CHECK(CivilTime::weekday(-1) == 2);                              // 1969-12-31, Wednesday
+    CHECK(CivilTime::floorDiv(-1, 86400) == -1);
+    int32_t utc, offset;
+    bool allDay;
+    CHECK(CivilTime::parseRfc3339("2024-11-04T09:00:00+01:00", utc, offset, allDay));
+    CHECK(utc == localTime(2024, 11, 4, 8, 0, 0) && offset == 3600 && !allDay);
+    CHECK(CivilTime::parseRfc3339("2024-11-04T09:00:00.250-05:30", utc, offset, allDay));
+    CHECK(utc == localTime(2024, 11, 4, 9, 0, -19800) && offset == -19800);
+    CHECK(CivilTime::parseRfc3339("2024-11-08", utc, offset, allDay));
+    CHECK(allDay && utc == civilDay(2024, 11, 8) * 86400);
+    CHECK(!CivilTime::parseRfc3339("2024-11-04T09:00:00", utc, offset, allDay));   // no offset
+    CHECK(!CivilTime::parseRfc3339("2024-13-04", utc, offset, allDay));
+    char formatted[21];
+    CivilTime::formatRfc3339(localTime(2024, 2, 29, 23, 59, 0) + 59, formatted);
+    CHECK_STR(formatted, "2024-02-29T23:59:59Z");
+
+    // 17b. DAILY with INTERVAL and COUNT, EXDATE, overnight instances.
+    const int32_t paris = 3600;
+    RecurrenceRule daily;
+    daily.begin(localTime(2024, 11, 4, 9, 0, paris), paris, 1800);
+    CHECK(daily.parse("RRULE:FREQ=DAILY;INTERVAL=2;COUNT=3"));
+    CHECK(daily.occursOn(civilDay(2024, 11, 4)) && daily.occursOn(civilDay(2024, 11, 8)));
+    CHECK(!daily.occursOn(civilDay(2024, 11, 5)) && !daily.occursOn(civilDay(2024, 11, 10)));
+    CHECK(!daily.occursOn(civilDay(2024, 11, 2)));
+    CHECK(daily.parseExdate("EXDATE;TZID=Europe/Paris:20241106T090000"));
+    CHECK(!daily.occursOn(civilDay(2024, 11, 6)));
+    CHECK(daily.lastDay == civilDay(2024, 11, 8));                   // an EXDATE still counts
+    CHECK(daily.isActiveAt(localTime(2024, 11, 8, 9, 29, paris)));
+    CHECK(!daily.isActiveAt(localTime(2024, 11, 8, 9, 30, paris)));
+    CHECK(!daily.isActiveAt(localTime(2024, 11, 6, 9, 10, paris)));
+
+    RecurrenceRule night;
+    night.begin(localTime(2024, 11, 4, 23, 0, paris), paris, 7200);
+    CHECK(night.parse("RRULE:FREQ=DAILY"));
+    CHECK(night.isActiveAt(localTime(2024, 11, 6, 0, 30, paris)));   // Tuesday's, past midnight
+    CHECK(!night.isActiveAt(localTime(2024, 11, 4, 0, 30, paris)));  // before the first
+
+    // 17c. WEEKLY: INTERVAL and BYDAY, UNTIL inclusive of the instance's start.
+    RecurrenceRule weekly;
+    weekly.begin(localTime(2024, 11, 4, 9, 0, paris), paris, 900);
+    CHECK(weekly.parse("RRULE:FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,WE;UNTIL=20241120T080000Z"));
+    CHECK(weekly.occursOn(civilDay(2024, 11, 4)) && weekly.occursOn(civilDay(2024, 11, 6)));
+    CHECK(!weekly.occursOn(civilDay(2024, 11, 11)) && !weekly.occursOn(civilDay(2024, 11, 13)));
+    CHECK(weekly.occursOn(civilDay(2024, 11, 18)) && weekly.occursOn(civilDay(2024, 11, 20)));
+    CHECK(!weekly.occursOn(civilDay(2024, 12, 2)));
+    CHECK(weekly.parse("RRULE:FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,WE;UNTIL=20241120T075959Z"));
+    CHECK(!weekly.occursOn(civilDay(2024, 11, 20)));
+    RecurrenceRule plain;
+    plain.begin(localTime(2024, 11, 5, 9, 0, paris), paris, 900);
+    CHECK(plain.parse("RRULE:FREQ=WEEKLY"));                         // the start's weekday
+    CHECK(plain.occursOn(civilDay(2024, 11, 12)) && !plain.occursOn(civilDay(2024, 11, 11)));
+
+    // 17d. MONTHLY: last Friday, first Monday, by day of month (none in February).
+    RecurrenceRule lastFriday;
+    lastFriday.begin(localTime(2024, 11, 29, 17, 0, paris), paris, 3600);
+    CHECK(lastFriday.parse("RRULE:FREQ=MONTHLY;BYDAY=-1FR"));
+    CHECK(lastFriday.occursOn(civilDay(2024, 12, 27)) && !lastFriday.occursOn(civilDay(2024, 12, 20)));
+    CHECK(lastFriday.occursOn(civilDay(2025, 1, 31)));
+    RecurrenceRule firstMonday;
+    firstMonday.begin(localTime(2024, 11, 4, 8, 0, paris), paris, 3600);
+    CHECK(firstMonday.parse("RRULE:FREQ=MONTHLY;INTERVAL=3;BYDAY=1MO"));
+    CHECK(firstMonday.occursOn(civilDay(2025, 2, 3)) && !firstMonday.occursOn(civilDay(2024, 12, 2)));
+    RecurrenceRule thirtyFirst;
+    thirtyFirst.begin(localTime(2024, 1, 31, 8, 0, 0), 0, 3600);
+    CHECK(thirtyFirst.parse("RRULE:FREQ=MONTHLY"));
+    CHECK(!thirtyFirst.occursOn(civilDay(2024, 2, 29)) && thirtyFirst.occursOn(civilDay(2024, 3, 31)));
+    RecurrenceRule fridayThe13th;
+    fridayThe13th.begin(localTime(2024, 9, 13, 8, 0, paris), paris, 3600);
+    CHECK(fridayThe13th.parse("RRULE:FREQ=MONTHLY;BYDAY=FR;BYMONTHDAY=13"));   // both must match
+    CHECK(fridayThe13th.occursOn(civilDay(2024, 12, 13)));
+    CHECK(!fridayThe13th.occursOn(civilDay(2024, 11, 13)));          // a Wednesday
+    CHECK(!fridayThe13th.occursOn(civilDay(2024, 11, 1)) && !fridayThe13th.occursOn(civilDay(2024, 10, 13)));
+
+    // DAILY narrowed by BYDAY and BYMONTHDAY.
+    RecurrenceRule workdays;
+    workdays.begin(localTime(2024, 11, 4, 7, 0, paris), paris, 3600);
+    CHECK(workdays.parse("RRULE:FREQ=DAILY;BYDAY=MO,TU,WE,TH,FR"));
+    CHECK(workdays.occursOn(civilDay(2024, 11, 8)) && workdays.occursOn(civilDay(2024, 11, 11)));
+    CHECK(!workdays.occursOn(civilDay(2024, 11, 9)) && !workdays.occursOn(civilDay(2024, 11, 10)));
+    CHECK(!workdays.isActiveAt(localTime(2024, 11, 9, 7, 30, paris)));
+    CHECK(workdays.parse("RRULE:FREQ=DAILY;BYDAY=MO,TU,WE,TH,FR;COUNT=6"));
+    CHECK(workdays.lastDay == civilDay(2024, 11, 11));               // weekend not counted
+    RecurrenceRule payday;
+    payday.begin(localTime(2024, 11, 4, 9, 0, paris), paris, 3600);
+    CHECK(payday.parse("RRULE:FREQ=DAILY;BYMONTHDAY=15"));
+    CHECK(payday.occursOn(civilDay(2024, 11, 15)) && payday.occursOn(civilDay(2024, 12, 15)));
+    CHECK(!payday.occursOn(civilDay(2024, 11, 14)) && !payday.occursOn(civilDay(2024, 11, 16)));
+
+    // 17e. Outside the subset: refused, left to the server.
+    RecurrenceRule other;
+    CHECK(!other.parse("RRULE:FREQ=YEARLY"));
+    CHECK(!other.parse("RRULE:FREQ=MONTHLY;BYMONTH=3"));
+    CHECK(!other.parse("RRULE:FREQ=MONTHLY;BYDAY=1MO,2TU"));
+    CHECK(!other.parse("RRULE:INTERVAL=2"));
+    CHECK(!other.parse("RRULE:FREQ=WEEKLY;BYMONTHDAY=13"));          // not allowed by RFC 5545
+    CHECK(!other.parse("RRULE:FREQ=WEEKLY;BYDAY=1MO"));              // ordinals: MONTHLY only
+    CHECK(!other.parse("RRULE:BYDAY=-1FR;FREQ=DAILY"));
+
+    // 17f. A store from a singleEvents=false reply: the moved instance is a
+    // one-off, the cancelled one is gone, the all-day event uses the offset.
+    JsonDocument doc;
+    deserializeJson(doc, RECURRING_WEEK);
+    RecurrenceStore store;
+    store.setAllDayOffset(paris);
+    CHECK(store.load(doc[F("items")].as<JsonArray>(), 1000));
+    CHECK(store.isUsable() && store.size() == 3);
+    CHECK(activeAt(store, "2024-11-04T08:05:00Z") == "Standup");
+    CHECK(activeAt(store, "2024-11-06T08:05:00Z") == "");
+    CHECK(activeAt(store, "2024-11-06T10:05:00Z") == "Standup (moved)");
+    CHECK(activeAt(store, "2024-11-07T08:05:00Z") == "");
+    CHECK(activeAt(store, "2024-11-08T08:05:00Z") == "Standup,Holiday");
+    CHECK(activeAt(store, "2024-11-08T23:30:00Z") == "");            // 00:30 Saturday in Paris
+    CHECK(!store.isStale(1000 + 86399) && store.isStale(1000 + 86400));
+
+    // Across daylight saving: a series started in winter keeps 09:00
+    // local in summer only once the store is given the summer offset.
+    JsonDocument dst;
+    deserializeJson(dst, "{\"items\":[{\"id\":\"w\",\"summary\":\"Weekly\","
+                         "\"start\":{\"dateTime\":\"2026-01-05T09:00:00+01:00\"},"
+                         "\"end\":{\"dateTime\":\"2026-01-05T10:00:00+01:00\"},"
+                         "\"recurrence\":[\"RRULE:FREQ=WEEKLY\"]}]}");
+    RecurrenceStore seasons;
+    CHECK(seasons.load(dst[F("items")].as<JsonArray>(), 1000));
+    CHECK(activeAt(seasons, "2026-07-06T07:30:00Z") == "");          // 09:30 in Paris: missed
+    CHECK(activeAt(seasons, "2026-07-06T08:30:00Z") == "Weekly");    // an hour late
+    seasons.setLocalOffset(2 * paris);                               // summer time, loaded rule too
+    CHECK(activeAt(seasons, "2026-07-06T06:59:00Z") == "");
+    CHECK(activeAt(seasons, "2026-07-06T07:30:00Z") == "Weekly");
+    CHECK(activeAt(seasons, "2026-07-06T08:00:00Z") == "");
+    CHECK(seasons.load(dst[F("items")].as<JsonArray>(), 2000));       // kept across loads
+    CHECK(activeAt(seasons, "2026-07-13T07:30:00Z") == "Weekly");
+    seasons.setLocalOffset(paris);                                   // back in winter
+    CHECK(activeAt(seasons, "2026-11-02T08:30:00Z") == "Weekly");
+    CHECK(activeAt(seasons, "2026-11-02T07:30:00Z") == "");
+
+    // 17g. syncAt() with a store: one request per refresh period, instances
+    // expanded locally in between, to the event list or the channel mask.
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp);
+    driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    sched.setCalendar(String("Cal"));
+    RecurrenceStore local(86400);
+    local.setAllDayOffset(paris);
+    sched.setRecurrences(&local);
+
+    mockHttpUris().clear();
+    mockHttpPush(200, RECURRING_WEEK);
+    CHECK(sched.syncAt("2024-11-04T08:05:00Z"));
+    CHECK(mockHttpUris().size() == 1);
+    CHECK(mockHttpUris().front().find("singleEvents=false") != std::string::npos);
+    CHECK(mockHttpUris().front().find("timeMin=2024-11-04T08:05:00Z&timeMax=2024-11-05T08:05:00Z") != std::string::npos);
+    CHECK(sched.getEventList().size() == 1 && sched.getEventList().front() == "Standup");
+    CHECK(sched.syncAt("2024-11-04T12:00:00Z"));
+    CHECK(sched.getEventList().empty());
+    CHECK(sched.syncAt("2024-11-05T08:04:59Z"));
+    CHECK(sched.getEventList().size() == 1);
+    CHECK(mockHttpUris().size() == 1);                               // no request since
+#ifdef SCHEDULAR_STATS
+    CHECK(sched.stats().cacheHits == 3);
+#endif
+
+    ChannelMatcher channels;
+    channels.add(0, "Standup", ChannelMatcher::PREFIX);
+    channels.add(1, "Holiday");
+    sched.setChannels(&channels);
+    CHECK(sched.syncAt("2024-11-04T08:10:00Z"));
+    CHECK(sched.getActiveChannels() == 1);
+    sched.setChannels(nullptr);
+
+    // A refresh that fails leaves the store stale and the scheduler in ERROR.
+    mockHttpPush(503, "{}");
+    CHECK(!sched.syncAt("2024-11-05T08:05:00Z"));
+    CHECK(sched.hasFailed());
+    CHECK(mockHttpUris().size() == 2);
+
+    // 17h. A rule outside the subset: the period falls back to server expansion.
+    TestSchedular fallback(String("i"), String("s"), &ntp);
+    driveToAuthenticated(fallback, ntp, /*now=*/2000, /*expiresIn=*/3600);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    fallback.setCalendar(String("Cal"));
+    RecurrenceStore refused;
+    fallback.setRecurrences(&refused);
+    mockHttpUris().clear();
+    mockHttpPush(200, "{\"items\":[{\"id\":\"y\",\"summary\":\"Birthday\","
+                      "\"start\":{\"date\":\"2024-11-04\"},\"end\":{\"date\":\"2024-11-05\"},"
+                      "\"recurrence\":[\"RRULE:FREQ=YEARLY\"]}]}");
+    mockHttpPush(200, "{\"items\":[{\"summary\":\"Birthday\"}]}");
+    CHECK(fallback.syncAt("2024-11-04T08:05:00Z"));
+    CHECK(!refused.isUsable());
+    CHECK(fallback.getEventList().size() == 1 && fallback.getEventList().front() == "Birthday");
+    CHECK(mockHttpUris().size() == 2);
+    CHECK(mockHttpUris().back().find("singleEvents=true") != std::string::npos);
+    mockHttpPush(200, "{\"items\":[]}");
+    CHECK(fallback.syncAt("2024-11-04T09:05:00Z"));
+    CHECK(mockHttpUris().size() == 3);                               // server only until the refresh
+    CHECK(fallback.getEventList().empty());
+    mockHttpReset();
+}
+
+// --- 18. gzip ------------------------------------------------------------
+
+// gzip members made with zlib (python: zlib.compressobj(level, DEFLATED, 31)).
+// GZ_CALENDARS: calendarListOf(12), level 9 (dynamic Huffman block).
+// GZ_FIXED / GZ_STORED: GZIP_SMALL, with Z_FIXED / level 0.
+// GZ_FAR: GZIP_FAR, whose tail refers back ~400 bytes.
+static const uint8_t GZ_CALENDARS[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x95, 0xd2, 0xbd, 0x0a, 0x83, 0x30,
+    0x14, 0x86, 0xe1, 0x5b, 0x91, 0x33, 0x4b, 0x30, 0xfe, 0xeb, 0x54, 0xe8, 0x65, 0x94, 0x0e, 0x41,
+    0x43, 0x10, 0x4c, 0x23, 0x89, 0x0e, 0x45, 0x72, 0xef, 0x75, 0x10, 0xec, 0x71, 0xfb, 0xb6, 0x03,
+    0xe7, 0x7b, 0xb6, 0x77, 0xa7, 0x69, 0xd5, 0x36, 0x50, 0xff, 0xda, 0x69, 0x1a, 0xa9, 0xa7, 0x41,
+    0xcd, 0xd9, 0xc3, 0x78, 0xb7, 0x2d, 0xe2, 0x38, 0xf5, 0x67, 0x54, 0x5e, 0x18, 0xe7, 0xcc, 0xac,
+    0xc5, 0xe0, 0x2c, 0xa5, 0x14, 0x36, 0x6b, 0x95, 0xff, 0x1e, 0xd3, 0xe7, 0xf9, 0x4f, 0x32, 0x8a,
+    0xe9, 0xc5, 0x25, 0xca, 0x25, 0xe3, 0x39, 0xca, 0x73, 0xc6, 0x0b, 0x94, 0x17, 0x8c, 0x97, 0x28,
+    0x2f, 0x19, 0xaf, 0x50, 0x5e, 0x31, 0x5e, 0xa3, 0xbc, 0x66, 0xbc, 0x41, 0x79, 0xc3, 0x78, 0x8b,
+    0xf2, 0x96, 0xf1, 0x0e, 0xe5, 0x1d, 0xcf, 0x06, 0xce, 0x4e, 0xde, 0xba, 0xc3, 0xc3, 0xfb, 0x2f,
+    0xef, 0x3e, 0xa1, 0xf8, 0x8e, 0x3f, 0x68, 0x73, 0xd7, 0x74, 0x1e, 0x03, 0x00, 0x00,
+};
+static const uint8_t GZ_FIXED[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xab, 0x56, 0xca, 0x2c, 0x49, 0xcd,
+    0x2d, 0x56, 0xb2, 0x8a, 0xae, 0x56, 0x2a, 0x2e, 0xcd, 0xcd, 0x4d, 0x2c, 0xaa, 0x54, 0xb2, 0x52,
+    0xf2, 0x48, 0x4d, 0x2c, 0xc9, 0xcc, 0x4b, 0x57, 0xaa, 0x8d, 0xad, 0x05, 0x00, 0xe1, 0x84, 0xf8,
+    0x55, 0x21, 0x00, 0x00, 0x00,
+};
+static const uint8_t GZ_STORED[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x03, 0x01, 0x21, 0x00, 0xde, 0xff, 0x7b,
+    0x22, 0x69, 0x74, 0x65, 0x6d, 0x73, 0x22, 0x3a, 0x5b, 0x7b, 0x22, 0x73, 0x75, 0x6d, 0x6d, 0x61,
+    0x72, 0x79, 0x22, 0x3a, 0x22, 0x48, 0x65, 0x61, 0x74, 0x69, 0x6e, 0x67, 0x22, 0x7d, 0x5d, 0x7d,
+    0xe1, 0x84, 0xf8, 0x55, 0x21, 0x00, 0x00, 0x00,
+};
+static const uint8_t GZ_FAR[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x35, 0xd0, 0x2b, 0x0e, 0x02, 0x41,
+    0x14, 0x44, 0xd1, 0xbd, 0x3c, 0xdd, 0x24, 0x5d, 0x55, 0xfc, 0x66, 0xb6, 0x42, 0xc6, 0x81, 0x18,
+    0x81, 0x02, 0x41, 0x42, 0xd8, 0x3b, 0xa2, 0xfb, 0xaa, 0xba, 0xea, 0x88, 0xfa, 0xd6, 0xfe, 0x7e,
+    0x3c, 0x5f, 0xb5, 0xde, 0x6a, 0xbf, 0x1f, 0x7a, 0xef, 0xd5, 0x46, 0x88, 0x30, 0x11, 0xe2, 0x48,
+    0x9c, 0x88, 0x33, 0x71, 0x21, 0xae, 0xc4, 0x32, 0x43, 0xc8, 0x42, 0x16, 0xb2, 0x90, 0x85, 0x2c,
+    0x64, 0x21, 0x0b, 0x59, 0xc8, 0x42, 0x36, 0xb2, 0x91, 0x8d, 0x6c, 0x64, 0x23, 0x1b, 0xd9, 0xc8,
+    0x46, 0x36, 0xb2, 0x91, 0x83, 0x1c, 0xe4, 0x20, 0x07, 0x39, 0xc8, 0x41, 0x0e, 0x72, 0x90, 0x83,
+    0x9c, 0xa5, 0xb6, 0x56, 0x9f, 0x5a, 0xe7, 0xd9, 0x6d, 0x5c, 0x3d, 0xc6, 0x6d, 0xde, 0xfc, 0xfb,
+    0x03, 0xe3, 0x62, 0xa6, 0x63, 0x95, 0x01, 0x00, 0x00,
+};
+
+static const char* GZIP_SMALL = "{\"items\":[{\"summary\":\"Heating\"}]}";
+
+// Plain text behind GZ_CALENDARS: `count` calendars, then {"id":"c","summary":"Cal"}.
+static std::string calendarListOf(int count) {
+    std::string s = "{\"items\":[";
+    char item[96];
+    for (int i = 0; i < count; ++i) {
+        std::snprintf(item, sizeof(item), "{\"id\":\"cal%d@group.calendar.google.com\",\"summary\":\"Calendar %d\"},", i, i);
+        s += item;
+    }
+    return s + "{\"id\":\"c\",\"summary\":\"Cal\"}]}";
+}
+
+static std::string farText() {
+    std::string s = "{\"items\":[";
+    char item[16];
+    for (int i = 0; i < 40; ++i) {
+        std::snprintf(item, sizeof(item), "%s\"id-%03d\"", i ? "," : "", i);
+        s += item;
+    }
+    return s + "],\"x\":\"id-000,id-001,id-002,id-003\"}";
+}
+
+// In-memory source with the readBytes() a GzipReader pulls from.
+struct BytesSource {
+    const uint8_t* p;
+    const uint8_t* end;
+    int read() { return p < end ? *p++ : -1; }
+    size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        while (n < length && p < end) buffer[n++] = static_cast<char>(*p++);
+        return n;
+    }
+};
+
+// A gzip member built by hand: `text` in a stored block, then a fixed-Huffman
+// block with one 258-byte match `distance` bytes back. What it inflates to
+// is text + text.substr(text.size() - distance, 258).
+struct DeflateBits {
+    std::vector<uint8_t> out;
+    uint32_t acc = 0;
+    int count = 0;
+    void bits(uint32_t v, int n) {              // LSB first: headers, extra bits
+        for (int i = 0; i < n; ++i) {
+            acc |= ((v >> i) & 1u) << count;
+            if (++count == 8) { out.push_back(static_cast<uint8_t>(acc)); acc = 0; count = 0; }
+        }
+    }
+    void code(uint32_t v, int n) {              // MSB first: Huffman codes
+        for (int i = n - 1; i >= 0; --i) bits((v >> i) & 1u, 1);
+    }
+    void align() { if (count) { out.push_back(static_cast<uint8_t>(acc)); acc = 0; count = 0; } }
+};
+
+static std::vector<uint8_t> gzipFarMatch(const std::string& text, uint32_t distance) {
+    DeflateBits w;
+    const uint8_t header[] = { 0x1f, 0x8b, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0x03 };
+    w.out.assign(header, header + sizeof(header));
+    w.bits(0, 1); w.bits(0, 2); w.align();      // stored, not final
+    w.bits(static_cast<uint32_t>(text.size()), 16);
+    w.bits(static_cast<uint32_t>(~text.size()) & 0xFFFF, 16);
+    w.out.insert(w.out.end(), text.begin(), text.end());
+    w.bits(1, 1); w.bits(1, 2);                 // fixed Huffman, final
+    w.code(0xC5, 8);                            // length 258 (symbol 285)
+    w.code(26, 5);                              // distance 8193..12288
+    w.bits(distance - 8193, 12);
+    w.code(0, 7);                               // end of block
+    w.align();
+    w.out.resize(w.out.size() + 8, 0);          // trailer, not checked
+    return w.out;
+}
+
+// Everything `reader` yields from `data`, read through read().
+template <size_t WINDOW>
+static std::string inflateAll(const uint8_t* data, size_t length, GzipReader<BytesSource, WINDOW>& reader) {
+    BytesSource source = { data, data + length };
+    reader.begin(source);
+    std::string out;
+    for (int c = reader.read(); c >= 0; c = reader.read()) out += static_cast<char>(c);
+    return out;
+}
+
+static void test_gzip() {
+    std::printf("gzip (inflater, window, pass-through, Accept-Encoding)\n");
+
+    // 18a. The three block types.
+    static GzipReader<BytesSource, 32768> reader;
+    CHECK(inflateAll(GZ_CALENDARS, sizeof(GZ_CALENDARS), reader) == calendarListOf(12));
+    CHECK(reader.isCompressed() && !reader.hasFailed());
+    CHECK(inflateAll(GZ_FIXED, sizeof(GZ_FIXED), reader) == GZIP_SMALL);
+    CHECK(inflateAll(GZ_STORED, sizeof(GZ_STORED), reader) == GZIP_SMALL);
+
+    // 18b. readBytes(), and straight into ArduinoJson.
+    {
+        BytesSource source = { GZ_CALENDARS, GZ_CALENDARS + sizeof(GZ_CALENDARS) };
+        reader.begin(source);
+        char head[10];
+        CHECK(reader.readBytes(head, sizeof(head)) == sizeof(head));
+        CHECK(std::strncmp(head, "{\"items\":[", sizeof(head)) == 0);
+        source = BytesSource{ GZ_CALENDARS, GZ_CALENDARS + sizeof(GZ_CALENDARS) };
+        reader.begin(source);
+        JsonDocument doc;
+        CHECK(!deserializeJson(doc, reader));
+        CHECK_STR(doc[F("items")][12][F("id")].as<const char*>(), "c");
+    }
+
+    // 18c. A back-reference past the window fails instead of decoding wrong.
+    {
+        GzipReader<BytesSource, 512> wide;
+        CHECK(inflateAll(GZ_FAR, sizeof(GZ_FAR), wide) == farText());
+        GzipReader<BytesSource, 256> narrow;
+        inflateAll(GZ_FAR, sizeof(GZ_FAR), narrow);
+        CHECK(narrow.hasFailed());
+    }
+
+    // A match 9000 bytes back, as zlib's 32 KB window produces in a big
+    // calendar: the default window follows it, an 8 KB one cannot.
+    {
+        std::string text(10000, ' ');
+        uint32_t seed = 1;
+        for (char& c : text) {
+            seed = seed * 1103515245u + 12345u;
+            c = static_cast<char>('a' + (seed >> 16) % 26);
+        }
+        const std::vector<uint8_t> far = gzipFarMatch(text, 9000);
+        CHECK(SCHEDULAR_GZIP_WINDOW == 32768);
+        static GzipReader<BytesSource> standard;
+        CHECK(inflateAll(far.data(), far.size(), standard) == text + text.substr(1000, 258));
+        CHECK(!standard.hasFailed());
+        static GzipReader<BytesSource, 8192> small;
+        inflateAll(far.data(), far.size(), small);
+        CHECK(small.hasFailed());
+    }
+
+    // 18d. Truncated or corrupt input fails; plain JSON passes through.
+    CHECK(inflateAll(GZ_CALENDARS, sizeof(GZ_CALENDARS) / 2, reader).size() < calendarListOf(12).size());
+    CHECK(reader.hasFailed());
+    {
+        uint8_t corrupt[sizeof(GZ_FIXED)];
+        std::memcpy(corrupt, GZ_FIXED, sizeof(corrupt));
+        corrupt[2] = 7;                         // not deflate
+        inflateAll(corrupt, sizeof(corrupt), reader);
+        CHECK(reader.hasFailed());
+    }
+    CHECK(inflateAll(reinterpret_cast<const uint8_t*>(GZIP_SMALL), std::strlen(GZIP_SMALL), reader) == GZIP_SMALL);
+    CHECK(!reader.isCompressed() && !reader.hasFailed());
+
+    // 18e. Through the transport: gzip is asked for (with SCHEDULAR_GZIP
+    // only) and a compressed reply parses like a plain one.
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp);
+    driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+    mockHttpReset();
+#ifdef SCHEDULAR_GZIP
+    mockHttpPush(200, GZ_CALENDARS, sizeof(GZ_CALENDARS));
+#else
+    mockHttpPush(200, calendarListOf(12).c_str());
+#endif
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.isLinked());
+    CHECK_STR(sched.calendarIdRaw().c_str(), "c");
+    bool asked = false;
+    for (const std::string& h : mockHttpHeaders()) asked |= h == "Accept-Encoding: gzip";
+#ifdef SCHEDULAR_GZIP
+    CHECK(asked);
+#else
+    CHECK(!asked);
+#endif
+}
+
+
+// --- 19. calendar cache --------------------------------------------------
+
+static int g_cachePersisted = 0;
+static void persistCache(const CalendarCache&) { ++g_cachePersisted; }
+
+static void test_calendar_cache() {
+    std::printf("calendar cache (check instead of list, trust period, fallback)\n");
+
+    const char* list = "{\"items\":[{\"id\":\"home@group\",\"summary\":\"Home\"},{\"id\":\"c\",\"summary\":\"Cal\"}]}";
+    CalendarCache cache;
+    std::memset(&cache, 0, sizeof(cache));
+    g_cachePersisted = 0;
+    FakeNtp ntp;
+
+    // 19a. Empty cache: the list, then the id is recorded.
+    {
+        TestSchedular sched(String("i"), String("s"), &ntp);
+        sched.setCalendarCache(&cache, persistCache);
+        driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+        mockHttpReset();
+        mockHttpPush(200, list);
+        sched.setCalendar(String("Cal"));
+        CHECK(sched.isLinked());
+        CHECK_STR(cache.id, "c");
+        CHECK(cache.nameHash == CalendarCache::hash("Cal"));
+        CHECK(cache.checkedAt == 2000);
+        CHECK(g_cachePersisted == 1);
+    }
+
+    // 19b. Next boot: one small request for the cached calendar's summary.
+    {
+        TestSchedular sched(String("i"), String("s"), &ntp);
+        sched.setCalendarCache(&cache, persistCache);
+        driveToAuthenticated(sched, ntp, /*now=*/5000, /*expiresIn=*/3600);
+        mockHttpReset();
+        mockHttpPush(200, "{\"summary\":\"Cal\"}");
+        sched.setCalendar(String("Cal"));
+        CHECK(sched.isLinked());
+        CHECK_STR(sched.calendarIdRaw().c_str(), "c");
+        CHECK(mockHttpUris().size() == 1);
+        CHECK(mockHttpUris().front() == "/calendar/v3/calendars/c?fields=summary");
+        CHECK(cache.checkedAt == 5000);
+        CHECK(g_cachePersisted == 2);
+    }
+
+    // 19c. Within the trust period: no request at all. Past it: checked.
+    {
+        TestSchedular sched(String("i"), String("s"), &ntp);
+        sched.setCalendarCache(&cache, persistCache, 3600);
+        driveToAuthenticated(sched, ntp, /*now=*/6000, /*expiresIn=*/3600);
+        mockHttpReset();
+        sched.setCalendar(String("Cal"));
+        CHECK(sched.isLinked());
+        CHECK(mockHttpUris().empty());
+        CHECK(g_cachePersisted == 2);
+#ifdef SCHEDULAR_STATS
+        CHECK(sched.stats().cacheHits == 1);
+#endif
+
+        driveToAuthenticated(sched, ntp, /*now=*/9000, /*expiresIn=*/3600);
+        mockHttpReset();
+        mockHttpPush(200, "{\"summary\":\"Cal\"}");
+        sched.setCalendar(String("Cal"));
+        CHECK(sched.isLinked());
+        CHECK(mockHttpUris().size() == 1);
+        CHECK(cache.checkedAt == 9000);
+#ifdef SCHEDULAR_STATS
+        CHECK(sched.stats().cacheHits == 2);            // the list is still spared
+#endif
+    }
+
+    // 19d. The check fails (calendar deleted, or renamed): back to the list.
+    {
+        TestSchedular sched(String("i"), String("s"), &ntp);
+        sched.setCalendarCache(&cache, persistCache);
+        driveToAuthenticated(sched, ntp, /*now=*/10000, /*expiresIn=*/3600);
+        mockHttpReset();
+        mockHttpPush(404, "{\"error\":{\"code\":404}}");
+        mockHttpPush(200, "{\"items\":[{\"id\":\"new@group\",\"summary\":\"Cal\"}]}");
+        sched.setCalendar(String("Cal"));
+        CHECK(sched.isLinked());
+        CHECK_STR(cache.id, "new@group");
+        CHECK(mockHttpUris().size() == 2);
+
+        mockHttpReset();
+        mockHttpPush(200, "{\"summary\":\"Cal (old)\"}");
+        mockHttpPush(200, list);
+        sched.setCalendar(String("Cal"));
+        CHECK(sched.isLinked());
+        CHECK_STR(cache.id, "c");
+    }
+
+    // 19e. Another name: the cache does not apply, and is then replaced.
+    {
+        TestSchedular sched(String("i"), String("s"), &ntp);
+        sched.setCalendarCache(&cache, nullptr, 3600);
+        driveToAuthenticated(sched, ntp, /*now=*/10100, /*expiresIn=*/3600);
+        mockHttpReset();
+        mockHttpPush(200, list);
+        sched.setCalendar(String("Home"));
+        CHECK(sched.isLinked());
+        CHECK(mockHttpUris().size() == 1);
+        CHECK(mockHttpUris().front().find("calendarList") != std::string::npos);
+        CHECK_STR(cache.id, "home@group");
+        CHECK(cache.nameHash == CalendarCache::hash("Home"));
+    }
+}
+
+
+// --- 20. EventFilter -----------------------------------------------------
+
+static void test_event_filter() {
+    std::printf("event filter (query assembly, encoding, device-side skips)\n");
+
+    // 20a. The query is assembled as filters are added, encoded, whole or not
+    //      at all.
+    {
+        EventFilter f;
+        CHECK_STR(f.query(), "&showDeleted=false");
+        CHECK(f.text("relay 2"));
+        CHECK(f.tag("device", "board=2"));
+        CHECK(f.types(EventFilter::TYPE_DEFAULT | EventFilter::TYPE_OUT_OF_OFFICE));
+        CHECK_STR(f.query(), "&showDeleted=false&q=relay%202&privateExtendedProperty=device%3Dboard%3D2"
+                             "&eventTypes=default&eventTypes=outOfOffice");
+        CHECK(!f.needsDetails());
+        CHECK(!f.text(""));
+
+        char longText[SCHEDULAR_FILTER_SIZE];
+        std::memset(longText, 'x', sizeof(longText) - 1);
+        longText[sizeof(longText) - 1] = '\0';
+        const std::string before = f.query();
+        CHECK(!f.text(longText));
+        CHECK(before == f.query());
+
+        f.clear();
+        CHECK_STR(f.query(), "&showDeleted=false");
+    }
+
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp);
+    driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.isLinked());
+
+    // 20b. Server-side filters only: the titles-only mask, the query appended.
+    EventFilter filter;
+    filter.tag("device", "relay");
+    sched.setEventFilter(&filter);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"summary\":\"Relay1\"}]}");
+    CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(mockHttpUris().back() == "/calendar/v3/calendars/c/events?fields=items(summary)&singleEvents=true"
+                                   "&showDeleted=false&privateExtendedProperty=device%3Drelay"
+                                   "&timeMin=2024-11-04T07:30:10Z&timeMax=2024-11-04T07:30:19Z");
+    CHECK(sched.getEventList().size() == 1);
+
+    // 20c. Declined and transparent events are dropped on the device; the
+    //      mask widens to what tells them apart.
+    const char* detailed =
+        "{\"items\":["
+        "{\"summary\":\"Relay1\"},"
+        "{\"summary\":\"Free\",\"transparency\":\"transparent\"},"
+        "{\"attendees\":[{\"self\":true,\"responseStatus\":\"declined\"}],\"summary\":\"Declined\"},"
+        "{\"summary\":\"Accepted\",\"attendees\":[{\"self\":true,\"responseStatus\":\"accepted\"}]},"
+        "{\"summary\":\"Heating\",\"transparency\":\"opaque\"}]}";
+    filter.skip(EventFilter::SKIP_DECLINED | EventFilter::SKIP_TRANSPARENT);
+    mockHttpReset();
+    mockHttpPush(200, detailed);
+    CHECK(sched.syncAt("2024-11-04T07:31:15Z"));
+    CHECK(mockHttpUris().back().find("fields=items(summary,transparency,attendees(self,responseStatus))&maxAttendees=1&")
+          != std::string::npos);
+    CHECK(sched.getEventList().size() == 3);
+    CHECK(sched.getEventList().front() == "Relay1");
+    CHECK(sched.getEventList().back() == "Heating");
+
+    // 20d. One skip at a time.
+    filter.skip(EventFilter::SKIP_TRANSPARENT);
+    mockHttpReset();
+    mockHttpPush(200, detailed);
+    CHECK(sched.syncAt("2024-11-04T07:32:15Z"));
+    CHECK(sched.getEventList().size() == 4);
+
+    // 20e. Channel output goes through the same skips.
+    ChannelMatcher channels;
+    channels.add(0, "Relay1");
+    channels.add(1, "Free");
+    channels.add(2, "Declined");
+    channels.add(3, "Heating");
+    sched.setChannels(&channels);
+    filter.skip(EventFilter::SKIP_DECLINED | EventFilter::SKIP_TRANSPARENT);
+    mockHttpReset();
+    mockHttpPush(200, detailed);
+    CHECK(sched.syncAt("2024-11-04T07:33:15Z"));
+    CHECK(sched.getActiveChannels() == 0b1001);
+
+    // 20f. No filter: the request is the plain one again.
+    sched.setChannels(nullptr);
+    sched.setEventFilter(nullptr);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[]}");
+    CHECK(sched.syncAt("2024-11-04T07:34:15Z"));
+    CHECK(mockHttpUris().back().find("showDeleted") == std::string::npos);
+}
+
+
+// --- 21. EventTimeline ---------------------------------------------------
+
+static const char* TIMELINE =
+    "{\"items\":["
+    "{\"summary\":\"Heating\",\"start\":{\"dateTime\":\"2024-11-04T08:00:00+01:00\"},"
+     "\"end\":{\"dateTime\":\"2024-11-04T10:00:00+01:00\"}},"
+    "{\"summary\":\"Holiday\",\"start\":{\"date\":\"2024-11-04\"},\"end\":{\"date\":\"2024-11-05\"}},"
+    "{\"summary\":\"Relay1\",\"start\":{\"dateTime\":\"2024-11-04T07:30:00.000Z\"},"
+     "\"end\":{\"dateTime\":\"2024-11-04T07:45:00Z\"}},"
+    "{\"summary\":\"Porch\",\"start\":{\"dateTime\":\"2024-11-04T07:40:00Z\"},"
+     "\"end\":{\"dateTime\":\"2024-11-04T07:50:00Z\"}}"
+    "]}";
+
+static void test_event_timeline() {
+    std::printf("event timeline (epoch records, sorted, time queries, syncAt)\n");
+
+    // 2024-11-04T00:00:00Z
+    const uint32_t day = 1730678400UL;
+    CHECK(sizeof(EventRecord) == 12);
+
+    // 21a. Parsed to epoch seconds, sorted by start, titles pooled.
+    {
+        EventTimeline timeline;
+        JsonDocument doc;
+        deserializeJson(doc, TIMELINE);
+        CHECK(timeline.load(doc[F("items")].as<JsonArray>(), day));
+        CHECK(timeline.isUsable());
+        CHECK(timeline.size() == 4);
+        CHECK_STR(timeline.title(0), "Holiday");
+        CHECK(timeline.record(0).isAllDay());
+        CHECK(timeline.record(0).start == day && timeline.record(0).duration() == 86400);
+        CHECK_STR(timeline.title(1), "Heating");
+        CHECK(timeline.record(1).start == day + 7 * 3600);       // 08:00+01:00
+        CHECK(timeline.record(1).length == 7);
+        CHECK(!timeline.record(1).isAllDay());
+        CHECK_STR(timeline.title(2), "Relay1");
+        CHECK(timeline.record(2).start == day + 7 * 3600 + 30 * 60);
+        CHECK(timeline.record(2).duration() == 15 * 60);
+        CHECK_STR(timeline.title(3), "Porch");
+
+        // 21b. Time queries.
+        CHECK(timeline.activeCount(day + 7 * 3600 + 42 * 60) == 4);
+        CHECK(timeline.activeCount(day + 10 * 3600) == 1);      // Holiday only
+        std::string active;
+        timeline.forEachActive(day + 7 * 3600 + 46 * 60, [&](uint8_t i) { active += timeline.title(i); active += ','; });
+        CHECK(active == "Holiday,Heating,Porch,");
+        CHECK(timeline.nextTransition(day + 7 * 3600 + 10 * 60) == day + 7 * 3600 + 30 * 60);
+        CHECK(timeline.nextTransition(day + 7 * 3600 + 30 * 60) == day + 7 * 3600 + 40 * 60);
+        CHECK(timeline.nextTransition(day + 7 * 3600 + 47 * 60) == day + 7 * 3600 + 50 * 60);
+        CHECK(timeline.nextTransition(day + 7 * 3600 + 50 * 60) == day + 9 * 3600);
+        CHECK(timeline.nextTransition(day + 9 * 3600) == day + 86400);
+        CHECK(timeline.nextTransition(day + 86400) == 0);
+    }
+
+    // 21c. Too many events, or an unreadable date: nothing usable.
+    {
+        EventTimeline timeline;
+        std::string many = "{\"items\":[";
+        for (unsigned i = 0; i <= SCHEDULAR_TIMELINE_EVENTS; ++i) {
+            many += i ? "," : "";
+            many += "{\"summary\":\"E\",\"start\":{\"date\":\"2024-11-04\"},\"end\":{\"date\":\"2024-11-05\"}}";
+        }
+        many += "]}";
+        JsonDocument doc;
+        deserializeJson(doc, many.c_str());
+        CHECK(!timeline.load(doc[F("items")].as<JsonArray>(), day));
+        CHECK(!timeline.isUsable());
+        CHECK(timeline.size() == 0);
+        CHECK(!timeline.isStale(day));
+
+        JsonDocument bad;
+        deserializeJson(bad, "{\"items\":[{\"summary\":\"X\",\"start\":{\"dateTime\":\"04/11/2024\"},\"end\":{}}]}");
+        CHECK(!timeline.load(bad[F("items")].as<JsonArray>(), day));
+    }
+
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp);
+    driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.isLinked());
+
+    // 21d. syncAt() loads the horizon once, then answers locally.
+    EventTimeline timeline(3600);
+    sched.setTimeline(&timeline);
+    mockHttpReset();
+    mockHttpPush(200, TIMELINE);
+    CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(mockHttpUris().size() == 1);
+    CHECK(mockHttpUris().back() == "/calendar/v3/calendars/c/events?fields=items(summary,start,end)&singleEvents=true"
+                                   "&timeMin=2024-11-04T07:30:15Z&timeMax=2024-11-04T08:30:15Z");
+    CHECK(sched.getEventList().size() == 3);
+    CHECK(sched.getEventList().front() == "Holiday");
+    CHECK(sched.getEventList().back() == "Relay1");
+
+    mockHttpReset();
+    CHECK(sched.syncAt("2024-11-04T07:46:00Z"));
+    CHECK(mockHttpUris().empty());
+    CHECK(sched.getEventList().size() == 3);
+    CHECK(sched.getEventList().back() == "Porch");
+#ifdef SCHEDULAR_STATS
+    CHECK(sched.stats().cacheHits == 2);
+#endif
+    CHECK(sched.getTimeline()->nextTransition(day + 7 * 3600 + 46 * 60) == day + 7 * 3600 + 50 * 60);
+
+    // 21e. Channel output from the timeline too.
+    ChannelMatcher channels;
+    channels.add(0, "Porch");
+    channels.add(1, "Heating");
+    sched.setChannels(&channels);
+    CHECK(sched.syncAt("2024-11-04T07:46:00Z"));
+    CHECK(mockHttpUris().empty());
+    CHECK(sched.getActiveChannels() == 0b11);
+    sched.setChannels(nullptr);
+
+    // 21f. Past the horizon: loaded again. A reply that does not fit leaves
+    //      syncAt() to the server until the next load.
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"summary\":\"X\",\"start\":{\"dateTime\":\"garbage\"}}]}");
+    mockHttpPush(200, "{\"items\":[{\"summary\":\"Relay2\"}]}");
+    CHECK(sched.syncAt("2024-11-04T08:30:15Z"));
+    CHECK(mockHttpUris().size() == 2);
+    CHECK(!timeline.isUsable());
+    CHECK(sched.getEventList().size() == 1);
+    CHECK(sched.getEventList().front() == "Relay2");
+
+    // 21g. A failed load is a failed sync.
+    mockHttpReset();
+    mockHttpPush(500, "{}");
+    CHECK(!sched.syncAt("2024-11-04T09:30:15Z"));
+    CHECK(sched.hasFailed());
+}
+
+
+// --- 22. Deep sleep -------------------------------------------------------
+
+// The calendar of a battery node, the same whatever the window asked for.
+static MockHttpReply respondSleep(const char* path) {
+    if (std::strcmp(path, "/token") == 0) {
+        return MockHttpReply{200, "{\"access_token\":\"ACCESS_TOKEN_2\",\"expires_in\":3600}"};
+    }
+    return MockHttpReply{200, "{\"items\":["
+        "{\"summary\":\"Heating\",\"start\":{\"dateTime\":\"2024-11-04T06:00:00Z\"},\"end\":{\"dateTime\":\"2024-11-04T08:00:00Z\"}},"
+        "{\"summary\":\"Porch\",\"start\":{\"dateTime\":\"2024-11-04T17:30:00Z\"},\"end\":{\"dateTime\":\"2024-11-04T23:30:00Z\"}},"
+        "{\"summary\":\"Heating\",\"start\":{\"dateTime\":\"2024-11-04T18:00:00Z\"},\"end\":{\"dateTime\":\"2024-11-04T22:00:00Z\"}}"
+        "]}"};
+}
+
+static void test_deep_sleep() {
+    std::printf("deep sleep (SleepState, wake-up times, a day of wake-ups)\n");
+
+    // 2024-11-04T00:00:00Z
+    const uint32_t day = 1730678400UL;
+    const uint32_t horizon = 6 * 3600;
+
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp);
+    EventTimeline timeline(horizon);
+    sched.setTimeline(&timeline);
+    SleepState rtc;
+    rtc.clear();
+
+    // 22a. Nothing worth resuming: all zeroes, or not linked.
+    CHECK(!rtc.isValid());
+    CHECK(!sched.resume(rtc));
+    CHECK(sched.suspend(rtc, day) == SCHEDULAR_SLEEP_MAX);
+    CHECK(rtc.isValid());
+    CHECK(!sched.resume(rtc));
+    CHECK(sched.needsRequest(day));
+
+    driveToAuthenticated(sched, ntp, /*now=*/day - 60, /*expiresIn=*/3600);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.isLinked());
+    CHECK(sched.needsRequest(day));         // nothing loaded yet
+
+    // 22b. Wake-ups: the next boundary, the reload, or the longest sleep.
+    mockHttpReset();
+    mockHttpResponder() = respondSleep;
+    CHECK(sched.syncAt("2024-11-04T05:30:00Z"));
+    CHECK(mockHttpUris().size() == 1);
+    CHECK(!sched.needsRequest(day + 5 * 3600 + 30 * 60));
+    CHECK(sched.nextWakeUp(day + 5 * 3600 + 30 * 60) == day + 6 * 3600);
+    CHECK(sched.nextWakeUp(day + 6 * 3600 + 1) == day + 7 * 3600 + 1);
+    CHECK(sched.nextWakeUp(day + 7 * 3600 + 30 * 60) == day + 8 * 3600);
+    CHECK(sched.nextWakeUp(day + 9 * 3600, 600) == day + 9 * 3600 + 600);
+    CHECK(sched.nextWakeUp(day + 11 * 3600) == day + 11 * 3600 + 30 * 60);    // reload
+    CHECK(sched.needsRequest(day + 11 * 3600 + 30 * 60));
+
+    // 22c. Kept, checked, restored into a fresh scheduler.
+    CHECK(sched.suspend(rtc, day + 5 * 3600 + 30 * 60) == 30 * 60);
+    CHECK(rtc.isValid());
+    CHECK(rtc.wakeAt == day + 6 * 3600);
+    {
+        TestSchedular woken(String("i"), String("s"), &ntp);
+        EventTimeline fresh(horizon);
+        woken.setTimeline(&fresh);
+        CHECK(woken.resume(rtc));
+        CHECK(woken.isLinked());
+        CHECK(woken.calendarIdRaw() == "c");
+        CHECK(woken.expiration() == sched.expiration());
+        CHECK(fresh.isUsable() && fresh.size() == 3);
+        CHECK(!woken.needsRequest(rtc.wakeAt));
+        mockHttpReset();
+        CHECK(woken.syncAt("2024-11-04T06:00:00Z"));
+        CHECK(mockHttpUris().empty());
+        CHECK(woken.getEventList().size() == 1);
+    }
+    rtc.timeline[0] ^= 1;
+    CHECK(!rtc.isValid());
+    TestSchedular corrupted(String("i"), String("s"), &ntp);
+    CHECK(!corrupted.resume(rtc));
+    CHECK(!corrupted.isLinked());
+
+    // 22d. A day of wake-ups, each one a fresh boot: the network only for
+    //      the four loads, and a token refresh with the three last ones.
+    //      Polling every minute would have taken 1440 requests.
+    mockHttpReset();
+    mockHttpResponder() = respondSleep;
+    timeline.clear();
+    sched.suspend(rtc, day - 60);
+    unsigned wakes = 0;
+    unsigned online = 0;
+    unsigned heating = 0;
+    for (uint32_t now = day; now < day + 86400; ++wakes) {
+        TestSchedular node(String("i"), String("s"), &ntp);
+        node.setRefreshToken(String("REFRESH_TOKEN"));
+        EventTimeline nodeTimeline(horizon);
+        node.setTimeline(&nodeTimeline);
+        CHECK(node.resume(rtc));
+        if (node.needsRequest(now)) {
+            ++online;
+            ntp.set(now);
+            node.maintain();
+        }
+        char ts[21];
+        CivilTime::formatRfc3339(static_cast<int32_t>(now), ts);
+        CHECK(node.syncAt(ts));
+        for (const auto& title : node.getEventList()) {
+            heating += title == "Heating";
+        }
+        now += node.suspend(rtc, now);
+    }
+    CHECK(online == 4);
+    CHECK(mockHttpUris().size() == 7);
+    // Hourly, plus 17:30 and 23:30.
+    CHECK(wakes == 26);
+    // Woken at 06:00 and 07:00, then 18:00 to 21:00.
+    CHECK(heating == 6);
+    mockHttpResponder() = nullptr;
+}
+
+
+// --- 23. Snapshot broadcast -----------------------------------------------
+
+// Datagrams on the air, and UDP endpoints that all hear them all.
+static std::deque<std::string> g_air;
+
+class LoopUdp : public UDP {
+public:
+    uint8_t begin(uint16_t) override { return 1; }
+    void stop() override {}
+    int beginPacket(IPAddress, uint16_t) override { _out.clear(); return 1; }
+    size_t write(uint8_t c) override { _out += static_cast<char>(c); return 1; }
+    size_t write(const uint8_t* b, size_t n) override { _out.append(reinterpret_cast<const char*>(b), n); return n; }
+    int endPacket() override { g_air.push_back(_out); return 1; }
+    int parsePacket() override {
+        if (g_air.empty()) return 0;
+        _in = g_air.front();
+        g_air.pop_front();
+        _pos = 0;
+        return static_cast<int>(_in.size());
+    }
+    int available() override { return static_cast<int>(_in.size() - _pos); }
+    int read() override { return _pos < _in.size() ? static_cast<uint8_t>(_in[_pos++]) : -1; }
+    int read(unsigned char* b, size_t n) override {
+        const size_t k = std::min(n, _in.size() - _pos);
+        std::memcpy(b, _in.data() + _pos, k);
+        _pos += k;
+        return static_cast<int>(k);
+    }
+    int read(char* b, size_t n) override { return read(reinterpret_cast<unsigned char*>(b), n); }
+    int peek() override { return _pos < _in.size() ? static_cast<uint8_t>(_in[_pos]) : -1; }
+    IPAddress remoteIP() override { return IPAddress(127, 0, 0, 1); }
+    uint16_t remotePort() override { return 4299; }
+private:
+    std::string _out, _in;
+    size_t _pos = 0;
+};
+
+static void test_broadcast() {
+    std::printf("snapshot broadcast (format, CRC, leader / follower, copies, staleness)\n");
+
+    const uint32_t day = 1730678400UL;
+    const uint8_t digits[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    CHECK(TimelineSnapshot::crc32(digits, sizeof(digits)) == 0xCBF43926UL);
+
+    EventTimeline source(3600);
+    JsonDocument doc;
+    deserializeJson(doc, TIMELINE);
+    CHECK(source.load(doc[F("items")].as<JsonArray>(), day));
+
+    // 23a. Round trip: 17 + 4 x 10 + 25 bytes of titles + 4.
+    {
+        uint8_t packet[SCHEDULAR_SNAPSHOT_SIZE];
+        const size_t n = TimelineSnapshot::encode(source, 7, packet, sizeof(packet));
+        CHECK(n == 86);
+        CHECK(TimelineSnapshot::check(packet, n));
+        EventTimeline copy(60);
+        uint32_t sequence = 0;
+        CHECK(TimelineSnapshot::decode(packet, n, copy, sequence));
+        CHECK(sequence == 7);
+        CHECK(copy.isUsable() && copy.size() == 4);
+        CHECK(copy.loadedAt() == day && copy.horizonSeconds() == 3600);
+        for (uint8_t i = 0; i < 4; ++i) {
+            CHECK_STR(copy.title(i), source.title(i));
+            CHECK(copy.record(i).start == source.record(i).start);
+            CHECK(copy.record(i).end == source.record(i).end);
+            CHECK(copy.record(i).flags == source.record(i).flags);
+        }
+
+        // 23b. Anything off fails the check, and leaves the timeline alone.
+        packet[40] ^= 0x10;
+        CHECK(!TimelineSnapshot::check(packet, n));
+        CHECK(!TimelineSnapshot::decode(packet, n, copy, sequence));
+        CHECK(copy.isUsable() && copy.size() == 4);
+        packet[40] ^= 0x10;
+        CHECK(!TimelineSnapshot::check(packet, n - 1));
+        packet[2] = TimelineSnapshot::VERSION + 1;
+        CHECK(!TimelineSnapshot::check(packet, n));
+        CHECK(TimelineSnapshot::encode(source, 7, packet, 60) == 0);
+    }
+
+    // 23c. Leader to follower: copies and late packets dropped.
+    g_air.clear();
+    LoopUdp leaderUdp, followerUdp;
+    TimelineLeader leader(leaderUdp, IPAddress(239, 255, 42, 99), 4299);
+    EventTimeline mirror;
+    TimelineFollower follower(followerUdp, mirror);
+    CHECK(!follower.poll());
+    CHECK(leader.publish(source) == 86);
+    CHECK(leader.publish(source) == 86);
+    CHECK(leader.sequence() == 1);
+    const std::string late = g_air.front();
+    CHECK(follower.poll());
+    CHECK(follower.sequence() == 1);
+    CHECK(follower.received() == 2);
+    CHECK(mirror.activeCount(day + 7 * 3600 + 42 * 60) == 4);
+    CHECK(mirror.nextTransition(day + 7 * 3600 + 42 * 60) == day + 7 * 3600 + 45 * 60);
+    CHECK(!mirror.isStale(day + 3599) && mirror.isStale(day + 3600));
+
+    CHECK(source.load(doc[F("items")].as<JsonArray>(), day + 3600));
+    CHECK(leader.publish(source) == 86);
+    CHECK(leader.sequence() == 2);
+    CHECK(follower.poll());
+    CHECK(mirror.loadedAt() == day + 3600);
+    g_air.push_back(late);
+    CHECK(!follower.poll());
+    CHECK(mirror.loadedAt() == day + 3600);
+    leader.publish(source);
+    g_air.back()[20] ^= 1;
+    CHECK(!follower.poll());
+    CHECK(follower.rejected() == 1);
+    CHECK(follower.sequence() == 2);
+
+    // One that checks out but does not decode (its first event ends before
+    // it starts): rejected, and no update.
+    CHECK(source.load(doc[F("items")].as<JsonArray>(), day + 3700));
+    CHECK(leader.publish(source) == 86);
+    std::string& bad = g_air.back();
+    uint8_t* raw = reinterpret_cast<uint8_t*>(&bad[0]);
+    std::memset(raw + TimelineSnapshot::HEADER + 4, 0, 4);
+    const uint32_t crc = TimelineSnapshot::crc32(raw, bad.size() - 4);
+    for (int i = 0; i < 4; ++i) {
+        raw[bad.size() - 4 + i] = static_cast<uint8_t>(crc >> (8 * i));
+    }
+    CHECK(TimelineSnapshot::check(raw, bad.size()));
+    CHECK(!follower.poll());
+    CHECK(follower.rejected() == 2);
+    CHECK(follower.sequence() == 2);
+    CHECK(!mirror.isUsable());
+
+    // A restarted leader counts from 1 again, on a later load.
+    TimelineLeader restarted(leaderUdp, IPAddress(239, 255, 42, 99), 4299);
+    CHECK(source.load(doc[F("items")].as<JsonArray>(), day + 7200));
+    restarted.publish(source);
+    CHECK(follower.poll());
+    CHECK(follower.sequence() == 1);
+    CHECK(mirror.loadedAt() == day + 7200);
+
+    // 23d. The titles of a leader without timeline, for validFor seconds.
+    std::list<String> titles;
+    titles.push_back("Heating");
+    titles.push_back("Porch");
+    CHECK(restarted.publishActive(titles, day + 7300, 60) == 17 + 2 + 7 + 2 + 5 + 4);
+    CHECK(follower.poll());
+    CHECK(mirror.size() == 2);
+    CHECK(mirror.activeCount(day + 7359) == 2);
+    CHECK(mirror.activeCount(day + 7360) == 0);
+    CHECK(mirror.isStale(day + 7360));
+    CHECK_STR(mirror.title(0), "Heating");
+    g_air.clear();
+}
+
+
+// --- 24. SchedularTrace ---------------------------------------------------
+
+#ifdef SCHEDULAR_TRACE
+// Event ids and codes of the records held, oldest first, as "event:code".
+static std::string traced(const SchedularTrace& trace) {
+    std::string out;
+    for (uint16_t i = 0; i < trace.size(); ++i) {
+        char item[32];
+        std::snprintf(item, sizeof(item), "%s%s:%d", i ? " " : "", SchedularTrace::name(trace.at(i).event), trace.at(i).code);
+        out += item;
+    }
+    return out;
+}
+
+// A transport that resolves and connects on its own, as the ESP32's and
+// PosixTransport do: every request reports one lookup and its timings.
+class ConnectingTransport : public SchedularTransport {
+public:
+    int post(const char* path, const char* json) { _connected(); return SchedularTransport::post(path, json); }
+    int get(const char* path, const char* authorization) { _connected(); return SchedularTransport::get(path, authorization); }
+
+private:
+    void _connected() {
+        _resolution.lookups = 1;
+        _resolution.cached = false;
+        _resolution.resolveUs = 1200;
+        _resolution.connectUs = 45000;
+    }
+};
+
+static void test_trace() {
+    std::printf("SchedularTrace (ring, request phases, state transitions)\n");
+    CHECK(sizeof(SchedularTrace::Record) == 12);
+
+    // 24a. The ring keeps the newest SCHEDULAR_TRACE_SIZE records.
+    {
+        SchedularTrace trace;
+        for (int i = 0; i < SCHEDULAR_TRACE_SIZE + 6; ++i) {
+            trace.record(SchedularTrace::EV_RETRY, i);
+        }
+        CHECK(trace.size() == SCHEDULAR_TRACE_SIZE);
+        CHECK(trace.count() == SCHEDULAR_TRACE_SIZE + 6);
+        CHECK(trace.dropped() == 6);
+        CHECK(trace.at(0).code == 6);
+        CHECK(trace.at(SCHEDULAR_TRACE_SIZE - 1).code == SCHEDULAR_TRACE_SIZE + 5);
+        trace.clear();
+        CHECK(trace.size() == 0);
+    }
+
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp);
+
+    // 24b. Registration: a 428 PENDING poll, then the token.
+    mockHttpReset();
+    mockHttpPush(200, "{\"verification_url\":\"u\",\"user_code\":\"C\",\"interval\":5,\"device_code\":\"D\"}");
+    mockHttpPush(428, "{\"error\":\"authorization_pending\"}");
+    mockHttpPush(200, "{\"access_token\":\"AT\",\"refresh_token\":\"REFRESH_TOKEN\",\"expires_in\":3600}");
+    String url, code;
+    ntp.set(1000);
+    sched.startRegistration(url, code);
+    ntp.set(1010);
+    sched.handleRegistration();
+    ntp.set(1020);
+    sched.handleRegistration();
+    CHECK(sched.isAuthenticated());
+    CHECK(traced(sched.trace()) ==
+          "request:0 response:200 dns:0 parse:0 end:200 state:2 "
+          "request:1 response:428 dns:0 parse:0 end:428 "
+          "request:1 response:200 dns:0 parse:0 end:200 state:6");
+
+    // 24c. Durations: the link latency lands in the response, the whole
+    //      request in the end record.
+    sched.clearTrace();
+    mockHttpReset();
+    mockHttpDefaultShape() = MockHttpShape().latency(30);
+    mockHttpPush(200, "{\"items\":[{\"id\":\"c\",\"summary\":\"Cal\"}]}");
+    mockHttpPush(200, "{\"items\":[{\"summary\":\"Relay1\"}]}");
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(traced(sched.trace()) ==
+          "request:3 response:200 dns:0 parse:0 end:200 state:14 "
+          "request:4 response:200 dns:0 parse:0 end:200 sync:1");
+    CHECK(sched.trace().at(1).durationUs >= 30000);
+    CHECK(sched.trace().at(4).durationUs >= sched.trace().at(1).durationUs);
+    CHECK(sched.trace().at(11).durationUs >= sched.trace().at(10).durationUs);
+    CHECK(sched.trace().at(11).atMs >= sched.trace().at(0).atMs + 60);
+
+    // 24d. A body that does not parse, then the recovery.
+    sched.clearTrace();
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"summary\":");
+    CHECK(!sched.syncAt("2024-11-04T07:31:15Z"));
+    CHECK(sched.trace().size() == 7);
+    CHECK(sched.trace().at(3).event == SchedularTrace::EV_PARSE && sched.trace().at(3).code != 0);
+    CHECK(traced(sched.trace()).find("end:0 sync:-1 state:1") != std::string::npos);
+    mockHttpPush(200, "{\"access_token\":\"AT2\",\"expires_in\":3600}");
+    sched.maintain();
+    CHECK(sched.trace().at(7).event == SchedularTrace::EV_RETRY);
+    CHECK(sched.trace().at(sched.trace().size() - 1).event == SchedularTrace::EV_STATE);
+    CHECK(sched.trace().at(sched.trace().size() - 1).code == GoogleSchedular::AUTHENTICATED);
+
+    // 24e. A transport that connects itself: the lookup and the connection
+    //      get their own records and durations. The others leave none.
+    {
+        CHECK(traced(sched.trace()).find("connect") == std::string::npos);
+        ConnectingTransport transport;
+        BasicGoogleSchedular<ConnectingTransport> connecting(String("i"), String("s"), &ntp, transport);
+        connecting.setRefreshToken(String("A_LONG_REFRESH_TOKEN"));
+        mockHttpReset();
+        mockHttpPush(200, "{\"access_token\":\"AT\",\"expires_in\":3600}");
+        connecting.maintain();
+        CHECK(connecting.isAuthenticated());
+        CHECK(traced(connecting.trace()).find("request:2 response:200 dns:1 connect:0 parse:0 end:200") == 0);
+        CHECK(connecting.trace().at(2).durationUs == 1200 && connecting.trace().at(2).arg == 0);
+        CHECK(connecting.trace().at(3).event == SchedularTrace::EV_CONNECT && connecting.trace().at(3).durationUs == 45000);
+    }
+    mockHttpReset();
+}
+#endif
+
+
+// --- 25. Paced parsing ----------------------------------------------------
+
+// A body in RAM that spends `usPerByte` of the fake clock on every byte, as
+// the parse does on a device.
+class SlowSource {
+public:
+    SlowSource(const std::string& body, unsigned long usPerByte) : _body(body), _pos(0), _us(usPerByte) {}
+    int read() {
+        if (_pos == _body.size()) return -1;
+        mockAdvanceMicros(_us);
+        return static_cast<unsigned char>(_body[_pos++]);
+    }
+    size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        int c;
+        while (n < length && (c = read()) >= 0) buffer[n++] = static_cast<char>(c);
+        return n;
+    }
+private:
+    std::string _body;
+    size_t _pos;
+    unsigned long _us;
+};
+
+static void test_paced_parsing() {
+    std::printf("paced parsing (byte / time slices, yield() mid-parse, same result)\n");
+    std::string body = "{\"items\":[";
+    for (int i = 0; i < 100; ++i) {
+        char item[64];
+        std::snprintf(item, sizeof(item), "%s{\"id\":\"c%03d\",\"summary\":\"Calendar %03d\"}", i ? "," : "", i, i);
+        body += item;
+    }
+    body += "]}";
+
+    // 25a. A yield() every sliceBytes bytes, by read() or by readBytes().
+    {
+        SlowSource source(body, 0);
+        PacedReader<SlowSource> reader(source, 500, 0);
+        JsonDocument doc;
+        const unsigned long before = mockYields();
+        CHECK(!deserializeJson(doc, reader));
+        CHECK(doc[F("items")].size() == 100);
+        CHECK(reader.yields() == body.size() / 500);
+        CHECK(mockYields() - before == reader.yields());
+
+        SlowSource bulk(body, 0);
+        PacedReader<SlowSource> chunks(bulk, 500, 0);
+        char buffer[100];
+        while (chunks.readBytes(buffer, sizeof(buffer)) != 0) {}
+        CHECK(chunks.yields() == body.size() / 500);
+    }
+
+    // 25b. A yield() once sliceUs have gone by, looked at every CHECK_BYTES.
+    {
+        SlowSource source(body, 10);
+        PacedReader<SlowSource> reader(source, 0, 1000);
+        JsonDocument doc;
+        CHECK(!deserializeJson(doc, reader));
+        const size_t perSlice = (1000 / 10 + SchedularPace::CHECK - 1) / SchedularPace::CHECK * SchedularPace::CHECK;
+        CHECK(reader.yields() == body.size() / perSlice);
+    }
+
+    // 25c. Both bounds lifted: one slice, no yield().
+    {
+        SlowSource source(body, 10);
+        PacedReader<SlowSource> reader(source, 0, 0);
+        JsonDocument doc;
+        CHECK(!deserializeJson(doc, reader));
+        CHECK(reader.yields() == 0);
+    }
+
+    // 25d. A Stream is read through readBytes(): the client's read() says -1
+    //      between two segments.
+    {
+        WiFiClientSecure client;
+        HTTPClient http;
+        mockHttpReset();
+        mockHttpPush(200, body.c_str(), MockHttpShape().segments(300, 5));
+        http.GET();
+        PacedReader<WiFiClientSecure> reader(client, 500, 0);
+        JsonDocument doc;
+        CHECK(!deserializeJson(doc, reader));
+        CHECK(std::strcmp(doc[F("items")][99][F("id")].as<const char*>(), "c099") == 0);
+        CHECK(reader.yields() == body.size() / 500);
+        client.stop();
+    }
+
+    // 25e. setCalendar() over a long calendarList yields while it parses and
+    //      still finds the calendar at the end of it.
+    {
+        FakeNtp ntp;
+        TestSchedular sched(String("id"), String("secret"), &ntp);
+        driveToAuthenticated(sched, ntp, 2000, 3600);
+        std::string list = body;
+        list.insert(list.size() - 2, ",{\"id\":\"target@group.calendar.google.com\",\"summary\":\"Target\"}");
+        mockHttpReset();
+        mockHttpPush(200, list.c_str());
+        const unsigned long before = mockYields();
+        sched.setCalendar(String("Target"));
+        CHECK(sched.isLinked());
+        CHECK(sched.calendarIdRaw() == "target@group.calendar.google.com");
+        CHECK(mockYields() - before >= list.size() / SCHEDULAR_PARSE_SLICE_BYTES);
+        mockHttpReset();
+    }
+}
+
+
+// --- 26. JSON arena -------------------------------------------------------
+
+static void test_json_arena() {
+    std::printf("JSON arena (documents off the heap, rewinds, bounded, no fallback)\n");
+    mockHttpRecordUris() = false;
+    const char* list = "{\"items\":[{\"id\":\"home@group\",\"summary\":\"Home\"},"
+                       "{\"id\":\"c\",\"summary\":\"Cal\"}]}";
+    const char* events = "{\"items\":[{\"summary\":\"Heating\"},{\"summary\":\"Relay1\"},"
+                         "{\"summary\":\"Lights living room\"}]}";
+    const char* token = "{\"access_token\":\"ACCESS_TOKEN\",\"expires_in\":3600}";
+
+    static size_t block[1024];
+    SchedularArena arena(block, sizeof(block));
+    FakeNtp ntp;
+    TestSchedular heap(String("i"), String("s"), &ntp);
+    TestSchedular pooled(String("i"), String("s"), &ntp);
+    CHECK(pooled.getJsonArena() == nullptr);
+    pooled.setJsonArena(&arena);
+    CHECK(pooled.getJsonArena() == &arena);
+    driveToAuthenticated(heap, ntp, 2000, 3600);
+    driveToAuthenticated(pooled, ntp, 2000, 3600);
+    CHECK(pooled.isAuthenticated());
+
+    // 26a. The same calls, with the documents and the token request body in
+    //      the arena: what is left on the heap is the request's own text and
+    //      the Strings kept (calendar id, titles).
+    scriptReply(200, list);
+    const Usage linkHeap = measureUsage([&]() { heap.setCalendar(String("Cal")); });
+    scriptReply(200, list);
+    const Usage linkArena = measureUsage([&]() { pooled.setCalendar(String("Cal")); });
+    CHECK(pooled.isLinked());
+    CHECK(linkArena.allocs + 4 <= linkHeap.allocs);
+
+    scriptReply(200, events);
+    heap.syncAt("2024-11-04T07:30:15Z");
+    scriptReply(200, events);
+    pooled.syncAt("2024-11-04T07:30:15Z");
+    scriptReply(200, events);
+    const Usage syncHeap = measureUsage([&]() { heap.syncAt("2024-11-04T07:30:15Z"); });
+    scriptReply(200, events);
+    const Usage syncArena = measureUsage([&]() { pooled.syncAt("2024-11-04T07:30:15Z"); });
+    CHECK(pooled.getEventList().size() == 3);
+    CHECK(syncArena.allocs + 4 <= syncHeap.allocs);
+
+    scriptReply(200, token);
+    const Usage refreshHeap = measureUsage([&]() {
+        SchedularDocument response;
+        heap.refreshAccessToken(response);
+    });
+    scriptReply(200, token);
+    const Usage refreshArena = measureUsage([&]() {
+        SchedularDocument response(&arena);
+        pooled.refreshAccessToken(response);
+    });
+    CHECK(refreshArena.allocs + 4 <= refreshHeap.allocs);
+    std::printf("      heap -> arena allocs: setCalendar %zu -> %zu, syncAt %zu -> %zu, refresh %zu -> %zu\n",
+                linkHeap.allocs, linkArena.allocs, syncHeap.allocs, syncArena.allocs, refreshHeap.allocs, refreshArena.allocs);
+
+    // 26b. Rewound after each call: the peak of a steady syncAt() does not creep.
+    scriptReply(200, events);
+    pooled.syncAt("2024-11-04T07:30:15Z");
+    const size_t peak = arena.peak();
+    CHECK(peak > 0 && peak <= arena.capacity());
+    for (int i = 0; i < 10; ++i) {
+        scriptReply(200, events);
+        CHECK(pooled.syncAt("2024-11-04T07:30:15Z"));
+        CHECK(arena.live() == 0 && arena.used() == 0);
+    }
+    CHECK(arena.peak() == peak);
+    CHECK(arena.failures() == 0);
+
+    // 26c. A reply larger than the arena fails the call, with no heap fallback.
+    static size_t small[32];
+    SchedularArena tight(small, sizeof(small));
+    pooled.setJsonArena(&tight);
+    scriptReply(200, events);
+    CHECK(!pooled.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(tight.failures() > 0);
+    CHECK(tight.live() == 0);
+
+    // 26d. Token requests that do not fit are not sent: an empty body would
+    //      come back 400 and read as a revoked credential.
+    mockHttpRecordUris() = true;
+    mockHttpReset();
+    mockHttpPush(400, "{\"error\":\"invalid_request\"}");
+    {
+        SchedularDocument response;
+        CHECK(pooled.refreshAccessToken(response) == GoogleSchedular::OAuth2::ERROR);
+        CHECK(pooled.pollAuthorization(response) == GoogleSchedular::OAuth2::ERROR);
+    }
+    CHECK(mockHttpUris().empty());
+    CHECK(mockHttpCursor() == 0);
+    CHECK(pooled.lastAuthHttpCode() == 0);
+
+    TestSchedular expiring(String("i"), String("s"), &ntp);
+    driveToAuthenticated(expiring, ntp, /*now=*/2000, /*expiresIn=*/60);
+    expiring.setJsonArena(&tight);
+    mockHttpReset();
+    mockHttpPush(400, "{\"error\":\"invalid_request\"}");
+    ntp.set(5000);
+    expiring.maintain();
+    CHECK(expiring.hasFailed());
+    CHECK(!expiring.isAuthInvalid());
+    CHECK(mockHttpCursor() == 0);
+    expiring.setJsonArena(nullptr);
+    mockHttpReset();
+    mockHttpPush(200, "{\"access_token\":\"AT2\",\"expires_in\":3600}");
+    expiring.maintain();
+    CHECK(expiring.isAuthenticated());
+
+    pooled.setJsonArena(nullptr);
+    mockHttpReset();
+}
+
+
+// --- 27. Memory tiers -----------------------------------------------------
+
+// A simulated heap (MockUmmHeap.h) as an ArduinoJson Allocator: the internal
+// RAM and the PSRAM of an ESP32, each a heap of its own.
+template <uint16_t BLOCKS>
+class SimulatedHeap : public ArduinoJson::Allocator {
+public:
+    void* allocate(size_t size) override { return heap.allocate(size); }
+    void deallocate(void* p) override { heap.release(p); }
+    void* reallocate(void* p, size_t size) override { return heap.reallocate(p, size); }
+    MockUmmHeap<BLOCKS> heap;
+};
+
+static void test_memory_tiers() {
+    std::printf("memory tiers (two simulated heaps, per-tier accounting, make<T>)\n");
+    static SimulatedHeap<8192> internalRam;     // 64 kB: a transport holds a 32 kB gzip window
+    static SimulatedHeap<32768> psram;          // 256 kB
+    SchedularTier fast(internalRam);
+    SchedularTier slow(psram);
+    const size_t internalFree = internalRam.heap.freeBytes();
+
+    // 27a. Hot transport buffers in internal RAM; JSON and the event store in
+    //      PSRAM.
+    SchedularTiers::set(SchedularTiers::TRANSPORT, &fast);
+    SchedularTiers::set(SchedularTiers::JSON, &slow);
+    SchedularTiers::set(SchedularTiers::EVENTS, &slow);
+    CHECK(&SchedularTiers::of(SchedularTiers::JSON) == &slow);
+
+    SchedularTransport* transport = SchedularTiers::make<SchedularTransport>(SchedularTiers::TRANSPORT);
+    EventTimeline* timeline = SchedularTiers::make<EventTimeline>(SchedularTiers::EVENTS, 3600);
+    CHECK(transport != nullptr && timeline != nullptr);
+    CHECK(fast.live() == sizeof(SchedularTransport));
+    CHECK(slow.live() == sizeof(EventTimeline));
+    CHECK(internalRam.heap.freeBytes() < internalFree);
+
+    FakeNtp ntp;
+    TestSchedular sched(String("i"), String("s"), &ntp, *transport);
+    driveToAuthenticated(sched, ntp, /*now=*/2000, /*expiresIn=*/3600);
+    std::string list = "{\"items\":[";
+    for (int i = 0; i < 200; ++i) {
+        char item[80];
+        std::snprintf(item, sizeof(item), "{\"id\":\"c%03d@group.calendar.google.com\",\"summary\":\"Calendar %03d\"},", i, i);
+        list += item;
+    }
+    list += "{\"id\":\"c\",\"summary\":\"Cal\"}]}";
+    mockHttpReset();
+    mockHttpPush(200, list.c_str());
+    const size_t jsonAllocations = slow.allocations();
+    sched.setCalendar(String("Cal"));
+    CHECK(sched.isLinked());
+    CHECK(slow.allocations() > jsonAllocations);
+    CHECK(slow.peak() >= sizeof(EventTimeline) + list.size() / 2);
+
+    // 27b. The documents are gone on return; the stores stay where they were
+    //      built, and the transport never left internal RAM.
+    sched.setTimeline(timeline);
+    mockHttpReset();
+    mockHttpPush(200, "{\"items\":[{\"summary\":\"Heating\",\"start\":{\"dateTime\":\"2024-11-04T07:00:00Z\"},"
+                      "\"end\":{\"dateTime\":\"2024-11-04T09:00:00Z\"}}]}");
+    CHECK(sched.syncAt("2024-11-04T07:30:15Z"));
+    CHECK(timeline->size() == 1);
+    CHECK(slow.live() == sizeof(EventTimeline));
+    CHECK(fast.live() == sizeof(SchedularTransport));
+    CHECK(fast.allocations() == 1);
+    CHECK(fast.failures() == 0 && slow.failures() == 0);
+    sched.setTimeline(nullptr);
+
+    // 27c. A full tier refuses, and the call fails instead of spilling into
+    //      another one.
+    static SimulatedHeap<64> tiny;               // 512 bytes
+    SchedularTier full(tiny);
+    SchedularTiers::set(SchedularTiers::JSON, &full);
+    mockHttpReset();
+    mockHttpPush(200, list.c_str());
+    sched.setCalendar(String("Cal"));
+    CHECK(!sched.isLinked());
+    CHECK(full.failures() > 0);
+    CHECK(full.live() == 0);
+    CHECK(SchedularTiers::make<EventTimeline>(SchedularTiers::JSON) == nullptr);
+
+    // 27d. Destroyed in their tiers, which then go back to the heap.
+    SchedularTiers::destroy(SchedularTiers::EVENTS, timeline);
+    SchedularTiers::destroy(SchedularTiers::TRANSPORT, transport);
+    CHECK(slow.live() == 0 && fast.live() == 0);
+    CHECK(internalRam.heap.freeBytes() == internalFree);
+    SchedularTiers::set(SchedularTiers::JSON, nullptr);
+    SchedularTiers::set(SchedularTiers::EVENTS, nullptr);
+    SchedularTiers::set(SchedularTiers::TRANSPORT, nullptr);
+    CHECK(&SchedularTiers::of(SchedularTiers::JSON) == &SchedularHeap::instance());
+    mockHttpReset();
+}
+
+
 int main() {
     test_state_predicates();
     test_start_registration();
@@ -713,6 +2972,28 @@ int main() {
     test_malformed_body();
     test_is_valid_timestamp();
     test_auth_failure_cause();
+#ifdef SCHEDULAR_STATS
+    test_stats();
+#endif
+    test_allocation_budgets();
+    test_simulated_network();
+    test_shared_transport();
+    test_tls_profile();
+    test_deadline_schedular();
+    test_channel_matcher();
+    test_recurrence();
+    test_gzip();
+    test_calendar_cache();
+    test_event_filter();
+    test_event_timeline();
+    test_deep_sleep();
+    test_broadcast();
+#ifdef SCHEDULAR_TRACE
+    test_trace();
+#endif
+    test_paced_parsing();
+    test_json_arena();
+    test_memory_tiers();
 
     if (g_failures == 0) {
         std::printf("OK - all tests passed\n");